@@ -0,0 +1,50 @@
+// Jolt Physics Library (https://github.com/jrouwe/JoltPhysics)
+// SPDX-FileCopyrightText: 2024 Jorrit Rouwe
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <Jolt/Core/JobSystem.h>
+
+JPH_NAMESPACE_BEGIN
+
+/// Helper functions to process a range of items using multiple jobs.
+/// The items are split in batches of consecutive items, jobs keep taking the next batch until all batches have been processed.
+class JobBatches
+{
+public:
+	/// Get the number of batches of inBatchSize items needed for inNumItems
+	static uint				sGetNumBatches(uint inNumItems, uint inBatchSize)	{ return (inNumItems + inBatchSize - 1) / inBatchSize; }
+
+	/// Call inFunction(batch index, first item, end item) for all batches and wait until they have all completed.
+	/// When there is only a single batch, inFunction is called on the calling thread.
+	template <class Function>
+	static void				sRun(uint inNumItems, uint inBatchSize, const char *inName, JobSystem &inJobSystem, const Function &inFunction)
+	{
+		// Don't bother with jobs if there's only a single batch
+		uint num_batches = sGetNumBatches(inNumItems, inBatchSize);
+		if (num_batches <= 1)
+		{
+			if (num_batches == 1)
+				inFunction(0, 0, inNumItems);
+			return;
+		}
+
+		// Jobs take batches until all items have been processed
+		atomic<uint> next_batch = 0;
+		auto job = [inNumItems, inBatchSize, num_batches, &next_batch, &inFunction]()
+		{
+			for (uint b = next_batch.fetch_add(1, memory_order_relaxed); b < num_batches; b = next_batch.fetch_add(1, memory_order_relaxed))
+				inFunction(b, b * inBatchSize, min((b + 1) * inBatchSize, inNumItems));
+		};
+
+		uint num_jobs = min((uint)max(1, inJobSystem.GetMaxConcurrency()), num_batches);
+		JobSystem::Barrier *barrier = inJobSystem.CreateBarrier();
+		for (uint j = 0; j < num_jobs; ++j)
+			barrier->AddJob(inJobSystem.CreateJob(inName, Color::sGreen, job));
+		inJobSystem.WaitForJobs(barrier);
+		inJobSystem.DestroyBarrier(barrier);
+	}
+};
+
+JPH_NAMESPACE_END
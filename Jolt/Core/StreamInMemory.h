@@ -0,0 +1,66 @@
+// Jolt Physics Library (https://github.com/jrouwe/JoltPhysics)
+// SPDX-FileCopyrightText: 2024 Jorrit Rouwe
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <Jolt/Core/StreamIn.h>
+
+JPH_NAMESPACE_BEGIN
+
+/// Stream that reads from a block of memory without copying it, e.g. a file that was loaded or memory mapped by the application
+class StreamInMemory : public StreamIn
+{
+public:
+	/// Constructor, the memory needs to stay alive for as long as the stream is used
+						StreamInMemory(const void *inData, size_t inSize)			: mData(static_cast<const uint8 *>(inData)), mSize(inSize) { }
+
+	/// Read a string of bytes from the binary stream
+	virtual void		ReadBytes(void *outData, size_t inNumBytes) override
+	{
+		if (inNumBytes > mSize - mOffset)
+		{
+			// Reading past the end
+			mIsEOF = true;
+			mOffset = mSize;
+			return;
+		}
+
+		memcpy(outData, mData + mOffset, inNumBytes);
+		mOffset += inNumBytes;
+	}
+
+	/// Returns true when an attempt has been made to read past the end of the data
+	virtual bool		IsEOF() const override										{ return mIsEOF; }
+
+	/// Returns true if there was an IO failure (reading past the end is the only possible failure)
+	virtual bool		IsFailed() const override									{ return mIsEOF; }
+
+	/// Get a pointer to the next byte to read, this allows reading large blocks in place
+	const uint8 *		GetCurrent() const											{ return mData + mOffset; }
+
+	/// Get the number of bytes that haven't been read yet
+	size_t				GetNumBytesLeft() const										{ return mSize - mOffset; }
+
+	/// Skip inNumBytes bytes, returns false if there are not enough bytes left
+	bool				Skip(size_t inNumBytes)
+	{
+		if (inNumBytes > mSize - mOffset)
+		{
+			mIsEOF = true;
+			mOffset = mSize;
+			return false;
+		}
+
+		mOffset += inNumBytes;
+		return true;
+	}
+
+private:
+	const uint8 *		mData;
+	size_t				mSize;
+	size_t				mOffset = 0;
+	bool				mIsEOF = false;
+};
+
+JPH_NAMESPACE_END
@@ -32,6 +32,7 @@ set(JOLT_PHYSICS_SRC_FILES
 	${JOLT_PHYSICS_ROOT}/Core/InsertionSort.h
 	${JOLT_PHYSICS_ROOT}/Core/IssueReporting.cpp
 	${JOLT_PHYSICS_ROOT}/Core/IssueReporting.h
+	${JOLT_PHYSICS_ROOT}/Core/JobBatches.h
 	${JOLT_PHYSICS_ROOT}/Core/JobSystem.h
 	${JOLT_PHYSICS_ROOT}/Core/JobSystem.inl
 	${JOLT_PHYSICS_ROOT}/Core/JobSystemSingleThreaded.cpp
@@ -65,6 +66,7 @@ set(JOLT_PHYSICS_SRC_FILES
 	${JOLT_PHYSICS_ROOT}/Core/STLAllocator.h
 	${JOLT_PHYSICS_ROOT}/Core/STLTempAllocator.h
 	${JOLT_PHYSICS_ROOT}/Core/StreamIn.h
+	${JOLT_PHYSICS_ROOT}/Core/StreamInMemory.h
 	${JOLT_PHYSICS_ROOT}/Core/StreamOut.h
 	${JOLT_PHYSICS_ROOT}/Core/StreamUtils.h
 	${JOLT_PHYSICS_ROOT}/Core/StreamWrapper.h
@@ -175,12 +177,18 @@ set(JOLT_PHYSICS_SRC_FILES
 	${JOLT_PHYSICS_ROOT}/Physics/Character/CharacterBase.h
 	${JOLT_PHYSICS_ROOT}/Physics/Character/CharacterVirtual.cpp
 	${JOLT_PHYSICS_ROOT}/Physics/Character/CharacterVirtual.h
+	${JOLT_PHYSICS_ROOT}/Physics/Character/CharacterVirtualBatchUpdater.cpp
+	${JOLT_PHYSICS_ROOT}/Physics/Character/CharacterVirtualBatchUpdater.h
+	${JOLT_PHYSICS_ROOT}/Physics/Character/CharacterVsCharacterCollisionGrid.cpp
+	${JOLT_PHYSICS_ROOT}/Physics/Character/CharacterVsCharacterCollisionGrid.h
 	${JOLT_PHYSICS_ROOT}/Physics/Collision/AABoxCast.h
 	${JOLT_PHYSICS_ROOT}/Physics/Collision/ActiveEdgeMode.h
 	${JOLT_PHYSICS_ROOT}/Physics/Collision/ActiveEdges.h
 	${JOLT_PHYSICS_ROOT}/Physics/Collision/BackFaceMode.h
 	${JOLT_PHYSICS_ROOT}/Physics/Collision/BroadPhase/BroadPhase.cpp
 	${JOLT_PHYSICS_ROOT}/Physics/Collision/BroadPhase/BroadPhase.h
+	${JOLT_PHYSICS_ROOT}/Physics/Collision/BroadPhase/BroadPhaseBodyList.cpp
+	${JOLT_PHYSICS_ROOT}/Physics/Collision/BroadPhase/BroadPhaseBodyList.h
 	${JOLT_PHYSICS_ROOT}/Physics/Collision/BroadPhase/BroadPhaseBruteForce.cpp
 	${JOLT_PHYSICS_ROOT}/Physics/Collision/BroadPhase/BroadPhaseBruteForce.h
 	${JOLT_PHYSICS_ROOT}/Physics/Collision/BroadPhase/BroadPhaseLayer.h
@@ -189,10 +197,16 @@ set(JOLT_PHYSICS_SRC_FILES
 	${JOLT_PHYSICS_ROOT}/Physics/Collision/BroadPhase/BroadPhaseQuadTree.cpp
 	${JOLT_PHYSICS_ROOT}/Physics/Collision/BroadPhase/BroadPhaseQuadTree.h
 	${JOLT_PHYSICS_ROOT}/Physics/Collision/BroadPhase/BroadPhaseQuery.h
+	${JOLT_PHYSICS_ROOT}/Physics/Collision/BroadPhase/BroadPhaseSAP.cpp
+	${JOLT_PHYSICS_ROOT}/Physics/Collision/BroadPhase/BroadPhaseSAP.h
+	${JOLT_PHYSICS_ROOT}/Physics/Collision/BroadPhase/HashGrid.cpp
+	${JOLT_PHYSICS_ROOT}/Physics/Collision/BroadPhase/HashGrid.h
 	${JOLT_PHYSICS_ROOT}/Physics/Collision/BroadPhase/ObjectVsBroadPhaseLayerFilterMask.h
 	${JOLT_PHYSICS_ROOT}/Physics/Collision/BroadPhase/ObjectVsBroadPhaseLayerFilterTable.h
 	${JOLT_PHYSICS_ROOT}/Physics/Collision/BroadPhase/QuadTree.cpp
 	${JOLT_PHYSICS_ROOT}/Physics/Collision/BroadPhase/QuadTree.h
+	${JOLT_PHYSICS_ROOT}/Physics/Collision/BroadPhase/SweepAndPrune.cpp
+	${JOLT_PHYSICS_ROOT}/Physics/Collision/BroadPhase/SweepAndPrune.h
 	${JOLT_PHYSICS_ROOT}/Physics/Collision/CastConvexVsTriangles.cpp
 	${JOLT_PHYSICS_ROOT}/Physics/Collision/CastConvexVsTriangles.h
 	${JOLT_PHYSICS_ROOT}/Physics/Collision/CastResult.h
@@ -289,6 +303,8 @@ set(JOLT_PHYSICS_SRC_FILES
 	${JOLT_PHYSICS_ROOT}/Physics/Collision/SortReverseAndStore.h
 	${JOLT_PHYSICS_ROOT}/Physics/Collision/TransformedShape.cpp
 	${JOLT_PHYSICS_ROOT}/Physics/Collision/TransformedShape.h
+	${JOLT_PHYSICS_ROOT}/Physics/Constraints/ArticulationConstraint.cpp
+	${JOLT_PHYSICS_ROOT}/Physics/Constraints/ArticulationConstraint.h
 	${JOLT_PHYSICS_ROOT}/Physics/Constraints/CalculateSolverSteps.h
 	${JOLT_PHYSICS_ROOT}/Physics/Constraints/ConeConstraint.cpp
 	${JOLT_PHYSICS_ROOT}/Physics/Constraints/ConeConstraint.h
@@ -361,12 +377,16 @@ set(JOLT_PHYSICS_SRC_FILES
 	${JOLT_PHYSICS_ROOT}/Physics/PhysicsUpdateContext.h
 	${JOLT_PHYSICS_ROOT}/Physics/Ragdoll/Ragdoll.cpp
 	${JOLT_PHYSICS_ROOT}/Physics/Ragdoll/Ragdoll.h
+	${JOLT_PHYSICS_ROOT}/Physics/Ragdoll/RagdollBatchDriver.cpp
+	${JOLT_PHYSICS_ROOT}/Physics/Ragdoll/RagdollBatchDriver.h
 	${JOLT_PHYSICS_ROOT}/Physics/SoftBody/SoftBodyContactListener.h
 	${JOLT_PHYSICS_ROOT}/Physics/SoftBody/SoftBodyCreationSettings.cpp
 	${JOLT_PHYSICS_ROOT}/Physics/SoftBody/SoftBodyCreationSettings.h
 	${JOLT_PHYSICS_ROOT}/Physics/SoftBody/SoftBodyManifold.h
 	${JOLT_PHYSICS_ROOT}/Physics/SoftBody/SoftBodyMotionProperties.cpp
 	${JOLT_PHYSICS_ROOT}/Physics/SoftBody/SoftBodyMotionProperties.h
+	${JOLT_PHYSICS_ROOT}/Physics/SoftBody/SoftBodySelfCollision.cpp
+	${JOLT_PHYSICS_ROOT}/Physics/SoftBody/SoftBodySelfCollision.h
 	${JOLT_PHYSICS_ROOT}/Physics/SoftBody/SoftBodyShape.cpp
 	${JOLT_PHYSICS_ROOT}/Physics/SoftBody/SoftBodyShape.h
 	${JOLT_PHYSICS_ROOT}/Physics/SoftBody/SoftBodySharedSettings.cpp
@@ -374,8 +394,12 @@ set(JOLT_PHYSICS_SRC_FILES
 	${JOLT_PHYSICS_ROOT}/Physics/SoftBody/SoftBodyUpdateContext.h
 	${JOLT_PHYSICS_ROOT}/Physics/SoftBody/SoftBodyVertex.h
 	${JOLT_PHYSICS_ROOT}/Physics/StateRecorder.h
+	${JOLT_PHYSICS_ROOT}/Physics/StateRecorderBuffer.cpp
+	${JOLT_PHYSICS_ROOT}/Physics/StateRecorderBuffer.h
+	${JOLT_PHYSICS_ROOT}/Physics/StateRecorderDelta.h
 	${JOLT_PHYSICS_ROOT}/Physics/StateRecorderImpl.cpp
 	${JOLT_PHYSICS_ROOT}/Physics/StateRecorderImpl.h
+	${JOLT_PHYSICS_ROOT}/Physics/StateRecorderJobs.h
 	${JOLT_PHYSICS_ROOT}/Physics/Vehicle/MotorcycleController.cpp
 	${JOLT_PHYSICS_ROOT}/Physics/Vehicle/MotorcycleController.h
 	${JOLT_PHYSICS_ROOT}/Physics/Vehicle/TrackedVehicleController.cpp
@@ -412,6 +436,8 @@ set(JOLT_PHYSICS_SRC_FILES
 	${JOLT_PHYSICS_ROOT}/Renderer/DebugRendererSimple.h
 	${JOLT_PHYSICS_ROOT}/Skeleton/SkeletalAnimation.cpp
 	${JOLT_PHYSICS_ROOT}/Skeleton/SkeletalAnimation.h
+	${JOLT_PHYSICS_ROOT}/Skeleton/SkeletalAnimationSampler.cpp
+	${JOLT_PHYSICS_ROOT}/Skeleton/SkeletalAnimationSampler.h
 	${JOLT_PHYSICS_ROOT}/Skeleton/Skeleton.cpp
 	${JOLT_PHYSICS_ROOT}/Skeleton/Skeleton.h
 	${JOLT_PHYSICS_ROOT}/Skeleton/SkeletonMapper.cpp
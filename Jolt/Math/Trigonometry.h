@@ -64,6 +64,16 @@ JPH_INLINE float ACosApproximate(float inX)
 	return inX < 0? JPH_PI - val : val;
 }
 
+/// Vectorized version of ACosApproximate(float), calculates the approximation for 4 values at once and gives the same results
+JPH_INLINE Vec4 ACosApproximate(Vec4Arg inX)
+{
+	Vec4 abs_x = Vec4::sMin(inX.Abs(), Vec4::sReplicate(1.0f)); // Ensure that we don't get a value larger than 1
+	Vec4 val = (Vec4::sReplicate(1.0f) - abs_x).Sqrt() * (Vec4::sReplicate(JPH_PI / 2) - 0.175394f * abs_x);
+
+	// Our approximation is valid in the range [0, 1], extend it to the range [-1, 1]
+	return Vec4::sSelect(val, Vec4::sReplicate(JPH_PI) - val, Vec4::sLess(inX, Vec4::sZero()));
+}
+
 /// Arc tangent of x (returns value in the range [-PI / 2, PI / 2])
 JPH_INLINE float ATan(float inX)
 {
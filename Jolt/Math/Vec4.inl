@@ -2,9 +2,9 @@
 // SPDX-FileCopyrightText: 2021 Jorrit Rouwe
 // SPDX-License-Identifier: MIT
 
-#include <Jolt/Math/Trigonometry.h>
 #include <Jolt/Math/Vec3.h>
 #include <Jolt/Math/UVec4.h>
+#include <Jolt/Math/Trigonometry.h>
 
 JPH_NAMESPACE_BEGIN
 
@@ -285,6 +285,9 @@ bool Body::ApplyBuoyancyImpulse(RVec3Arg inSurfacePosition, Vec3Arg inSurfaceNor
 
 void Body::SaveState(StateRecorder &inStream) const
 {
+	// The cSaveState* offsets describe the data written below, they need to be updated when this changes
+	static_assert(sizeof(mRotation) == sizeof(Quat));
+
 	// Only write properties that can change at runtime
 	inStream.Write(mPosition);
 	inStream.Write(mRotation);
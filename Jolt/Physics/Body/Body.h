@@ -343,6 +343,10 @@ public:
 	/// Restoring state for replay
 	void					RestoreState(StateRecorder &inStream);
 
+	/// Offsets in the data written by SaveState, the data of the motion properties (if any) follows the rotation
+	static constexpr uint	cSaveStateRotationOffset = 3 * sizeof(Real);
+	static constexpr uint	cSaveStateMotionPropertiesOffset = cSaveStateRotationOffset + sizeof(Quat);
+
 	///@}
 
 	static constexpr uint32	cInactiveIndex = MotionProperties::cInactiveIndex;				///< Constant indicating that body is not active
@@ -13,6 +13,8 @@
 #include <Jolt/Physics/SoftBody/SoftBodyCreationSettings.h>
 #include <Jolt/Physics/SoftBody/SoftBodyShape.h>
 #include <Jolt/Physics/StateRecorder.h>
+#include <Jolt/Physics/StateRecorderDelta.h>
+#include <Jolt/Physics/StateRecorderJobs.h>
 #include <Jolt/Core/StringTools.h>
 #include <Jolt/Core/QuickSort.h>
 #ifdef JPH_DEBUG_RENDERER
@@ -751,7 +753,7 @@ void BodyManager::UnlockAllBodies() const
 	mBodyMutexes.UnlockAll();
 }
 
-void BodyManager::SaveState(StateRecorder &inStream, const StateRecorderFilter *inFilter) const
+void BodyManager::SaveState(StateRecorder &inStream, const StateRecorderFilter *inFilter, JobSystem *inJobSystem) const
 {
 	{
 		LockAllBodies();
@@ -766,17 +768,55 @@ void BodyManager::SaveState(StateRecorder &inStream, const StateRecorderFilter *
 		// Write state of bodies
 		uint32 num_bodies = (uint32)bodies.size();
 		inStream.Write(num_bodies);
-		for (const Body *b : bodies)
+		auto save_bodies = [&bodies](StateRecorder &ioStream, uint inBegin, uint inEnd)
 		{
-			inStream.Write(b->GetID());
-			inStream.Write(b->IsActive());
-			b->SaveState(inStream);
+			for (uint i = inBegin; i < inEnd; ++i)
+			{
+				const Body *b = bodies[i];
+				ioStream.Write(b->GetID());
+				ioStream.Write(b->IsActive());
+				b->SaveState(ioStream);
+			}
+		};
+		if (inJobSystem != nullptr && num_bodies > StateRecorderJobs::cBatchSize)
+		{
+			// Save batches of bodies in parallel and then concatenate them, the batch buffers keep their memory between saves
+			uint num_batches = StateRecorderJobs::sGetNumBatches(num_bodies);
+			if (mSaveStateBatches.size() < num_batches)
+				mSaveStateBatches.resize(num_batches);
+			JobBatches::sRun(num_bodies, StateRecorderJobs::cBatchSize, "SaveBodyState", *inJobSystem, [this, &save_bodies](uint inBatch, uint inBegin, uint inEnd)
+			{
+				StateRecorderBuffer &batch = mSaveStateBatches[inBatch];
+				batch.Clear();
+				save_bodies(batch, inBegin, inEnd);
+			});
+			for (uint b = 0; b < num_batches; ++b)
+				inStream.WriteBytes(mSaveStateBatches[b].GetData(), mSaveStateBatches[b].GetDataSize());
 		}
+		else
+			save_bodies(inStream, 0, num_bodies);
 
 		UnlockAllBodies();
 	}
 }
 
+void BodyManager::ApplyRestoredActivation(const BodyIDVector &inBodiesToActivate, const BodyIDVector &inBodiesToDeactivate)
+{
+	UniqueLock lock(mActiveBodiesMutex JPH_IF_ENABLE_ASSERTS(, this, EPhysicsLockTypes::ActiveBodiesList));
+
+	for (BodyID body_id : inBodiesToActivate)
+	{
+		Body *body = TryGetBody(body_id);
+		AddBodyToActiveBodies(*body);
+	}
+
+	for (BodyID body_id : inBodiesToDeactivate)
+	{
+		Body *body = TryGetBody(body_id);
+		RemoveBodyFromActiveBodies(*body);
+	}
+}
+
 bool BodyManager::RestoreState(StateRecorder &inStream)
 {
 	BodyIDVector bodies_to_activate, bodies_to_deactivate;
@@ -857,22 +897,115 @@ bool BodyManager::RestoreState(StateRecorder &inStream)
 		UnlockAllBodies();
 	}
 
+	ApplyRestoredActivation(bodies_to_activate, bodies_to_deactivate);
+
+	return true;
+}
+
+bool BodyManager::RestoreState(StateRecorderBuffer &inStream, JobSystem &inJobSystem)
+{
+	// Validation needs to read the bodies in the order in which they are stored in the system, do it single threaded
+	if (inStream.IsValidating())
+		return RestoreState(static_cast<StateRecorder &>(inStream));
+
+	BodyIDVector bodies_to_activate, bodies_to_deactivate;
+
 	{
-		UniqueLock lock(mActiveBodiesMutex JPH_IF_ENABLE_ASSERTS(, this, EPhysicsLockTypes::ActiveBodiesList));
+		LockAllBodies();
 
-		for (BodyID body_id : bodies_to_activate)
+		// Read number of bodies
+		uint32 num_bodies = 0;
+		inStream.Read(num_bodies);
+
+		// Find where each batch of bodies starts in the stream.
+		// All rigid bodies with or without motion properties store the same amount of data, so we only need to determine the size once.
+		const uint8 *data = inStream.GetData();
+		size_t offset = inStream.GetReadOffset(), data_size = inStream.GetDataSize();
+		uint num_batches = StateRecorderJobs::sGetNumBatches(num_bodies);
+		Array<size_t> batch_offsets;
+		batch_offsets.reserve(num_batches + 1);
+		size_t rigid_body_size[] = { 0, 0 };
+		StateRecorderBuffer body_data;
+		for (uint32 idx = 0; idx < num_bodies; ++idx)
 		{
-			Body *body = TryGetBody(body_id);
-			AddBodyToActiveBodies(*body);
-		}
+			if (idx % StateRecorderJobs::cBatchSize == 0)
+				batch_offsets.push_back(offset);
+
+			// Get the body
+			BodyID body_id;
+			const Body *b = nullptr;
+			if (offset + sizeof(BodyID) <= data_size)
+			{
+				memcpy(&body_id, data + offset, sizeof(BodyID));
+				b = TryGetBody(body_id);
+			}
+			if (b == nullptr)
+			{
+				JPH_ASSERT(false, "Restoring state for non-existing body");
+				UnlockAllBodies();
+				return false;
+			}
 
-		for (BodyID body_id : bodies_to_deactivate)
+			// Determine the size of its state
+			size_t size;
+			if (b->IsRigidBody() && rigid_body_size[b->mMotionProperties != nullptr] != 0)
+				size = rigid_body_size[b->mMotionProperties != nullptr];
+			else
+			{
+				body_data.Clear();
+				b->SaveState(body_data);
+				size = body_data.GetDataSize();
+				if (b->IsRigidBody())
+					rigid_body_size[b->mMotionProperties != nullptr] = size;
+			}
+			offset += sizeof(BodyID) + sizeof(bool) + size;
+		}
+		batch_offsets.push_back(offset);
+		if (offset > data_size)
 		{
-			Body *body = TryGetBody(body_id);
-			RemoveBodyFromActiveBodies(*body);
+			JPH_ASSERT(false, "Not enough data");
+			UnlockAllBodies();
+			return false;
 		}
+
+		// Restore batches of bodies in parallel
+		Array<BodyIDVector> batch_to_activate(num_batches), batch_to_deactivate(num_batches);
+		JobBatches::sRun(num_bodies, StateRecorderJobs::cBatchSize, "RestoreBodyState", inJobSystem, [this, data, &batch_offsets, &batch_to_activate, &batch_to_deactivate](uint inBatch, uint inBegin, uint inEnd)
+		{
+			size_t batch_size = batch_offsets[inBatch + 1] - batch_offsets[inBatch];
+			StateRecorderBuffer batch(const_cast<uint8 *>(data + batch_offsets[inBatch]), batch_size);
+			batch.SetDataSize(batch_size);
+
+			for (uint i = inBegin; i < inEnd; ++i)
+			{
+				BodyID body_id;
+				batch.Read(body_id);
+				Body *b = TryGetBody(body_id);
+				bool is_active;
+				batch.Read(is_active);
+				if (is_active != b->IsActive())
+				{
+					if (is_active)
+						batch_to_activate[inBatch].push_back(body_id);
+					else
+						batch_to_deactivate[inBatch].push_back(body_id);
+				}
+				b->RestoreState(batch);
+			}
+		});
+		inStream.SkipBytes(offset - inStream.GetReadOffset());
+
+		// Merge the bodies to activate in the same order as a single threaded restore would
+		for (const BodyIDVector &batch : batch_to_activate)
+			bodies_to_activate.insert(bodies_to_activate.end(), batch.begin(), batch.end());
+		for (const BodyIDVector &batch : batch_to_deactivate)
+			bodies_to_deactivate.insert(bodies_to_deactivate.end(), batch.begin(), batch.end());
+
+		UnlockAllBodies();
 	}
 
+	ApplyRestoredActivation(bodies_to_activate, bodies_to_deactivate);
+
 	return true;
 }
 
@@ -903,6 +1036,312 @@ void BodyManager::RestoreBodyState(Body &ioBody, StateRecorder &inStream)
 	}
 }
 
+// Layout of the data written by Body::SaveState for a rigid body with motion properties, used to store changes with limited precision
+static constexpr uint cBodyStateRotationOffset = Body::cSaveStateRotationOffset;
+static constexpr uint cBodyStateLinearVelocityOffset = Body::cSaveStateMotionPropertiesOffset + MotionProperties::cSaveStateLinearVelocityOffset;
+static constexpr uint cBodyStateAngularVelocityOffset = Body::cSaveStateMotionPropertiesOffset + MotionProperties::cSaveStateAngularVelocityOffset;
+static constexpr uint cBodyStateForceOffset = Body::cSaveStateMotionPropertiesOffset + MotionProperties::cSaveStateForceOffset;
+static constexpr uint cBodyStateSleepTestOffset = Body::cSaveStateMotionPropertiesOffset + MotionProperties::cSaveStateSleepTestOffset;
+static constexpr uint cBodyStateAllowSleepingOffset = Body::cSaveStateMotionPropertiesOffset + MotionProperties::cSaveStateAllowSleepingOffset;
+static constexpr uint cBodyStateSize = Body::cSaveStateMotionPropertiesOffset + MotionProperties::cSaveStateSize;
+
+/// Flags that describe what is stored for a body in a delta state
+enum class EBodyDeltaFlags : uint8
+{
+	IsActive		= 1 << 0,				///< Body is active
+	Full			= 1 << 1,				///< Data written by Body::SaveState follows
+	Position		= 1 << 2,				///< Quantized change in position follows
+	Rotation		= 1 << 3,				///< Quantized rotation follows
+	LinearVelocity	= 1 << 4,				///< Quantized change in linear velocity follows
+	AngularVelocity	= 1 << 5,				///< Quantized change in angular velocity follows
+};
+
+/// Quantize a change in value, returns false if it doesn't fit in 16 bits
+static bool sQuantizeDelta(Vec3Arg inDelta, float inPrecision, int16_t outQuantized[3])
+{
+	JPH_ASSERT(inPrecision > 0.0f);
+
+	for (int i = 0; i < 3; ++i)
+	{
+		float q = round(inDelta[i] / inPrecision);
+		if (abs(q) > 32767.0f)
+			return false;
+		outQuantized[i] = int16_t(q);
+	}
+	return true;
+}
+
+/// Convert a quantized change back to a vector
+static Vec3 sDequantizeDelta(const int16_t inQuantized[3], float inPrecision)
+{
+	return inPrecision * Vec3(float(inQuantized[0]), float(inQuantized[1]), float(inQuantized[2]));
+}
+
+/// Quantize a rotation by storing the X, Y and Z components of the quaternion with positive W
+static void sQuantizeRotation(QuatArg inRotation, int16_t outQuantized[3])
+{
+	Vec3 xyz = inRotation.GetW() < 0.0f? -inRotation.GetXYZ() : inRotation.GetXYZ();
+	for (int i = 0; i < 3; ++i)
+		outQuantized[i] = int16_t(round(Clamp(xyz[i], -1.0f, 1.0f) * 32767.0f));
+}
+
+/// Convert a quantized rotation back to a quaternion
+static Quat sDequantizeRotation(const int16_t inQuantized[3])
+{
+	Vec3 xyz = Vec3(float(inQuantized[0]), float(inQuantized[1]), float(inQuantized[2])) / 32767.0f;
+	float w = sqrt(max(0.0f, 1.0f - xyz.LengthSq()));
+	return Quat(Vec4(xyz, w)).Normalized();
+}
+
+void BodyManager::SaveStateReference(DeltaStateReference &ioReference) const
+{
+	ioReference.mBodies.clear();
+	ioReference.mBodyData.Clear();
+
+	{
+		LockAllBodies();
+
+		// Write the state of all bodies and remember where it is stored
+		for (const Body *b : mBodies)
+			if (sIsValidBodyPointer(b) && b->IsInBroadPhase())
+			{
+				uint32 offset = uint32(ioReference.mBodyData.GetDataSize());
+				b->SaveState(ioReference.mBodyData);
+				ioReference.mBodies.push_back({ b->GetID(), offset, uint32(ioReference.mBodyData.GetDataSize()) - offset, b->IsActive() });
+			}
+
+		UnlockAllBodies();
+	}
+}
+
+void BodyManager::SaveStateDelta(StateRecorder &inStream, const DeltaStateReference &inReference, const DeltaStateSettings &inSettings) const
+{
+	// A precision of zero cannot be quantized, store the changes exactly in that case
+	bool quantize = inSettings.mQuantize && inSettings.mPositionPrecision > 0.0f && inSettings.mVelocityPrecision > 0.0f;
+
+	// Write the settings that are needed to decode the bodies
+	inStream.Write(quantize);
+	inStream.Write(inSettings.mPositionPrecision);
+	inStream.Write(inSettings.mVelocityPrecision);
+
+	{
+		LockAllBodies();
+
+		// Buffer for the state of a single body, this is reused between calls so that we don't allocate
+		StateRecorderBuffer &body_data = inReference.mScratch;
+
+		const DeltaStateReference::BodyState *reference = inReference.mBodies.data(), *reference_end = reference + inReference.mBodies.size();
+		for (const Body *b : mBodies)
+			if (sIsValidBodyPointer(b) && b->IsInBroadPhase())
+			{
+				// Find the body in the reference, both are sorted by body index
+				BodyID body_id = b->GetID();
+				while (reference < reference_end && reference->mID.GetIndex() < body_id.GetIndex())
+					++reference;
+				const DeltaStateReference::BodyState *body_reference = reference < reference_end && reference->mID == body_id? reference : nullptr;
+
+				// Get the current state
+				body_data.Clear();
+				b->SaveState(body_data);
+				const uint8 *data = body_data.GetData();
+				size_t data_size = body_data.GetDataSize();
+
+				bool is_active = b->IsActive();
+				uint8 flags = is_active? uint8(EBodyDeltaFlags::IsActive) : 0;
+				int16_t position[3], rotation[3], linear_velocity[3], angular_velocity[3];
+				if (body_reference == nullptr || body_reference->mIsActive != is_active || body_reference->mSize != data_size)
+				{
+					// Body is new or changed activation state, store it fully
+					flags |= uint8(EBodyDeltaFlags::Full);
+				}
+				else
+				{
+					const uint8 *reference_data = inReference.mBodyData.GetData() + body_reference->mOffset;
+					if (!quantize)
+					{
+						// Only store the body when it changed, the contacts and constraints are compared against the reference separately
+						if (memcmp(data, reference_data, data_size) == 0)
+							continue;
+						flags |= uint8(EBodyDeltaFlags::Full);
+					}
+					else if (!b->IsRigidBody()
+						|| b->mMotionProperties == nullptr
+						|| memcmp(data + cBodyStateForceOffset, reference_data + cBodyStateForceOffset, cBodyStateSleepTestOffset - cBodyStateForceOffset) != 0
+						|| data[cBodyStateAllowSleepingOffset] != reference_data[cBodyStateAllowSleepingOffset])
+					{
+						// Only position, rotation and velocity can be quantized, the sleep test state is taken from the reference.
+						// If anything else changed, store the body fully.
+						if (memcmp(data, reference_data, data_size) == 0)
+							continue;
+						flags |= uint8(EBodyDeltaFlags::Full);
+					}
+					else
+					{
+						JPH_ASSERT(data_size == cBodyStateSize);
+
+						// Get the reference values
+						Real reference_position[3];
+						memcpy(reference_position, reference_data, sizeof(reference_position));
+						Quat reference_rotation;
+						memcpy(&reference_rotation, reference_data + cBodyStateRotationOffset, sizeof(Quat));
+						Float3 reference_linear_velocity, reference_angular_velocity;
+						memcpy(&reference_linear_velocity, reference_data + cBodyStateLinearVelocityOffset, sizeof(Float3));
+						memcpy(&reference_angular_velocity, reference_data + cBodyStateAngularVelocityOffset, sizeof(Float3));
+
+						// Quantize the changes
+						const MotionProperties *mp = b->mMotionProperties;
+						int16_t reference_quantized_rotation[3];
+						sQuantizeRotation(b->mRotation, rotation);
+						sQuantizeRotation(reference_rotation, reference_quantized_rotation);
+						if (!sQuantizeDelta(Vec3(b->mPosition - RVec3(reference_position[0], reference_position[1], reference_position[2])), inSettings.mPositionPrecision, position)
+							|| !sQuantizeDelta(mp->mLinearVelocity - Vec3(reference_linear_velocity), inSettings.mVelocityPrecision, linear_velocity)
+							|| !sQuantizeDelta(mp->mAngularVelocity - Vec3(reference_angular_velocity), inSettings.mVelocityPrecision, angular_velocity))
+						{
+							// Change too big
+							flags |= uint8(EBodyDeltaFlags::Full);
+						}
+						else
+						{
+							// Only store the values that changed
+							auto is_zero = [](const int16_t inQuantized[3]) { return inQuantized[0] == 0 && inQuantized[1] == 0 && inQuantized[2] == 0; };
+							if (!is_zero(position))
+								flags |= uint8(EBodyDeltaFlags::Position);
+							if (memcmp(rotation, reference_quantized_rotation, sizeof(rotation)) != 0)
+								flags |= uint8(EBodyDeltaFlags::Rotation);
+							if (!is_zero(linear_velocity))
+								flags |= uint8(EBodyDeltaFlags::LinearVelocity);
+							if (!is_zero(angular_velocity))
+								flags |= uint8(EBodyDeltaFlags::AngularVelocity);
+
+							// Skip the body if nothing changed
+							if (flags == (is_active? uint8(EBodyDeltaFlags::IsActive) : 0))
+								continue;
+						}
+					}
+				}
+
+				// Write the body
+				inStream.Write(body_id);
+				inStream.Write(flags);
+				if (flags & uint8(EBodyDeltaFlags::Full))
+					inStream.WriteBytes(data, data_size);
+				else
+				{
+					if (flags & uint8(EBodyDeltaFlags::Position))
+						inStream.Write(position);
+					if (flags & uint8(EBodyDeltaFlags::Rotation))
+						inStream.Write(rotation);
+					if (flags & uint8(EBodyDeltaFlags::LinearVelocity))
+						inStream.Write(linear_velocity);
+					if (flags & uint8(EBodyDeltaFlags::AngularVelocity))
+						inStream.Write(angular_velocity);
+				}
+			}
+
+		UnlockAllBodies();
+	}
+
+	// We don't know up front how many bodies changed, so the list is terminated with an invalid body ID
+	inStream.Write(BodyID());
+}
+
+bool BodyManager::RestoreStateDelta(StateRecorder &inStream)
+{
+	JPH_ASSERT(!inStream.IsValidating(), "Validation is not supported for delta states");
+
+	// Read the settings
+	bool quantize = false;
+	float position_precision = 0.0f, velocity_precision = 0.0f;
+	inStream.Read(quantize);
+	inStream.Read(position_precision);
+	inStream.Read(velocity_precision);
+
+	BodyIDVector bodies_to_activate, bodies_to_deactivate;
+
+	{
+		LockAllBodies();
+
+		// Read bodies until we reach the invalid body ID that terminates the list
+		for (;;)
+		{
+			BodyID body_id;
+			inStream.Read(body_id);
+			if (inStream.IsEOF())
+			{
+				JPH_ASSERT(false, "Not enough data");
+				UnlockAllBodies();
+				return false;
+			}
+			if (body_id.IsInvalid())
+				break;
+			uint8 flags = 0;
+			inStream.Read(flags);
+			Body *b = TryGetBody(body_id);
+			if (b == nullptr)
+			{
+				JPH_ASSERT(false, "Restoring state for non-existing body");
+				UnlockAllBodies();
+				return false;
+			}
+
+			if (flags & uint8(EBodyDeltaFlags::Full))
+			{
+				// Body was stored fully
+				b->RestoreState(inStream);
+			}
+			else
+			{
+				// Apply the quantized changes to the reference state
+				MotionProperties *mp = b->mMotionProperties;
+				if (!quantize || !b->IsRigidBody() || mp == nullptr)
+				{
+					JPH_ASSERT(false, "Body doesn't match the delta state");
+					UnlockAllBodies();
+					return false;
+				}
+				int16_t quantized[3];
+				if (flags & uint8(EBodyDeltaFlags::Position))
+				{
+					inStream.Read(quantized);
+					b->mPosition += sDequantizeDelta(quantized, position_precision);
+				}
+				if (flags & uint8(EBodyDeltaFlags::Rotation))
+				{
+					inStream.Read(quantized);
+					b->mRotation = sDequantizeRotation(quantized);
+				}
+				if (flags & uint8(EBodyDeltaFlags::LinearVelocity))
+				{
+					inStream.Read(quantized);
+					mp->mLinearVelocity += sDequantizeDelta(quantized, velocity_precision);
+				}
+				if (flags & uint8(EBodyDeltaFlags::AngularVelocity))
+				{
+					inStream.Read(quantized);
+					mp->mAngularVelocity += sDequantizeDelta(quantized, velocity_precision);
+				}
+				b->CalculateWorldSpaceBoundsInternal();
+			}
+
+			// Check if the activation state changed
+			bool is_active = (flags & uint8(EBodyDeltaFlags::IsActive)) != 0;
+			if (is_active != b->IsActive())
+			{
+				if (is_active)
+					bodies_to_activate.push_back(body_id);
+				else
+					bodies_to_deactivate.push_back(body_id);
+			}
+		}
+
+		UnlockAllBodies();
+	}
+
+	ApplyRestoredActivation(bodies_to_activate, bodies_to_deactivate);
+
+	return true;
+}
+
 #ifdef JPH_DEBUG_RENDERER
 void BodyManager::Draw(const DrawSettings &inDrawSettings, const PhysicsSettings &inPhysicsSettings, DebugRenderer *inRenderer, const BodyDrawFilter *inBodyFilter)
 {
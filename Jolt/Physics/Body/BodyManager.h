@@ -5,6 +5,7 @@
 #pragma once
 
 #include <Jolt/Physics/Body/Body.h>
+#include <Jolt/Physics/StateRecorderBuffer.h>
 #include <Jolt/Core/Mutex.h>
 #include <Jolt/Core/MutexArray.h>
 
@@ -15,6 +16,9 @@ class BodyCreationSettings;
 class SoftBodyCreationSettings;
 class BodyActivationListener;
 class StateRecorderFilter;
+class DeltaStateReference;
+class JobSystem;
+class DeltaStateSettings;
 struct PhysicsSettings;
 #ifdef JPH_DEBUG_RENDERER
 class DebugRenderer;
@@ -203,18 +207,30 @@ public:
 	/// Reset the Body::EFlags::InvalidateContactCache flag for all bodies. All contact pairs in the contact cache will now by valid again.
 	void							ValidateContactCacheForAllBodies();
 
-	/// Saving state for replay
-	void							SaveState(StateRecorder &inStream, const StateRecorderFilter *inFilter) const;
+	/// Saving state for replay. When inJobSystem is not null, the bodies are saved in parallel (this gives the same data).
+	void							SaveState(StateRecorder &inStream, const StateRecorderFilter *inFilter, JobSystem *inJobSystem = nullptr) const;
 
 	/// Restoring state for replay. Returns false if failed.
 	bool							RestoreState(StateRecorder &inStream);
 
+	/// Restoring state for replay, the bodies are restored in parallel using inJobSystem. Returns false if failed.
+	bool							RestoreState(StateRecorderBuffer &inStream, JobSystem &inJobSystem);
+
 	/// Save the state of a single body for replay
 	void							SaveBodyState(const Body &inBody, StateRecorder &inStream) const;
 
 	/// Save the state of a single body for replay
 	void							RestoreBodyState(Body &inBody, StateRecorder &inStream);
 
+	/// Save the state of all bodies in ioReference so that SaveStateDelta can determine which bodies changed
+	void							SaveStateReference(DeltaStateReference &ioReference) const;
+
+	/// Save the state of the bodies that changed with respect to inReference
+	void							SaveStateDelta(StateRecorder &inStream, const DeltaStateReference &inReference, const DeltaStateSettings &inSettings) const;
+
+	/// Restore the state of the bodies saved by SaveStateDelta, the bodies must have been restored to the reference state first. Returns false if failed.
+	bool							RestoreStateDelta(StateRecorder &inStream);
+
 #ifdef JPH_DEBUG_RENDERER
 	enum class EShapeColor
 	{
@@ -299,6 +315,9 @@ private:
 	/// Remove a single body from mActiveBodies, note doesn't lock the active body mutex!
 	inline void						RemoveBodyFromActiveBodies(Body &ioBody);
 
+	/// Activate / deactivate the bodies whose activation state changed while restoring state, locks the active body mutex
+	void							ApplyRestoredActivation(const BodyIDVector &inBodiesToActivate, const BodyIDVector &inBodiesToDeactivate);
+
 	/// Helper function to remove a body from the manager
 	JPH_INLINE Body *				RemoveBodyInternal(const BodyID &inBodyID);
 
@@ -359,6 +378,9 @@ private:
 	/// Listener that is notified whenever a body is activated/deactivated
 	BodyActivationListener *		mActivationListener = nullptr;
 
+	/// Buffers that batches of bodies are saved to when saving the state in parallel, kept to avoid allocating on every save (protected by locking all bodies)
+	mutable Array<StateRecorderBuffer> mSaveStateBatches;
+
 	/// Cached broadphase layer interface
 	const BroadPhaseLayerInterface *mBroadPhaseLayerInterface = nullptr;
 
@@ -62,6 +62,10 @@ void MotionProperties::SetMassProperties(EAllowedDOFs inAllowedDOFs, const MassP
 
 void MotionProperties::SaveState(StateRecorder &inStream) const
 {
+	// The cSaveState* offsets describe the data written below, they need to be updated when this changes
+	static_assert(sizeof(mForce) == sizeof(Float3) && sizeof(mTorque) == sizeof(Float3));
+	static_assert(sizeof(mSleepTestSpheres) == 3 * sizeof(Sphere) && sizeof(mSleepTestTimer) == sizeof(float) && sizeof(mAllowSleeping) == sizeof(bool));
+
 	// Only write properties that can change at runtime
 	inStream.Write(mLinearVelocity);
 	inStream.Write(mAngularVelocity);
@@ -226,6 +226,14 @@ public:
 	/// Restoring state for replay
 	void					RestoreState(StateRecorder &inStream);
 
+	/// Offsets of the members in the data written by SaveState, these allow comparing saved states without restoring them (see PhysicsSystem::SaveStateDelta)
+	static constexpr uint	cSaveStateLinearVelocityOffset = 0;
+	static constexpr uint	cSaveStateAngularVelocityOffset = cSaveStateLinearVelocityOffset + sizeof(Float3);
+	static constexpr uint	cSaveStateForceOffset = cSaveStateAngularVelocityOffset + sizeof(Float3);
+	static constexpr uint	cSaveStateSleepTestOffset = cSaveStateForceOffset + 2 * sizeof(Float3);
+	static constexpr uint	cSaveStateAllowSleepingOffset = cSaveStateSleepTestOffset + JPH_IF_DOUBLE_PRECISION(sizeof(Double3) +) 3 * sizeof(Sphere) + sizeof(float);
+	static constexpr uint	cSaveStateSize = cSaveStateAllowSleepingOffset + sizeof(bool);
+
 	static constexpr uint32	cInactiveIndex = uint32(-1);									///< Constant indicating that body is not active
 
 private:
@@ -105,6 +105,8 @@ CharacterVirtual::CharacterVirtual(const CharacterVirtualSettings *inSettings, R
 	// Copy settings
 	SetMaxStrength(inSettings->mMaxStrength);
 	SetMass(inSettings->mMass);
+	mUseContactCache = inSettings->mUseContactCache;
+	mContactCacheMargin = inSettings->mContactCacheMargin;
 
 	// Create an inner rigid body if requested
 	if (inSettings->mInnerBodyShape != nullptr)
@@ -129,6 +131,19 @@ void CharacterVirtual::UpdateInnerBodyTransform()
 {
 	if (!mInnerBodyID.IsInvalid())
 		mSystem->GetBodyInterface().SetPositionAndRotation(mInnerBodyID, GetInnerBodyPosition(), mRotation, EActivation::DontActivate);
+
+	if (mCharacterVsCharacterCollision != nullptr)
+		mCharacterVsCharacterCollision->OnCharacterMoved(this);
+}
+
+const BroadPhaseQuery &CharacterVirtual::GetBroadPhaseQuery() const
+{
+	return mBroadPhaseQuery != nullptr? *mBroadPhaseQuery : mSystem->GetBroadPhaseQuery();
+}
+
+const NarrowPhaseQuery &CharacterVirtual::GetNarrowPhaseQuery() const
+{
+	return mNarrowPhaseQuery != nullptr? *mNarrowPhaseQuery : mSystem->GetNarrowPhaseQuery();
 }
 
 void CharacterVirtual::GetAdjustedBodyVelocity(const Body& inBody, Vec3 &outLinearVelocity, Vec3 &outAngularVelocity) const
@@ -336,27 +351,30 @@ void CharacterVirtual::ContactCastCollector::AddHit(const ShapeCastResult &inRes
 	}
 }
 
-void CharacterVirtual::CheckCollision(RVec3Arg inPosition, QuatArg inRotation, Vec3Arg inMovementDirection, float inMaxSeparationDistance, const Shape *inShape, RVec3Arg inBaseOffset, CollideShapeCollector &ioCollector, const BroadPhaseLayerFilter &inBroadPhaseLayerFilter, const ObjectLayerFilter &inObjectLayerFilter, const BodyFilter &inBodyFilter, const ShapeFilter &inShapeFilter) const
+CollideShapeSettings CharacterVirtual::GetCollideShapeSettings(Vec3Arg inMovementDirection, float inMaxSeparationDistance) const
 {
-	// Query shape transform
-	RMat44 transform = GetCenterOfMassTransform(inPosition, inRotation, inShape);
-
-	// Settings for collide shape
 	CollideShapeSettings settings;
 	settings.mBackFaceMode = mBackFaceMode;
 	settings.mActiveEdgeMovementDirection = inMovementDirection;
 	settings.mMaxSeparationDistance = mCharacterPadding + inMaxSeparationDistance;
-
-	// Body filter
-	IgnoreSingleBodyFilterChained body_filter(mInnerBodyID, inBodyFilter);
-
-	// Collide shape
 	if (mEnhancedInternalEdgeRemoval)
 	{
-		// Version that does additional work to remove internal edges
+		// Collide with all edges and collect faces, the internal edges will be removed by an InternalEdgeRemovingCollector
 		settings.mActiveEdgeMode = EActiveEdgeMode::CollideWithAll;
 		settings.mCollectFacesMode = ECollectFacesMode::CollectFaces;
+	}
+	else
+	{
+		// Use the cached active edges
+		settings.mActiveEdgeMode = EActiveEdgeMode::CollideOnlyWithActive;
+	}
+	return settings;
+}
 
+void CharacterVirtual::CollideWithBodies(RMat44Arg inCenterOfMassTransform, const Shape *inShape, const CollideShapeSettings &inSettings, RVec3Arg inBaseOffset, CollideShapeCollector &ioCollector, const BroadPhaseLayerFilter &inBroadPhaseLayerFilter, const ObjectLayerFilter &inObjectLayerFilter, const BodyFilter &inBodyFilter, const ShapeFilter &inShapeFilter) const
+{
+	if (mEnhancedInternalEdgeRemoval)
+	{
 		// This is a copy of NarrowPhaseQuery::CollideShape with additional logic to wrap the collector in an InternalEdgeRemovingCollector and flushing that collector after every body
 		class MyCollector : public CollideShapeBodyCollector
 		{
@@ -410,27 +428,158 @@ void CharacterVirtual::CheckCollision(RVec3Arg inPosition, QuatArg inRotation, V
 		};
 
 		// Calculate bounds for shape and expand by max separation distance
-		AABox bounds = inShape->GetWorldSpaceBounds(transform, Vec3::sReplicate(1.0f));
-		bounds.ExpandBy(Vec3::sReplicate(settings.mMaxSeparationDistance));
+		AABox bounds = inShape->GetWorldSpaceBounds(inCenterOfMassTransform, Vec3::sReplicate(1.0f));
+		bounds.ExpandBy(Vec3::sReplicate(inSettings.mMaxSeparationDistance));
 
 		// Do broadphase test
-		MyCollector collector(inShape, transform, settings, inBaseOffset, ioCollector, mSystem->GetBodyLockInterface(), body_filter, inShapeFilter);
-		mSystem->GetBroadPhaseQuery().CollideAABox(bounds, collector, inBroadPhaseLayerFilter, inObjectLayerFilter);
+		MyCollector collector(inShape, inCenterOfMassTransform, inSettings, inBaseOffset, ioCollector, mSystem->GetBodyLockInterface(), inBodyFilter, inShapeFilter);
+		GetBroadPhaseQuery().CollideAABox(bounds, collector, inBroadPhaseLayerFilter, inObjectLayerFilter);
 	}
 	else
-	{
-		// Version that uses the cached active edges
-		settings.mActiveEdgeMode = EActiveEdgeMode::CollideOnlyWithActive;
+		GetNarrowPhaseQuery().CollideShape(inShape, Vec3::sReplicate(1.0f), inCenterOfMassTransform, inSettings, inBaseOffset, ioCollector, inBroadPhaseLayerFilter, inObjectLayerFilter, inBodyFilter, inShapeFilter);
+}
 
-		mSystem->GetNarrowPhaseQuery().CollideShape(inShape, Vec3::sReplicate(1.0f), transform, settings, inBaseOffset, ioCollector, inBroadPhaseLayerFilter, inObjectLayerFilter, body_filter, inShapeFilter);
+void CharacterVirtual::CollideWithCharacters(RMat44Arg inCenterOfMassTransform, const CollideShapeSettings &inSettings, RVec3Arg inBaseOffset, CollideShapeCollector &ioCollector) const
+{
+	if (mCharacterVsCharacterCollision != nullptr)
+	{
+		ioCollector.SetContext(nullptr); // We're no longer colliding with a transformed shape, reset
+		mCharacterVsCharacterCollision->CollideCharacter(this, inCenterOfMassTransform, inSettings, inBaseOffset, ioCollector);
 	}
+}
+
+void CharacterVirtual::CheckCollision(RVec3Arg inPosition, QuatArg inRotation, Vec3Arg inMovementDirection, float inMaxSeparationDistance, const Shape *inShape, RVec3Arg inBaseOffset, CollideShapeCollector &ioCollector, const BroadPhaseLayerFilter &inBroadPhaseLayerFilter, const ObjectLayerFilter &inObjectLayerFilter, const BodyFilter &inBodyFilter, const ShapeFilter &inShapeFilter) const
+{
+	// Query shape transform
+	RMat44 transform = GetCenterOfMassTransform(inPosition, inRotation, inShape);
+
+	// Settings for collide shape
+	CollideShapeSettings settings = GetCollideShapeSettings(inMovementDirection, inMaxSeparationDistance);
+
+	// Body filter
+	IgnoreSingleBodyFilterChained body_filter(mInnerBodyID, inBodyFilter);
+
+	// Collide shape
+	CollideWithBodies(transform, inShape, settings, inBaseOffset, ioCollector, inBroadPhaseLayerFilter, inObjectLayerFilter, body_filter, inShapeFilter);
 
 	// Also collide with other characters
-	if (mCharacterVsCharacterCollision != nullptr)
+	CollideWithCharacters(transform, settings, inBaseOffset, ioCollector);
+}
+
+bool CharacterVirtual::CollectContactCacheBodies(const AABox &inBounds, const BroadPhaseLayerFilter &inBroadPhaseLayerFilter, const ObjectLayerFilter &inObjectLayerFilter, Array<BodyID> &ioScratch, Array<CachedBody> &outBodies) const
+{
+	// Collector that stores the IDs of the bodies
+	class MyCollector : public CollideShapeBodyCollector
 	{
-		ioCollector.SetContext(nullptr); // We're no longer colliding with a transformed shape, reset
-		mCharacterVsCharacterCollision->CollideCharacter(this, transform, settings, inBaseOffset, ioCollector);
+	public:
+		explicit				MyCollector(Array<BodyID> &outBodyIDs) : mBodyIDs(outBodyIDs) { }
+
+		virtual void			AddHit(const ResultType &inResult) override
+		{
+			mBodyIDs.push_back(inResult);
+		}
+
+		Array<BodyID> &			mBodyIDs;
+	};
+
+	// Find the bodies, the order of the broadphase is not deterministic so sort them
+	ioScratch.clear();
+	MyCollector collector(ioScratch);
+	GetBroadPhaseQuery().CollideAABox(inBounds, collector, inBroadPhaseLayerFilter, inObjectLayerFilter);
+	QuickSort(ioScratch.begin(), ioScratch.end());
+
+	// Store the state of the bodies
+	outBodies.clear();
+	for (const BodyID &id : ioScratch)
+		if (id != mInnerBodyID)
+		{
+			BodyLockRead lock(mSystem->GetBodyLockInterface(), id);
+			if (lock.SucceededAndIsInBroadPhase())
+			{
+				// An active body will move, the contacts cannot be cached
+				const Body &body = lock.GetBody();
+				if (body.IsActive())
+					return false;
+
+				outBodies.push_back({ id, body.GetPosition(), body.GetRotation(), body.GetShape() });
+			}
+		}
+	return true;
+}
+
+void CharacterVirtual::GetCachedBodyContacts(RMat44Arg inCenterOfMassTransform, Vec3Arg inMovementDirection, const Shape *inShape, ContactCollector &ioCollector, const BroadPhaseLayerFilter &inBroadPhaseLayerFilter, const ObjectLayerFilter &inObjectLayerFilter, const BodyFilter &inBodyFilter, const ShapeFilter &inShapeFilter) const
+{
+	JPH_PROFILE_FUNCTION();
+
+	++mNumContactCacheQueries;
+
+	TempContactList &contacts = ioCollector.mContacts;
+	float max_distance = mCharacterPadding + mPredictiveContactDistance;
+
+	// Check if the character stayed close enough to where the contacts were collected and if the bodies around it didn't change
+	ContactCache &cache = mContactCache;
+	Vec3 offset = Vec3(inCenterOfMassTransform.GetTranslation() - cache.mCenterOfMassTransform.GetTranslation());
+	if (cache.mValid
+		&& cache.mShape == inShape
+		&& cache.mMovementDirection == inMovementDirection
+		&& cache.mUp == mUp
+		&& offset.LengthSq() <= Square(mContactCacheMargin)
+		&& inCenterOfMassTransform.GetRotation() == cache.mCenterOfMassTransform.GetRotation()
+		&& CollectContactCacheBodies(cache.mBounds, inBroadPhaseLayerFilter, inObjectLayerFilter, cache.mScratchBodyIDs, cache.mScratchBodies)
+		&& cache.mScratchBodies == cache.mBodies)
+	{
+		++mNumContactCacheHits;
+
+		// Move the cached contacts along with the character, this is exact for flat surfaces and an approximation for curved surfaces
+		for (const Contact &c : cache.mContacts)
+		{
+			float normal_offset = offset.Dot(c.mContactNormal);
+			float distance = c.mDistance + normal_offset;
+			if (distance <= max_distance)
+			{
+				Contact &contact = contacts.emplace_back(c);
+				contact.mPosition += offset - normal_offset * c.mContactNormal;
+				contact.mDistance = distance;
+			}
+		}
+		return;
+	}
+
+	// Collect the contacts with extra separation distance so that they are still complete when the character moves by less than the margin
+	cache.mValid = false;
+	CollideShapeSettings settings = GetCollideShapeSettings(inMovementDirection, mPredictiveContactDistance + mContactCacheMargin);
+	ContactCollector collector(mSystem, this, mMaxNumHits, mHitReductionCosMaxAngle, mUp, ioCollector.mBaseOffset, contacts);
+	CollideWithBodies(inCenterOfMassTransform, inShape, settings, ioCollector.mBaseOffset, collector, inBroadPhaseLayerFilter, inObjectLayerFilter, inBodyFilter, inShapeFilter);
+	if (collector.mMaxHitsExceeded)
+	{
+		// Too many hits, the reduction could have removed relevant contacts in favor of contacts in the margin, collect the contacts without caching them
+		contacts.clear();
+		CollideWithBodies(inCenterOfMassTransform, inShape, GetCollideShapeSettings(inMovementDirection, mPredictiveContactDistance), ioCollector.mBaseOffset, ioCollector, inBroadPhaseLayerFilter, inObjectLayerFilter, inBodyFilter, inShapeFilter);
+		return;
 	}
+	cache.mContacts.assign(contacts.begin(), contacts.end());
+
+	// Remove the contacts that were only found because of the margin
+	for (size_t i = 0; i < contacts.size(); )
+		if (contacts[i].mDistance > max_distance)
+		{
+			contacts[i] = contacts.back();
+			contacts.pop_back();
+		}
+		else
+			++i;
+
+	// Remember the bodies around the character so that we can detect when they change
+	cache.mBounds = inShape->GetWorldSpaceBounds(inCenterOfMassTransform, Vec3::sReplicate(1.0f));
+	cache.mBounds.ExpandBy(Vec3::sReplicate(settings.mMaxSeparationDistance));
+	if (!CollectContactCacheBodies(cache.mBounds, inBroadPhaseLayerFilter, inObjectLayerFilter, cache.mScratchBodyIDs, cache.mBodies))
+		return;
+
+	cache.mCenterOfMassTransform = inCenterOfMassTransform;
+	cache.mShape = inShape;
+	cache.mMovementDirection = inMovementDirection;
+	cache.mUp = mUp;
+	cache.mValid = true;
 }
 
 void CharacterVirtual::GetContactsAtPosition(RVec3Arg inPosition, Vec3Arg inMovementDirection, const Shape *inShape, TempContactList &outContacts, const BroadPhaseLayerFilter &inBroadPhaseLayerFilter, const ObjectLayerFilter &inObjectLayerFilter, const BodyFilter &inBodyFilter, const ShapeFilter &inShapeFilter) const
@@ -443,7 +592,18 @@ void CharacterVirtual::GetContactsAtPosition(RVec3Arg inPosition, Vec3Arg inMove
 
 	// Collide shape
 	ContactCollector collector(mSystem, this, mMaxNumHits, mHitReductionCosMaxAngle, mUp, mPosition, outContacts);
-	CheckCollision(inPosition, mRotation, inMovementDirection, mPredictiveContactDistance, inShape, mPosition, collector, inBroadPhaseLayerFilter, inObjectLayerFilter, body_filter, inShapeFilter);
+	if (mUseContactCache)
+	{
+		RMat44 transform = GetCenterOfMassTransform(inPosition, mRotation, inShape);
+
+		// Contacts with bodies can come from the cache
+		GetCachedBodyContacts(transform, inMovementDirection, inShape, collector, inBroadPhaseLayerFilter, inObjectLayerFilter, body_filter, inShapeFilter);
+
+		// Other characters are not tracked by the cache, always collide with them
+		CollideWithCharacters(transform, GetCollideShapeSettings(inMovementDirection, mPredictiveContactDistance), mPosition, collector);
+	}
+	else
+		CheckCollision(inPosition, mRotation, inMovementDirection, mPredictiveContactDistance, inShape, mPosition, collector, inBroadPhaseLayerFilter, inObjectLayerFilter, body_filter, inShapeFilter);
 
 	// The broadphase bounding boxes will not be deterministic, which means that the order in which the contacts are received by the collector is not deterministic.
 	// Therefore we need to sort the contacts to preserve determinism. Note that currently this will fail if we exceed mMaxNumHits hits.
@@ -586,7 +746,7 @@ bool CharacterVirtual::GetFirstContactForSweep(RVec3Arg inPosition, Vec3Arg inDi
 	ContactCastCollector collector(mSystem, this, inDisplacement, mUp, inIgnoredContacts, base_offset, contact);
 	collector.ResetEarlyOutFraction(contact.mFraction);
 	RShapeCast shape_cast(mShape, Vec3::sReplicate(1.0f), start, inDisplacement);
-	mSystem->GetNarrowPhaseQuery().CastShape(shape_cast, settings, base_offset, collector, inBroadPhaseLayerFilter, inObjectLayerFilter, body_filter, inShapeFilter);
+	GetNarrowPhaseQuery().CastShape(shape_cast, settings, base_offset, collector, inBroadPhaseLayerFilter, inObjectLayerFilter, body_filter, inShapeFilter);
 
 	// Also collide with other characters
 	if (mCharacterVsCharacterCollision != nullptr)
@@ -1449,6 +1609,9 @@ bool CharacterVirtual::SetShape(const Shape *inShape, float inMaxPenetrationDept
 
 		// Set new shape
 		mShape = inShape;
+
+		if (mCharacterVsCharacterCollision != nullptr)
+			mCharacterVsCharacterCollision->OnCharacterMoved(this);
 	}
 
 	return mShape == inShape;
@@ -1797,6 +1960,12 @@ void CharacterVirtual::RestoreState(StateRecorder &inStream)
 	mActiveContacts.resize(num_contacts);
 	for (Contact &c : mActiveContacts)
 		c.RestoreState(inStream);
+
+	// The contact cache is not part of the state
+	InvalidateContactCache();
+
+	if (mCharacterVsCharacterCollision != nullptr)
+		mCharacterVsCharacterCollision->OnCharacterMoved(this);
 }
 
 JPH_NAMESPACE_END
@@ -16,6 +16,8 @@ JPH_NAMESPACE_BEGIN
 
 class CharacterVirtual;
 class CollideShapeSettings;
+class BroadPhaseQuery;
+class NarrowPhaseQuery;
 
 /// Contains the configuration of a character
 class JPH_EXPORT CharacterVirtualSettings : public CharacterBaseSettings
@@ -44,6 +46,14 @@ public:
 	float								mHitReductionCosMaxAngle = 0.999f;						///< Cos(angle) where angle is the maximum angle between two hits contact normals that are allowed to be merged during hit reduction. Default is around 2.5 degrees. Set to -1 to turn off.
 	float								mPenetrationRecoverySpeed = 1.0f;						///< This value governs how fast a penetration will be resolved, 0 = nothing is resolved, 1 = everything in one update
 
+	/// When enabled, the contacts with bodies are cached together with the list of bodies that were found around the character.
+	/// As long as the character stays within mContactCacheMargin of the position where the contacts were collected and none of these bodies moved,
+	/// the collision query is skipped and the cached contacts are reused. This makes idle or slowly walking characters a lot cheaper.
+	/// Contacts with other characters are never cached. Note that cached contacts are moved along with the character, which is exact for flat surfaces
+	/// but an approximation for curved surfaces. The cache is not stored by SaveState, so a restored character can deviate slightly from the original.
+	bool								mUseContactCache = false;
+	float								mContactCacheMargin = 0.05f;							///< How far the character can move away from the position where the contacts were cached before they are collected again. Contacts are collected this much further outside of the shape.
+
 	/// This character can optionally have an inner rigid body. This rigid body can be used to give the character presence in the world. When set it means that:
 	/// - Regular collision checks (e.g. NarrowPhaseQuery::CastRay) will collide with the rigid body (they cannot collide with CharacterVirtual since it is not added to the broad phase)
 	/// - Regular contact callbacks will be called through the ContactListener (next to the ones that will be passed to the CharacterContactListener)
@@ -136,6 +146,11 @@ public:
 	/// @param inBaseOffset All hit results will be returned relative to this offset, can be zero to get results in world position, but when you're testing far from the origin you get better precision by picking a position that's closer e.g. GetPosition() since floats are most accurate near the origin
 	/// @param ioCollector Collision collector that receives the collision results.
 	virtual void						CastCharacter(const CharacterVirtual *inCharacter, RMat44Arg inCenterOfMassTransform, Vec3Arg inDirection, const ShapeCastSettings &inShapeCastSettings, RVec3Arg inBaseOffset, CastShapeCollector &ioCollector) const = 0;
+
+	/// Called when the position, rotation or shape of a character that uses this interface changes, can be used to keep a spatial structure up to date.
+	/// Note that when characters are updated in parallel (see CharacterVirtualBatchUpdater) this is called from multiple threads.
+	/// @param inCharacter The character that moved.
+	virtual void						OnCharacterMoved([[maybe_unused]] const CharacterVirtual *inCharacter) { }
 };
 
 /// Simple collision checker that loops over all registered characters.
@@ -230,18 +245,18 @@ public:
 
 	/// Set to indicate that extra effort should be made to try to remove ghost contacts (collisions with internal edges of a mesh). This is more expensive but makes bodies move smoother over a mesh with convex edges.
 	bool								GetEnhancedInternalEdgeRemoval() const					{ return mEnhancedInternalEdgeRemoval; }
-	void								SetEnhancedInternalEdgeRemoval(bool inApply)			{ mEnhancedInternalEdgeRemoval = inApply; }
+	void								SetEnhancedInternalEdgeRemoval(bool inApply)			{ mEnhancedInternalEdgeRemoval = inApply; InvalidateContactCache(); }
 
 	/// Character padding
 	float								GetCharacterPadding() const								{ return mCharacterPadding; }
 
 	/// Max num hits to collect in order to avoid excess of contact points collection
 	uint								GetMaxNumHits() const									{ return mMaxNumHits; }
-	void								SetMaxNumHits(uint inMaxHits)							{ mMaxNumHits = inMaxHits; }
+	void								SetMaxNumHits(uint inMaxHits)							{ mMaxNumHits = inMaxHits; InvalidateContactCache(); }
 
 	/// Cos(angle) where angle is the maximum angle between two hits contact normals that are allowed to be merged during hit reduction. Default is around 2.5 degrees. Set to -1 to turn off.
 	float								GetHitReductionCosMaxAngle() const						{ return mHitReductionCosMaxAngle; }
-	void								SetHitReductionCosMaxAngle(float inCosMaxAngle)			{ mHitReductionCosMaxAngle = inCosMaxAngle; }
+	void								SetHitReductionCosMaxAngle(float inCosMaxAngle)			{ mHitReductionCosMaxAngle = inCosMaxAngle; InvalidateContactCache(); }
 
 	/// Returns if we exceeded the maximum number of hits during the last collision check and had to discard hits based on distance.
 	/// This can be used to find areas that have too complex geometry for the character to navigate properly.
@@ -249,6 +264,22 @@ public:
 	/// try to do its best to select the most relevant contacts to avoid the character from getting stuck.
 	bool								GetMaxHitsExceeded() const								{ return mMaxHitsExceeded; }
 
+	/// Enable or disable caching of contacts with bodies (see CharacterVirtualSettings::mUseContactCache)
+	bool								GetUseContactCache() const								{ return mUseContactCache; }
+	void								SetUseContactCache(bool inUse)							{ mUseContactCache = inUse; InvalidateContactCache(); }
+
+	/// How far the character can move before the cached contacts are collected again (see CharacterVirtualSettings::mContactCacheMargin)
+	float								GetContactCacheMargin() const							{ return mContactCacheMargin; }
+	void								SetContactCacheMargin(float inMargin)					{ mContactCacheMargin = inMargin; InvalidateContactCache(); }
+
+	/// Discard the cached contacts. The cache assumes that the filters that are passed to Update return the same results every update, call this when they change.
+	void								InvalidateContactCache()								{ mContactCache.mValid = false; }
+
+	/// Statistics of the contact cache: how often contacts with bodies were requested and how often they could be taken from the cache
+	uint								GetNumContactCacheQueries() const						{ return mNumContactCacheQueries; }
+	uint								GetNumContactCacheHits() const							{ return mNumContactCacheHits; }
+	void								ResetContactCacheStats()								{ mNumContactCacheQueries = 0; mNumContactCacheHits = 0; }
+
 	/// An extra offset applied to the shape in local space. This allows applying an extra offset to the shape in local space. Note that setting it on the fly can cause the shape to teleport into collision.
 	Vec3								GetShapeOffset() const									{ return mShapeOffset; }
 	void								SetShapeOffset(Vec3Arg inShapeOffset)					{ mShapeOffset = inShapeOffset; UpdateInnerBodyTransform(); }
@@ -473,6 +504,17 @@ private:
 
 	using ConstraintList = Array<Constraint, STLTempAllocator<Constraint>>;
 
+	// A body that was found around the character when the contact cache was filled
+	struct CachedBody
+	{
+		bool							operator == (const CachedBody &inRHS) const				{ return mBodyID == inRHS.mBodyID && mPosition == inRHS.mPosition && mRotation == inRHS.mRotation && mShape == inRHS.mShape; }
+
+		BodyID							mBodyID;												///< ID of the body
+		RVec3							mPosition;												///< Position of the body
+		Quat							mRotation;												///< Rotation of the body
+		const Shape *					mShape;													///< Shape of the body
+	};
+
 	// Collision collector that collects hits for CollideShape
 	class ContactCollector : public CollideShapeCollector
 	{
@@ -532,6 +574,21 @@ private:
 	// Trigger the contact callback for inContact and get the contact settings
 	void								ContactAdded(const Contact &inContact, CharacterContactSettings &ioSettings) const;
 
+	// Get the settings for colliding the character shape
+	CollideShapeSettings				GetCollideShapeSettings(Vec3Arg inMovementDirection, float inMaxSeparationDistance) const;
+
+	// Collide the character shape with the bodies in the world, inBodyFilter should already exclude the inner body
+	void								CollideWithBodies(RMat44Arg inCenterOfMassTransform, const Shape *inShape, const CollideShapeSettings &inSettings, RVec3Arg inBaseOffset, CollideShapeCollector &ioCollector, const BroadPhaseLayerFilter &inBroadPhaseLayerFilter, const ObjectLayerFilter &inObjectLayerFilter, const BodyFilter &inBodyFilter, const ShapeFilter &inShapeFilter) const;
+
+	// Collide the character shape with the other characters
+	void								CollideWithCharacters(RMat44Arg inCenterOfMassTransform, const CollideShapeSettings &inSettings, RVec3Arg inBaseOffset, CollideShapeCollector &ioCollector) const;
+
+	// Collect the bodies in inBounds for validating the contact cache, returns false if one of the bodies is active
+	bool								CollectContactCacheBodies(const AABox &inBounds, const BroadPhaseLayerFilter &inBroadPhaseLayerFilter, const ObjectLayerFilter &inObjectLayerFilter, Array<BodyID> &ioScratch, Array<CachedBody> &outBodies) const;
+
+	// Add the contacts with bodies to ioCollector, taking them from the contact cache when it is still valid and refreshing the cache otherwise
+	void								GetCachedBodyContacts(RMat44Arg inCenterOfMassTransform, Vec3Arg inMovementDirection, const Shape *inShape, ContactCollector &ioCollector, const BroadPhaseLayerFilter &inBroadPhaseLayerFilter, const ObjectLayerFilter &inObjectLayerFilter, const BodyFilter &inBodyFilter, const ShapeFilter &inShapeFilter) const;
+
 	// Tests the shape for collision around inPosition
 	void								GetContactsAtPosition(RVec3Arg inPosition, Vec3Arg inMovementDirection, const Shape *inShape, TempContactList &outContacts, const BroadPhaseLayerFilter &inBroadPhaseLayerFilter, const ObjectLayerFilter &inObjectLayerFilter, const BodyFilter &inBodyFilter, const ShapeFilter &inShapeFilter) const;
 
@@ -583,9 +640,16 @@ private:
 		return mPosition + (mRotation * mShapeOffset + mCharacterPadding * mUp);
 	}
 
-	// Move the inner rigid body to the current position
+	// Move the inner rigid body to the current position and notify the character vs character collision interface
 	void								UpdateInnerBodyTransform();
 
+	// Get the queries that are used to find the bodies that the character collides with
+	const BroadPhaseQuery &				GetBroadPhaseQuery() const;
+	const NarrowPhaseQuery &			GetNarrowPhaseQuery() const;
+
+	// CharacterVirtualBatchUpdater overrides the queries to share broad phase results between characters
+	friend class CharacterVirtualBatchUpdater;
+
 	// Our main listener for contacts
 	CharacterContactListener *			mListener = nullptr;
 
@@ -632,11 +696,39 @@ private:
 	// Remember if we exceeded the maximum number of hits and had to remove similar contacts
 	mutable bool						mMaxHitsExceeded = false;
 
+	// Contact cache settings
+	bool								mUseContactCache;
+	float								mContactCacheMargin;
+
+	// Contacts with bodies that were collected around the character, see CharacterVirtualSettings::mUseContactCache
+	struct ContactCache
+	{
+		bool							mValid = false;											// If the cache can be used
+		RMat44							mCenterOfMassTransform;									// Transform of the shape when the contacts were collected
+		RefConst<Shape>					mShape;													// Shape that was used to collect the contacts
+		Vec3							mMovementDirection;										// Movement direction that was used to determine the active edges
+		Vec3							mUp;													// Up vector that was used to determine the surface normals
+		AABox							mBounds;												// Bounds in which the bodies were collected
+		ContactList						mContacts;												// Contacts, collected with mContactCacheMargin extra separation distance and without padding correction
+		Array<CachedBody>				mBodies;												// Bodies in mBounds sorted on ID
+		Array<CachedBody>				mScratchBodies;											// Temporary list used to validate mBodies
+		Array<BodyID>					mScratchBodyIDs;										// Temporary list used to collect body IDs
+	};
+	mutable ContactCache				mContactCache;
+
+	// Contact cache statistics
+	mutable uint						mNumContactCacheQueries = 0;
+	mutable uint						mNumContactCacheHits = 0;
+
 	// User data, can be used for anything by the application
 	uint64								mUserData = 0;
 
 	// The inner rigid body that proxies the character in the world
 	BodyID								mInnerBodyID;
+
+	// Queries used to find the bodies that the character collides with, when null the queries of the physics system are used
+	const BroadPhaseQuery *				mBroadPhaseQuery = nullptr;
+	const NarrowPhaseQuery *			mNarrowPhaseQuery = nullptr;
 };
 
 JPH_NAMESPACE_END
@@ -0,0 +1,327 @@
+// Jolt Physics Library (https://github.com/jrouwe/JoltPhysics)
+// SPDX-FileCopyrightText: 2024 Jorrit Rouwe
+// SPDX-License-Identifier: MIT
+
+#include <Jolt/Jolt.h>
+
+#include <Jolt/Physics/Character/CharacterVirtualBatchUpdater.h>
+#include <Jolt/Physics/PhysicsSystem.h>
+#include <Jolt/Core/JobSystem.h>
+#include <Jolt/Core/Profiler.h>
+#include <Jolt/Core/QuickSort.h>
+
+JPH_NAMESPACE_BEGIN
+
+CharacterVirtualBatchUpdater::CharacterVirtualBatchUpdater(uint inTempAllocatorSize) :
+	mTempAllocatorSize(inTempAllocatorSize)
+{
+}
+
+CharacterVirtualBatchUpdater::~CharacterVirtualBatchUpdater()
+{
+	for (JobContext *c : mJobContexts)
+		delete c;
+}
+
+uint CharacterVirtualBatchUpdater::sFindRoot(Array<uint> &ioParents, uint inIndex)
+{
+	// Walk up the tree and halve the path while doing so
+	while (ioParents[inIndex] != inIndex)
+	{
+		ioParents[inIndex] = ioParents[ioParents[inIndex]];
+		inIndex = ioParents[inIndex];
+	}
+	return inIndex;
+}
+
+void CharacterVirtualBatchUpdater::sUnion(Array<uint> &ioParents, uint inIndex1, uint inIndex2)
+{
+	uint root1 = sFindRoot(ioParents, inIndex1);
+	uint root2 = sFindRoot(ioParents, inIndex2);
+	if (root1 < root2)
+		ioParents[root2] = root1;
+	else if (root2 < root1)
+		ioParents[root1] = root2;
+}
+
+void CharacterVirtualBatchUpdater::sCollectBodies(const PhysicsSystem &inSystem, const AABox &inBounds, const BroadPhaseLayerFilter &inBroadPhaseLayerFilter, const ObjectLayerFilter &inObjectLayerFilter, Array<const Body *> &outBodies)
+{
+	JPH_PROFILE_FUNCTION();
+
+	// Collector that converts the body IDs into bodies, bodies can't be removed during the update so we don't need to lock them
+	class MyCollector : public CollideShapeBodyCollector
+	{
+	public:
+								MyCollector(const BodyLockInterface &inBodyLockInterface, Array<const Body *> &outBodies) : mBodyLockInterface(inBodyLockInterface), mBodies(outBodies) { }
+
+		virtual void			AddHit(const BodyID &inResult) override
+		{
+			const Body *body = mBodyLockInterface.TryGetBody(inResult);
+			if (body != nullptr)
+				mBodies.push_back(body);
+		}
+
+	private:
+		const BodyLockInterface &mBodyLockInterface;
+		Array<const Body *> &	mBodies;
+	};
+
+	outBodies.clear();
+	MyCollector collector(inSystem.GetBodyLockInterfaceNoLock(), outBodies);
+	inSystem.GetBroadPhaseQuery().CollideAABox(inBounds, collector, inBroadPhaseLayerFilter, inObjectLayerFilter);
+
+	// Sort the bodies so that the order doesn't depend on the internal structure of the broad phase
+	QuickSort(outBodies.begin(), outBodies.end(), [](const Body *inLHS, const Body *inRHS) { return inLHS->GetID() < inRHS->GetID(); });
+}
+
+void CharacterVirtualBatchUpdater::BuildIslands(uint inNumCharacters, uint inNumSets)
+{
+	JPH_PROFILE_FUNCTION();
+
+	// Assign an island to every set in the order of the first character of the set
+	mSetToIsland.clear();
+	mSetToIsland.resize(inNumSets, cMergedIsland);
+	mIslands.clear();
+	for (uint c = 0; c < inNumCharacters; ++c)
+	{
+		uint &island_idx = mSetToIsland[mCharacterToSet[c]];
+		if (island_idx == cMergedIsland)
+		{
+			island_idx = uint(mIslands.size());
+			mIslands.push_back({ mReach[c], 0, 0, cMergedIsland });
+		}
+		else
+			mIslands[island_idx].mBounds.Encapsulate(mReach[c]);
+		++mIslands[island_idx].mNumCharacters;
+	}
+
+	// Determine where the characters of each island start
+	uint first_character = 0;
+	for (Island &island : mIslands)
+	{
+		island.mFirstCharacter = first_character;
+		first_character += island.mNumCharacters;
+		island.mNumCharacters = 0;
+	}
+
+	// Store the characters per island in the order in which they were passed in
+	mIslandCharacters.resize(inNumCharacters);
+	for (uint c = 0; c < inNumCharacters; ++c)
+	{
+		Island &island = mIslands[mSetToIsland[mCharacterToSet[c]]];
+		mIslandCharacters[island.mFirstCharacter + island.mNumCharacters++] = c;
+	}
+}
+
+void CharacterVirtualBatchUpdater::ExtendedUpdate(CharacterVirtual *const *inCharacters, uint inNumCharacters, float inDeltaTime, Vec3Arg inGravity, const CharacterVirtual::ExtendedUpdateSettings &inSettings, const BroadPhaseLayerFilter &inBroadPhaseLayerFilter, const ObjectLayerFilter &inObjectLayerFilter, const BodyFilter &inBodyFilter, const ShapeFilter &inShapeFilter, JobSystem &inJobSystem)
+{
+	JPH_PROFILE_FUNCTION();
+
+	mStats = Stats();
+	if (inNumCharacters == 0)
+		return;
+
+	const PhysicsSystem &system = *inCharacters[0]->mSystem;
+
+	// Determine the volume that each character can reach during this update.
+	// Update moves at most velocity * delta time, StickToFloor and WalkStairs add their step distances and all queries are expanded by the predictive contact distance and the padding.
+	{
+		JPH_PROFILE("DetermineReach");
+
+		float stick_to_floor = inSettings.mStickToFloorStepDown.Length();
+		float step_up = inSettings.mWalkStairsStepUp.Length();
+		float step_down_extra = inSettings.mWalkStairsStepDownExtra.Length();
+		mReach.resize(inNumCharacters);
+		for (uint c = 0; c < inNumCharacters; ++c)
+		{
+			const CharacterVirtual *character = inCharacters[c];
+			JPH_ASSERT(character->mSystem == &system, "All characters must belong to the same physics system");
+
+			float displacement = character->GetLinearVelocity().Length() * inDeltaTime;
+			float walk_stairs = step_up > 0.0f? 2.0f * step_up + step_down_extra + max(inSettings.mWalkStairsMinStepForward, displacement) + inSettings.mWalkStairsStepForwardTest : 0.0f;
+			float margin = displacement + stick_to_floor + walk_stairs + character->mPredictiveContactDistance + 2.0f * character->mCharacterPadding + character->mCollisionTolerance;
+
+			AABox reach = character->GetTransformedShape().GetWorldSpaceBounds();
+			reach.ExpandBy(Vec3::sReplicate(margin));
+			mReach[c] = reach;
+		}
+	}
+
+	// Group characters whose reach overlaps using sweep and prune along the x axis
+	{
+		JPH_PROFILE("GroupCharacters");
+
+		mSortedCharacters.resize(inNumCharacters);
+		mCharacterParents.resize(inNumCharacters);
+		for (uint c = 0; c < inNumCharacters; ++c)
+		{
+			mSortedCharacters[c] = c;
+			mCharacterParents[c] = c;
+		}
+		QuickSort(mSortedCharacters.begin(), mSortedCharacters.end(), [this](uint inLHS, uint inRHS) { return mReach[inLHS].mMin.GetX() < mReach[inRHS].mMin.GetX(); });
+
+		for (const uint *c1 = mSortedCharacters.begin(), *c_end = mSortedCharacters.end(); c1 < c_end; ++c1)
+		{
+			const AABox &reach1 = mReach[*c1];
+			for (const uint *c2 = c1 + 1; c2 < c_end && mReach[*c2].mMin.GetX() <= reach1.mMax.GetX(); ++c2)
+				if (reach1.Overlaps(mReach[*c2]))
+					sUnion(mCharacterParents, *c1, *c2);
+		}
+
+		mCharacterToSet.resize(inNumCharacters);
+		for (uint c = 0; c < inNumCharacters; ++c)
+			mCharacterToSet[c] = sFindRoot(mCharacterParents, c);
+		BuildIslands(inNumCharacters, inNumCharacters);
+	}
+
+	// Helper function that runs inFunction(job index) on a number of jobs and waits for them to complete
+	uint max_jobs = (uint)max(1, inJobSystem.GetMaxConcurrency());
+	auto run_jobs = [&inJobSystem](uint inNumJobs, const char *inName, const function<void(uint)> &inFunction)
+	{
+		JobSystem::Barrier *barrier = inJobSystem.CreateBarrier();
+		for (uint j = 0; j < inNumJobs; ++j)
+			barrier->AddJob(inJobSystem.CreateJob(inName, Color::sGreen, [&inFunction, j]() { inFunction(j); }));
+		inJobSystem.WaitForJobs(barrier);
+		inJobSystem.DestroyBarrier(barrier);
+	};
+
+	// Collect the bodies around each island with a single broad phase query
+	uint num_initial_islands = uint(mIslands.size());
+	if (mBodiesPerIsland.size() < num_initial_islands)
+		mBodiesPerIsland.resize(num_initial_islands);
+	{
+		atomic<uint> next_island = 0;
+		run_jobs(min(max_jobs, num_initial_islands), "CollideCharacterIslands", [this, &system, &next_island, num_initial_islands, &inBroadPhaseLayerFilter, &inObjectLayerFilter](uint)
+		{
+			for (uint i = next_island.fetch_add(1, memory_order_relaxed); i < num_initial_islands; i = next_island.fetch_add(1, memory_order_relaxed))
+				sCollectBodies(system, mIslands[i].mBounds, inBroadPhaseLayerFilter, inObjectLayerFilter, mBodiesPerIsland[i]);
+		});
+	}
+
+	// Merge islands that can touch the same non-static body so that the impulses on that body are applied in a fixed order
+	{
+		JPH_PROFILE("MergeIslands");
+
+		mIslandParents.resize(num_initial_islands);
+		for (uint i = 0; i < num_initial_islands; ++i)
+			mIslandParents[i] = i;
+
+		if (mBodyToIsland.size() < system.GetMaxBodies())
+			mBodyToIsland.resize(system.GetMaxBodies());
+		for (uint i = 0; i < num_initial_islands; ++i)
+			for (const Body *body : mBodiesPerIsland[i])
+				mBodyToIsland[body->GetID().GetIndex()] = cMergedIsland;
+		for (uint i = 0; i < num_initial_islands; ++i)
+			for (const Body *body : mBodiesPerIsland[i])
+				if (!body->IsStatic())
+				{
+					uint &island_idx = mBodyToIsland[body->GetID().GetIndex()];
+					if (island_idx == cMergedIsland)
+						island_idx = i;
+					else
+						sUnion(mIslandParents, island_idx, i);
+				}
+
+		// Rebuild the islands if any were merged
+		uint num_sets = 0;
+		for (uint i = 0; i < num_initial_islands; ++i)
+			if (mIslandParents[i] == i)
+				++num_sets;
+		if (num_sets < num_initial_islands)
+		{
+			// Characters were assigned to the initial islands in order, so we can find the island of each character through mIslands
+			for (uint i = 0; i < num_initial_islands; ++i)
+			{
+				uint root = sFindRoot(mIslandParents, i);
+				const Island &island = mIslands[i];
+				for (const uint *c = mIslandCharacters.data() + island.mFirstCharacter, *c_end = c + island.mNumCharacters; c < c_end; ++c)
+					mCharacterToSet[*c] = root;
+			}
+			BuildIslands(inNumCharacters, num_initial_islands);
+
+			// Islands that consist of a single initial island can use the bodies that were collected for it.
+			// The root of a set has the lowest index so it is visited before the other initial islands in the set.
+			for (uint i = 0; i < num_initial_islands; ++i)
+			{
+				uint root = sFindRoot(mIslandParents, i);
+				mIslands[mSetToIsland[root]].mInitialIsland = root == i? i : cMergedIsland;
+			}
+		}
+		else
+		{
+			for (uint i = 0; i < num_initial_islands; ++i)
+				mIslands[i].mInitialIsland = i;
+		}
+	}
+
+	// Update the biggest islands first to balance the load
+	uint num_islands = uint(mIslands.size());
+	mIslandOrder.resize(num_islands);
+	for (uint i = 0; i < num_islands; ++i)
+		mIslandOrder[i] = i;
+	QuickSort(mIslandOrder.begin(), mIslandOrder.end(), [this](uint inLHS, uint inRHS) { return mIslands[inLHS].mNumCharacters > mIslands[inRHS].mNumCharacters || (mIslands[inLHS].mNumCharacters == mIslands[inRHS].mNumCharacters && inLHS < inRHS); });
+
+	// Create the contexts for the jobs
+	uint num_jobs = min(max_jobs, num_islands);
+	while (mJobContexts.size() < num_jobs)
+		mJobContexts.push_back(new JobContext(mTempAllocatorSize));
+
+	// Update the islands
+	atomic<uint> next_island = 0;
+	atomic<uint> num_shared_islands = 0;
+	atomic<uint> num_unshared_queries = 0;
+	run_jobs(num_jobs, "UpdateCharacterIslands", [this, &system, inCharacters, &next_island, &num_shared_islands, &num_unshared_queries, num_islands, inDeltaTime, inGravity, &inSettings, &inBroadPhaseLayerFilter, &inObjectLayerFilter, &inBodyFilter, &inShapeFilter](uint inJobIndex)
+	{
+		JobContext &context = *mJobContexts[inJobIndex];
+
+		for (uint i = next_island.fetch_add(1, memory_order_relaxed); i < num_islands; i = next_island.fetch_add(1, memory_order_relaxed))
+		{
+			const Island &island = mIslands[mIslandOrder[i]];
+
+			// Get the bodies for this island, merged islands need to query the broad phase again since the combined bounds can contain bodies that neither of the initial islands found
+			const Array<const Body *> *bodies;
+			if (island.mInitialIsland != cMergedIsland)
+				bodies = &mBodiesPerIsland[island.mInitialIsland];
+			else
+			{
+				sCollectBodies(system, island.mBounds, inBroadPhaseLayerFilter, inObjectLayerFilter, context.mBodies);
+				bodies = &context.mBodies;
+			}
+
+			// Set up the shared queries
+			bool shared = bodies->size() <= cMaxSharedBodies;
+			if (shared)
+			{
+				context.mBroadPhaseQuery.mBroadPhaseQuery = &system.GetBroadPhaseQuery();
+				context.mBroadPhaseQuery.mBounds = island.mBounds;
+				context.mBroadPhaseQuery.mBodies = bodies->data();
+				context.mBroadPhaseQuery.mNumBodies = uint(bodies->size());
+				context.mBroadPhaseQuery.mNumFallbackQueries = &num_unshared_queries;
+				context.mNarrowPhaseQuery.Init(system.GetBodyLockInterface(), context.mBroadPhaseQuery);
+				num_shared_islands.fetch_add(1, memory_order_relaxed);
+			}
+
+			// Update the characters in the order in which they were passed in
+			for (const uint *c = mIslandCharacters.data() + island.mFirstCharacter, *c_end = c + island.mNumCharacters; c < c_end; ++c)
+			{
+				CharacterVirtual *character = inCharacters[*c];
+				if (shared)
+				{
+					character->mBroadPhaseQuery = &context.mBroadPhaseQuery;
+					character->mNarrowPhaseQuery = &context.mNarrowPhaseQuery;
+				}
+				character->ExtendedUpdate(inDeltaTime, inGravity, inSettings, inBroadPhaseLayerFilter, inObjectLayerFilter, inBodyFilter, inShapeFilter, context.mTempAllocator);
+				character->mBroadPhaseQuery = nullptr;
+				character->mNarrowPhaseQuery = nullptr;
+			}
+		}
+	});
+
+	// Update statistics
+	mStats.mNumIslands = num_islands;
+	mStats.mMaxIslandSize = mIslands[mIslandOrder[0]].mNumCharacters;
+	mStats.mNumSharedIslands = num_shared_islands.load(memory_order_relaxed);
+	mStats.mNumUnsharedQueries = num_unshared_queries.load(memory_order_relaxed);
+}
+
+JPH_NAMESPACE_END
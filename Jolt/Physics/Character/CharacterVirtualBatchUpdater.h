@@ -0,0 +1,128 @@
+// Jolt Physics Library (https://github.com/jrouwe/JoltPhysics)
+// SPDX-FileCopyrightText: 2024 Jorrit Rouwe
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <Jolt/Physics/Character/CharacterVirtual.h>
+#include <Jolt/Physics/Collision/BroadPhase/BroadPhaseBodyList.h>
+#include <Jolt/Physics/Collision/NarrowPhaseQuery.h>
+#include <Jolt/Geometry/AABox.h>
+#include <Jolt/Core/Atomics.h>
+#include <Jolt/Core/TempAllocator.h>
+
+JPH_NAMESPACE_BEGIN
+
+class JobSystem;
+class PhysicsSystem;
+
+/// Updates many CharacterVirtual instances in parallel on the job system.
+///
+/// Characters are grouped in islands. Two characters end up in the same island when the volumes that they can reach during the update overlap
+/// or when they can touch the same non-static body. Islands are updated in parallel, the characters within an island are updated one after another
+/// in the order in which they were passed in. This means that character vs character interactions and the impulses that characters apply to bodies
+/// are processed in a fixed order, so the outcome doesn't depend on the number of threads.
+///
+/// All characters in an island share a single broad phase query: the bodies around the island are collected once before the update
+/// and the narrow phase queries of the characters are performed against this list.
+///
+/// Note that during the update:
+/// - The CharacterContactListener of the characters will be called from multiple threads.
+/// - The CharacterVsCharacterCollision interface will be called from multiple threads, it can read the position of characters that are being updated by other threads (these are never close enough to collide).
+/// - Bodies cannot be added, removed or moved and the physics system cannot be updated.
+class JPH_EXPORT CharacterVirtualBatchUpdater : public NonCopyable
+{
+public:
+	JPH_OVERRIDE_NEW_DELETE
+
+	/// Max amount of bodies in the shared broad phase query of an island, if more bodies are found the characters in the island query the broad phase themselves
+	static constexpr uint		cMaxSharedBodies = 128;
+
+	/// Constructor
+	/// @param inTempAllocatorSize Amount of temporary memory that is reserved for every job that updates characters (falls back to malloc when it runs out)
+	explicit					CharacterVirtualBatchUpdater(uint inTempAllocatorSize = 1024 * 1024);
+
+	/// Destructor
+								~CharacterVirtualBatchUpdater();
+
+	/// Calls CharacterVirtual::ExtendedUpdate for a list of characters. All characters must belong to the same PhysicsSystem.
+	/// Before calling, use CharacterVirtual::SetLinearVelocity to set the velocity of each character (see CharacterVirtual::ExtendedUpdate).
+	/// @param inCharacters List of characters to update
+	/// @param inNumCharacters Number of characters in inCharacters
+	/// @param inDeltaTime Time step to simulate.
+	/// @param inGravity Gravity vector (m/s^2). This gravity vector is only used when the character is standing on top of another object to apply downward force.
+	/// @param inSettings A structure containing settings for the algorithm.
+	/// @param inBroadPhaseLayerFilter Filter that is used to check if a character collides with something in the broadphase.
+	/// @param inObjectLayerFilter Filter that is used to check if a character collides with a layer.
+	/// @param inBodyFilter Filter that is used to check if a character collides with a body.
+	/// @param inShapeFilter Filter that is used to check if a character collides with a subshape.
+	/// @param inJobSystem The job system that is used to update the islands in parallel.
+	void						ExtendedUpdate(CharacterVirtual *const *inCharacters, uint inNumCharacters, float inDeltaTime, Vec3Arg inGravity, const CharacterVirtual::ExtendedUpdateSettings &inSettings, const BroadPhaseLayerFilter &inBroadPhaseLayerFilter, const ObjectLayerFilter &inObjectLayerFilter, const BodyFilter &inBodyFilter, const ShapeFilter &inShapeFilter, JobSystem &inJobSystem);
+
+	/// Statistics of the last update
+	struct Stats
+	{
+		uint					mNumIslands = 0;						///< Number of islands that were updated
+		uint					mMaxIslandSize = 0;						///< Number of characters in the largest island
+		uint					mNumSharedIslands = 0;					///< Number of islands that used a shared broad phase query
+		uint					mNumUnsharedQueries = 0;				///< Number of broad phase queries of characters in a shared island that fell outside of the shared bounds and had to query the broad phase
+	};
+
+	/// Get the statistics of the last update
+	const Stats &				GetStats() const						{ return mStats; }
+
+private:
+	/// Context for a job that updates characters
+	struct JobContext
+	{
+		JPH_OVERRIDE_NEW_DELETE
+
+		explicit				JobContext(uint inTempAllocatorSize)	: mTempAllocator(inTempAllocatorSize) { }
+
+		TempAllocatorImplWithMallocFallback mTempAllocator;				///< Temporary memory for this job
+		BroadPhaseBodyList		mBroadPhaseQuery;						///< Shared broad phase query of the island that is being updated
+		NarrowPhaseQuery		mNarrowPhaseQuery;						///< Narrow phase query on top of mBroadPhaseQuery
+		Array<const Body *>		mBodies;								///< Bodies of an island that was merged from multiple islands
+	};
+
+	/// A group of characters that are updated sequentially
+	struct Island
+	{
+		AABox					mBounds;								///< Bounds of the volume that the characters can reach
+		uint					mFirstCharacter;						///< Index of the first character in mIslandCharacters
+		uint					mNumCharacters;							///< Number of characters in the island
+		uint					mInitialIsland;							///< Index in mBodiesPerIsland of the bodies found for this island or cMergedIsland if the island was merged from multiple islands
+	};
+
+	/// Value for Island::mInitialIsland that indicates that the island was merged from multiple islands
+	static constexpr uint		cMergedIsland = ~uint(0);
+
+	/// Find the root of a union find set
+	static uint					sFindRoot(Array<uint> &ioParents, uint inIndex);
+
+	/// Merge two union find sets, the lowest index becomes the root
+	static void					sUnion(Array<uint> &ioParents, uint inIndex1, uint inIndex2);
+
+	/// Collect all bodies in inBounds, sorted on body ID
+	static void					sCollectBodies(const PhysicsSystem &inSystem, const AABox &inBounds, const BroadPhaseLayerFilter &inBroadPhaseLayerFilter, const ObjectLayerFilter &inObjectLayerFilter, Array<const Body *> &outBodies);
+
+	/// Fill in mIslands, mIslandCharacters and mSetToIsland from mCharacterToSet, all characters in a set go into the same island. Islands are ordered by their first character.
+	void						BuildIslands(uint inNumCharacters, uint inNumSets);
+
+	uint						mTempAllocatorSize;						///< Size of the temporary allocator of each job
+	Array<JobContext *>			mJobContexts;							///< Context of each job
+	Array<AABox>				mReach;									///< For each character the volume that it can reach during the update
+	Array<uint>					mSortedCharacters;						///< Characters sorted on the minimum x coordinate of their reach
+	Array<uint>					mCharacterParents;						///< Union find structure that groups characters
+	Array<uint>					mIslandParents;							///< Union find structure that groups islands that share bodies
+	Array<uint>					mCharacterToSet;						///< For each character the index of the set it belongs to
+	Array<uint>					mSetToIsland;							///< For each set the island it belongs to
+	Array<uint>					mIslandCharacters;						///< Characters of all islands, ordered by island
+	Array<Island>				mIslands;								///< Islands that are being updated
+	Array<uint>					mIslandOrder;							///< Order in which the islands are updated, largest island first
+	Array<Array<const Body *>>	mBodiesPerIsland;						///< Bodies that were found for each island before merging islands that share bodies
+	Array<uint>					mBodyToIsland;							///< For each body index the first island that found the body (only valid for bodies that were found)
+	Stats						mStats;									///< Statistics of the last update
+};
+
+JPH_NAMESPACE_END
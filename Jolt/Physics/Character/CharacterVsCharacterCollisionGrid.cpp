@@ -0,0 +1,255 @@
+// Jolt Physics Library (https://github.com/jrouwe/JoltPhysics)
+// SPDX-FileCopyrightText: 2024 Jorrit Rouwe
+// SPDX-License-Identifier: MIT
+
+#include <Jolt/Jolt.h>
+
+#include <Jolt/Physics/Character/CharacterVsCharacterCollisionGrid.h>
+#include <Jolt/Physics/Collision/CollideShape.h>
+#include <Jolt/Physics/Collision/CollisionDispatch.h>
+#include <Jolt/Physics/Collision/ShapeCast.h>
+#include <Jolt/Core/Profiler.h>
+
+JPH_NAMESPACE_BEGIN
+
+CharacterVsCharacterCollisionGrid::CharacterVsCharacterCollisionGrid(float inCellSize, uint inNumBuckets) :
+	mInvCellSize(1.0f / inCellSize)
+{
+	JPH_ASSERT(inCellSize > 0.0f);
+	JPH_ASSERT(IsPowerOf2(inNumBuckets));
+
+	mBuckets.resize(inNumBuckets, cInvalidIndex);
+}
+
+AABox CharacterVsCharacterCollisionGrid::sGetBounds(const CharacterVirtual *inCharacter)
+{
+	AABox bounds = inCharacter->GetTransformedShape().GetWorldSpaceBounds();
+	bounds.ExpandBy(Vec3::sReplicate(inCharacter->GetCharacterPadding()));
+	return bounds;
+}
+
+inline CharacterVsCharacterCollisionGrid::Cell CharacterVsCharacterCollisionGrid::GetCell(Vec3Arg inPosition) const
+{
+	// Clamp the coordinates so that they fit in an int
+	constexpr float cMaxCell = float(1 << 30);
+	Vec3 p = Vec3::sClamp(inPosition * mInvCellSize, Vec3::sReplicate(-cMaxCell), Vec3::sReplicate(cMaxCell));
+	return { int(floor(p.GetX())), int(floor(p.GetY())), int(floor(p.GetZ())) };
+}
+
+inline uint32 CharacterVsCharacterCollisionGrid::GetBucket(const Cell &inCell) const
+{
+	return ((uint32(inCell.mX) * 73856093u) ^ (uint32(inCell.mY) * 19349663u) ^ (uint32(inCell.mZ) * 83492791u)) & (uint32(mBuckets.size()) - 1);
+}
+
+void CharacterVsCharacterCollisionGrid::LinkEntry(uint32 inIndex)
+{
+	// Keep the bucket sorted on index so that the order in which characters are visited doesn't depend on the order in which they moved
+	Entry &entry = mEntries[inIndex];
+	uint32 &head = mBuckets[GetBucket(entry.mCell)];
+	uint32 prev = cInvalidIndex;
+	uint32 next = head;
+	while (next != cInvalidIndex && next < inIndex)
+	{
+		prev = next;
+		next = mEntries[next].mNext;
+	}
+
+	entry.mPrev = prev;
+	entry.mNext = next;
+	if (prev != cInvalidIndex)
+		mEntries[prev].mNext = inIndex;
+	else
+		head = inIndex;
+	if (next != cInvalidIndex)
+		mEntries[next].mPrev = inIndex;
+}
+
+void CharacterVsCharacterCollisionGrid::UnlinkEntry(uint32 inIndex)
+{
+	Entry &entry = mEntries[inIndex];
+	if (entry.mPrev != cInvalidIndex)
+		mEntries[entry.mPrev].mNext = entry.mNext;
+	else
+		mBuckets[GetBucket(entry.mCell)] = entry.mNext;
+	if (entry.mNext != cInvalidIndex)
+		mEntries[entry.mNext].mPrev = entry.mPrev;
+}
+
+void CharacterVsCharacterCollisionGrid::Add(CharacterVirtual *inCharacter)
+{
+	lock_guard lock(mMutex);
+
+	JPH_ASSERT(mCharacterToEntry.find(inCharacter) == mCharacterToEntry.end(), "Character already added");
+
+	AABox bounds = sGetBounds(inCharacter);
+	AtomicMax(mMaxHalfExtent, bounds.GetExtent().ReduceMax(), memory_order_relaxed);
+
+	uint32 index = uint32(mEntries.size());
+	Entry &entry = mEntries.emplace_back();
+	entry.mCharacter = inCharacter;
+	entry.mCell = GetCell(bounds.GetCenter());
+	LinkEntry(index);
+	mCharacterToEntry[inCharacter] = index;
+}
+
+void CharacterVsCharacterCollisionGrid::Remove(const CharacterVirtual *inCharacter)
+{
+	lock_guard lock(mMutex);
+
+	UnorderedMap<const CharacterVirtual *, uint32>::iterator i = mCharacterToEntry.find(inCharacter);
+	if (i == mCharacterToEntry.end())
+		return;
+	uint32 index = i->second;
+	mCharacterToEntry.erase(i);
+	UnlinkEntry(index);
+
+	// Move the last entry into the free slot and relink it so that its bucket stays sorted
+	uint32 last = uint32(mEntries.size()) - 1;
+	if (index != last)
+	{
+		UnlinkEntry(last);
+		mEntries[index] = mEntries[last];
+		mCharacterToEntry[mEntries[index].mCharacter] = index;
+		LinkEntry(index);
+	}
+	mEntries.pop_back();
+}
+
+void CharacterVsCharacterCollisionGrid::OnCharacterMoved(const CharacterVirtual *inCharacter)
+{
+	// Characters that are not in the grid are not tracked
+	UnorderedMap<const CharacterVirtual *, uint32>::const_iterator i = mCharacterToEntry.find(inCharacter);
+	if (i == mCharacterToEntry.end())
+		return;
+	uint32 index = i->second;
+
+	AABox bounds = sGetBounds(inCharacter);
+	AtomicMax(mMaxHalfExtent, bounds.GetExtent().ReduceMax(), memory_order_relaxed);
+
+	// Only the thread that moves the character changes its cell, so we can check it without locking
+	Cell cell = GetCell(bounds.GetCenter());
+	if (cell != mEntries[index].mCell)
+	{
+		lock_guard lock(mMutex);
+
+		UnlinkEntry(index);
+		mEntries[index].mCell = cell;
+		LinkEntry(index);
+	}
+}
+
+template <class Visitor>
+inline void CharacterVsCharacterCollisionGrid::WalkCells(const AABox &inBounds, const Visitor &inVisitor) const
+{
+	if (mEntries.empty())
+		return;
+
+	// Characters are linked in the cell that contains their center, their bounds extend up to mMaxHalfExtent from the center
+	Vec3 expand = Vec3::sReplicate(mMaxHalfExtent.load(memory_order_relaxed));
+	Cell min_cell = GetCell(inBounds.mMin - expand);
+	Cell max_cell = GetCell(inBounds.mMax + expand);
+
+	// If the query covers more cells than there are characters it is cheaper to test all characters
+	float num_cells = (float(max_cell.mX) - float(min_cell.mX) + 1.0f) * (float(max_cell.mY) - float(min_cell.mY) + 1.0f) * (float(max_cell.mZ) - float(min_cell.mZ) + 1.0f);
+	if (num_cells > float(mEntries.size()))
+	{
+		for (const Entry &entry : mEntries)
+			if (inVisitor(entry.mCharacter))
+				return;
+		return;
+	}
+
+	// Visit all cells, the bucket of a cell can contain characters of other cells too so we need to check the cell of every character
+	Cell cell;
+	for (cell.mX = min_cell.mX; cell.mX <= max_cell.mX; ++cell.mX)
+		for (cell.mY = min_cell.mY; cell.mY <= max_cell.mY; ++cell.mY)
+			for (cell.mZ = min_cell.mZ; cell.mZ <= max_cell.mZ; ++cell.mZ)
+				for (uint32 index = mBuckets[GetBucket(cell)]; index != cInvalidIndex; )
+				{
+					const Entry &entry = mEntries[index];
+					if (entry.mCell == cell && inVisitor(entry.mCharacter))
+						return;
+					index = entry.mNext;
+				}
+}
+
+void CharacterVsCharacterCollisionGrid::CollideCharacter(const CharacterVirtual *inCharacter, RMat44Arg inCenterOfMassTransform, const CollideShapeSettings &inCollideShapeSettings, RVec3Arg inBaseOffset, CollideShapeCollector &ioCollector) const
+{
+	JPH_PROFILE_FUNCTION();
+
+	// Make shape 1 relative to inBaseOffset
+	Mat44 transform1 = inCenterOfMassTransform.PostTranslated(-inBaseOffset).ToMat44();
+
+	const Shape *shape = inCharacter->GetShape();
+	CollideShapeSettings settings = inCollideShapeSettings;
+
+	// Calculate the bounds of the query
+	AABox bounds = shape->GetWorldSpaceBounds(inCenterOfMassTransform, Vec3::sReplicate(1.0f));
+	bounds.ExpandBy(Vec3::sReplicate(inCollideShapeSettings.mMaxSeparationDistance));
+
+	shared_lock lock(mMutex);
+
+	WalkCells(bounds, [inCharacter, &transform1, shape, &settings, &inCollideShapeSettings, inBaseOffset, &ioCollector, &bounds](CharacterVirtual *inOther)
+	{
+		if (inOther == inCharacter
+			|| !sGetBounds(inOther).Overlaps(bounds))
+			return false;
+
+		// Collector needs to know which character we're colliding with
+		ioCollector.SetUserData(reinterpret_cast<uint64>(inOther));
+
+		// Make shape 2 relative to inBaseOffset
+		Mat44 transform2 = inOther->GetCenterOfMassTransform().PostTranslated(-inBaseOffset).ToMat44();
+
+		// We need to add the padding of character 2 so that we will detect collision with its outer shell
+		settings.mMaxSeparationDistance = inCollideShapeSettings.mMaxSeparationDistance + inOther->GetCharacterPadding();
+
+		// Note that this collides against the character's shape without padding, this will be corrected for in CharacterVirtual::GetContactsAtPosition
+		CollisionDispatch::sCollideShapeVsShape(shape, inOther->GetShape(), Vec3::sReplicate(1.0f), Vec3::sReplicate(1.0f), transform1, transform2, SubShapeIDCreator(), SubShapeIDCreator(), settings, ioCollector);
+
+		return ioCollector.ShouldEarlyOut();
+	});
+
+	// Reset the user data
+	ioCollector.SetUserData(0);
+}
+
+void CharacterVsCharacterCollisionGrid::CastCharacter(const CharacterVirtual *inCharacter, RMat44Arg inCenterOfMassTransform, Vec3Arg inDirection, const ShapeCastSettings &inShapeCastSettings, RVec3Arg inBaseOffset, CastShapeCollector &ioCollector) const
+{
+	JPH_PROFILE_FUNCTION();
+
+	// Convert shape cast relative to inBaseOffset
+	Mat44 transform1 = inCenterOfMassTransform.PostTranslated(-inBaseOffset).ToMat44();
+	ShapeCast shape_cast(inCharacter->GetShape(), Vec3::sReplicate(1.0f), transform1, inDirection);
+
+	// Calculate the bounds of the swept shape
+	AABox bounds = inCharacter->GetShape()->GetWorldSpaceBounds(inCenterOfMassTransform, Vec3::sReplicate(1.0f));
+	AABox end_bounds = bounds;
+	end_bounds.Translate(inDirection);
+	bounds.Encapsulate(end_bounds);
+
+	shared_lock lock(mMutex);
+
+	WalkCells(bounds, [inCharacter, &shape_cast, &inShapeCastSettings, inBaseOffset, &ioCollector, &bounds](CharacterVirtual *inOther)
+	{
+		if (inOther == inCharacter
+			|| !sGetBounds(inOther).Overlaps(bounds))
+			return false;
+
+		// Collector needs to know which character we're colliding with
+		ioCollector.SetUserData(reinterpret_cast<uint64>(inOther));
+
+		// Make shape 2 relative to inBaseOffset
+		Mat44 transform2 = inOther->GetCenterOfMassTransform().PostTranslated(-inBaseOffset).ToMat44();
+
+		// Note that this collides against the character's shape without padding, this will be corrected for in CharacterVirtual::GetFirstContactForSweep
+		CollisionDispatch::sCastShapeVsShapeWorldSpace(shape_cast, inShapeCastSettings, inOther->GetShape(), Vec3::sReplicate(1.0f), { }, transform2, SubShapeIDCreator(), SubShapeIDCreator(), ioCollector);
+
+		return ioCollector.ShouldEarlyOut();
+	});
+
+	// Reset the user data
+	ioCollector.SetUserData(0);
+}
+
+JPH_NAMESPACE_END
@@ -0,0 +1,105 @@
+// Jolt Physics Library (https://github.com/jrouwe/JoltPhysics)
+// SPDX-FileCopyrightText: 2024 Jorrit Rouwe
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <Jolt/Physics/Character/CharacterVirtual.h>
+#include <Jolt/Geometry/AABox.h>
+#include <Jolt/Core/Atomics.h>
+#include <Jolt/Core/Mutex.h>
+#include <Jolt/Core/UnorderedMap.h>
+
+JPH_NAMESPACE_BEGIN
+
+/// Collision checker that stores the registered characters in a loose uniform hash grid so that only nearby characters are tested.
+/// A character is stored in the cell that contains the center of its bounding box, queries are widened by the largest half extent of all characters.
+/// The characters notify the grid through OnCharacterMoved when they move, a character that moves to another cell is relinked immediately.
+/// Queries and moves can happen from multiple threads (e.g. when using CharacterVirtualBatchUpdater), adding and removing characters cannot happen at the same time as queries.
+class JPH_EXPORT CharacterVsCharacterCollisionGrid : public CharacterVsCharacterCollision
+{
+public:
+	JPH_OVERRIDE_NEW_DELETE
+
+	/// Constructor
+	/// @param inCellSize Size of a cell of the grid, should be a couple of times the size of a character.
+	/// @param inNumBuckets Number of buckets that the cells are mapped to (must be a power of 2).
+	explicit							CharacterVsCharacterCollisionGrid(float inCellSize = 2.0f, uint inNumBuckets = 1024);
+
+	/// Add a character to the grid. The character must also use this grid through CharacterVirtual::SetCharacterVsCharacterCollision, otherwise the grid is not notified when the character moves.
+	void								Add(CharacterVirtual *inCharacter);
+
+	/// Remove a character from the grid.
+	void								Remove(const CharacterVirtual *inCharacter);
+
+	/// Get the number of characters in the grid
+	uint								GetNumCharacters() const								{ return uint(mEntries.size()); }
+
+	// See: CharacterVsCharacterCollision
+	virtual void						CollideCharacter(const CharacterVirtual *inCharacter, RMat44Arg inCenterOfMassTransform, const CollideShapeSettings &inCollideShapeSettings, RVec3Arg inBaseOffset, CollideShapeCollector &ioCollector) const override;
+	virtual void						CastCharacter(const CharacterVirtual *inCharacter, RMat44Arg inCenterOfMassTransform, Vec3Arg inDirection, const ShapeCastSettings &inShapeCastSettings, RVec3Arg inBaseOffset, CastShapeCollector &ioCollector) const override;
+	virtual void						OnCharacterMoved(const CharacterVirtual *inCharacter) override;
+
+private:
+	/// Value used to indicate that an index is not used
+	static constexpr uint32				cInvalidIndex = ~uint32(0);
+
+	/// Integer coordinates of a cell
+	struct Cell
+	{
+		inline bool						operator == (const Cell &inRHS) const					{ return mX == inRHS.mX && mY == inRHS.mY && mZ == inRHS.mZ; }
+		inline bool						operator != (const Cell &inRHS) const					{ return !(*this == inRHS); }
+
+		int								mX;
+		int								mY;
+		int								mZ;
+	};
+
+	/// Information about a character in the grid
+	struct Entry
+	{
+		CharacterVirtual *				mCharacter;												///< The character
+		Cell							mCell;													///< Cell that the character is linked in
+		uint32							mNext;													///< Index of the next character in the same bucket
+		uint32							mPrev;													///< Index of the previous character in the same bucket
+	};
+
+	/// Get the world space bounds of a character including its padding
+	static AABox						sGetBounds(const CharacterVirtual *inCharacter);
+
+	/// Get the cell that contains inPosition
+	inline Cell							GetCell(Vec3Arg inPosition) const;
+
+	/// Get the bucket that stores a cell
+	inline uint32						GetBucket(const Cell &inCell) const;
+
+	/// Link a character in the bucket of its cell
+	void								LinkEntry(uint32 inIndex);
+
+	/// Unlink a character from the bucket of its cell
+	void								UnlinkEntry(uint32 inIndex);
+
+	/// Visit all characters of which the bounds potentially overlap with inBounds. inVisitor returns true when the walk should be aborted.
+	template <class Visitor>
+	inline void							WalkCells(const AABox &inBounds, const Visitor &inVisitor) const;
+
+	/// Lock that protects the grid, queries take a shared lock, relinking a character takes a unique lock
+	mutable SharedMutex					mMutex;
+
+	/// Inverse of the size of a cell
+	float								mInvCellSize;
+
+	/// For each bucket the index of the first character in the bucket
+	Array<uint32>						mBuckets;
+
+	/// All characters in the grid
+	Array<Entry>						mEntries;
+
+	/// Maps a character to its index in mEntries
+	UnorderedMap<const CharacterVirtual *, uint32> mCharacterToEntry;
+
+	/// Largest half extent of the bounds of any character in the grid
+	atomic<float>						mMaxHalfExtent { 0.0f };
+};
+
+JPH_NAMESPACE_END
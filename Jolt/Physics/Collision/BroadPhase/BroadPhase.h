@@ -6,6 +6,7 @@
 
 #include <Jolt/Physics/Collision/BroadPhase/BroadPhaseQuery.h>
 #include <Jolt/Physics/Collision/BroadPhase/BroadPhaseLayer.h>
+#include <Jolt/Core/QuickSort.h>
 
 JPH_NAMESPACE_BEGIN
 
@@ -21,6 +22,14 @@ struct BodyPair;
 
 using BodyPairCollector = CollisionCollector<BodyPair, CollisionCollectorTraitsCollideShape>;
 
+/// Type of broadphase that the PhysicsSystem creates
+enum class EBroadPhaseType : uint8
+{
+	QuadTree,			///< BroadPhaseQuadTree, a good general purpose broadphase
+	SweepAndPrune,		///< BroadPhaseSAP, can be faster for many small moving bodies that are spread out along one axis
+	BruteForce,			///< BroadPhaseBruteForce, reference implementation that tests all bodies (slow)
+};
+
 /// Used to do coarse collision detection operations to quickly prune out bodies that will not collide.
 class JPH_EXPORT BroadPhase : public BroadPhaseQuery
 {
@@ -34,6 +43,16 @@ public:
 	/// Should be called after many objects have been inserted to make the broadphase more efficient, usually done on startup only
 	virtual void		Optimize()															{ /* Optionally overridden by implementation */ }
 
+	/// Set the maximum number of tree nodes that may be rebuilt per update to incrementally keep the broadphase efficient (0 = disabled).
+	/// This spreads the work of Optimize() over multiple frames so that there are no large spikes in the update time.
+	virtual void		SetIncrementalOptimizationBudget([[maybe_unused]] uint inMaxNodesPerUpdate) { /* Optionally overridden by implementation */ }
+
+	/// Enable or disable caching the results of FindCollidingPairs between updates.
+	/// When enabled, each active body remembers the bodies around a box that is enlarged by inMargin + inVelocityScale * |linear velocity|.
+	/// These are reused for as long as the body stays inside this box and the other bodies did not move further than the enlargement.
+	/// Must be called when none of the body mutexes are locked.
+	virtual void		SetPairCache([[maybe_unused]] bool inEnabled, [[maybe_unused]] float inMargin, [[maybe_unused]] float inVelocityScale) { /* Optionally overridden by implementation */ }
+
 	/// Must be called just before updating the broadphase when none of the body mutexes are locked
 	virtual void		FrameSync()															{ /* Optionally overridden by implementation */ }
 
@@ -105,6 +124,29 @@ public:
 #endif // JPH_TRACK_BROADPHASE_STATS
 
 protected:
+	/// Sort ioBodies on the layer returned by inGetLayer(BodyID) and call inFunction(layer, start, end) once for every range of bodies that share the same layer.
+	/// inGetLayer is called a lot, so it should read from a C pointer or else sorting is incredibly slow in debug mode.
+	template <class GetLayer, class Function>
+	static inline void	sForEachLayer(BodyID *ioBodies, int inNumber, const GetLayer &inGetLayer, const Function &inFunction)
+	{
+		// Sort bodies on layer
+		QuickSort(ioBodies, ioBodies + inNumber, [&inGetLayer](BodyID inLHS, BodyID inRHS) { return inGetLayer(inLHS) < inGetLayer(inRHS); });
+
+		BodyID *b_start = ioBodies, *b_end = ioBodies + inNumber;
+		while (b_start < b_end)
+		{
+			// Find first body with different layer
+			auto layer = inGetLayer(*b_start);
+			BodyID *b_mid = std::upper_bound(b_start, b_end, layer, [&inGetLayer](decltype(layer) inLayer, BodyID inBodyID) { return inLayer < inGetLayer(inBodyID); });
+
+			// Process all bodies of the same layer
+			inFunction(layer, b_start, b_mid);
+
+			// Repeat
+			b_start = b_mid;
+		}
+	}
+
 	/// Link to the body manager that manages the bodies in this broadphase
 	BodyManager *		mBodyManager = nullptr;
 };
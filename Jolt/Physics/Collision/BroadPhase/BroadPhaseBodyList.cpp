@@ -0,0 +1,208 @@
+// Jolt Physics Library (https://github.com/jrouwe/JoltPhysics)
+// SPDX-FileCopyrightText: 2024 Jorrit Rouwe
+// SPDX-License-Identifier: MIT
+
+#include <Jolt/Jolt.h>
+
+#include <Jolt/Physics/Collision/BroadPhase/BroadPhaseBodyList.h>
+#include <Jolt/Physics/Collision/AABoxCast.h>
+#include <Jolt/Physics/Collision/CastResult.h>
+#include <Jolt/Physics/Collision/RayCast.h>
+#include <Jolt/Physics/Body/Body.h>
+#include <Jolt/Geometry/OrientedBox.h>
+#include <Jolt/Geometry/RayAABox.h>
+
+JPH_NAMESPACE_BEGIN
+
+inline bool BroadPhaseBodyList::CanHandle(const AABox &inBounds) const
+{
+	if (mBounds.Contains(inBounds))
+		return true;
+
+	if (mNumFallbackQueries != nullptr)
+		mNumFallbackQueries->fetch_add(1, memory_order_relaxed);
+	return false;
+}
+
+void BroadPhaseBodyList::CastRay(const RayCast &inRay, RayCastBodyCollector &ioCollector, const BroadPhaseLayerFilter &inBroadPhaseLayerFilter, const ObjectLayerFilter &inObjectLayerFilter) const
+{
+	// If the ray is not inside the bounds that we collected the bodies for, query the real broad phase
+	AABox ray_bounds(inRay.mOrigin, inRay.mOrigin);
+	ray_bounds.Encapsulate(inRay.mOrigin + inRay.mDirection);
+	if (!CanHandle(ray_bounds))
+	{
+		mBroadPhaseQuery->CastRay(inRay, ioCollector, inBroadPhaseLayerFilter, inObjectLayerFilter);
+		return;
+	}
+
+	// Load ray
+	Vec3 origin(inRay.mOrigin);
+	RayInvDirection inv_direction(inRay.mDirection);
+
+	float early_out_fraction = ioCollector.GetEarlyOutFraction();
+	for (const Body *const *b = mBodies, *const *b_end = mBodies + mNumBodies; b < b_end; ++b)
+	{
+		const Body &body = **b;
+
+		// Test layer
+		if (inObjectLayerFilter.ShouldCollide(body.GetObjectLayer()))
+		{
+			// Test intersection with ray
+			const AABox &bounds = body.GetWorldSpaceBounds();
+			float fraction = RayAABox(origin, inv_direction, bounds.mMin, bounds.mMax);
+			if (fraction < early_out_fraction)
+			{
+				// Store hit
+				BroadPhaseCastResult result { body.GetID(), fraction };
+				ioCollector.AddHit(result);
+				if (ioCollector.ShouldEarlyOut())
+					break;
+				early_out_fraction = ioCollector.GetEarlyOutFraction();
+			}
+		}
+	}
+}
+
+void BroadPhaseBodyList::CollideAABox(const AABox &inBox, CollideShapeBodyCollector &ioCollector, const BroadPhaseLayerFilter &inBroadPhaseLayerFilter, const ObjectLayerFilter &inObjectLayerFilter) const
+{
+	// If the box is not inside the bounds that we collected the bodies for, query the real broad phase
+	if (!CanHandle(inBox))
+	{
+		mBroadPhaseQuery->CollideAABox(inBox, ioCollector, inBroadPhaseLayerFilter, inObjectLayerFilter);
+		return;
+	}
+
+	for (const Body *const *b = mBodies, *const *b_end = mBodies + mNumBodies; b < b_end; ++b)
+	{
+		const Body &body = **b;
+
+		// Test layer and intersection with box
+		if (inObjectLayerFilter.ShouldCollide(body.GetObjectLayer())
+			&& body.GetWorldSpaceBounds().Overlaps(inBox))
+		{
+			// Store hit
+			ioCollector.AddHit(body.GetID());
+			if (ioCollector.ShouldEarlyOut())
+				break;
+		}
+	}
+}
+
+void BroadPhaseBodyList::CollideSphere(Vec3Arg inCenter, float inRadius, CollideShapeBodyCollector &ioCollector, const BroadPhaseLayerFilter &inBroadPhaseLayerFilter, const ObjectLayerFilter &inObjectLayerFilter) const
+{
+	// If the sphere is not inside the bounds that we collected the bodies for, query the real broad phase
+	if (!CanHandle(AABox(inCenter, inRadius)))
+	{
+		mBroadPhaseQuery->CollideSphere(inCenter, inRadius, ioCollector, inBroadPhaseLayerFilter, inObjectLayerFilter);
+		return;
+	}
+
+	float radius_sq = Square(inRadius);
+	for (const Body *const *b = mBodies, *const *b_end = mBodies + mNumBodies; b < b_end; ++b)
+	{
+		const Body &body = **b;
+
+		// Test layer and intersection with sphere
+		if (inObjectLayerFilter.ShouldCollide(body.GetObjectLayer())
+			&& body.GetWorldSpaceBounds().GetSqDistanceTo(inCenter) <= radius_sq)
+		{
+			// Store hit
+			ioCollector.AddHit(body.GetID());
+			if (ioCollector.ShouldEarlyOut())
+				break;
+		}
+	}
+}
+
+void BroadPhaseBodyList::CollidePoint(Vec3Arg inPoint, CollideShapeBodyCollector &ioCollector, const BroadPhaseLayerFilter &inBroadPhaseLayerFilter, const ObjectLayerFilter &inObjectLayerFilter) const
+{
+	// If the point is not inside the bounds that we collected the bodies for, query the real broad phase
+	if (!CanHandle(AABox(inPoint, inPoint)))
+	{
+		mBroadPhaseQuery->CollidePoint(inPoint, ioCollector, inBroadPhaseLayerFilter, inObjectLayerFilter);
+		return;
+	}
+
+	for (const Body *const *b = mBodies, *const *b_end = mBodies + mNumBodies; b < b_end; ++b)
+	{
+		const Body &body = **b;
+
+		// Test layer and intersection with point
+		if (inObjectLayerFilter.ShouldCollide(body.GetObjectLayer())
+			&& body.GetWorldSpaceBounds().Contains(inPoint))
+		{
+			// Store hit
+			ioCollector.AddHit(body.GetID());
+			if (ioCollector.ShouldEarlyOut())
+				break;
+		}
+	}
+}
+
+void BroadPhaseBodyList::CollideOrientedBox(const OrientedBox &inBox, CollideShapeBodyCollector &ioCollector, const BroadPhaseLayerFilter &inBroadPhaseLayerFilter, const ObjectLayerFilter &inObjectLayerFilter) const
+{
+	// If the box is not inside the bounds that we collected the bodies for, query the real broad phase
+	if (!CanHandle(AABox(-inBox.mHalfExtents, inBox.mHalfExtents).Transformed(inBox.mOrientation)))
+	{
+		mBroadPhaseQuery->CollideOrientedBox(inBox, ioCollector, inBroadPhaseLayerFilter, inObjectLayerFilter);
+		return;
+	}
+
+	for (const Body *const *b = mBodies, *const *b_end = mBodies + mNumBodies; b < b_end; ++b)
+	{
+		const Body &body = **b;
+
+		// Test layer and intersection with box
+		if (inObjectLayerFilter.ShouldCollide(body.GetObjectLayer())
+			&& inBox.Overlaps(body.GetWorldSpaceBounds()))
+		{
+			// Store hit
+			ioCollector.AddHit(body.GetID());
+			if (ioCollector.ShouldEarlyOut())
+				break;
+		}
+	}
+}
+
+void BroadPhaseBodyList::CastAABox(const AABoxCast &inBox, CastShapeBodyCollector &ioCollector, const BroadPhaseLayerFilter &inBroadPhaseLayerFilter, const ObjectLayerFilter &inObjectLayerFilter) const
+{
+	// If the swept box is not inside the bounds that we collected the bodies for, query the real broad phase
+	AABox swept_box = inBox.mBox;
+	swept_box.Translate(inBox.mDirection);
+	swept_box.Encapsulate(inBox.mBox);
+	if (!CanHandle(swept_box))
+	{
+		mBroadPhaseQuery->CastAABox(inBox, ioCollector, inBroadPhaseLayerFilter, inObjectLayerFilter);
+		return;
+	}
+
+	// Load box
+	Vec3 origin(inBox.mBox.GetCenter());
+	Vec3 extent(inBox.mBox.GetExtent());
+	RayInvDirection inv_direction(inBox.mDirection);
+
+	float early_out_fraction = ioCollector.GetPositiveEarlyOutFraction();
+	for (const Body *const *b = mBodies, *const *b_end = mBodies + mNumBodies; b < b_end; ++b)
+	{
+		const Body &body = **b;
+
+		// Test layer
+		if (inObjectLayerFilter.ShouldCollide(body.GetObjectLayer()))
+		{
+			// Test intersection with ray
+			const AABox &bounds = body.GetWorldSpaceBounds();
+			float fraction = RayAABox(origin, inv_direction, bounds.mMin - extent, bounds.mMax + extent);
+			if (fraction < early_out_fraction)
+			{
+				// Store hit
+				BroadPhaseCastResult result { body.GetID(), fraction };
+				ioCollector.AddHit(result);
+				if (ioCollector.ShouldEarlyOut())
+					break;
+				early_out_fraction = ioCollector.GetPositiveEarlyOutFraction();
+			}
+		}
+	}
+}
+
+JPH_NAMESPACE_END
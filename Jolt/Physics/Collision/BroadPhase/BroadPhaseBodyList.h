@@ -0,0 +1,43 @@
+// Jolt Physics Library (https://github.com/jrouwe/JoltPhysics)
+// SPDX-FileCopyrightText: 2024 Jorrit Rouwe
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <Jolt/Physics/Collision/BroadPhase/BroadPhaseQuery.h>
+#include <Jolt/Geometry/AABox.h>
+#include <Jolt/Core/Atomics.h>
+
+JPH_NAMESPACE_BEGIN
+
+class Body;
+
+/// Broad phase query that tests against a list of bodies that were collected from the broad phase up front.
+/// This allows multiple queries in the same area (e.g. the wheels of a vehicle or a group of characters) to share a single broad phase query.
+/// Queries that are not contained in the bounds that were used to collect the bodies are passed on to the real broad phase.
+/// Note that the broad phase layer filter is not applied, it should have been applied when collecting the bodies.
+class JPH_EXPORT BroadPhaseBodyList : public BroadPhaseQuery
+{
+public:
+	JPH_OVERRIDE_NEW_DELETE
+
+	// See BroadPhaseQuery
+	virtual void			CastRay(const RayCast &inRay, RayCastBodyCollector &ioCollector, const BroadPhaseLayerFilter &inBroadPhaseLayerFilter, const ObjectLayerFilter &inObjectLayerFilter) const override;
+	virtual void			CollideAABox(const AABox &inBox, CollideShapeBodyCollector &ioCollector, const BroadPhaseLayerFilter &inBroadPhaseLayerFilter, const ObjectLayerFilter &inObjectLayerFilter) const override;
+	virtual void			CollideSphere(Vec3Arg inCenter, float inRadius, CollideShapeBodyCollector &ioCollector, const BroadPhaseLayerFilter &inBroadPhaseLayerFilter, const ObjectLayerFilter &inObjectLayerFilter) const override;
+	virtual void			CollidePoint(Vec3Arg inPoint, CollideShapeBodyCollector &ioCollector, const BroadPhaseLayerFilter &inBroadPhaseLayerFilter, const ObjectLayerFilter &inObjectLayerFilter) const override;
+	virtual void			CollideOrientedBox(const OrientedBox &inBox, CollideShapeBodyCollector &ioCollector, const BroadPhaseLayerFilter &inBroadPhaseLayerFilter, const ObjectLayerFilter &inObjectLayerFilter) const override;
+	virtual void			CastAABox(const AABoxCast &inBox, CastShapeBodyCollector &ioCollector, const BroadPhaseLayerFilter &inBroadPhaseLayerFilter, const ObjectLayerFilter &inObjectLayerFilter) const override;
+
+	const BroadPhaseQuery *	mBroadPhaseQuery = nullptr;				///< The real broad phase
+	AABox					mBounds;								///< Bounds that were used to collect the bodies
+	const Body *const *		mBodies = nullptr;						///< Bodies that were found in mBounds
+	uint					mNumBodies = 0;							///< Number of bodies in mBodies
+	atomic<uint> *			mNumFallbackQueries = nullptr;			///< Optional counter that is incremented when a query falls outside of mBounds
+
+private:
+	/// Check if a query with bounds inBounds can be handled by the body list, if not count it
+	inline bool				CanHandle(const AABox &inBounds) const;
+};
+
+JPH_NAMESPACE_END
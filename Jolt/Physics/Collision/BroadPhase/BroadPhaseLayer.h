@@ -56,6 +56,14 @@ private:
 /// Constant value used to indicate an invalid broad phase layer
 static constexpr BroadPhaseLayer cBroadPhaseLayerInvalid(0xff);
 
+/// Acceleration structure that BroadPhaseQuadTree uses to store the bodies of a broadphase layer
+enum class EBroadPhaseLayerType : uint8
+{
+	QuadTree,					///< Quad tree, good general purpose structure that handles large amounts of static bodies well
+	SweepAndPrune,				///< Sorted list along a single axis, cheap to update so good for layers with many small moving bodies that are spread out along one axis
+	HashGrid,					///< Loose uniform hash grid, cheap to insert and move bodies so good for layers with many similarly sized small bodies (e.g. debris)
+};
+
 /// Interface that the application should implement to allow mapping object layers to broadphase layers
 class JPH_EXPORT BroadPhaseLayerInterface : public NonCopyable
 {
@@ -69,6 +77,12 @@ public:
 	/// Convert an object layer to the corresponding broadphase layer
 	virtual BroadPhaseLayer			GetBroadPhaseLayer(ObjectLayer inLayer) const = 0;
 
+	/// Get the acceleration structure that should be used to store the bodies of a broadphase layer (only used by BroadPhaseQuadTree, queried once during PhysicsSystem::Init)
+	virtual EBroadPhaseLayerType	GetBroadPhaseLayerType([[maybe_unused]] BroadPhaseLayer inLayer) const
+	{
+		return EBroadPhaseLayerType::QuadTree;
+	}
+
 #if defined(JPH_EXTERNAL_PROFILE) || defined(JPH_PROFILE_ENABLED)
 	/// Get the user readable name of a broadphase layer (debugging purposes)
 	virtual const char *			GetBroadPhaseLayerName(BroadPhaseLayer inLayer) const = 0;
@@ -20,6 +20,7 @@ public:
 		mNumBroadPhaseLayers(inNumBroadPhaseLayers)
 	{
 		mObjectToBroadPhase.resize(inNumObjectLayers, BroadPhaseLayer(0));
+		mBroadPhaseLayerTypes.resize(inNumBroadPhaseLayers, EBroadPhaseLayerType::QuadTree);
 #if defined(JPH_EXTERNAL_PROFILE) || defined(JPH_PROFILE_ENABLED)
 		mBroadPhaseLayerNames.resize(inNumBroadPhaseLayers, "Undefined");
 #endif // JPH_EXTERNAL_PROFILE || JPH_PROFILE_ENABLED
@@ -41,6 +42,16 @@ public:
 		return mObjectToBroadPhase[inLayer];
 	}
 
+	void					SetBroadPhaseLayerType(BroadPhaseLayer inLayer, EBroadPhaseLayerType inType)
+	{
+		mBroadPhaseLayerTypes[(BroadPhaseLayer::Type)inLayer] = inType;
+	}
+
+	virtual EBroadPhaseLayerType GetBroadPhaseLayerType(BroadPhaseLayer inLayer) const override
+	{
+		return mBroadPhaseLayerTypes[(BroadPhaseLayer::Type)inLayer];
+	}
+
 #if defined(JPH_EXTERNAL_PROFILE) || defined(JPH_PROFILE_ENABLED)
 	void					SetBroadPhaseLayerName(BroadPhaseLayer inLayer, const char *inName)
 	{
@@ -56,6 +67,7 @@ public:
 private:
 	uint					mNumBroadPhaseLayers;
 	Array<BroadPhaseLayer>	mObjectToBroadPhase;
+	Array<EBroadPhaseLayerType> mBroadPhaseLayerTypes;
 #if defined(JPH_EXTERNAL_PROFILE) || defined(JPH_PROFILE_ENABLED)
 	Array<const char *>		mBroadPhaseLayerNames;
 #endif // JPH_EXTERNAL_PROFILE || JPH_PROFILE_ENABLED
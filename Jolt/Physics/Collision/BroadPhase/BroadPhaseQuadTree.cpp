@@ -7,13 +7,17 @@
 #include <Jolt/Physics/Collision/RayCast.h>
 #include <Jolt/Physics/Collision/AABoxCast.h>
 #include <Jolt/Physics/Collision/CastResult.h>
-#include <Jolt/Core/QuickSort.h>
+#include <Jolt/Physics/Body/BodyPair.h>
+#include <Jolt/Core/Atomics.h>
 
 JPH_NAMESPACE_BEGIN
 
 BroadPhaseQuadTree::~BroadPhaseQuadTree()
 {
 	delete [] mLayers;
+	delete [] mSweepAndPrunes;
+	delete [] mHashGrids;
+	delete [] mPairCacheTravel;
 }
 
 void BroadPhaseQuadTree::Init(BodyManager *inBodyManager, const BroadPhaseLayerInterface &inLayerInterface)
@@ -53,6 +57,58 @@ void BroadPhaseQuadTree::Init(BodyManager *inBodyManager, const BroadPhaseLayerI
 		mLayers[l].SetName(inLayerInterface.GetBroadPhaseLayerName(BroadPhaseLayer(BroadPhaseLayer::Type(l))));
 #endif // JPH_EXTERNAL_PROFILE || JPH_PROFILE_ENABLED
 	}
+
+	// Determine which structure each layer uses, the sorted lists and hash grids are empty until they are used so we create one for every layer
+	mLayerTypes.resize(mNumLayers);
+	mSweepAndPrunes = new SweepAndPrune [mNumLayers];
+	mHashGrids = new HashGrid [mNumLayers];
+	for (uint l = 0; l < mNumLayers; ++l)
+	{
+		mLayerTypes[l] = inLayerInterface.GetBroadPhaseLayerType(BroadPhaseLayer(BroadPhaseLayer::Type(l)));
+		if (mLayerTypes[l] == EBroadPhaseLayerType::HashGrid)
+			mHashGrids[l].Init(uint(mMaxBodies));
+	}
+
+	// Init travel distances for the pair cache
+	mPairCacheTravel = new PairCacheTravel [mNumLayers];
+}
+
+void BroadPhaseQuadTree::SetPairCache(bool inEnabled, float inMargin, float inVelocityScale)
+{
+	JPH_ASSERT(inMargin >= 0.0f && inVelocityScale >= 0.0f);
+
+	// Store parameters, they will be used the next time candidates are collected
+	mPairCacheMargin = inMargin;
+	mPairCacheVelocityScale = inVelocityScale;
+
+	if (inEnabled == mPairCacheEnabled)
+		return;
+	mPairCacheEnabled = inEnabled;
+
+	if (inEnabled)
+	{
+		JPH_PROFILE_FUNCTION();
+
+		// Start tracking the bounds of all bodies that are in the broadphase
+		const BodyVector &bodies = mBodyManager->GetBodies();
+		mPairCache.resize(mMaxBodies);
+		for (size_t i = 0; i < mMaxBodies; ++i)
+			if (mTracking[i].mBroadPhaseLayer != (BroadPhaseLayer::Type)cBroadPhaseLayerInvalid)
+			{
+				PairCacheEntry &entry = mPairCache[i];
+				entry.mLastBounds = bodies[i]->GetWorldSpaceBounds();
+				entry.mIntervalIndex = cInvalidPairCacheInterval;
+			}
+
+		// Make sure no stale entries are used
+		++mPairCacheEpoch;
+	}
+	else
+	{
+		// Free the memory
+		mPairCache.clear();
+		mPairCache.shrink_to_fit();
+	}
 }
 
 void BroadPhaseQuadTree::FrameSync()
@@ -77,16 +133,28 @@ void BroadPhaseQuadTree::Optimize()
 
 	LockModifications();
 
+	BodyVector &bodies = mBodyManager->GetBodies();
 	for (uint l = 0; l < mNumLayers; ++l)
-	{
-		QuadTree &tree = mLayers[l];
-		if (tree.HasBodies())
-		{
-			QuadTree::UpdateState update_state;
-			tree.UpdatePrepare(mBodyManager->GetBodies(), mTracking, update_state, true);
-			tree.UpdateFinalize(mBodyManager->GetBodies(), mTracking, update_state);
-		}
-	}
+		DispatchLayer(l,
+			[this, &bodies](QuadTree &inTree)
+			{
+				if (inTree.HasBodies())
+				{
+					QuadTree::UpdateState update_state;
+					inTree.UpdatePrepare(bodies, mTracking, update_state, true);
+					inTree.UpdateFinalize(bodies, mTracking, update_state);
+				}
+			},
+			[&bodies](SweepAndPrune &inSAP)
+			{
+				if (inSAP.UpdatePrepare(bodies))
+					inSAP.UpdateFinalize();
+			},
+			[&bodies](HashGrid &inGrid)
+			{
+				if (inGrid.UpdatePrepare())
+					inGrid.UpdateFinalize(bodies);
+			});
 
 	UnlockModifications();
 
@@ -108,6 +176,15 @@ BroadPhase::UpdateState BroadPhaseQuadTree::UpdatePrepare()
 	UpdateState update_state;
 	UpdateStateImpl *update_state_impl = reinterpret_cast<UpdateStateImpl *>(&update_state);
 
+	// Resort the lists of all sweep and prune layers in which bodies moved and prepare the hash grids, this is cheap compared to rebuilding a tree.
+	// Each structure remembers if it needs to be finalized so we don't need to store anything in the update state.
+	const BodyVector &bodies = mBodyManager->GetBodies();
+	for (uint l = 0; l < mNumLayers; ++l)
+		DispatchLayer(l,
+			[](QuadTree &) { },
+			[&bodies](SweepAndPrune &inSAP) { inSAP.UpdatePrepare(bodies); },
+			[](HashGrid &inGrid) { inGrid.UpdatePrepare(); });
+
 	// Loop until we've seen all layers
 	for (uint iteration = 0; iteration < mNumLayers; ++iteration)
 	{
@@ -118,12 +195,32 @@ BroadPhase::UpdateState BroadPhaseQuadTree::UpdatePrepare()
 		// If it is dirty we update this one
 		if (tree.HasBodies() && tree.IsDirty() && tree.CanBeUpdated())
 		{
+			// Piggyback on the update to also rebuild the parts of the tree that degraded the most
+			tree.MarkWorstSubtreesChanged(mIncrementalOptimizationBudget);
+
 			update_state_impl->mTree = &tree;
-			tree.UpdatePrepare(mBodyManager->GetBodies(), mTracking, update_state_impl->mUpdateState, false);
+			tree.UpdatePrepare(bodies, mTracking, update_state_impl->mUpdateState, false);
 			return update_state;
 		}
 	}
 
+	// No tree is dirty, use this update to incrementally optimize one of the trees
+	if (mIncrementalOptimizationBudget > 0)
+		for (uint iteration = 0; iteration < mNumLayers; ++iteration)
+		{
+			// Get the layer
+			QuadTree &tree = mLayers[mNextLayerToUpdate];
+			mNextLayerToUpdate = (mNextLayerToUpdate + 1) % mNumLayers;
+
+			// Rebuild the worst subtrees of this tree if it has degraded
+			if (tree.HasBodies() && tree.CanBeUpdated() && tree.MarkWorstSubtreesChanged(mIncrementalOptimizationBudget))
+			{
+				update_state_impl->mTree = &tree;
+				tree.UpdatePrepare(bodies, mTracking, update_state_impl->mUpdateState, false);
+				return update_state;
+			}
+		}
+
 	// Nothing to update
 	update_state_impl->mTree = nullptr;
 	return update_state;
@@ -134,12 +231,31 @@ void BroadPhaseQuadTree::UpdateFinalize(const UpdateState &inUpdateState)
 	// LockModifications should have been called
 	JPH_ASSERT(mUpdateMutex.is_locked());
 
+	// Start a new travel interval for the pair cache
+	if (mPairCacheEnabled)
+	{
+		for (BroadPhaseLayer::Type l = 0; l < mNumLayers; ++l)
+		{
+			PairCacheTravel &travel = mPairCacheTravel[l];
+			travel.mCommitted += double(travel.mPending.exchange(0.0f, memory_order_relaxed));
+		}
+		mPairCacheIntervalIndex = (mPairCacheIntervalIndex + 1) % cInvalidPairCacheInterval;
+	}
+
+	// Swap in the resorted lists and move the bodies in the hash grids to their new cells
+	const BodyVector &bodies = mBodyManager->GetBodies();
+	for (uint l = 0; l < mNumLayers; ++l)
+		DispatchLayer(l,
+			[](QuadTree &) { },
+			[](SweepAndPrune &inSAP) { inSAP.UpdateFinalize(); },
+			[&bodies](HashGrid &inGrid) { inGrid.UpdateFinalize(bodies); });
+
 	// Test if a tree was updated
 	const UpdateStateImpl *update_state_impl = reinterpret_cast<const UpdateStateImpl *>(&inUpdateState);
 	if (update_state_impl->mTree == nullptr)
 		return;
 
-	update_state_impl->mTree->UpdateFinalize(mBodyManager->GetBodies(), mTracking, update_state_impl->mUpdateState);
+	update_state_impl->mTree->UpdateFinalize(bodies, mTracking, update_state_impl->mUpdateState);
 
 	// Make all queries from now on use the new lock
 	mQueryLockIdx = mQueryLockIdx ^ 1;
@@ -162,44 +278,36 @@ BroadPhase::AddState BroadPhaseQuadTree::AddBodiesPrepare(BodyID *ioBodies, int
 
 	LayerState *state = new LayerState [mNumLayers];
 
-	// Sort bodies on layer
+	// Sort bodies on layer and handle each layer separately
 	Body * const * const bodies_ptr = bodies.data(); // C pointer or else sort is incredibly slow in debug mode
-	QuickSort(ioBodies, ioBodies + inNumber, [bodies_ptr](BodyID inLHS, BodyID inRHS) { return bodies_ptr[inLHS.GetIndex()]->GetBroadPhaseLayer() < bodies_ptr[inRHS.GetIndex()]->GetBroadPhaseLayer(); });
-
-	BodyID *b_start = ioBodies, *b_end = ioBodies + inNumber;
-	while (b_start < b_end)
+	sForEachLayer(ioBodies, inNumber, [bodies_ptr](BodyID inBodyID) { return (BroadPhaseLayer::Type)bodies_ptr[inBodyID.GetIndex()]->GetBroadPhaseLayer(); }, [this, &bodies, state](BroadPhaseLayer::Type inLayer, BodyID *inStart, BodyID *inEnd)
 	{
-		// Get broadphase layer
-		BroadPhaseLayer::Type broadphase_layer = (BroadPhaseLayer::Type)bodies[b_start->GetIndex()]->GetBroadPhaseLayer();
-		JPH_ASSERT(broadphase_layer < mNumLayers);
-
-		// Find first body with different layer
-		BodyID *b_mid = std::upper_bound(b_start, b_end, broadphase_layer, [bodies_ptr](BroadPhaseLayer::Type inLayer, BodyID inBodyID) { return inLayer < (BroadPhaseLayer::Type)bodies_ptr[inBodyID.GetIndex()]->GetBroadPhaseLayer(); });
+		JPH_ASSERT(inLayer < mNumLayers);
 
 		// Keep track of state for this layer
-		LayerState &layer_state = state[broadphase_layer];
-		layer_state.mBodyStart = b_start;
-		layer_state.mBodyEnd = b_mid;
+		LayerState &layer_state = state[inLayer];
+		layer_state.mBodyStart = inStart;
+		layer_state.mBodyEnd = inEnd;
 
-		// Insert all bodies of the same layer
-		mLayers[broadphase_layer].AddBodiesPrepare(bodies, mTracking, b_start, int(b_mid - b_start), layer_state.mAddState);
+		// Prepare inserting all bodies of the same layer, sorted lists and hash grids are cheap to insert into so they only insert during AddBodiesFinalize
+		DispatchLayer(inLayer,
+			[this, &bodies, &layer_state, inStart, inEnd](QuadTree &inTree) { inTree.AddBodiesPrepare(bodies, mTracking, inStart, int(inEnd - inStart), layer_state.mAddState); },
+			[](SweepAndPrune &) { },
+			[](HashGrid &) { });
 
 		// Keep track in which tree we placed the object
-		for (const BodyID *b = b_start; b < b_mid; ++b)
+		for (const BodyID *b = inStart; b < inEnd; ++b)
 		{
 			uint32 index = b->GetIndex();
 			JPH_ASSERT(bodies[index]->GetID() == *b, "Provided BodyID doesn't match BodyID in body manager");
 			JPH_ASSERT(!bodies[index]->IsInBroadPhase());
 			Tracking &t = mTracking[index];
 			JPH_ASSERT(t.mBroadPhaseLayer == (BroadPhaseLayer::Type)cBroadPhaseLayerInvalid);
-			t.mBroadPhaseLayer = broadphase_layer;
+			t.mBroadPhaseLayer = inLayer;
 			JPH_ASSERT(t.mObjectLayer == cObjectLayerInvalid);
 			t.mObjectLayer = bodies[index]->GetObjectLayer();
 		}
-
-		// Repeat
-		b_start = b_mid;
-	}
+	});
 
 	return state;
 }
@@ -222,7 +330,11 @@ void BroadPhaseQuadTree::AddBodiesFinalize(BodyID *ioBodies, int inNumber, AddSt
 		if (l.mBodyStart != nullptr)
 		{
 			// Insert all bodies of the same layer
-			mLayers[broadphase_layer].AddBodiesFinalize(mTracking, int(l.mBodyEnd - l.mBodyStart), l.mAddState);
+			int num_bodies = int(l.mBodyEnd - l.mBodyStart);
+			DispatchLayer(broadphase_layer,
+				[this, &l, num_bodies](QuadTree &inTree) { inTree.AddBodiesFinalize(mTracking, num_bodies, l.mAddState); },
+				[&bodies, &l, num_bodies](SweepAndPrune &inSAP) { inSAP.AddBodies(bodies, l.mBodyStart, num_bodies); },
+				[&bodies, &l, num_bodies](HashGrid &inGrid) { inGrid.AddBodies(bodies, l.mBodyStart, num_bodies); });
 
 			// Mark added to broadphase
 			for (const BodyID *b = l.mBodyStart; b < l.mBodyEnd; ++b)
@@ -233,10 +345,21 @@ void BroadPhaseQuadTree::AddBodiesFinalize(BodyID *ioBodies, int inNumber, AddSt
 				JPH_ASSERT(mTracking[index].mObjectLayer == bodies[index]->GetObjectLayer());
 				JPH_ASSERT(!bodies[index]->IsInBroadPhase());
 				bodies[index]->SetInBroadPhaseInternal(true);
+
+				// Start tracking the bounds for the pair cache
+				if (mPairCacheEnabled)
+				{
+					PairCacheEntry &entry = mPairCache[index];
+					entry.mLastBounds = bodies[index]->GetWorldSpaceBounds();
+					entry.mIntervalIndex = cInvalidPairCacheInterval;
+				}
 			}
 		}
 	}
 
+	// Cached pairs don't include the new bodies
+	++mPairCacheEpoch;
+
 	delete [] state;
 }
 
@@ -254,8 +377,11 @@ void BroadPhaseQuadTree::AddBodiesAbort(BodyID *ioBodies, int inNumber, AddState
 		const LayerState &l = state[broadphase_layer];
 		if (l.mBodyStart != nullptr)
 		{
-			// Insert all bodies of the same layer
-			mLayers[broadphase_layer].AddBodiesAbort(mTracking, l.mAddState);
+			// Abort inserting all bodies of the same layer
+			DispatchLayer(broadphase_layer,
+				[this, &l](QuadTree &inTree) { inTree.AddBodiesAbort(mTracking, l.mAddState); },
+				[](SweepAndPrune &) { },
+				[](HashGrid &) { });
 
 			// Reset bookkeeping
 			for (const BodyID *b = l.mBodyStart; b < l.mBodyEnd; ++b)
@@ -286,24 +412,20 @@ void BroadPhaseQuadTree::RemoveBodies(BodyID *ioBodies, int inNumber)
 	BodyVector &bodies = mBodyManager->GetBodies();
 	JPH_ASSERT(mMaxBodies == mBodyManager->GetMaxBodies());
 
-	// Sort bodies on layer
+	// Sort bodies on layer and handle each layer separately
 	Tracking *tracking = mTracking.data(); // C pointer or else sort is incredibly slow in debug mode
-	QuickSort(ioBodies, ioBodies + inNumber, [tracking](BodyID inLHS, BodyID inRHS) { return tracking[inLHS.GetIndex()].mBroadPhaseLayer < tracking[inRHS.GetIndex()].mBroadPhaseLayer; });
-
-	BodyID *b_start = ioBodies, *b_end = ioBodies + inNumber;
-	while (b_start < b_end)
+	sForEachLayer(ioBodies, inNumber, [tracking](BodyID inBodyID) { return (BroadPhaseLayer::Type)tracking[inBodyID.GetIndex()].mBroadPhaseLayer; }, [this, &bodies, tracking](BroadPhaseLayer::Type inLayer, BodyID *inStart, BodyID *inEnd)
 	{
-		// Get broad phase layer
-		BroadPhaseLayer::Type broadphase_layer = mTracking[b_start->GetIndex()].mBroadPhaseLayer;
-		JPH_ASSERT(broadphase_layer != (BroadPhaseLayer::Type)cBroadPhaseLayerInvalid);
-
-		// Find first body with different layer
-		BodyID *b_mid = std::upper_bound(b_start, b_end, broadphase_layer, [tracking](BroadPhaseLayer::Type inLayer, BodyID inBodyID) { return inLayer < tracking[inBodyID.GetIndex()].mBroadPhaseLayer; });
+		JPH_ASSERT(inLayer != (BroadPhaseLayer::Type)cBroadPhaseLayerInvalid);
 
 		// Remove all bodies of the same layer
-		mLayers[broadphase_layer].RemoveBodies(bodies, mTracking, b_start, int(b_mid - b_start));
+		int num_bodies = int(inEnd - inStart);
+		DispatchLayer(inLayer,
+			[this, &bodies, inStart, num_bodies](QuadTree &inTree) { inTree.RemoveBodies(bodies, mTracking, inStart, num_bodies); },
+			[inStart, num_bodies](SweepAndPrune &inSAP) { inSAP.RemoveBodies(inStart, num_bodies); },
+			[inStart, num_bodies](HashGrid &inGrid) { inGrid.RemoveBodies(inStart, num_bodies); });
 
-		for (const BodyID *b = b_start; b < b_mid; ++b)
+		for (const BodyID *b = inStart; b < inEnd; ++b)
 		{
 			// Reset bookkeeping
 			uint32 index = b->GetIndex();
@@ -315,10 +437,10 @@ void BroadPhaseQuadTree::RemoveBodies(BodyID *ioBodies, int inNumber)
 			JPH_ASSERT(bodies[index]->IsInBroadPhase());
 			bodies[index]->SetInBroadPhaseInternal(false);
 		}
+	});
 
-		// Repeat
-		b_start = b_mid;
-	}
+	// Cached pairs may refer to the removed bodies
+	++mPairCacheEpoch;
 }
 
 void BroadPhaseQuadTree::NotifyBodiesAABBChanged(BodyID *ioBodies, int inNumber, bool inTakeLock)
@@ -336,26 +458,23 @@ void BroadPhaseQuadTree::NotifyBodiesAABBChanged(BodyID *ioBodies, int inNumber,
 	const BodyVector &bodies = mBodyManager->GetBodies();
 	JPH_ASSERT(mMaxBodies == mBodyManager->GetMaxBodies());
 
-	// Sort bodies on layer
+	// Sort bodies on layer and handle each layer separately
 	const Tracking *tracking = mTracking.data(); // C pointer or else sort is incredibly slow in debug mode
-	QuickSort(ioBodies, ioBodies + inNumber, [tracking](BodyID inLHS, BodyID inRHS) { return tracking[inLHS.GetIndex()].mBroadPhaseLayer < tracking[inRHS.GetIndex()].mBroadPhaseLayer; });
-
-	BodyID *b_start = ioBodies, *b_end = ioBodies + inNumber;
-	while (b_start < b_end)
+	sForEachLayer(ioBodies, inNumber, [tracking](BodyID inBodyID) { return (BroadPhaseLayer::Type)tracking[inBodyID.GetIndex()].mBroadPhaseLayer; }, [this, &bodies](BroadPhaseLayer::Type inLayer, const BodyID *inStart, const BodyID *inEnd)
 	{
-		// Get broadphase layer
-		BroadPhaseLayer::Type broadphase_layer = tracking[b_start->GetIndex()].mBroadPhaseLayer;
-		JPH_ASSERT(broadphase_layer != (BroadPhaseLayer::Type)cBroadPhaseLayerInvalid);
-
-		// Find first body with different layer
-		BodyID *b_mid = std::upper_bound(b_start, b_end, broadphase_layer, [tracking](BroadPhaseLayer::Type inLayer, BodyID inBodyID) { return inLayer < tracking[inBodyID.GetIndex()].mBroadPhaseLayer; });
+		JPH_ASSERT(inLayer != (BroadPhaseLayer::Type)cBroadPhaseLayerInvalid);
 
 		// Nodify all bodies of the same layer changed
-		mLayers[broadphase_layer].NotifyBodiesAABBChanged(bodies, mTracking, b_start, int(b_mid - b_start));
+		int num_bodies = int(inEnd - inStart);
+		DispatchLayer(inLayer,
+			[this, &bodies, inStart, num_bodies](QuadTree &inTree) { inTree.NotifyBodiesAABBChanged(bodies, mTracking, inStart, num_bodies); },
+			[&bodies, inStart, num_bodies](SweepAndPrune &inSAP) { inSAP.NotifyBodiesAABBChanged(bodies, inStart, num_bodies); },
+			[&bodies, inStart, num_bodies](HashGrid &inGrid) { inGrid.NotifyBodiesAABBChanged(bodies, inStart, num_bodies); });
 
-		// Repeat
-		b_start = b_mid;
-	}
+		// Keep track of how far the bodies moved for the pair cache
+		if (mPairCacheEnabled)
+			UpdatePairCacheTravel(inLayer, inStart, int(inEnd - inStart));
+	});
 
 	if (inTakeLock)
 		PhysicsLock::sUnlockShared(mUpdateMutex JPH_IF_ENABLE_ASSERTS(, mLockContext, EPhysicsLockTypes::BroadPhaseUpdate));
@@ -388,6 +507,9 @@ void BroadPhaseQuadTree::NotifyBodiesLayerChanged(BodyID *ioBodies, int inNumber
 		}
 	}
 
+	// Cached pairs were filtered using the old object layers
+	++mPairCacheEpoch;
+
 	if (inNumber > 0)
 	{
 		// Changing layer requires us to remove from one tree and add to another, so this is equivalent to removing all bodies first and then adding them again
@@ -397,139 +519,81 @@ void BroadPhaseQuadTree::NotifyBodiesLayerChanged(BodyID *ioBodies, int inNumber
 	}
 }
 
-void BroadPhaseQuadTree::CastRay(const RayCast &inRay, RayCastBodyCollector &ioCollector, const BroadPhaseLayerFilter &inBroadPhaseLayerFilter, const ObjectLayerFilter &inObjectLayerFilter) const
+template <class Collector, class Query>
+inline void BroadPhaseQuadTree::QueryLayers(const BroadPhaseLayerFilter &inBroadPhaseLayerFilter, const Collector &inCollector, const Query &inQuery) const
 {
-	JPH_PROFILE_FUNCTION();
-
+	const BodyVector &bodies = mBodyManager->GetBodies();
 	JPH_ASSERT(mMaxBodies == mBodyManager->GetMaxBodies());
 
-	// Prevent this from running in parallel with node deletion in FrameSync(), see notes there
-	shared_lock lock(mQueryLocks[mQueryLockIdx]);
-
 	// Loop over all layers and test the ones that could hit
 	for (BroadPhaseLayer::Type l = 0; l < mNumLayers; ++l)
-	{
-		const QuadTree &tree = mLayers[l];
-		if (tree.HasBodies() && inBroadPhaseLayerFilter.ShouldCollide(BroadPhaseLayer(l)))
+		if (LayerHasBodies(l) && inBroadPhaseLayerFilter.ShouldCollide(BroadPhaseLayer(l)))
 		{
-			JPH_PROFILE(tree.GetName());
-			tree.CastRay(inRay, ioCollector, inObjectLayerFilter, mTracking);
-			if (ioCollector.ShouldEarlyOut())
+			DispatchLayer(l,
+				[this, &inQuery](const QuadTree &inTree) { JPH_PROFILE(inTree.GetName()); inQuery(inTree, mTracking); },
+				[&inQuery, &bodies](const SweepAndPrune &inSAP) { inQuery(inSAP, bodies); },
+				[&inQuery, &bodies](const HashGrid &inGrid) { inQuery(inGrid, bodies); });
+
+			if (inCollector.ShouldEarlyOut())
 				break;
 		}
-	}
 }
 
-void BroadPhaseQuadTree::CollideAABox(const AABox &inBox, CollideShapeBodyCollector &ioCollector, const BroadPhaseLayerFilter &inBroadPhaseLayerFilter, const ObjectLayerFilter &inObjectLayerFilter) const
+void BroadPhaseQuadTree::CastRay(const RayCast &inRay, RayCastBodyCollector &ioCollector, const BroadPhaseLayerFilter &inBroadPhaseLayerFilter, const ObjectLayerFilter &inObjectLayerFilter) const
 {
 	JPH_PROFILE_FUNCTION();
 
-	JPH_ASSERT(mMaxBodies == mBodyManager->GetMaxBodies());
+	// Prevent this from running in parallel with node deletion in FrameSync(), see notes there
+	shared_lock lock(mQueryLocks[mQueryLockIdx]);
+
+	QueryLayers(inBroadPhaseLayerFilter, ioCollector, [&](const auto &inLayer, const auto &inBodies) { inLayer.CastRay(inRay, ioCollector, inObjectLayerFilter, inBodies); });
+}
+
+void BroadPhaseQuadTree::CollideAABox(const AABox &inBox, CollideShapeBodyCollector &ioCollector, const BroadPhaseLayerFilter &inBroadPhaseLayerFilter, const ObjectLayerFilter &inObjectLayerFilter) const
+{
+	JPH_PROFILE_FUNCTION();
 
 	// Prevent this from running in parallel with node deletion in FrameSync(), see notes there
 	shared_lock lock(mQueryLocks[mQueryLockIdx]);
 
-	// Loop over all layers and test the ones that could hit
-	for (BroadPhaseLayer::Type l = 0; l < mNumLayers; ++l)
-	{
-		const QuadTree &tree = mLayers[l];
-		if (tree.HasBodies() && inBroadPhaseLayerFilter.ShouldCollide(BroadPhaseLayer(l)))
-		{
-			JPH_PROFILE(tree.GetName());
-			tree.CollideAABox(inBox, ioCollector, inObjectLayerFilter, mTracking);
-			if (ioCollector.ShouldEarlyOut())
-				break;
-		}
-	}
+	QueryLayers(inBroadPhaseLayerFilter, ioCollector, [&](const auto &inLayer, const auto &inBodies) { inLayer.CollideAABox(inBox, ioCollector, inObjectLayerFilter, inBodies); });
 }
 
 void BroadPhaseQuadTree::CollideSphere(Vec3Arg inCenter, float inRadius, CollideShapeBodyCollector &ioCollector, const BroadPhaseLayerFilter &inBroadPhaseLayerFilter, const ObjectLayerFilter &inObjectLayerFilter) const
 {
 	JPH_PROFILE_FUNCTION();
 
-	JPH_ASSERT(mMaxBodies == mBodyManager->GetMaxBodies());
-
 	// Prevent this from running in parallel with node deletion in FrameSync(), see notes there
 	shared_lock lock(mQueryLocks[mQueryLockIdx]);
 
-	// Loop over all layers and test the ones that could hit
-	for (BroadPhaseLayer::Type l = 0; l < mNumLayers; ++l)
-	{
-		const QuadTree &tree = mLayers[l];
-		if (tree.HasBodies() && inBroadPhaseLayerFilter.ShouldCollide(BroadPhaseLayer(l)))
-		{
-			JPH_PROFILE(tree.GetName());
-			tree.CollideSphere(inCenter, inRadius, ioCollector, inObjectLayerFilter, mTracking);
-			if (ioCollector.ShouldEarlyOut())
-				break;
-		}
-	}
+	QueryLayers(inBroadPhaseLayerFilter, ioCollector, [&](const auto &inLayer, const auto &inBodies) { inLayer.CollideSphere(inCenter, inRadius, ioCollector, inObjectLayerFilter, inBodies); });
 }
 
 void BroadPhaseQuadTree::CollidePoint(Vec3Arg inPoint, CollideShapeBodyCollector &ioCollector, const BroadPhaseLayerFilter &inBroadPhaseLayerFilter, const ObjectLayerFilter &inObjectLayerFilter) const
 {
 	JPH_PROFILE_FUNCTION();
 
-	JPH_ASSERT(mMaxBodies == mBodyManager->GetMaxBodies());
-
 	// Prevent this from running in parallel with node deletion in FrameSync(), see notes there
 	shared_lock lock(mQueryLocks[mQueryLockIdx]);
 
-	// Loop over all layers and test the ones that could hit
-	for (BroadPhaseLayer::Type l = 0; l < mNumLayers; ++l)
-	{
-		const QuadTree &tree = mLayers[l];
-		if (tree.HasBodies() && inBroadPhaseLayerFilter.ShouldCollide(BroadPhaseLayer(l)))
-		{
-			JPH_PROFILE(tree.GetName());
-			tree.CollidePoint(inPoint, ioCollector, inObjectLayerFilter, mTracking);
-			if (ioCollector.ShouldEarlyOut())
-				break;
-		}
-	}
+	QueryLayers(inBroadPhaseLayerFilter, ioCollector, [&](const auto &inLayer, const auto &inBodies) { inLayer.CollidePoint(inPoint, ioCollector, inObjectLayerFilter, inBodies); });
 }
 
 void BroadPhaseQuadTree::CollideOrientedBox(const OrientedBox &inBox, CollideShapeBodyCollector &ioCollector, const BroadPhaseLayerFilter &inBroadPhaseLayerFilter, const ObjectLayerFilter &inObjectLayerFilter) const
 {
 	JPH_PROFILE_FUNCTION();
 
-	JPH_ASSERT(mMaxBodies == mBodyManager->GetMaxBodies());
-
 	// Prevent this from running in parallel with node deletion in FrameSync(), see notes there
 	shared_lock lock(mQueryLocks[mQueryLockIdx]);
 
-	// Loop over all layers and test the ones that could hit
-	for (BroadPhaseLayer::Type l = 0; l < mNumLayers; ++l)
-	{
-		const QuadTree &tree = mLayers[l];
-		if (tree.HasBodies() && inBroadPhaseLayerFilter.ShouldCollide(BroadPhaseLayer(l)))
-		{
-			JPH_PROFILE(tree.GetName());
-			tree.CollideOrientedBox(inBox, ioCollector, inObjectLayerFilter, mTracking);
-			if (ioCollector.ShouldEarlyOut())
-				break;
-		}
-	}
+	QueryLayers(inBroadPhaseLayerFilter, ioCollector, [&](const auto &inLayer, const auto &inBodies) { inLayer.CollideOrientedBox(inBox, ioCollector, inObjectLayerFilter, inBodies); });
 }
 
 void BroadPhaseQuadTree::CastAABoxNoLock(const AABoxCast &inBox, CastShapeBodyCollector &ioCollector, const BroadPhaseLayerFilter &inBroadPhaseLayerFilter, const ObjectLayerFilter &inObjectLayerFilter) const
 {
 	JPH_PROFILE_FUNCTION();
 
-	JPH_ASSERT(mMaxBodies == mBodyManager->GetMaxBodies());
-
-	// Loop over all layers and test the ones that could hit
-	for (BroadPhaseLayer::Type l = 0; l < mNumLayers; ++l)
-	{
-		const QuadTree &tree = mLayers[l];
-		if (tree.HasBodies() && inBroadPhaseLayerFilter.ShouldCollide(BroadPhaseLayer(l)))
-		{
-			JPH_PROFILE(tree.GetName());
-			tree.CastAABox(inBox, ioCollector, inObjectLayerFilter, mTracking);
-			if (ioCollector.ShouldEarlyOut())
-				break;
-		}
-	}
+	QueryLayers(inBroadPhaseLayerFilter, ioCollector, [&](const auto &inLayer, const auto &inBodies) { inLayer.CastAABox(inBox, ioCollector, inObjectLayerFilter, inBodies); });
 }
 
 void BroadPhaseQuadTree::CastAABox(const AABoxCast &inBox, CastShapeBodyCollector &ioCollector, const BroadPhaseLayerFilter &inBroadPhaseLayerFilter, const ObjectLayerFilter &inObjectLayerFilter) const
@@ -549,33 +613,134 @@ void BroadPhaseQuadTree::FindCollidingPairs(BodyID *ioActiveBodies, int inNumAct
 
 	// Note that we don't take any locks at this point. We know that the tree is not going to be swapped or deleted while finding collision pairs due to the way the jobs are scheduled in the PhysicsSystem::Update.
 
-	// Sort bodies on layer
+	// Sort bodies on layer and handle each layer separately
 	const Tracking *tracking = mTracking.data(); // C pointer or else sort is incredibly slow in debug mode
-	QuickSort(ioActiveBodies, ioActiveBodies + inNumActiveBodies, [tracking](BodyID inLHS, BodyID inRHS) { return tracking[inLHS.GetIndex()].mObjectLayer < tracking[inRHS.GetIndex()].mObjectLayer; });
+	sForEachLayer(ioActiveBodies, inNumActiveBodies, [tracking](BodyID inBodyID) { return (ObjectLayer)tracking[inBodyID.GetIndex()].mObjectLayer; }, [&](ObjectLayer inObjectLayer, const BodyID *inStart, const BodyID *inEnd)
+	{
+		JPH_ASSERT(inObjectLayer != cObjectLayerInvalid);
 
-	BodyID *b_start = ioActiveBodies, *b_end = ioActiveBodies + inNumActiveBodies;
-	while (b_start < b_end)
+		if (mPairCacheEnabled)
+		{
+			// Reuse the pairs of the previous update where possible
+			FindCollidingPairsCached(inStart, int(inEnd - inStart), inObjectLayer, inSpeculativeContactDistance, inObjectVsBroadPhaseLayerFilter, inObjectLayerPairFilter, ioPairCollector);
+		}
+		else
+		{
+			// Test all layers that could hit
+			DefaultBroadPhaseLayerFilter broadphase_layer_filter(inObjectVsBroadPhaseLayerFilter, inObjectLayer);
+			QueryLayers(broadphase_layer_filter, ioPairCollector, [&](const auto &inLayer, const auto &) { inLayer.FindCollidingPairs(bodies, inStart, int(inEnd - inStart), inSpeculativeContactDistance, ioPairCollector, inObjectLayerPairFilter); });
+		}
+	});
+}
+
+void BroadPhaseQuadTree::UpdatePairCacheTravel(BroadPhaseLayer::Type inBroadPhaseLayer, const BodyID *inBodies, int inNumber)
+{
+	const BodyVector &bodies = mBodyManager->GetBodies();
+
+	// Determine how far the bodies moved since the start of the interval
+	Vec3 max_travel = Vec3::sZero();
+	for (const BodyID *b = inBodies, *b_end = inBodies + inNumber; b < b_end; ++b)
 	{
-		// Get broadphase layer
-		ObjectLayer object_layer = tracking[b_start->GetIndex()].mObjectLayer;
-		JPH_ASSERT(object_layer != cObjectLayerInvalid);
+		PairCacheEntry &entry = mPairCache[b->GetIndex()];
+		if (entry.mIntervalIndex != mPairCacheIntervalIndex)
+		{
+			// First time the body moves this interval, the last reported bounds are the bounds at the start of the interval
+			entry.mIntervalStartBounds = entry.mLastBounds;
+			entry.mIntervalIndex = mPairCacheIntervalIndex;
+		}
+
+		const AABox &bounds = bodies[b->GetIndex()]->GetWorldSpaceBounds();
+		max_travel = Vec3::sMax(max_travel, Vec3::sMax((bounds.mMin - entry.mIntervalStartBounds.mMin).Abs(), (bounds.mMax - entry.mIntervalStartBounds.mMax).Abs()));
+		entry.mLastBounds = bounds;
+	}
 
-		// Find first body with different layer
-		BodyID *b_mid = std::upper_bound(b_start, b_end, object_layer, [tracking](ObjectLayer inLayer, BodyID inBodyID) { return inLayer < tracking[inBodyID.GetIndex()].mObjectLayer; });
+	// Update the maximum travel for this layer
+	AtomicMax(mPairCacheTravel[inBroadPhaseLayer].mPending, max_travel.ReduceMax(), memory_order_relaxed);
+}
 
-		// Loop over all layers and test the ones that could hit
-		for (BroadPhaseLayer::Type l = 0; l < mNumLayers; ++l)
+void BroadPhaseQuadTree::FindCollidingPairsCached(const BodyID *inActiveBodies, int inNumActiveBodies, ObjectLayer inObjectLayer, float inSpeculativeContactDistance, const ObjectVsBroadPhaseLayerFilter &inObjectVsBroadPhaseLayerFilter, const ObjectLayerPairFilter &inObjectLayerPairFilter, BodyPairCollector &ioPairCollector) const
+{
+	JPH_PROFILE_FUNCTION();
+
+	const BodyVector &bodies = mBodyManager->GetBodies();
+
+	// Determine how far the bodies in the layers that we collide with have traveled.
+	// The travel of the current interval is not committed yet, so we conservatively assume that the bodies were at the start of the interval when we collect new candidates.
+	double committed_travel = 0.0, total_travel = 0.0;
+	for (BroadPhaseLayer::Type l = 0; l < mNumLayers; ++l)
+		if (inObjectVsBroadPhaseLayerFilter.ShouldCollide(inObjectLayer, BroadPhaseLayer(l)))
+		{
+			const PairCacheTravel &travel = mPairCacheTravel[l];
+			committed_travel += travel.mCommitted;
+			total_travel += travel.mCommitted + double(travel.mPending.load(memory_order_relaxed));
+		}
+	uint32 epoch = mPairCacheEpoch.load(memory_order_relaxed);
+
+	// Collector that stores all bodies except the body itself
+	class MyCollector : public CollideShapeBodyCollector
+	{
+	public:
+								MyCollector(const BodyID &inBodyID, Array<BodyID> &outCandidates) : mBodyID(inBodyID), mCandidates(outCandidates) { }
+
+		virtual void			AddHit(const BodyID &inBodyID) override
+		{
+			if (inBodyID != mBodyID)
+				mCandidates.push_back(inBodyID);
+		}
+
+	private:
+		BodyID					mBodyID;
+		Array<BodyID> &			mCandidates;
+	};
+
+	DefaultObjectLayerFilter object_layer_filter(inObjectLayerPairFilter, inObjectLayer);
+	DefaultBroadPhaseLayerFilter broadphase_layer_filter(inObjectVsBroadPhaseLayerFilter, inObjectLayer);
+
+	for (const BodyID *b1 = inActiveBodies, *b1_end = inActiveBodies + inNumActiveBodies; b1 < b1_end; ++b1)
+	{
+		BodyID b1_id = *b1;
+		const Body &body1 = *bodies[b1_id.GetIndex()];
+		JPH_ASSERT(!body1.IsStatic());
+
+		// Expand the bounding box by the speculative contact distance
+		AABox bounds1 = body1.GetWorldSpaceBounds();
+		bounds1.ExpandBy(Vec3::sReplicate(inSpeculativeContactDistance));
+
+		// The candidates remain valid as long as the body stays inside its enlarged box and the other bodies didn't travel further than the margin
+		PairCacheEntry &entry = mPairCache[b1_id.GetIndex()];
+		if (entry.mEpoch != epoch
+			|| entry.mObjectLayer != inObjectLayer
+			|| !entry.mFatBounds.Contains(bounds1)
+			|| total_travel - entry.mTravel >= double(entry.mMargin))
 		{
-			const QuadTree &tree = mLayers[l];
-			if (tree.HasBodies() && inObjectVsBroadPhaseLayerFilter.ShouldCollide(object_layer, BroadPhaseLayer(l)))
+			// Enlarge the box of the body, the faster the body moves the larger the box
+			entry.mMargin = mPairCacheMargin + mPairCacheVelocityScale * body1.GetLinearVelocity().Length();
+			entry.mFatBounds = bounds1;
+			entry.mFatBounds.ExpandBy(Vec3::sReplicate(entry.mMargin));
+			entry.mTravel = committed_travel;
+			entry.mEpoch = epoch;
+			entry.mObjectLayer = inObjectLayer;
+
+			// Collect all bodies that could enter the enlarged box before the other bodies have traveled more than the margin
+			AABox query_bounds = entry.mFatBounds;
+			query_bounds.ExpandBy(Vec3::sReplicate(entry.mMargin));
+			entry.mCandidates.clear();
+			MyCollector collector(b1_id, entry.mCandidates);
+			QueryLayers(broadphase_layer_filter, collector, [&](const auto &inLayer, const auto &inBodies) { inLayer.CollideAABox(query_bounds, collector, object_layer_filter, inBodies); });
+		}
+
+		// Report the candidates that currently overlap
+		for (const BodyID &b2_id : entry.mCandidates)
+		{
+			// Collision between dynamic pairs need to be picked up only once
+			const Body &body2 = *bodies[b2_id.GetIndex()];
+			if (Body::sFindCollidingPairsCanCollide(body1, body2)
+				&& bounds1.Overlaps(body2.GetWorldSpaceBounds()))
 			{
-				JPH_PROFILE(tree.GetName());
-				tree.FindCollidingPairs(bodies, b_start, int(b_mid - b_start), inSpeculativeContactDistance, ioPairCollector, inObjectLayerPairFilter);
+				// Store potential hit between bodies
+				ioPairCollector.AddHit({ b1_id, b2_id });
 			}
 		}
-
-		// Repeat
-		b_start = b_mid;
 	}
 }
 
@@ -584,9 +749,13 @@ AABox BroadPhaseQuadTree::GetBounds() const
 	// Prevent this from running in parallel with node deletion in FrameSync(), see notes there
 	shared_lock lock(mQueryLocks[mQueryLockIdx]);
 
+	const BodyVector &bodies = mBodyManager->GetBodies();
 	AABox bounds;
 	for (BroadPhaseLayer::Type l = 0; l < mNumLayers; ++l)
-		bounds.Encapsulate(mLayers[l].GetBounds());
+		bounds.Encapsulate(DispatchLayer(l,
+			[](const QuadTree &inTree) { return inTree.GetBounds(); },
+			[&bodies](const SweepAndPrune &inSAP) { return inSAP.GetBounds(bodies); },
+			[&bodies](const HashGrid &inGrid) { return inGrid.GetBounds(bodies); }));
 	return bounds;
 }
 
@@ -5,12 +5,15 @@
 #pragma once
 
 #include <Jolt/Physics/Collision/BroadPhase/QuadTree.h>
+#include <Jolt/Physics/Collision/BroadPhase/SweepAndPrune.h>
+#include <Jolt/Physics/Collision/BroadPhase/HashGrid.h>
 #include <Jolt/Physics/Collision/BroadPhase/BroadPhase.h>
 #include <Jolt/Physics/PhysicsLock.h>
 
 JPH_NAMESPACE_BEGIN
 
 /// Fast SIMD based quad tree BroadPhase that is multithreading aware and tries to do a minimal amount of locking.
+/// Layers for which BroadPhaseLayerInterface::GetBroadPhaseLayerType returns something other than EBroadPhaseLayerType::QuadTree are stored in a different structure.
 class JPH_EXPORT BroadPhaseQuadTree final : public BroadPhase
 {
 public:
@@ -22,6 +25,8 @@ public:
 	// Implementing interface of BroadPhase (see BroadPhase for documentation)
 	virtual void			Init(BodyManager *inBodyManager, const BroadPhaseLayerInterface &inLayerInterface) override;
 	virtual void			Optimize() override;
+	virtual void			SetIncrementalOptimizationBudget(uint inMaxNodesPerUpdate) override { mIncrementalOptimizationBudget = inMaxNodesPerUpdate; }
+	virtual void			SetPairCache(bool inEnabled, float inMargin, float inVelocityScale) override;
 	virtual void			FrameSync() override;
 	virtual void			LockModifications() override;
 	virtual	UpdateState		UpdatePrepare() override;
@@ -60,6 +65,69 @@ private:
 	using Tracking = QuadTree::Tracking;
 	using TrackingVector = QuadTree::TrackingVector;
 
+	/// Value for PairCacheEntry::mIntervalIndex to indicate that mIntervalStartBounds needs to be initialized
+	static constexpr uint32 cInvalidPairCacheInterval = ~uint32(0);
+
+	/// Cached result of FindCollidingPairs for a single body, see SetPairCache()
+	struct PairCacheEntry
+	{
+		AABox				mFatBounds;								///< Enlarged bounds of the body (including speculative contact distance) at the time the candidates were collected
+		AABox				mLastBounds;							///< World space bounds of the body as last reported through NotifyBodiesAABBChanged
+		AABox				mIntervalStartBounds;					///< World space bounds of the body at the start of travel interval mIntervalIndex
+		Array<BodyID>		mCandidates;							///< All bodies that overlapped mFatBounds expanded by mMargin at the time they were collected
+		double				mTravel = 0.0;							///< Sum of PairCacheTravel::mCommitted of all layers that this body collides with at the time the candidates were collected
+		float				mMargin = 0.0f;							///< Distance that other bodies can travel before the candidates need to be collected again
+		uint32				mEpoch = 0;								///< Value of mPairCacheEpoch when the candidates were collected
+		uint32				mIntervalIndex = cInvalidPairCacheInterval;	///< Index of the travel interval in which mIntervalStartBounds was recorded
+		ObjectLayer			mObjectLayer = cObjectLayerInvalid;		///< Object layer of the body at the time the candidates were collected
+	};
+
+	/// Distance traveled by the bodies in a broad phase layer, used to determine if cached pairs are still valid
+	struct PairCacheTravel
+	{
+		double				mCommitted = 0.0;						///< Sum of the maximum travel of a body in this layer for all completed intervals
+		atomic<float>		mPending { 0.0f };						///< Maximum travel of a body in this layer during the current interval
+	};
+
+	/// Call the function that matches the structure that stores the bodies of broadphase layer inLayer (see EBroadPhaseLayerType) and return its result
+	template <class QuadTreeFunction, class SweepAndPruneFunction, class HashGridFunction>
+	inline auto				DispatchLayer(BroadPhaseLayer::Type inLayer, const QuadTreeFunction &inQuadTree, const SweepAndPruneFunction &inSweepAndPrune, const HashGridFunction &inHashGrid)
+	{
+		switch (mLayerTypes[inLayer])
+		{
+		case EBroadPhaseLayerType::SweepAndPrune:	return inSweepAndPrune(mSweepAndPrunes[inLayer]);
+		case EBroadPhaseLayerType::HashGrid:		return inHashGrid(mHashGrids[inLayer]);
+		default:									return inQuadTree(mLayers[inLayer]);
+		}
+	}
+
+	/// Const version of DispatchLayer, the functions receive a const reference to the structure
+	template <class QuadTreeFunction, class SweepAndPruneFunction, class HashGridFunction>
+	inline auto				DispatchLayer(BroadPhaseLayer::Type inLayer, const QuadTreeFunction &inQuadTree, const SweepAndPruneFunction &inSweepAndPrune, const HashGridFunction &inHashGrid) const
+	{
+		return const_cast<BroadPhaseQuadTree *>(this)->DispatchLayer(inLayer,
+			[&inQuadTree](const QuadTree &inTree) { return inQuadTree(inTree); },
+			[&inSweepAndPrune](const SweepAndPrune &inSAP) { return inSweepAndPrune(inSAP); },
+			[&inHashGrid](const HashGrid &inGrid) { return inHashGrid(inGrid); });
+	}
+
+	/// Check if a broadphase layer contains any bodies
+	inline bool				LayerHasBodies(BroadPhaseLayer::Type inLayer) const
+	{
+		return DispatchLayer(inLayer, [](const QuadTree &inTree) { return inTree.HasBodies(); }, [](const SweepAndPrune &inSAP) { return inSAP.HasBodies(); }, [](const HashGrid &inGrid) { return inGrid.HasBodies(); });
+	}
+
+	/// Call inQuery for every layer that contains bodies and passes inBroadPhaseLayerFilter until inCollector wants to early out.
+	/// inQuery receives the structure of the layer and the data it needs to look up the bodies (mTracking for a QuadTree, the bodies for the other structures).
+	template <class Collector, class Query>
+	inline void				QueryLayers(const BroadPhaseLayerFilter &inBroadPhaseLayerFilter, const Collector &inCollector, const Query &inQuery) const;
+
+	/// Update the travel distances of the pair cache after the bounds of inBodies changed
+	void					UpdatePairCacheTravel(BroadPhaseLayer::Type inBroadPhaseLayer, const BodyID *inBodies, int inNumber);
+
+	/// Find colliding pairs using the pair cache (see FindCollidingPairs)
+	void					FindCollidingPairsCached(const BodyID *inActiveBodies, int inNumActiveBodies, ObjectLayer inObjectLayer, float inSpeculativeContactDistance, const ObjectVsBroadPhaseLayerFilter &inObjectVsBroadPhaseLayerFilter, const ObjectLayerPairFilter &inObjectLayerPairFilter, BodyPairCollector &ioPairCollector) const;
+
 #ifdef JPH_ENABLE_ASSERTS
 	/// Context used to lock a physics lock
 	PhysicsLockContext		mLockContext = nullptr;
@@ -81,6 +149,15 @@ private:
 	QuadTree *				mLayers;
 	uint					mNumLayers;
 
+	/// For each broadphase layer the structure that stores its bodies
+	Array<EBroadPhaseLayerType> mLayerTypes;
+
+	/// One sorted list per broadphase layer, only used by layers of type EBroadPhaseLayerType::SweepAndPrune
+	SweepAndPrune *			mSweepAndPrunes = nullptr;
+
+	/// One hash grid per broadphase layer, only initialized for layers of type EBroadPhaseLayerType::HashGrid
+	HashGrid *				mHashGrids = nullptr;
+
 	/// UpdateState implementation for this tree used during UpdatePrepare/Finalize()
 	struct UpdateStateImpl
 	{
@@ -103,6 +180,26 @@ private:
 
 	/// This is the next tree to update in UpdatePrepare()
 	uint32					mNextLayerToUpdate = 0;
+
+	/// Maximum number of nodes that UpdatePrepare() marks for rebuilding in a single tree (0 = incremental optimization disabled)
+	uint					mIncrementalOptimizationBudget = 0;
+
+	/// Parameters of the pair cache as passed to SetPairCache()
+	bool					mPairCacheEnabled = false;
+	float					mPairCacheMargin = 0.0f;
+	float					mPairCacheVelocityScale = 0.0f;
+
+	/// For each BodyID the cached pairs, only allocated when the pair cache is enabled
+	mutable Array<PairCacheEntry> mPairCache;
+
+	/// Travel distances for each broad phase layer
+	PairCacheTravel *		mPairCacheTravel = nullptr;
+
+	/// Incremented every time bodies are added, removed or change layer, this invalidates all cached pairs
+	atomic<uint32>			mPairCacheEpoch { 1 };
+
+	/// Index of the current travel interval, a new interval starts every UpdateFinalize()
+	uint32					mPairCacheIntervalIndex = 0;
 };
 
 JPH_NAMESPACE_END
@@ -0,0 +1,327 @@
+// Jolt Physics Library (https://github.com/jrouwe/JoltPhysics)
+// SPDX-FileCopyrightText: 2024 Jorrit Rouwe
+// SPDX-License-Identifier: MIT
+
+#include <Jolt/Jolt.h>
+#include <Jolt/Physics/Collision/BroadPhase/BroadPhaseSAP.h>
+
+JPH_NAMESPACE_BEGIN
+
+BroadPhaseSAP::~BroadPhaseSAP()
+{
+	delete [] mLayers;
+}
+
+void BroadPhaseSAP::Init(BodyManager *inBodyManager, const BroadPhaseLayerInterface &inLayerInterface)
+{
+	BroadPhase::Init(inBodyManager, inLayerInterface);
+
+	// Store input parameters
+	mNumLayers = inLayerInterface.GetNumBroadPhaseLayers();
+	JPH_ASSERT(mNumLayers < (BroadPhaseLayer::Type)cBroadPhaseLayerInvalid);
+
+#ifdef JPH_ENABLE_ASSERTS
+	// Store lock context
+	mLockContext = inBodyManager;
+#endif // JPH_ENABLE_ASSERTS
+
+	// Store max bodies
+	mMaxBodies = inBodyManager->GetMaxBodies();
+
+	// Initialize tracking data
+	mTracking.resize(mMaxBodies, (BroadPhaseLayer::Type)cBroadPhaseLayerInvalid);
+
+	// Create the sorted lists
+	mLayers = new SweepAndPrune [mNumLayers];
+}
+
+void BroadPhaseSAP::Optimize()
+{
+	JPH_PROFILE_FUNCTION();
+
+	LockModifications();
+
+	UpdateState update_state = UpdatePrepare();
+	UpdateFinalize(update_state);
+
+	UnlockModifications();
+}
+
+void BroadPhaseSAP::LockModifications()
+{
+	// From this point on we prevent modifications to the lists
+	PhysicsLock::sLock(mUpdateMutex JPH_IF_ENABLE_ASSERTS(, mLockContext, EPhysicsLockTypes::BroadPhaseUpdate));
+}
+
+BroadPhase::UpdateState BroadPhaseSAP::UpdatePrepare()
+{
+	// LockModifications should have been called
+	JPH_ASSERT(mUpdateMutex.is_locked());
+
+	// Resort all lists in which bodies moved, each list remembers if it needs to be finalized so we don't need to store anything in the update state
+	const BodyVector &bodies = mBodyManager->GetBodies();
+	for (uint l = 0; l < mNumLayers; ++l)
+		mLayers[l].UpdatePrepare(bodies);
+
+	return UpdateState();
+}
+
+void BroadPhaseSAP::UpdateFinalize([[maybe_unused]] const UpdateState &inUpdateState)
+{
+	// LockModifications should have been called
+	JPH_ASSERT(mUpdateMutex.is_locked());
+
+	for (uint l = 0; l < mNumLayers; ++l)
+		mLayers[l].UpdateFinalize();
+}
+
+void BroadPhaseSAP::UnlockModifications()
+{
+	// From this point on we allow modifications to the lists again
+	PhysicsLock::sUnlock(mUpdateMutex JPH_IF_ENABLE_ASSERTS(, mLockContext, EPhysicsLockTypes::BroadPhaseUpdate));
+}
+
+void BroadPhaseSAP::AddBodiesFinalize(BodyID *ioBodies, int inNumber, AddState inAddState)
+{
+	JPH_PROFILE_FUNCTION();
+
+	JPH_ASSERT(inNumber > 0);
+
+	// This cannot run concurrently with UpdatePrepare()/UpdateFinalize()
+	SharedLock lock(mUpdateMutex JPH_IF_ENABLE_ASSERTS(, mLockContext, EPhysicsLockTypes::BroadPhaseUpdate));
+
+	BodyVector &bodies = mBodyManager->GetBodies();
+	JPH_ASSERT(mMaxBodies == mBodyManager->GetMaxBodies());
+
+	// Sort bodies on layer and handle each layer separately
+	Body * const * const bodies_ptr = bodies.data(); // C pointer or else sort is incredibly slow in debug mode
+	sForEachLayer(ioBodies, inNumber, [bodies_ptr](BodyID inBodyID) { return (BroadPhaseLayer::Type)bodies_ptr[inBodyID.GetIndex()]->GetBroadPhaseLayer(); }, [this, &bodies](BroadPhaseLayer::Type inLayer, const BodyID *inStart, const BodyID *inEnd)
+	{
+		JPH_ASSERT(inLayer < mNumLayers);
+
+		// Insert all bodies of the same layer
+		mLayers[inLayer].AddBodies(bodies, inStart, int(inEnd - inStart));
+
+		// Keep track in which list we placed the body and mark added to broadphase
+		for (const BodyID *b = inStart; b < inEnd; ++b)
+		{
+			uint32 index = b->GetIndex();
+			JPH_ASSERT(bodies[index]->GetID() == *b, "Provided BodyID doesn't match BodyID in body manager");
+			JPH_ASSERT(!bodies[index]->IsInBroadPhase());
+			JPH_ASSERT(mTracking[index] == (BroadPhaseLayer::Type)cBroadPhaseLayerInvalid);
+			mTracking[index] = inLayer;
+			bodies[index]->SetInBroadPhaseInternal(true);
+		}
+	});
+}
+
+void BroadPhaseSAP::RemoveBodies(BodyID *ioBodies, int inNumber)
+{
+	JPH_PROFILE_FUNCTION();
+
+	JPH_ASSERT(inNumber > 0);
+
+	// This cannot run concurrently with UpdatePrepare()/UpdateFinalize()
+	SharedLock lock(mUpdateMutex JPH_IF_ENABLE_ASSERTS(, mLockContext, EPhysicsLockTypes::BroadPhaseUpdate));
+
+	BodyVector &bodies = mBodyManager->GetBodies();
+	JPH_ASSERT(mMaxBodies == mBodyManager->GetMaxBodies());
+
+	// Sort bodies on layer and handle each layer separately
+	const BroadPhaseLayer::Type *tracking = mTracking.data(); // C pointer or else sort is incredibly slow in debug mode
+	sForEachLayer(ioBodies, inNumber, [tracking](BodyID inBodyID) { return tracking[inBodyID.GetIndex()]; }, [this, &bodies](BroadPhaseLayer::Type inLayer, BodyID *inStart, BodyID *inEnd)
+	{
+		JPH_ASSERT(inLayer != (BroadPhaseLayer::Type)cBroadPhaseLayerInvalid);
+
+		// Reset bookkeeping and mark removed from broadphase
+		for (const BodyID *b = inStart; b < inEnd; ++b)
+		{
+			uint32 index = b->GetIndex();
+			mTracking[index] = (BroadPhaseLayer::Type)cBroadPhaseLayerInvalid;
+			JPH_ASSERT(bodies[index]->IsInBroadPhase());
+			bodies[index]->SetInBroadPhaseInternal(false);
+		}
+
+		// Remove all bodies of the same layer (this sorts the bodies within the layer)
+		mLayers[inLayer].RemoveBodies(inStart, int(inEnd - inStart));
+	});
+}
+
+void BroadPhaseSAP::NotifyBodiesAABBChanged(BodyID *ioBodies, int inNumber, bool inTakeLock)
+{
+	JPH_PROFILE_FUNCTION();
+
+	JPH_ASSERT(inNumber > 0);
+
+	// This cannot run concurrently with UpdatePrepare()/UpdateFinalize()
+	if (inTakeLock)
+		PhysicsLock::sLockShared(mUpdateMutex JPH_IF_ENABLE_ASSERTS(, mLockContext, EPhysicsLockTypes::BroadPhaseUpdate));
+	else
+		JPH_ASSERT(mUpdateMutex.is_locked());
+
+	const BodyVector &bodies = mBodyManager->GetBodies();
+	JPH_ASSERT(mMaxBodies == mBodyManager->GetMaxBodies());
+
+	// Sort bodies on layer and handle each layer separately
+	const BroadPhaseLayer::Type *tracking = mTracking.data(); // C pointer or else sort is incredibly slow in debug mode
+	sForEachLayer(ioBodies, inNumber, [tracking](BodyID inBodyID) { return tracking[inBodyID.GetIndex()]; }, [this, &bodies](BroadPhaseLayer::Type inLayer, const BodyID *inStart, const BodyID *inEnd)
+	{
+		JPH_ASSERT(inLayer != (BroadPhaseLayer::Type)cBroadPhaseLayerInvalid);
+
+		// Notify all bodies of the same layer changed
+		mLayers[inLayer].NotifyBodiesAABBChanged(bodies, inStart, int(inEnd - inStart));
+	});
+
+	if (inTakeLock)
+		PhysicsLock::sUnlockShared(mUpdateMutex JPH_IF_ENABLE_ASSERTS(, mLockContext, EPhysicsLockTypes::BroadPhaseUpdate));
+}
+
+void BroadPhaseSAP::NotifyBodiesLayerChanged(BodyID *ioBodies, int inNumber)
+{
+	JPH_PROFILE_FUNCTION();
+
+	JPH_ASSERT(inNumber > 0);
+
+	// First sort the bodies that actually changed broadphase layer to beginning of the array, the object layer is read from the body directly
+	const BodyVector &bodies = mBodyManager->GetBodies();
+	JPH_ASSERT(mMaxBodies == mBodyManager->GetMaxBodies());
+	for (BodyID *body_id = ioBodies + inNumber - 1; body_id >= ioBodies; --body_id)
+	{
+		uint32 index = body_id->GetIndex();
+		JPH_ASSERT(bodies[index]->GetID() == *body_id, "Provided BodyID doesn't match BodyID in body manager");
+		BroadPhaseLayer::Type broadphase_layer = (BroadPhaseLayer::Type)bodies[index]->GetBroadPhaseLayer();
+		JPH_ASSERT(broadphase_layer < mNumLayers);
+		if (mTracking[index] == broadphase_layer)
+		{
+			// Move the body to the end, layer didn't change
+			swap(*body_id, ioBodies[inNumber - 1]);
+			--inNumber;
+		}
+	}
+
+	if (inNumber > 0)
+	{
+		// Changing layer requires us to remove from one list and add to another
+		RemoveBodies(ioBodies, inNumber);
+		AddBodiesFinalize(ioBodies, inNumber, nullptr);
+	}
+}
+
+template <class Collector, class Query>
+inline void BroadPhaseSAP::QueryLayers(const BroadPhaseLayerFilter &inBroadPhaseLayerFilter, const Collector &inCollector, const Query &inQuery) const
+{
+	// Loop over all layers and test the ones that could hit
+	for (BroadPhaseLayer::Type l = 0; l < mNumLayers; ++l)
+	{
+		const SweepAndPrune &layer = mLayers[l];
+		if (layer.HasBodies() && inBroadPhaseLayerFilter.ShouldCollide(BroadPhaseLayer(l)))
+		{
+			inQuery(layer);
+			if (inCollector.ShouldEarlyOut())
+				break;
+		}
+	}
+}
+
+void BroadPhaseSAP::CastRay(const RayCast &inRay, RayCastBodyCollector &ioCollector, const BroadPhaseLayerFilter &inBroadPhaseLayerFilter, const ObjectLayerFilter &inObjectLayerFilter) const
+{
+	JPH_PROFILE_FUNCTION();
+
+	const BodyVector &bodies = mBodyManager->GetBodies();
+
+	QueryLayers(inBroadPhaseLayerFilter, ioCollector, [&](const SweepAndPrune &inLayer) { inLayer.CastRay(inRay, ioCollector, inObjectLayerFilter, bodies); });
+}
+
+void BroadPhaseSAP::CollideAABox(const AABox &inBox, CollideShapeBodyCollector &ioCollector, const BroadPhaseLayerFilter &inBroadPhaseLayerFilter, const ObjectLayerFilter &inObjectLayerFilter) const
+{
+	JPH_PROFILE_FUNCTION();
+
+	const BodyVector &bodies = mBodyManager->GetBodies();
+
+	QueryLayers(inBroadPhaseLayerFilter, ioCollector, [&](const SweepAndPrune &inLayer) { inLayer.CollideAABox(inBox, ioCollector, inObjectLayerFilter, bodies); });
+}
+
+void BroadPhaseSAP::CollideSphere(Vec3Arg inCenter, float inRadius, CollideShapeBodyCollector &ioCollector, const BroadPhaseLayerFilter &inBroadPhaseLayerFilter, const ObjectLayerFilter &inObjectLayerFilter) const
+{
+	JPH_PROFILE_FUNCTION();
+
+	const BodyVector &bodies = mBodyManager->GetBodies();
+
+	QueryLayers(inBroadPhaseLayerFilter, ioCollector, [&](const SweepAndPrune &inLayer) { inLayer.CollideSphere(inCenter, inRadius, ioCollector, inObjectLayerFilter, bodies); });
+}
+
+void BroadPhaseSAP::CollidePoint(Vec3Arg inPoint, CollideShapeBodyCollector &ioCollector, const BroadPhaseLayerFilter &inBroadPhaseLayerFilter, const ObjectLayerFilter &inObjectLayerFilter) const
+{
+	JPH_PROFILE_FUNCTION();
+
+	const BodyVector &bodies = mBodyManager->GetBodies();
+
+	QueryLayers(inBroadPhaseLayerFilter, ioCollector, [&](const SweepAndPrune &inLayer) { inLayer.CollidePoint(inPoint, ioCollector, inObjectLayerFilter, bodies); });
+}
+
+void BroadPhaseSAP::CollideOrientedBox(const OrientedBox &inBox, CollideShapeBodyCollector &ioCollector, const BroadPhaseLayerFilter &inBroadPhaseLayerFilter, const ObjectLayerFilter &inObjectLayerFilter) const
+{
+	JPH_PROFILE_FUNCTION();
+
+	const BodyVector &bodies = mBodyManager->GetBodies();
+
+	QueryLayers(inBroadPhaseLayerFilter, ioCollector, [&](const SweepAndPrune &inLayer) { inLayer.CollideOrientedBox(inBox, ioCollector, inObjectLayerFilter, bodies); });
+}
+
+void BroadPhaseSAP::CastAABoxNoLock(const AABoxCast &inBox, CastShapeBodyCollector &ioCollector, const BroadPhaseLayerFilter &inBroadPhaseLayerFilter, const ObjectLayerFilter &inObjectLayerFilter) const
+{
+	JPH_PROFILE_FUNCTION();
+
+	const BodyVector &bodies = mBodyManager->GetBodies();
+
+	QueryLayers(inBroadPhaseLayerFilter, ioCollector, [&](const SweepAndPrune &inLayer) { inLayer.CastAABox(inBox, ioCollector, inObjectLayerFilter, bodies); });
+}
+
+void BroadPhaseSAP::CastAABox(const AABoxCast &inBox, CastShapeBodyCollector &ioCollector, const BroadPhaseLayerFilter &inBroadPhaseLayerFilter, const ObjectLayerFilter &inObjectLayerFilter) const
+{
+	// The sorted lists have their own locks, so there's no difference with the no lock version
+	CastAABoxNoLock(inBox, ioCollector, inBroadPhaseLayerFilter, inObjectLayerFilter);
+}
+
+void BroadPhaseSAP::FindCollidingPairs(BodyID *ioActiveBodies, int inNumActiveBodies, float inSpeculativeContactDistance, const ObjectVsBroadPhaseLayerFilter &inObjectVsBroadPhaseLayerFilter, const ObjectLayerPairFilter &inObjectLayerPairFilter, BodyPairCollector &ioPairCollector) const
+{
+	JPH_PROFILE_FUNCTION();
+
+	const BodyVector &bodies = mBodyManager->GetBodies();
+	JPH_ASSERT(mMaxBodies == mBodyManager->GetMaxBodies());
+
+	// Sort bodies on layer and handle each layer separately
+	Body * const * const bodies_ptr = bodies.data(); // C pointer or else sort is incredibly slow in debug mode
+	sForEachLayer(ioActiveBodies, inNumActiveBodies, [bodies_ptr](BodyID inBodyID) { return bodies_ptr[inBodyID.GetIndex()]->GetObjectLayer(); }, [&](ObjectLayer inObjectLayer, const BodyID *inStart, const BodyID *inEnd)
+	{
+		JPH_ASSERT(inObjectLayer != cObjectLayerInvalid);
+
+		// Loop over all layers and test the ones that could hit
+		for (BroadPhaseLayer::Type l = 0; l < mNumLayers; ++l)
+		{
+			const SweepAndPrune &layer = mLayers[l];
+			if (layer.HasBodies() && inObjectVsBroadPhaseLayerFilter.ShouldCollide(inObjectLayer, BroadPhaseLayer(l)))
+				layer.FindCollidingPairs(bodies, inStart, int(inEnd - inStart), inSpeculativeContactDistance, ioPairCollector, inObjectLayerPairFilter);
+		}
+	});
+}
+
+AABox BroadPhaseSAP::GetBounds() const
+{
+	const BodyVector &bodies = mBodyManager->GetBodies();
+
+	AABox bounds;
+	for (BroadPhaseLayer::Type l = 0; l < mNumLayers; ++l)
+		bounds.Encapsulate(mLayers[l].GetBounds(bodies));
+	return bounds;
+}
+
+bool BroadPhaseSAP::IsSorted() const
+{
+	for (BroadPhaseLayer::Type l = 0; l < mNumLayers; ++l)
+		if (!mLayers[l].IsSorted())
+			return false;
+	return true;
+}
+
+JPH_NAMESPACE_END
@@ -0,0 +1,71 @@
+// Jolt Physics Library (https://github.com/jrouwe/JoltPhysics)
+// SPDX-FileCopyrightText: 2024 Jorrit Rouwe
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <Jolt/Physics/Collision/BroadPhase/SweepAndPrune.h>
+#include <Jolt/Physics/Collision/BroadPhase/BroadPhase.h>
+#include <Jolt/Physics/PhysicsLock.h>
+
+JPH_NAMESPACE_BEGIN
+
+/// Sweep and prune BroadPhase that keeps one sorted list of bodies per broadphase layer.
+/// This works well for layers with many small moving bodies that are spread out along one axis (e.g. vehicles on a road), for large static layers the BroadPhaseQuadTree is a better choice.
+class JPH_EXPORT BroadPhaseSAP final : public BroadPhase
+{
+public:
+	JPH_OVERRIDE_NEW_DELETE
+
+	/// Destructor
+	virtual					~BroadPhaseSAP() override;
+
+	// Implementing interface of BroadPhase (see BroadPhase for documentation)
+	virtual void			Init(BodyManager *inBodyManager, const BroadPhaseLayerInterface &inLayerInterface) override;
+	virtual void			Optimize() override;
+	virtual void			LockModifications() override;
+	virtual	UpdateState		UpdatePrepare() override;
+	virtual void			UpdateFinalize(const UpdateState &inUpdateState) override;
+	virtual void			UnlockModifications() override;
+	virtual void			AddBodiesFinalize(BodyID *ioBodies, int inNumber, AddState inAddState) override;
+	virtual void			RemoveBodies(BodyID *ioBodies, int inNumber) override;
+	virtual void			NotifyBodiesAABBChanged(BodyID *ioBodies, int inNumber, bool inTakeLock) override;
+	virtual void			NotifyBodiesLayerChanged(BodyID *ioBodies, int inNumber) override;
+	virtual void			CastRay(const RayCast &inRay, RayCastBodyCollector &ioCollector, const BroadPhaseLayerFilter &inBroadPhaseLayerFilter, const ObjectLayerFilter &inObjectLayerFilter) const override;
+	virtual void			CollideAABox(const AABox &inBox, CollideShapeBodyCollector &ioCollector, const BroadPhaseLayerFilter &inBroadPhaseLayerFilter, const ObjectLayerFilter &inObjectLayerFilter) const override;
+	virtual void			CollideSphere(Vec3Arg inCenter, float inRadius, CollideShapeBodyCollector &ioCollector, const BroadPhaseLayerFilter &inBroadPhaseLayerFilter, const ObjectLayerFilter &inObjectLayerFilter) const override;
+	virtual void			CollidePoint(Vec3Arg inPoint, CollideShapeBodyCollector &ioCollector, const BroadPhaseLayerFilter &inBroadPhaseLayerFilter, const ObjectLayerFilter &inObjectLayerFilter) const override;
+	virtual void			CollideOrientedBox(const OrientedBox &inBox, CollideShapeBodyCollector &ioCollector, const BroadPhaseLayerFilter &inBroadPhaseLayerFilter, const ObjectLayerFilter &inObjectLayerFilter) const override;
+	virtual void			CastAABoxNoLock(const AABoxCast &inBox, CastShapeBodyCollector &ioCollector, const BroadPhaseLayerFilter &inBroadPhaseLayerFilter, const ObjectLayerFilter &inObjectLayerFilter) const override;
+	virtual void			CastAABox(const AABoxCast &inBox, CastShapeBodyCollector &ioCollector, const BroadPhaseLayerFilter &inBroadPhaseLayerFilter, const ObjectLayerFilter &inObjectLayerFilter) const override;
+	virtual void			FindCollidingPairs(BodyID *ioActiveBodies, int inNumActiveBodies, float inSpeculativeContactDistance, const ObjectVsBroadPhaseLayerFilter &inObjectVsBroadPhaseLayerFilter, const ObjectLayerPairFilter &inObjectLayerPairFilter, BodyPairCollector &ioPairCollector) const override;
+	virtual AABox			GetBounds() const override;
+
+	/// Check that the lists of all broadphase layers are sorted (for validation)
+	bool					IsSorted() const;
+
+private:
+	/// Call inQuery for every list that contains bodies and passes inBroadPhaseLayerFilter until inCollector wants to early out
+	template <class Collector, class Query>
+	inline void				QueryLayers(const BroadPhaseLayerFilter &inBroadPhaseLayerFilter, const Collector &inCollector, const Query &inQuery) const;
+
+#ifdef JPH_ENABLE_ASSERTS
+	/// Context used to lock a physics lock
+	PhysicsLockContext		mLockContext = nullptr;
+#endif // JPH_ENABLE_ASSERTS
+
+	/// Max amount of bodies we support
+	size_t					mMaxBodies = 0;
+
+	/// For each BodyID the broadphase layer that it was added to
+	Array<BroadPhaseLayer::Type> mTracking;
+
+	/// One sorted list per broadphase layer
+	SweepAndPrune *			mLayers = nullptr;
+	uint					mNumLayers = 0;
+
+	/// Mutex that prevents object modification during UpdatePrepare/Finalize()
+	SharedMutex				mUpdateMutex;
+};
+
+JPH_NAMESPACE_END
@@ -0,0 +1,545 @@
+// Jolt Physics Library (https://github.com/jrouwe/JoltPhysics)
+// SPDX-FileCopyrightText: 2024 Jorrit Rouwe
+// SPDX-License-Identifier: MIT
+
+#include <Jolt/Jolt.h>
+
+#include <Jolt/Physics/Collision/BroadPhase/HashGrid.h>
+#include <Jolt/Physics/Collision/RayCast.h>
+#include <Jolt/Physics/Collision/AABoxCast.h>
+#include <Jolt/Physics/Collision/CastResult.h>
+#include <Jolt/Physics/Body/BodyPair.h>
+#include <Jolt/Geometry/RayAABox.h>
+#include <Jolt/Geometry/OrientedBox.h>
+
+JPH_NAMESPACE_BEGIN
+
+HashGrid::~HashGrid()
+{
+	delete [] mEntries;
+	delete [] mBuckets;
+	delete [] mPendingMoves;
+	delete [] mIsPendingMove;
+}
+
+void HashGrid::Init(uint inMaxBodies)
+{
+	JPH_ASSERT(mEntries == nullptr, "Init should only be called once");
+
+	mMaxBodies = inMaxBodies;
+
+	// Allocate body information
+	mEntries = new Entry [inMaxBodies];
+	for (uint i = 0; i < inMaxBodies; ++i)
+		mEntries[i].mDenseIndex = cInvalidIndex;
+
+	// Allocate buckets, we use at least as many buckets as bodies so that the chance that two occupied cells share a bucket is low
+	mNumBuckets = GetNextPowerOf2(max(inMaxBodies, 16u));
+	mBuckets = new uint32 [mNumBuckets];
+	std::fill(mBuckets, mBuckets + mNumBuckets, cInvalidIndex);
+
+	// Allocate pending moves
+	mPendingMoves = new BodyID [inMaxBodies];
+	mIsPendingMove = new atomic<bool> [inMaxBodies];
+	for (uint i = 0; i < inMaxBodies; ++i)
+		mIsPendingMove[i].store(false, memory_order_relaxed);
+}
+
+inline HashGrid::Cell HashGrid::GetCell(Vec3Arg inPosition, float inInvCellSize) const
+{
+	// Clamp the coordinates so that they fit in an int
+	constexpr float cMaxCell = float(1 << 30);
+	Vec3 p = Vec3::sClamp(inPosition * inInvCellSize, Vec3::sReplicate(-cMaxCell), Vec3::sReplicate(cMaxCell));
+	return { int(floor(p.GetX())), int(floor(p.GetY())), int(floor(p.GetZ())) };
+}
+
+inline uint32 HashGrid::GetBucket(const Cell &inCell) const
+{
+	return ((uint32(inCell.mX) * 73856093u) ^ (uint32(inCell.mY) * 19349663u) ^ (uint32(inCell.mZ) * 83492791u)) & (mNumBuckets - 1);
+}
+
+void HashGrid::LinkEntry(uint32 inIndex)
+{
+	Entry &entry = mEntries[inIndex];
+	uint32 &head = mBuckets[GetBucket(entry.mCell)];
+	entry.mPrev = cInvalidIndex;
+	entry.mNext = head;
+	if (head != cInvalidIndex)
+		mEntries[head].mPrev = inIndex;
+	head = inIndex;
+}
+
+void HashGrid::UnlinkEntry(uint32 inIndex)
+{
+	Entry &entry = mEntries[inIndex];
+	if (entry.mPrev != cInvalidIndex)
+		mEntries[entry.mPrev].mNext = entry.mNext;
+	else
+		mBuckets[GetBucket(entry.mCell)] = entry.mNext;
+	if (entry.mNext != cInvalidIndex)
+		mEntries[entry.mNext].mPrev = entry.mPrev;
+}
+
+void HashGrid::AddBodies(const BodyVector &inBodies, const BodyID *inBodyIDs, int inNumber)
+{
+	JPH_PROFILE_FUNCTION();
+
+	JPH_ASSERT(inNumber > 0);
+	JPH_ASSERT(mEntries != nullptr, "Init not called");
+
+	lock_guard lock(mMutex);
+
+	// The first bodies that are added determine the initial cell size
+	if (mCellSize == 0.0f)
+	{
+		float sum_half_extent = 0.0f;
+		for (const BodyID *b = inBodyIDs, *b_end = inBodyIDs + inNumber; b < b_end; ++b)
+			sum_half_extent += inBodies[b->GetIndex()]->GetWorldSpaceBounds().GetExtent().ReduceMax();
+		mCellSize = cCellSizeFactor * sum_half_extent / float(inNumber);
+		if (mCellSize <= 0.0f)
+			mCellSize = 1.0f;
+		mInvCellSize = 1.0f / mCellSize;
+	}
+
+	// Link the bodies in the cell that contains their center
+	float max_half_extent = 0.0f;
+	for (const BodyID *b = inBodyIDs, *b_end = inBodyIDs + inNumber; b < b_end; ++b)
+	{
+		uint32 index = b->GetIndex();
+		Entry &entry = mEntries[index];
+		JPH_ASSERT(entry.mDenseIndex == cInvalidIndex, "Body already in grid");
+
+		const AABox &bounds = inBodies[index]->GetWorldSpaceBounds();
+		entry.mCell = GetCell(bounds.GetCenter(), mInvCellSize);
+		entry.mBodyID = *b;
+		entry.mDenseIndex = uint32(mBodyIDs.size());
+		entry.mHalfExtent = bounds.GetExtent().ReduceMax();
+		mBodyIDs.push_back(*b);
+		LinkEntry(index);
+
+		mSumHalfExtent += double(entry.mHalfExtent);
+		max_half_extent = max(max_half_extent, entry.mHalfExtent);
+	}
+	AtomicMax(mMaxHalfExtent, max_half_extent, memory_order_relaxed);
+
+	mNumBodies.store(uint32(mBodyIDs.size()), memory_order_relaxed);
+}
+
+void HashGrid::RemoveBodies(const BodyID *inBodyIDs, int inNumber)
+{
+	JPH_PROFILE_FUNCTION();
+
+	JPH_ASSERT(inNumber > 0);
+
+	lock_guard lock(mMutex);
+
+	bool removed_pending_move = false;
+	for (const BodyID *b = inBodyIDs, *b_end = inBodyIDs + inNumber; b < b_end; ++b)
+	{
+		uint32 index = b->GetIndex();
+		Entry &entry = mEntries[index];
+		JPH_ASSERT(entry.mDenseIndex != cInvalidIndex && entry.mBodyID == *b, "Trying to remove a body that is not in the grid");
+
+		UnlinkEntry(index);
+
+		// Remove from the list of all bodies by moving the last body into its place
+		BodyID last = mBodyIDs.back();
+		mBodyIDs[entry.mDenseIndex] = last;
+		mEntries[last.GetIndex()].mDenseIndex = entry.mDenseIndex;
+		mBodyIDs.pop_back();
+		entry.mDenseIndex = cInvalidIndex;
+
+		mSumHalfExtent -= double(entry.mHalfExtent);
+
+		if (mIsPendingMove[index].exchange(false, memory_order_relaxed))
+			removed_pending_move = true;
+	}
+
+	// Remove the bodies from the pending moves, this ensures that the pending moves never exceed the number of bodies
+	if (removed_pending_move)
+	{
+		BodyID *pending_end = std::remove_if(mPendingMoves, mPendingMoves + mNumPendingMoves.load(memory_order_relaxed), [this](const BodyID &inBodyID) { return !mIsPendingMove[inBodyID.GetIndex()].load(memory_order_relaxed); });
+		mNumPendingMoves.store(uint32(pending_end - mPendingMoves), memory_order_relaxed);
+	}
+
+	// Prevent accumulating round off errors
+	if (mBodyIDs.empty())
+		mSumHalfExtent = 0.0;
+
+	mNumBodies.store(uint32(mBodyIDs.size()), memory_order_relaxed);
+}
+
+void HashGrid::NotifyBodiesAABBChanged(const BodyVector &inBodies, const BodyID *inBodyIDs, int inNumber)
+{
+	// Prevent the grid from being modified by AddBodies / RemoveBodies
+	shared_lock lock(mMutex);
+
+	float max_drift = 0.0f, max_half_extent = 0.0f;
+	for (const BodyID *b = inBodyIDs, *b_end = inBodyIDs + inNumber; b < b_end; ++b)
+	{
+		uint32 index = b->GetIndex();
+		const Entry &entry = mEntries[index];
+		JPH_ASSERT(entry.mDenseIndex != cInvalidIndex);
+
+		const AABox &bounds = inBodies[index]->GetWorldSpaceBounds();
+		Vec3 center = bounds.GetCenter();
+		float half_extent = bounds.GetExtent().ReduceMax();
+		max_half_extent = max(max_half_extent, half_extent);
+
+		if (GetCell(center, mInvCellSize) != entry.mCell)
+		{
+			// Determine how far the center moved outside of its cell, add a small margin to account for round off
+			Vec3 cell_min = Vec3(float(entry.mCell.mX), float(entry.mCell.mY), float(entry.mCell.mZ)) * mCellSize;
+			Vec3 cell_max = cell_min + Vec3::sReplicate(mCellSize);
+			max_drift = max(max_drift, Vec3::sMax(cell_min - center, center - cell_max).ReduceMax() + 1.0e-3f * mCellSize);
+
+			// Queue the body so that it gets moved to its new cell in UpdateFinalize
+			if (!mIsPendingMove[index].exchange(true, memory_order_relaxed))
+				mPendingMoves[mNumPendingMoves.fetch_add(1, memory_order_relaxed)] = *b;
+		}
+		else if (half_extent > 2.0f * entry.mHalfExtent || half_extent < 0.5f * entry.mHalfExtent)
+		{
+			// The body changed size enough to influence the cell size, queue it so that UpdateFinalize updates its size (rotating bodies stay below this threshold)
+			if (!mIsPendingMove[index].exchange(true, memory_order_relaxed))
+				mPendingMoves[mNumPendingMoves.fetch_add(1, memory_order_relaxed)] = *b;
+		}
+	}
+
+	// Queries need to take this into account
+	AtomicMax(mMaxDrift, max_drift, memory_order_relaxed);
+	AtomicMax(mMaxHalfExtent, max_half_extent, memory_order_relaxed);
+}
+
+bool HashGrid::UpdatePrepare()
+{
+	// Check if the bodies changed size so much that the cell size should change, this requires all bodies to be relinked
+	mNextCellSize = 0.0f;
+	if (!mBodyIDs.empty())
+	{
+		float cell_size = cCellSizeFactor * float(mSumHalfExtent / double(mBodyIDs.size()));
+		if (cell_size > 0.0f && (cell_size > 2.0f * mCellSize || cell_size < 0.5f * mCellSize))
+			mNextCellSize = cell_size;
+	}
+
+	mUpdatePrepared = mNextCellSize != 0.0f || mNumPendingMoves.load(memory_order_relaxed) > 0;
+	return mUpdatePrepared;
+}
+
+void HashGrid::UpdateFinalize(const BodyVector &inBodies)
+{
+	// Check if there's anything to do
+	if (!mUpdatePrepared)
+		return;
+	mUpdatePrepared = false;
+
+	JPH_PROFILE_FUNCTION();
+
+	lock_guard lock(mMutex);
+
+	uint32 num_pending_moves = mNumPendingMoves.load(memory_order_relaxed);
+	if (mNextCellSize != 0.0f)
+	{
+		// Change the cell size
+		mCellSize = mNextCellSize;
+		mInvCellSize = 1.0f / mCellSize;
+
+		// Relink all bodies
+		std::fill(mBuckets, mBuckets + mNumBuckets, cInvalidIndex);
+		float max_half_extent = 0.0f;
+		mSumHalfExtent = 0.0;
+		for (const BodyID &body_id : mBodyIDs)
+		{
+			uint32 index = body_id.GetIndex();
+			Entry &entry = mEntries[index];
+			const AABox &bounds = inBodies[index]->GetWorldSpaceBounds();
+			entry.mCell = GetCell(bounds.GetCenter(), mInvCellSize);
+			entry.mHalfExtent = bounds.GetExtent().ReduceMax();
+			LinkEntry(index);
+
+			mSumHalfExtent += double(entry.mHalfExtent);
+			max_half_extent = max(max_half_extent, entry.mHalfExtent);
+		}
+		mMaxHalfExtent.store(max_half_extent, memory_order_relaxed);
+
+		// All pending moves have been handled
+		for (const BodyID *b = mPendingMoves, *b_end = mPendingMoves + num_pending_moves; b < b_end; ++b)
+			mIsPendingMove[b->GetIndex()].store(false, memory_order_relaxed);
+	}
+	else
+	{
+		// Move the bodies to their new cell
+		for (const BodyID *b = mPendingMoves, *b_end = mPendingMoves + num_pending_moves; b < b_end; ++b)
+		{
+			uint32 index = b->GetIndex();
+			mIsPendingMove[index].store(false, memory_order_relaxed);
+
+			// Update the size of the body so that the next UpdatePrepare uses the current average size (mMaxHalfExtent was already updated by NotifyBodiesAABBChanged)
+			Entry &entry = mEntries[index];
+			const AABox &bounds = inBodies[index]->GetWorldSpaceBounds();
+			float half_extent = bounds.GetExtent().ReduceMax();
+			mSumHalfExtent += double(half_extent) - double(entry.mHalfExtent);
+			entry.mHalfExtent = half_extent;
+
+			Cell cell = GetCell(bounds.GetCenter(), mInvCellSize);
+			if (cell != entry.mCell)
+			{
+				UnlinkEntry(index);
+				entry.mCell = cell;
+				LinkEntry(index);
+			}
+		}
+	}
+
+	// All bodies are linked in the cell that contains their center again
+	mNumPendingMoves.store(0, memory_order_relaxed);
+	mMaxDrift.store(0.0f, memory_order_relaxed);
+}
+
+template <class Visitor>
+inline void HashGrid::WalkCells(const AABox &inBounds, const Visitor &inVisitor) const
+{
+	if (mBodyIDs.empty())
+		return;
+
+	// Bodies are linked in the cell that contains their center, their bounds extend up to mMaxHalfExtent from the center and the center can be up to mMaxDrift outside of the cell
+	Vec3 expand = Vec3::sReplicate(mMaxHalfExtent.load(memory_order_relaxed) + mMaxDrift.load(memory_order_relaxed));
+	Cell min_cell = GetCell(inBounds.mMin - expand, mInvCellSize);
+	Cell max_cell = GetCell(inBounds.mMax + expand, mInvCellSize);
+
+	// If the query covers more cells than there are bodies it is cheaper to test all bodies
+	float num_cells = (float(max_cell.mX) - float(min_cell.mX) + 1.0f) * (float(max_cell.mY) - float(min_cell.mY) + 1.0f) * (float(max_cell.mZ) - float(min_cell.mZ) + 1.0f);
+	if (num_cells > float(mBodyIDs.size()))
+	{
+		for (const BodyID &body_id : mBodyIDs)
+			if (inVisitor(body_id))
+				return;
+		return;
+	}
+
+	// Visit all cells, the bucket of a cell can contain bodies of other cells too so we need to check the cell of every body
+	Cell cell;
+	for (cell.mX = min_cell.mX; cell.mX <= max_cell.mX; ++cell.mX)
+		for (cell.mY = min_cell.mY; cell.mY <= max_cell.mY; ++cell.mY)
+			for (cell.mZ = min_cell.mZ; cell.mZ <= max_cell.mZ; ++cell.mZ)
+				for (uint32 index = mBuckets[GetBucket(cell)]; index != cInvalidIndex; )
+				{
+					const Entry &entry = mEntries[index];
+					if (entry.mCell == cell && inVisitor(entry.mBodyID))
+						return;
+					index = entry.mNext;
+				}
+}
+
+void HashGrid::CastRay(const RayCast &inRay, RayCastBodyCollector &ioCollector, const ObjectLayerFilter &inObjectLayerFilter, const BodyVector &inBodies) const
+{
+	JPH_PROFILE_FUNCTION();
+
+	shared_lock lock(mMutex);
+
+	// Load ray
+	Vec3 origin(inRay.mOrigin);
+	Vec3 end = origin + inRay.mDirection;
+	RayInvDirection inv_direction(inRay.mDirection);
+
+	WalkCells(AABox(Vec3::sMin(origin, end), Vec3::sMax(origin, end)), [&origin, &inv_direction, &ioCollector, &inObjectLayerFilter, &inBodies](const BodyID &inBodyID)
+	{
+		const Body &body = *inBodies[inBodyID.GetIndex()];
+
+		// Test layer
+		if (inObjectLayerFilter.ShouldCollide(body.GetObjectLayer()))
+		{
+			// Test intersection with ray
+			const AABox &bounds = body.GetWorldSpaceBounds();
+			float fraction = RayAABox(origin, inv_direction, bounds.mMin, bounds.mMax);
+			if (fraction < ioCollector.GetEarlyOutFraction())
+			{
+				// Store hit
+				BroadPhaseCastResult result { inBodyID, fraction };
+				ioCollector.AddHit(result);
+				return ioCollector.ShouldEarlyOut();
+			}
+		}
+		return false;
+	});
+}
+
+void HashGrid::CollideAABox(const AABox &inBox, CollideShapeBodyCollector &ioCollector, const ObjectLayerFilter &inObjectLayerFilter, const BodyVector &inBodies) const
+{
+	JPH_PROFILE_FUNCTION();
+
+	shared_lock lock(mMutex);
+
+	WalkCells(inBox, [&inBox, &ioCollector, &inObjectLayerFilter, &inBodies](const BodyID &inBodyID)
+	{
+		const Body &body = *inBodies[inBodyID.GetIndex()];
+
+		// Test layer and intersection with box
+		if (inObjectLayerFilter.ShouldCollide(body.GetObjectLayer())
+			&& body.GetWorldSpaceBounds().Overlaps(inBox))
+		{
+			// Store hit
+			ioCollector.AddHit(inBodyID);
+			return ioCollector.ShouldEarlyOut();
+		}
+		return false;
+	});
+}
+
+void HashGrid::CollideSphere(Vec3Arg inCenter, float inRadius, CollideShapeBodyCollector &ioCollector, const ObjectLayerFilter &inObjectLayerFilter, const BodyVector &inBodies) const
+{
+	JPH_PROFILE_FUNCTION();
+
+	shared_lock lock(mMutex);
+
+	float radius_sq = Square(inRadius);
+	Vec3 radius = Vec3::sReplicate(inRadius);
+
+	WalkCells(AABox(inCenter - radius, inCenter + radius), [inCenter, radius_sq, &ioCollector, &inObjectLayerFilter, &inBodies](const BodyID &inBodyID)
+	{
+		const Body &body = *inBodies[inBodyID.GetIndex()];
+
+		// Test layer and intersection with sphere
+		if (inObjectLayerFilter.ShouldCollide(body.GetObjectLayer())
+			&& body.GetWorldSpaceBounds().GetSqDistanceTo(inCenter) <= radius_sq)
+		{
+			// Store hit
+			ioCollector.AddHit(inBodyID);
+			return ioCollector.ShouldEarlyOut();
+		}
+		return false;
+	});
+}
+
+void HashGrid::CollidePoint(Vec3Arg inPoint, CollideShapeBodyCollector &ioCollector, const ObjectLayerFilter &inObjectLayerFilter, const BodyVector &inBodies) const
+{
+	JPH_PROFILE_FUNCTION();
+
+	shared_lock lock(mMutex);
+
+	WalkCells(AABox(inPoint, inPoint), [inPoint, &ioCollector, &inObjectLayerFilter, &inBodies](const BodyID &inBodyID)
+	{
+		const Body &body = *inBodies[inBodyID.GetIndex()];
+
+		// Test layer and if point is inside box
+		if (inObjectLayerFilter.ShouldCollide(body.GetObjectLayer())
+			&& body.GetWorldSpaceBounds().Contains(inPoint))
+		{
+			// Store hit
+			ioCollector.AddHit(inBodyID);
+			return ioCollector.ShouldEarlyOut();
+		}
+		return false;
+	});
+}
+
+void HashGrid::CollideOrientedBox(const OrientedBox &inBox, CollideShapeBodyCollector &ioCollector, const ObjectLayerFilter &inObjectLayerFilter, const BodyVector &inBodies) const
+{
+	JPH_PROFILE_FUNCTION();
+
+	shared_lock lock(mMutex);
+
+	WalkCells(AABox(-inBox.mHalfExtents, inBox.mHalfExtents).Transformed(inBox.mOrientation), [&inBox, &ioCollector, &inObjectLayerFilter, &inBodies](const BodyID &inBodyID)
+	{
+		const Body &body = *inBodies[inBodyID.GetIndex()];
+
+		// Test layer and intersection with oriented box
+		if (inObjectLayerFilter.ShouldCollide(body.GetObjectLayer())
+			&& inBox.Overlaps(body.GetWorldSpaceBounds()))
+		{
+			// Store hit
+			ioCollector.AddHit(inBodyID);
+			return ioCollector.ShouldEarlyOut();
+		}
+		return false;
+	});
+}
+
+void HashGrid::CastAABox(const AABoxCast &inBox, CastShapeBodyCollector &ioCollector, const ObjectLayerFilter &inObjectLayerFilter, const BodyVector &inBodies) const
+{
+	JPH_PROFILE_FUNCTION();
+
+	shared_lock lock(mMutex);
+
+	// Load box
+	Vec3 origin(inBox.mBox.GetCenter());
+	Vec3 extent(inBox.mBox.GetExtent());
+	RayInvDirection inv_direction(inBox.mDirection);
+
+	// Determine the bounds of the swept box
+	AABox swept_bounds(Vec3::sMin(inBox.mBox.mMin, inBox.mBox.mMin + inBox.mDirection), Vec3::sMax(inBox.mBox.mMax, inBox.mBox.mMax + inBox.mDirection));
+
+	WalkCells(swept_bounds, [&origin, &extent, &inv_direction, &ioCollector, &inObjectLayerFilter, &inBodies](const BodyID &inBodyID)
+	{
+		const Body &body = *inBodies[inBodyID.GetIndex()];
+
+		// Test layer
+		if (inObjectLayerFilter.ShouldCollide(body.GetObjectLayer()))
+		{
+			// Test intersection with ray against the box expanded by the extent of the cast box
+			const AABox &bounds = body.GetWorldSpaceBounds();
+			float fraction = RayAABox(origin, inv_direction, bounds.mMin - extent, bounds.mMax + extent);
+			if (fraction < ioCollector.GetPositiveEarlyOutFraction())
+			{
+				// Store hit
+				BroadPhaseCastResult result { inBodyID, fraction };
+				ioCollector.AddHit(result);
+				return ioCollector.ShouldEarlyOut();
+			}
+		}
+		return false;
+	});
+}
+
+void HashGrid::FindCollidingPairs(const BodyVector &inBodies, const BodyID *inActiveBodies, int inNumActiveBodies, float inSpeculativeContactDistance, BodyPairCollector &ioPairCollector, const ObjectLayerPairFilter &inObjectLayerPairFilter) const
+{
+	JPH_PROFILE_FUNCTION();
+
+	// Assert sane input
+	JPH_ASSERT(inActiveBodies != nullptr);
+	JPH_ASSERT(inNumActiveBodies > 0);
+
+	shared_lock lock(mMutex);
+
+	// Loop over all active bodies
+	for (const BodyID *b1 = inActiveBodies, *b1_end = inActiveBodies + inNumActiveBodies; b1 < b1_end; ++b1)
+	{
+		BodyID b1_id = *b1;
+		const Body &body1 = *inBodies[b1_id.GetIndex()];
+		JPH_ASSERT(!body1.IsStatic());
+
+		// Expand the bounding box by the speculative contact distance
+		AABox bounds1 = body1.GetWorldSpaceBounds();
+		bounds1.ExpandBy(Vec3::sReplicate(inSpeculativeContactDistance));
+
+		// Test the body against all bodies in the neighboring cells
+		WalkCells(bounds1, [b1_id, &body1, &bounds1, &ioPairCollector, &inObjectLayerPairFilter, &inBodies](const BodyID &inBodyID)
+		{
+			// Don't collide with self
+			if (b1_id != inBodyID)
+			{
+				// Collision between dynamic pairs need to be picked up only once
+				const Body &body2 = *inBodies[inBodyID.GetIndex()];
+				if (inObjectLayerPairFilter.ShouldCollide(body1.GetObjectLayer(), body2.GetObjectLayer())
+					&& Body::sFindCollidingPairsCanCollide(body1, body2)
+					&& bounds1.Overlaps(body2.GetWorldSpaceBounds()))
+				{
+					// Store potential hit between bodies
+					ioPairCollector.AddHit({ b1_id, inBodyID });
+				}
+			}
+			return false;
+		});
+	}
+}
+
+AABox HashGrid::GetBounds(const BodyVector &inBodies) const
+{
+	shared_lock lock(mMutex);
+
+	AABox bounds;
+	for (const BodyID &body_id : mBodyIDs)
+		bounds.Encapsulate(inBodies[body_id.GetIndex()]->GetWorldSpaceBounds());
+	return bounds;
+}
+
+JPH_NAMESPACE_END
@@ -0,0 +1,164 @@
+// Jolt Physics Library (https://github.com/jrouwe/JoltPhysics)
+// SPDX-FileCopyrightText: 2024 Jorrit Rouwe
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <Jolt/Core/Atomics.h>
+#include <Jolt/Core/Mutex.h>
+#include <Jolt/Core/NonCopyable.h>
+#include <Jolt/Physics/Body/BodyManager.h>
+#include <Jolt/Physics/Collision/BroadPhase/BroadPhase.h>
+
+JPH_NAMESPACE_BEGIN
+
+/// Internal loose uniform hash grid structure in broadphase, intended for layers with many similarly sized small bodies.
+/// A body is stored in the cell that contains the center of its bounding box, queries are widened by the largest half extent of all bodies so bodies that stick out of their cell are found too.
+/// The cell size is derived from the average size of the bodies and the cells are mapped to a fixed amount of buckets through a hash.
+/// Moving a body within its cell doesn't change the grid, a body that moves to another cell is queued and relinked during the UpdatePrepare/Finalize() call.
+/// Until that time queries are widened by the maximum distance that a body moved outside of its cell.
+class JPH_EXPORT HashGrid : public NonCopyable
+{
+public:
+	JPH_OVERRIDE_NEW_DELETE
+
+	/// Destructor
+								~HashGrid();
+
+	/// Allocate the grid, must be called before adding bodies
+	void						Init(uint inMaxBodies);
+
+	/// Add bodies to the grid, inBodies is the list of all bodies in the body manager
+	void						AddBodies(const BodyVector &inBodies, const BodyID *inBodyIDs, int inNumber);
+
+	/// Remove bodies from the grid
+	void						RemoveBodies(const BodyID *inBodyIDs, int inNumber);
+
+	/// Call whenever the aabb of a body changes
+	void						NotifyBodiesAABBChanged(const BodyVector &inBodies, const BodyID *inBodyIDs, int inNumber);
+
+	/// Check if there are any bodies in the grid
+	inline bool					HasBodies() const							{ return mNumBodies.load(memory_order_relaxed) != 0; }
+
+	/// Determine if the grid needs to be updated, this can run in a background thread without influencing queries. Returns false if there was nothing to do.
+	bool						UpdatePrepare();
+
+	/// Move the bodies that changed cell to their new cell and change the cell size if needed (does nothing if UpdatePrepare returned false)
+	void						UpdateFinalize(const BodyVector &inBodies);
+
+	/// Cast a ray and get the intersecting bodies in ioCollector.
+	void						CastRay(const RayCast &inRay, RayCastBodyCollector &ioCollector, const ObjectLayerFilter &inObjectLayerFilter, const BodyVector &inBodies) const;
+
+	/// Get bodies intersecting with inBox in ioCollector
+	void						CollideAABox(const AABox &inBox, CollideShapeBodyCollector &ioCollector, const ObjectLayerFilter &inObjectLayerFilter, const BodyVector &inBodies) const;
+
+	/// Get bodies intersecting with a sphere in ioCollector
+	void						CollideSphere(Vec3Arg inCenter, float inRadius, CollideShapeBodyCollector &ioCollector, const ObjectLayerFilter &inObjectLayerFilter, const BodyVector &inBodies) const;
+
+	/// Get bodies intersecting with a point and any hits to ioCollector
+	void						CollidePoint(Vec3Arg inPoint, CollideShapeBodyCollector &ioCollector, const ObjectLayerFilter &inObjectLayerFilter, const BodyVector &inBodies) const;
+
+	/// Get bodies intersecting with an oriented box and any hits to ioCollector
+	void						CollideOrientedBox(const OrientedBox &inBox, CollideShapeBodyCollector &ioCollector, const ObjectLayerFilter &inObjectLayerFilter, const BodyVector &inBodies) const;
+
+	/// Cast a box and get intersecting bodies in ioCollector
+	void						CastAABox(const AABoxCast &inBox, CastShapeBodyCollector &ioCollector, const ObjectLayerFilter &inObjectLayerFilter, const BodyVector &inBodies) const;
+
+	/// Find all colliding pairs between dynamic bodies, calls ioPairCollector for every pair found
+	void						FindCollidingPairs(const BodyVector &inBodies, const BodyID *inActiveBodies, int inNumActiveBodies, float inSpeculativeContactDistance, BodyPairCollector &ioPairCollector, const ObjectLayerPairFilter &inObjectLayerPairFilter) const;
+
+	/// Get the bounding box of all bodies in the grid
+	AABox						GetBounds(const BodyVector &inBodies) const;
+
+private:
+	/// Value used to indicate that an index is not used
+	static constexpr uint32		cInvalidIndex = ~uint32(0);
+
+	/// Cell size relative to the average half extent of the bodies
+	static constexpr float		cCellSizeFactor = 4.0f;
+
+	/// Integer coordinates of a cell
+	struct Cell
+	{
+		inline bool				operator == (const Cell &inRHS) const		{ return mX == inRHS.mX && mY == inRHS.mY && mZ == inRHS.mZ; }
+		inline bool				operator != (const Cell &inRHS) const		{ return !(*this == inRHS); }
+
+		int						mX;
+		int						mY;
+		int						mZ;
+	};
+
+	/// Information about a body in the grid, indexed by body index
+	struct Entry
+	{
+		Cell					mCell;										///< Cell that the body is linked in
+		BodyID					mBodyID;									///< Body that this entry refers to
+		uint32					mNext;										///< Index of the next body in the same bucket
+		uint32					mPrev;										///< Index of the previous body in the same bucket
+		uint32					mDenseIndex;								///< Index of the body in mBodyIDs or cInvalidIndex if the body is not in the grid
+		float					mHalfExtent;								///< Largest half extent of the bounding box of the body when it was last linked
+	};
+
+	/// Get the cell that contains inPosition
+	inline Cell					GetCell(Vec3Arg inPosition, float inInvCellSize) const;
+
+	/// Get the bucket that stores a cell
+	inline uint32				GetBucket(const Cell &inCell) const;
+
+	/// Link a body in the bucket of its cell
+	void						LinkEntry(uint32 inIndex);
+
+	/// Unlink a body from the bucket of its cell
+	void						UnlinkEntry(uint32 inIndex);
+
+	/// Visit all bodies that potentially overlap with inBounds. inVisitor returns true when the walk should be aborted.
+	template <class Visitor>
+	inline void					WalkCells(const AABox &inBounds, const Visitor &inVisitor) const;
+
+	/// Lock that protects the grid, queries and moves take a shared lock, modifications take a unique lock
+	mutable SharedMutex			mMutex;
+
+	/// Max amount of bodies we support
+	uint						mMaxBodies = 0;
+
+	/// For each body index the location in the grid
+	Entry *						mEntries = nullptr;
+
+	/// For each bucket the index of the first body in the bucket
+	uint32 *					mBuckets = nullptr;
+	uint32						mNumBuckets = 0;
+
+	/// All bodies in the grid, used when a query covers more cells than there are bodies
+	Array<BodyID>				mBodyIDs;
+
+	/// Amount of bodies in the grid
+	atomic<uint32>				mNumBodies { 0 };
+
+	/// Sum of Entry::mHalfExtent of all bodies in the grid, used to determine the cell size. Updated when bodies are added, removed, moved to another cell or change size significantly.
+	double						mSumHalfExtent = 0.0;
+
+	/// Size of a cell and its inverse (0 when no bodies have been added yet)
+	float						mCellSize = 0.0f;
+	float						mInvCellSize = 0.0f;
+
+	/// Cell size that was chosen by UpdatePrepare, 0 if the cell size doesn't change
+	float						mNextCellSize = 0.0f;
+
+	/// If UpdatePrepare determined that UpdateFinalize needs to do something
+	bool						mUpdatePrepared = false;
+
+	/// Largest half extent of the bounding box of any body in the grid
+	atomic<float>				mMaxHalfExtent { 0.0f };
+
+	/// Maximum distance that the center of a body moved outside of the cell that it is linked in
+	atomic<float>				mMaxDrift { 0.0f };
+
+	/// Bodies that moved to another cell and need to be relinked in UpdateFinalize
+	BodyID *					mPendingMoves = nullptr;
+	atomic<uint32>				mNumPendingMoves { 0 };
+
+	/// For each body index if the body is in mPendingMoves
+	atomic<bool> *				mIsPendingMove = nullptr;
+};
+
+JPH_NAMESPACE_END
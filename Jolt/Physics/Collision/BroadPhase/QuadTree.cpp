@@ -395,6 +395,206 @@ void QuadTree::UpdateFinalize([[maybe_unused]] const BodyVector &inBodies, [[may
 #endif
 }
 
+bool QuadTree::MarkWorstSubtreesChanged(uint inMaxNodes)
+{
+	JPH_PROFILE_FUNCTION();
+
+	// Assert we have no nodes pending deletion, this means DiscardOldTree wasn't called yet
+	JPH_ASSERT(mFreeNodeBatch.mNumObjects == 0);
+
+	if (inMaxNodes == 0)
+		return false;
+
+	// Candidate subtree to rebuild
+	struct Candidate
+	{
+		uint32			mNodeIdx;
+		uint32			mParentNodeIdx;
+		float			mCostIncrease;
+	};
+	constexpr int cMaxCandidates = 8;
+	constexpr float cMinRelativeCostIncrease = 0.25f;
+	Candidate candidates[cMaxCandidates];
+	int num_candidates = 0;
+
+	// Every candidate marks at least one node, so there's no point in finding more candidates than we can mark
+	int max_candidates = int(min(inMaxNodes, uint(cMaxCandidates)));
+
+	// Node to visit and an upper bound for the cost increase of the nodes in its subtree
+	struct StackEntry
+	{
+		uint32			mNodeIdx;
+		float			mMaxCostIncrease;
+	};
+
+	// Walk the tree and find the unchanged nodes with the highest SAH cost increase. The SAH cost of a node is proportional
+	// to its surface area (the chance that a query needs to visit it), so we look at the growth in surface area since the node
+	// was built (e.g. bodies moved) and the growth in surface area that overlaps with its siblings (e.g. batches of bodies that
+	// were added in overlapping regions, these will never be split up by a normal update).
+	// The cost of a node is its surface area plus the overlap with its 3 siblings, so it is at most 4 times the surface area of its parent.
+	// This allows us to skip subtrees that cannot contain a node that is worse than the candidates we found so far.
+	StackEntry node_stack[cStackSize];
+	node_stack[0] = { GetCurrentRoot().mIndex, FLT_MAX };
+	int top = 0;
+	do
+	{
+		StackEntry entry = node_stack[top];
+		--top;
+
+		// Skip the subtree if it cannot improve on the current candidates
+		if (num_candidates == max_candidates && entry.mMaxCostIncrease <= candidates[num_candidates - 1].mCostIncrease)
+			continue;
+
+		uint32 node_idx = entry.mNodeIdx;
+
+		const Node &node = mAllocator->Get(node_idx);
+
+		// Get bounds of all children
+		AABox child_bounds[4];
+		for (int child_idx = 0; child_idx < 4; ++child_idx)
+			node.GetChildBounds(child_idx, child_bounds[child_idx]);
+
+		for (int child_idx = 0; child_idx < 4; ++child_idx)
+		{
+			NodeID child_node_id = node.mChildNodeID[child_idx];
+			if (!child_node_id.IsValid() || child_node_id.IsBody())
+				continue;
+
+			// Recurse into child, the children of a node can degrade independently of their parent
+			uint32 child_node_idx = child_node_id.GetNodeIndex();
+			const AABox &bounds = child_bounds[child_idx];
+			if (!bounds.IsValid())
+				continue;
+			if (top + 1 < cStackSize)
+				node_stack[++top] = { child_node_idx, 4.0f * bounds.GetSurfaceArea() };
+
+			// Nodes that are changed will already be rebuilt by the next update
+			const Node &child_node = mAllocator->Get(child_node_idx);
+			if (child_node.mIsChanged)
+				continue;
+
+			// Determine how much the cost of the node increased since it was built
+			float cost_increase = sGetChildCost(child_bounds, child_idx) - child_node.mBuildCost;
+
+			// Ignore small changes, rebuilding the node would not gain much.
+			// A node that contains one of its siblings was inserted as a whole by an earlier partial rebuild (e.g. because the budget ran out
+			// while marking a subtree), in that case it is worth mixing the node with its sibling when the overlap is significant for the sibling.
+			float min_cost_increase = cMinRelativeCostIncrease * bounds.GetSurfaceArea();
+			for (int sibling_idx = 0; sibling_idx < 4; ++sibling_idx)
+				if (sibling_idx != child_idx && child_bounds[sibling_idx].IsValid() && bounds.Contains(child_bounds[sibling_idx]))
+					min_cost_increase = min(min_cost_increase, cMinRelativeCostIncrease * child_bounds[sibling_idx].GetSurfaceArea());
+			if (cost_increase <= min_cost_increase)
+				continue;
+
+			// Insert into the sorted list of candidates (highest cost first)
+			int insert_idx = num_candidates;
+			while (insert_idx > 0 && candidates[insert_idx - 1].mCostIncrease < cost_increase)
+				--insert_idx;
+			if (insert_idx < max_candidates)
+			{
+				num_candidates = min(num_candidates + 1, max_candidates);
+				for (int i = num_candidates - 1; i > insert_idx; --i)
+					candidates[i] = candidates[i - 1];
+				candidates[insert_idx] = { child_node_idx, node_idx, cost_increase };
+			}
+		}
+	}
+	while (top >= 0);
+
+	// Mark the candidate subtrees as changed, top levels first so that a partially marked subtree still gets the biggest improvement
+	uint num_marked = 0;
+	uint32 queue[cStackSize];
+	for (const Candidate *c = candidates, *c_end = candidates + num_candidates; c < c_end && num_marked < inMaxNodes; ++c)
+	{
+		// Candidate may have been marked as part of a previous candidate
+		if (mAllocator->Get(c->mNodeIdx).mIsChanged)
+			continue;
+
+		// Mark the path to the root so that the rebuild will reach this subtree
+		MarkNodeAndParentsChanged(c->mParentNodeIdx);
+
+		// Breadth first mark the nodes in the subtree, the queue is a ring buffer and when it is full the deeper nodes are left unmarked
+		queue[0] = c->mNodeIdx;
+		uint queue_start = 0, queue_size = 1;
+		while (queue_size > 0 && num_marked < inMaxNodes)
+		{
+			Node &node = mAllocator->Get(queue[queue_start]);
+			queue_start = (queue_start + 1) % cStackSize;
+			--queue_size;
+			node.mIsChanged = true;
+			++num_marked;
+
+			for (NodeID child_node_id : node.mChildNodeID)
+				if (child_node_id.IsValid() && child_node_id.IsNode() && queue_size < cStackSize)
+				{
+					queue[(queue_start + queue_size) % cStackSize] = child_node_id.GetNodeIndex();
+					++queue_size;
+				}
+		}
+	}
+
+	if (num_marked == 0)
+		return false;
+
+	// Mark tree dirty so that it will be updated
+	mIsDirty = true;
+	return true;
+}
+
+float QuadTree::sGetChildCost(const AABox *inChildBounds, int inChildIndex)
+{
+	const AABox &bounds = inChildBounds[inChildIndex];
+	float cost = bounds.GetSurfaceArea();
+	for (int sibling_idx = 0; sibling_idx < 4; ++sibling_idx)
+		if (sibling_idx != inChildIndex && bounds.Overlaps(inChildBounds[sibling_idx]))
+			cost += bounds.Intersect(inChildBounds[sibling_idx]).GetSurfaceArea();
+	return cost;
+}
+
+float QuadTree::GetSurfaceAreaHeuristicCost() const
+{
+	JPH_PROFILE_FUNCTION();
+
+	// Get the surface area of the root
+	const Node &root = mAllocator->Get(GetCurrentRoot().mIndex);
+	AABox root_bounds;
+	root.GetNodeBounds(root_bounds);
+	if (!root_bounds.IsValid())
+		return 0.0f;
+	float root_surface_area = root_bounds.GetSurfaceArea();
+	if (root_surface_area <= 0.0f)
+		return 0.0f;
+
+	// Walk the tree and sum the surface areas of the nodes, the root is always visited
+	float cost = root_surface_area;
+	NodeID node_stack[cStackSize];
+	node_stack[0] = GetCurrentRoot().GetNodeID();
+	int top = 0;
+	do
+	{
+		const Node &node = mAllocator->Get(node_stack[top].GetNodeIndex());
+		--top;
+
+		for (int child_idx = 0; child_idx < 4; ++child_idx)
+		{
+			NodeID child_node_id = node.mChildNodeID[child_idx];
+			if (child_node_id.IsValid() && child_node_id.IsNode())
+			{
+				AABox bounds;
+				node.GetChildBounds(child_idx, bounds);
+				if (bounds.IsValid())
+					cost += bounds.GetSurfaceArea();
+
+				JPH_ASSERT(top + 1 < cStackSize);
+				node_stack[++top] = child_node_id;
+			}
+		}
+	}
+	while (top >= 0);
+
+	return cost / root_surface_area;
+}
+
 void QuadTree::sPartition(NodeID *ioNodeIDs, Vec3 *ioNodeCenters, int inNumber, int &outMidPoint)
 {
 	// Handle trivial case
@@ -536,6 +736,7 @@ QuadTree::NodeID QuadTree::BuildTree(const BodyVector &inBodies, TrackingVector
 	};
 	static_assert(sizeof(StackEntry) == 64);
 	StackEntry stack[cStackSize / 4]; // We don't process 4 at a time in this loop but 1, so the stack can be 4x as small
+	uint8 new_children[cStackSize / 4]; // For each stack entry a bit mask of the children that are nodes created by this function
 	int top = 0;
 
 	// Create root node
@@ -544,6 +745,7 @@ QuadTree::NodeID QuadTree::BuildTree(const BodyVector &inBodies, TrackingVector
 	stack[0].mDepth = 0;
 	stack[0].mNodeBoundsMin = Vec3::sReplicate(cLargeFloat);
 	stack[0].mNodeBoundsMax = Vec3::sReplicate(-cLargeFloat);
+	new_children[0] = 0;
 	sPartition4(ioNodeIDs, centers, 0, inNumber, stack[0].mSplit);
 
 	for (;;)
@@ -556,6 +758,21 @@ QuadTree::NodeID QuadTree::BuildTree(const BodyVector &inBodies, TrackingVector
 		// Check if all children processed
 		if (cur_stack.mChildIdx >= 4)
 		{
+			// Now that all children are known, remember the cost of the child nodes that we created so we can detect when they degrade
+			if (new_children[top] != 0)
+			{
+				Node &node = mAllocator->Get(cur_stack.mNodeIdx);
+				AABox child_bounds[4];
+				for (int child_idx = 0; child_idx < 4; ++child_idx)
+					node.GetChildBounds(child_idx, child_bounds[child_idx]);
+				for (int child_idx = 0; child_idx < 4; ++child_idx)
+					if (new_children[top] & (1 << child_idx))
+					{
+						NodeID child_node_id = node.mChildNodeID[child_idx];
+						mAllocator->Get(child_node_id.GetNodeIndex()).mBuildCost = sGetChildCost(child_bounds, child_idx);
+					}
+			}
+
 			// Terminate if there's nothing left to pop
 			if (top <= 0)
 				break;
@@ -566,13 +783,15 @@ QuadTree::NodeID QuadTree::BuildTree(const BodyVector &inBodies, TrackingVector
 			prev_stack.mNodeBoundsMax = Vec3::sMax(prev_stack.mNodeBoundsMax, cur_stack.mNodeBoundsMax);
 
 			// Store parent node
+			AABox node_bounds(cur_stack.mNodeBoundsMin, cur_stack.mNodeBoundsMax);
 			Node &node = mAllocator->Get(cur_stack.mNodeIdx);
 			node.mParentNodeIndex = prev_stack.mNodeIdx;
 
 			// Store this node's properties in the parent node
 			Node &parent_node = mAllocator->Get(prev_stack.mNodeIdx);
 			parent_node.mChildNodeID[prev_stack.mChildIdx] = NodeID::sFromNodeIndex(cur_stack.mNodeIdx);
-			parent_node.SetChildBounds(prev_stack.mChildIdx, AABox(cur_stack.mNodeBoundsMin, cur_stack.mNodeBoundsMax));
+			parent_node.SetChildBounds(prev_stack.mChildIdx, node_bounds);
+			new_children[top - 1] |= uint8(1 << prev_stack.mChildIdx);
 
 			// Pop entry from stack
 			--top;
@@ -622,6 +841,7 @@ QuadTree::NodeID QuadTree::BuildTree(const BodyVector &inBodies, TrackingVector
 				new_stack.mDepth = next_depth;
 				new_stack.mNodeBoundsMin = Vec3::sReplicate(cLargeFloat);
 				new_stack.mNodeBoundsMax = Vec3::sReplicate(-cLargeFloat);
+				new_children[top] = 0;
 				sPartition4(ioNodeIDs, centers, low, high, new_stack.mSplit);
 			}
 		}
@@ -633,6 +853,7 @@ QuadTree::NodeID QuadTree::BuildTree(const BodyVector &inBodies, TrackingVector
 	// Store bounding box of root
 	outBounds.mMin = stack[0].mNodeBoundsMin;
 	outBounds.mMax = stack[0].mNodeBoundsMax;
+	mAllocator->Get(stack[0].mNodeIdx).mBuildCost = outBounds.GetSurfaceArea(); // The root has no siblings yet
 
 	// Return root
 	return NodeID::sFromNodeIndex(stack[0].mNodeIdx);
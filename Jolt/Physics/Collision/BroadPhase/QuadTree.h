@@ -134,8 +134,9 @@ private:
 		/// If any changes are made to an object inside this sub tree then the direct path from the body to the top of the tree will become changed.
 		atomic<uint32>			mIsChanged;
 
-		// Padding to align to 124 bytes
-		uint32					mPadding = 0;
+		/// Cost of this node at the time it was built (see sGetChildCost), used to detect how much the node has degraded since.
+		/// This also pads the node to 128 bytes.
+		float					mBuildCost = 0.0f;
 	};
 
 	// Maximum size of the stack during tree walk
@@ -205,6 +206,16 @@ public:
 	void						UpdatePrepare(const BodyVector &inBodies, TrackingVector &ioTracking, UpdateState &outUpdateState, bool inFullRebuild);
 	void						UpdateFinalize(const BodyVector &inBodies, const TrackingVector &inTracking, const UpdateState &inUpdateState);
 
+	/// Incremental optimization: Find the subtrees whose surface area heuristic cost increased the most since they were built
+	/// (e.g. because bodies moved and widened the bounds) and mark up to inMaxNodes nodes in them as changed.
+	/// The next UpdatePrepare/Finalize() will rebuild these subtrees. Returns true if any node was marked.
+	/// Should only be called when no UpdatePrepare/Finalize() is in progress.
+	bool						MarkWorstSubtreesChanged(uint inMaxNodes);
+
+	/// Get the surface area heuristic cost of the tree: the sum of the surface areas of all nodes divided by the surface area of the root.
+	/// This is proportional to the amount of nodes that a randomly placed query needs to visit, so lower is better.
+	float						GetSurfaceAreaHeuristicCost() const;
+
 	/// Temporary data structure to pass information between AddBodiesPrepare and AddBodiesFinalize/Abort
 	struct AddState
 	{
@@ -305,6 +316,10 @@ private:
 	/// Build a tree for ioBodyIDs, returns the NodeID of the root (which will be the ID of a single body if inNumber = 1). All tree levels up to inMaxDepthMarkChanged will be marked as 'changed'.
 	NodeID						BuildTree(const BodyVector &inBodies, TrackingVector &ioTracking, NodeID *ioNodeIDs, int inNumber, uint inMaxDepthMarkChanged, AABox &outBounds);
 
+	/// Get the cost of visiting child inChildIndex of a node, inChildBounds are the bounds of all 4 children of the node.
+	/// This is the surface area of the child (the chance that a query needs to visit it) plus the surface area that it overlaps with its siblings.
+	static float				sGetChildCost(const AABox *inChildBounds, int inChildIndex);
+
 	/// Sorts ioNodeIDs spatially into 2 groups. Second groups starts at ioNodeIDs + outMidPoint.
 	/// After the function returns ioNodeIDs and ioNodeCenters will be shuffled
 	static void					sPartition(NodeID *ioNodeIDs, Vec3 *ioNodeCenters, int inNumber, int &outMidPoint);
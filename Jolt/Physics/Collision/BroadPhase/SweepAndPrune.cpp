@@ -0,0 +1,548 @@
+// Jolt Physics Library (https://github.com/jrouwe/JoltPhysics)
+// SPDX-FileCopyrightText: 2024 Jorrit Rouwe
+// SPDX-License-Identifier: MIT
+
+#include <Jolt/Jolt.h>
+
+#include <Jolt/Physics/Collision/BroadPhase/SweepAndPrune.h>
+#include <Jolt/Physics/Collision/RayCast.h>
+#include <Jolt/Physics/Collision/AABoxCast.h>
+#include <Jolt/Physics/Collision/CastResult.h>
+#include <Jolt/Physics/Body/BodyPair.h>
+#include <Jolt/Geometry/RayAABox.h>
+#include <Jolt/Geometry/OrientedBox.h>
+#include <Jolt/Core/QuickSort.h>
+#include <Jolt/Core/InsertionSort.h>
+
+JPH_NAMESPACE_BEGIN
+
+inline void SweepAndPrune::AccumulateCenter(Vec3Arg inCenter, double inSign)
+{
+	DVec3 center(inCenter);
+	mCenterSum += inSign * center;
+	mCenterSqSum += inSign * center * center;
+}
+
+void SweepAndPrune::AddBodies(const BodyVector &inBodies, const BodyID *inBodyIDs, int inNumber)
+{
+	JPH_PROFILE_FUNCTION();
+
+	JPH_ASSERT(inNumber > 0);
+
+	lock_guard lock(mMutex);
+
+	// Make sure there's space to store the sort keys
+	uint32 max_index = 0;
+	for (const BodyID *b = inBodyIDs, *b_end = inBodyIDs + inNumber; b < b_end; ++b)
+		max_index = max(max_index, b->GetIndex());
+	if (mSortKeys.size() <= max_index)
+	{
+		mSortKeys.resize(max_index + 1);
+		mMovedBodies.resize(max_index + 1);
+		mIsMoved.resize(max_index + 1, false);
+		mCenters.resize(max_index + 1);
+	}
+
+	// Create entries for the new bodies at the end of the list
+	size_t old_size = mEntries.size();
+	mEntries.resize(old_size + inNumber);
+	float max_extent = 0.0f;
+	Entry *entry = mEntries.data() + old_size;
+	for (const BodyID *b = inBodyIDs, *b_end = inBodyIDs + inNumber; b < b_end; ++b, ++entry)
+	{
+		uint32 index = b->GetIndex();
+		const AABox &bounds = inBodies[index]->GetWorldSpaceBounds();
+		float key = bounds.mMin[mAxis];
+		max_extent = max(max_extent, bounds.mMax[mAxis] - key);
+		mSortKeys[index] = key;
+		entry->mKey = key;
+		entry->mBodyID = *b;
+
+		// Keep track of the spread of the bodies
+		Vec3 center = bounds.GetCenter();
+		center.StoreFloat3(&mCenters[index]);
+		AccumulateCenter(center, 1.0);
+	}
+	AtomicMax(mMaxExtent, max_extent, memory_order_relaxed);
+
+	// Sort the new entries
+	auto compare = [](const Entry &inLHS, const Entry &inRHS) { return inLHS.mKey < inRHS.mKey; };
+	Entries::iterator middle = mEntries.begin() + old_size;
+	QuickSort(middle, mEntries.end(), compare);
+
+	// Merge them with the existing entries
+	if (old_size > 0)
+	{
+		mNextEntries.resize(mEntries.size());
+		std::merge(mEntries.begin(), middle, middle, mEntries.end(), mNextEntries.begin(), compare);
+		mEntries.swap(mNextEntries);
+	}
+
+	mNumBodies.store(uint32(mEntries.size()), memory_order_relaxed);
+}
+
+void SweepAndPrune::RemoveBodies(BodyID *ioBodyIDs, int inNumber)
+{
+	JPH_PROFILE_FUNCTION();
+
+	JPH_ASSERT(inNumber > 0);
+
+	lock_guard lock(mMutex);
+
+	// Sort the bodies so we can binary search them
+	BodyID *b_end = ioBodyIDs + inNumber;
+	QuickSort(ioBodyIDs, b_end);
+	auto is_removed = [ioBodyIDs, b_end](const BodyID &inBodyID) { return std::binary_search(ioBodyIDs, b_end, inBodyID); };
+
+	// Remove all entries that refer to these bodies
+	Entries::iterator new_end = std::remove_if(mEntries.begin(), mEntries.end(), [&is_removed](const Entry &inEntry) { return is_removed(inEntry.mBodyID); });
+	JPH_ASSERT(mEntries.end() - new_end == inNumber, "Trying to remove bodies that are not in the list");
+	mEntries.erase(new_end, mEntries.end());
+
+	// Remove the bodies from the moved list, when the list overflowed UpdatePrepare will resort the entire list anyway
+	uint32 num_moved = mNumMovedBodies.load(memory_order_relaxed);
+	if (num_moved > 0 && num_moved <= mMovedBodies.size())
+	{
+		Array<BodyID>::iterator moved_end = std::remove_if(mMovedBodies.begin(), mMovedBodies.begin() + num_moved, is_removed);
+		mNumMovedBodies.store(uint32(moved_end - mMovedBodies.begin()), memory_order_relaxed);
+	}
+
+	// Keep track of the spread of the bodies, reset the sums when the list is empty so that rounding errors don't accumulate
+	if (mEntries.empty())
+	{
+		mCenterSum = DVec3::sZero();
+		mCenterSqSum = DVec3::sZero();
+	}
+	else
+		for (const BodyID *b = ioBodyIDs; b < b_end; ++b)
+			AccumulateCenter(Vec3(mCenters[b->GetIndex()]), -1.0);
+
+	mNumBodies.store(uint32(mEntries.size()), memory_order_relaxed);
+}
+
+void SweepAndPrune::NotifyBodiesAABBChanged(const BodyVector &inBodies, const BodyID *inBodyIDs, int inNumber)
+{
+	// Prevent the sort keys from being resized by AddBodies
+	shared_lock lock(mMutex);
+
+	// Determine how far the bodies moved away from their sort key
+	float max_drift = 0.0f, max_extent = 0.0f;
+	for (const BodyID *b = inBodyIDs, *b_end = inBodyIDs + inNumber; b < b_end; ++b)
+	{
+		const AABox &bounds = inBodies[b->GetIndex()]->GetWorldSpaceBounds();
+		float min = bounds.mMin[mAxis];
+		max_drift = max(max_drift, abs(min - mSortKeys[b->GetIndex()]));
+		max_extent = max(max_extent, bounds.mMax[mAxis] - min);
+	}
+
+	// Queries need to take this into account
+	AtomicMax(mMaxDrift, max_drift, memory_order_relaxed);
+	AtomicMax(mMaxExtent, max_extent, memory_order_relaxed);
+
+	// Queue the bodies so that UpdatePrepare gives them a new sort key, if the queue overflows the entire list is resorted
+	uint32 first = mNumMovedBodies.fetch_add(uint32(inNumber), memory_order_relaxed);
+	if (first < mMovedBodies.size())
+	{
+		uint32 num_to_copy = min(uint32(inNumber), uint32(mMovedBodies.size()) - first);
+		std::copy(inBodyIDs, inBodyIDs + num_to_copy, mMovedBodies.begin() + first);
+	}
+}
+
+bool SweepAndPrune::UpdatePrepare(const BodyVector &inBodies)
+{
+	// Check if anything moved
+	if (!IsDirty())
+		return false;
+
+	JPH_PROFILE_FUNCTION();
+
+	// Take the bodies that moved, NotifyBodiesAABBChanged cannot be called until UpdateFinalize
+	uint32 num_moved = mNumMovedBodies.exchange(0, memory_order_relaxed);
+	bool full_sort = num_moved > mMovedBodies.size();
+	Array<BodyID>::iterator moved_begin = mMovedBodies.begin(), moved_end = moved_begin;
+	if (full_sort)
+	{
+		// The queue overflowed, recalculate the spread of the bodies from scratch
+		mCenterSum = DVec3::sZero();
+		mCenterSqSum = DVec3::sZero();
+		for (const Entry &e : mEntries)
+		{
+			uint32 index = e.mBodyID.GetIndex();
+			Vec3 center = inBodies[index]->GetWorldSpaceBounds().GetCenter();
+			center.StoreFloat3(&mCenters[index]);
+			AccumulateCenter(center, 1.0);
+		}
+	}
+	else
+	{
+		// A body can be notified multiple times, remove duplicates
+		moved_end = moved_begin + num_moved;
+		QuickSort(moved_begin, moved_end);
+		moved_end = std::unique(moved_begin, moved_end);
+
+		// Only the bodies that moved change the spread of the bodies
+		for (Array<BodyID>::const_iterator b = moved_begin; b < moved_end; ++b)
+		{
+			uint32 index = b->GetIndex();
+			Vec3 center = inBodies[index]->GetWorldSpaceBounds().GetCenter();
+			AccumulateCenter(Vec3(mCenters[index]), -1.0);
+			AccumulateCenter(center, 1.0);
+			center.StoreFloat3(&mCenters[index]);
+		}
+	}
+
+	// Pick the axis along which the bodies are spread out the most
+	uint axis = mAxis;
+	if (!mEntries.empty())
+	{
+		double num_bodies = double(mEntries.size());
+		DVec3 mean = mCenterSum / num_bodies;
+		Vec3 variance(mCenterSqSum / num_bodies - mean * mean);
+
+		// Only switch when the other axis is significantly better as switching requires a full sort
+		uint best_axis = uint(variance.GetHighestComponentIndex());
+		if (variance[best_axis] > 1.5f * variance[mAxis])
+		{
+			axis = best_axis;
+			full_sort = true;
+		}
+	}
+
+	auto compare = [](const Entry &inLHS, const Entry &inRHS) { return inLHS.mKey < inRHS.mKey; };
+	mNextEntries.resize(mEntries.size());
+	Entry *next_entry = mNextEntries.data();
+	float max_extent = 0.0f;
+	if (full_sort)
+	{
+		// Update all sort keys
+		for (const Entry &e : mEntries)
+		{
+			const AABox &bounds = inBodies[e.mBodyID.GetIndex()]->GetWorldSpaceBounds();
+			float key = bounds.mMin[axis];
+			max_extent = max(max_extent, bounds.mMax[axis] - key);
+			mSortKeys[e.mBodyID.GetIndex()] = key;
+			next_entry->mKey = key;
+			next_entry->mBodyID = e.mBodyID;
+			++next_entry;
+		}
+
+		// Sort the list, if the axis didn't change the list is almost sorted so an insertion sort is fastest
+		if (axis == mAxis)
+			InsertionSort(mNextEntries.begin(), mNextEntries.end(), compare);
+		else
+			QuickSort(mNextEntries.begin(), mNextEntries.end(), compare);
+	}
+	else
+	{
+		// Update the sort keys of the bodies that moved
+		mMovedEntries.resize(moved_end - moved_begin);
+		Entry *moved_entry = mMovedEntries.data();
+		for (Array<BodyID>::const_iterator b = moved_begin; b < moved_end; ++b, ++moved_entry)
+		{
+			uint32 index = b->GetIndex();
+			float key = inBodies[index]->GetWorldSpaceBounds().mMin[axis];
+			mSortKeys[index] = key;
+			mIsMoved[index] = true;
+			moved_entry->mKey = key;
+			moved_entry->mBodyID = *b;
+		}
+		QuickSort(mMovedEntries.begin(), mMovedEntries.end(), compare);
+
+		// Merge them with the bodies that didn't move, these are still sorted
+		Entries::const_iterator m = mMovedEntries.begin(), m_end = mMovedEntries.end();
+		for (const Entry &e : mEntries)
+			if (!mIsMoved[e.mBodyID.GetIndex()])
+			{
+				for (; m < m_end && m->mKey < e.mKey; ++m)
+					*next_entry++ = *m;
+				*next_entry++ = e;
+			}
+		for (; m < m_end; ++m)
+			*next_entry++ = *m;
+		JPH_ASSERT(next_entry == mNextEntries.data() + mNextEntries.size(), "Moved bodies should be in the list exactly once");
+
+		// Reset the scratch flags
+		for (const Entry &e : mMovedEntries)
+			mIsMoved[e.mBodyID.GetIndex()] = false;
+
+		// NotifyBodiesAABBChanged already took the extent of the moved bodies into account, this doesn't shrink until the next full sort
+		max_extent = mMaxExtent.load(memory_order_relaxed);
+	}
+
+	mNextAxis = axis;
+	mNextMaxExtent = max_extent;
+	mUpdatePrepared = true;
+	return true;
+}
+
+void SweepAndPrune::UpdateFinalize()
+{
+	// Check if there's anything to swap in
+	if (!mUpdatePrepared)
+		return;
+	mUpdatePrepared = false;
+
+	lock_guard lock(mMutex);
+
+	// Swap in the new list, the sort keys now match the bounds of the bodies again
+	mEntries.swap(mNextEntries);
+	mAxis = mNextAxis;
+	mMaxExtent.store(mNextMaxExtent, memory_order_relaxed);
+	mMaxDrift.store(0.0f, memory_order_relaxed);
+}
+
+template <class Visitor>
+inline void SweepAndPrune::WalkRange(float inMin, float inMax, const Visitor &inVisitor) const
+{
+	// Bodies can have moved up to mMaxDrift away from their sort key, the first body that can overlap starts at most mMaxExtent before inMin
+	float max_drift = mMaxDrift.load(memory_order_relaxed);
+	float min_key = inMin - mMaxExtent.load(memory_order_relaxed) - max_drift;
+	float max_key = inMax + max_drift;
+
+	// Find the first body that could overlap and walk until the keys are beyond the range
+	Entries::const_iterator e = std::lower_bound(mEntries.begin(), mEntries.end(), min_key, [](const Entry &inEntry, float inKey) { return inEntry.mKey < inKey; });
+	for (Entries::const_iterator e_end = mEntries.end(); e < e_end && e->mKey <= max_key; ++e)
+		if (inVisitor(e->mBodyID))
+			return;
+}
+
+void SweepAndPrune::CastRay(const RayCast &inRay, RayCastBodyCollector &ioCollector, const ObjectLayerFilter &inObjectLayerFilter, const BodyVector &inBodies) const
+{
+	JPH_PROFILE_FUNCTION();
+
+	shared_lock lock(mMutex);
+
+	// Load ray
+	Vec3 origin(inRay.mOrigin);
+	RayInvDirection inv_direction(inRay.mDirection);
+
+	// Determine range of the ray along the sort axis
+	float start = origin[mAxis];
+	float end = start + inRay.mDirection[mAxis];
+
+	WalkRange(min(start, end), max(start, end), [&origin, &inv_direction, &ioCollector, &inObjectLayerFilter, &inBodies](const BodyID &inBodyID)
+	{
+		const Body &body = *inBodies[inBodyID.GetIndex()];
+
+		// Test layer
+		if (inObjectLayerFilter.ShouldCollide(body.GetObjectLayer()))
+		{
+			// Test intersection with ray
+			const AABox &bounds = body.GetWorldSpaceBounds();
+			float fraction = RayAABox(origin, inv_direction, bounds.mMin, bounds.mMax);
+			if (fraction < ioCollector.GetEarlyOutFraction())
+			{
+				// Store hit
+				BroadPhaseCastResult result { inBodyID, fraction };
+				ioCollector.AddHit(result);
+				return ioCollector.ShouldEarlyOut();
+			}
+		}
+		return false;
+	});
+}
+
+void SweepAndPrune::CollideAABox(const AABox &inBox, CollideShapeBodyCollector &ioCollector, const ObjectLayerFilter &inObjectLayerFilter, const BodyVector &inBodies) const
+{
+	JPH_PROFILE_FUNCTION();
+
+	shared_lock lock(mMutex);
+
+	WalkRange(inBox.mMin[mAxis], inBox.mMax[mAxis], [&inBox, &ioCollector, &inObjectLayerFilter, &inBodies](const BodyID &inBodyID)
+	{
+		const Body &body = *inBodies[inBodyID.GetIndex()];
+
+		// Test layer and intersection with box
+		if (inObjectLayerFilter.ShouldCollide(body.GetObjectLayer())
+			&& body.GetWorldSpaceBounds().Overlaps(inBox))
+		{
+			// Store hit
+			ioCollector.AddHit(inBodyID);
+			return ioCollector.ShouldEarlyOut();
+		}
+		return false;
+	});
+}
+
+void SweepAndPrune::CollideSphere(Vec3Arg inCenter, float inRadius, CollideShapeBodyCollector &ioCollector, const ObjectLayerFilter &inObjectLayerFilter, const BodyVector &inBodies) const
+{
+	JPH_PROFILE_FUNCTION();
+
+	shared_lock lock(mMutex);
+
+	float radius_sq = Square(inRadius);
+	float center = inCenter[mAxis];
+
+	WalkRange(center - inRadius, center + inRadius, [inCenter, radius_sq, &ioCollector, &inObjectLayerFilter, &inBodies](const BodyID &inBodyID)
+	{
+		const Body &body = *inBodies[inBodyID.GetIndex()];
+
+		// Test layer and intersection with sphere
+		if (inObjectLayerFilter.ShouldCollide(body.GetObjectLayer())
+			&& body.GetWorldSpaceBounds().GetSqDistanceTo(inCenter) <= radius_sq)
+		{
+			// Store hit
+			ioCollector.AddHit(inBodyID);
+			return ioCollector.ShouldEarlyOut();
+		}
+		return false;
+	});
+}
+
+void SweepAndPrune::CollidePoint(Vec3Arg inPoint, CollideShapeBodyCollector &ioCollector, const ObjectLayerFilter &inObjectLayerFilter, const BodyVector &inBodies) const
+{
+	JPH_PROFILE_FUNCTION();
+
+	shared_lock lock(mMutex);
+
+	float point = inPoint[mAxis];
+
+	WalkRange(point, point, [inPoint, &ioCollector, &inObjectLayerFilter, &inBodies](const BodyID &inBodyID)
+	{
+		const Body &body = *inBodies[inBodyID.GetIndex()];
+
+		// Test layer and if point is inside box
+		if (inObjectLayerFilter.ShouldCollide(body.GetObjectLayer())
+			&& body.GetWorldSpaceBounds().Contains(inPoint))
+		{
+			// Store hit
+			ioCollector.AddHit(inBodyID);
+			return ioCollector.ShouldEarlyOut();
+		}
+		return false;
+	});
+}
+
+void SweepAndPrune::CollideOrientedBox(const OrientedBox &inBox, CollideShapeBodyCollector &ioCollector, const ObjectLayerFilter &inObjectLayerFilter, const BodyVector &inBodies) const
+{
+	JPH_PROFILE_FUNCTION();
+
+	shared_lock lock(mMutex);
+
+	// Get the world space bounds of the oriented box
+	AABox bounds = AABox(-inBox.mHalfExtents, inBox.mHalfExtents).Transformed(inBox.mOrientation);
+
+	WalkRange(bounds.mMin[mAxis], bounds.mMax[mAxis], [&inBox, &ioCollector, &inObjectLayerFilter, &inBodies](const BodyID &inBodyID)
+	{
+		const Body &body = *inBodies[inBodyID.GetIndex()];
+
+		// Test layer and intersection with oriented box
+		if (inObjectLayerFilter.ShouldCollide(body.GetObjectLayer())
+			&& inBox.Overlaps(body.GetWorldSpaceBounds()))
+		{
+			// Store hit
+			ioCollector.AddHit(inBodyID);
+			return ioCollector.ShouldEarlyOut();
+		}
+		return false;
+	});
+}
+
+void SweepAndPrune::CastAABox(const AABoxCast &inBox, CastShapeBodyCollector &ioCollector, const ObjectLayerFilter &inObjectLayerFilter, const BodyVector &inBodies) const
+{
+	JPH_PROFILE_FUNCTION();
+
+	shared_lock lock(mMutex);
+
+	// Load box
+	Vec3 origin(inBox.mBox.GetCenter());
+	Vec3 extent(inBox.mBox.GetExtent());
+	RayInvDirection inv_direction(inBox.mDirection);
+
+	// Determine range of the swept box along the sort axis
+	float start = origin[mAxis];
+	float end = start + inBox.mDirection[mAxis];
+	float axis_extent = extent[mAxis];
+
+	WalkRange(min(start, end) - axis_extent, max(start, end) + axis_extent, [&origin, &extent, &inv_direction, &ioCollector, &inObjectLayerFilter, &inBodies](const BodyID &inBodyID)
+	{
+		const Body &body = *inBodies[inBodyID.GetIndex()];
+
+		// Test layer
+		if (inObjectLayerFilter.ShouldCollide(body.GetObjectLayer()))
+		{
+			// Test intersection with ray against the box expanded by the extent of the cast box
+			const AABox &bounds = body.GetWorldSpaceBounds();
+			float fraction = RayAABox(origin, inv_direction, bounds.mMin - extent, bounds.mMax + extent);
+			if (fraction < ioCollector.GetPositiveEarlyOutFraction())
+			{
+				// Store hit
+				BroadPhaseCastResult result { inBodyID, fraction };
+				ioCollector.AddHit(result);
+				return ioCollector.ShouldEarlyOut();
+			}
+		}
+		return false;
+	});
+}
+
+void SweepAndPrune::FindCollidingPairs(const BodyVector &inBodies, const BodyID *inActiveBodies, int inNumActiveBodies, float inSpeculativeContactDistance, BodyPairCollector &ioPairCollector, const ObjectLayerPairFilter &inObjectLayerPairFilter) const
+{
+	JPH_PROFILE_FUNCTION();
+
+	// Assert sane input
+	JPH_ASSERT(inActiveBodies != nullptr);
+	JPH_ASSERT(inNumActiveBodies > 0);
+
+	shared_lock lock(mMutex);
+
+	// Loop over all active bodies
+	for (const BodyID *b1 = inActiveBodies, *b1_end = inActiveBodies + inNumActiveBodies; b1 < b1_end; ++b1)
+	{
+		BodyID b1_id = *b1;
+		const Body &body1 = *inBodies[b1_id.GetIndex()];
+		JPH_ASSERT(!body1.IsStatic());
+
+		// Expand the bounding box by the speculative contact distance
+		AABox bounds1 = body1.GetWorldSpaceBounds();
+		bounds1.ExpandBy(Vec3::sReplicate(inSpeculativeContactDistance));
+
+		// Test the body against all bodies in range
+		WalkRange(bounds1.mMin[mAxis], bounds1.mMax[mAxis], [b1_id, &body1, &bounds1, &ioPairCollector, &inObjectLayerPairFilter, &inBodies](const BodyID &inBodyID)
+		{
+			// Don't collide with self
+			if (b1_id != inBodyID)
+			{
+				// Collision between dynamic pairs need to be picked up only once
+				const Body &body2 = *inBodies[inBodyID.GetIndex()];
+				if (inObjectLayerPairFilter.ShouldCollide(body1.GetObjectLayer(), body2.GetObjectLayer())
+					&& Body::sFindCollidingPairsCanCollide(body1, body2)
+					&& bounds1.Overlaps(body2.GetWorldSpaceBounds()))
+				{
+					// Store potential hit between bodies
+					ioPairCollector.AddHit({ b1_id, inBodyID });
+				}
+			}
+			return false;
+		});
+	}
+}
+
+AABox SweepAndPrune::GetBounds(const BodyVector &inBodies) const
+{
+	shared_lock lock(mMutex);
+
+	AABox bounds;
+	for (const Entry &e : mEntries)
+		bounds.Encapsulate(inBodies[e.mBodyID.GetIndex()]->GetWorldSpaceBounds());
+	return bounds;
+}
+
+bool SweepAndPrune::IsSorted() const
+{
+	shared_lock lock(mMutex);
+
+	if (mEntries.size() != mNumBodies.load(memory_order_relaxed))
+		return false;
+
+	for (size_t i = 0; i < mEntries.size(); ++i)
+	{
+		const Entry &e = mEntries[i];
+		if ((i > 0 && mEntries[i - 1].mKey > e.mKey)
+			|| mSortKeys[e.mBodyID.GetIndex()] != e.mKey)
+			return false;
+	}
+	return true;
+}
+
+JPH_NAMESPACE_END
@@ -0,0 +1,143 @@
+// Jolt Physics Library (https://github.com/jrouwe/JoltPhysics)
+// SPDX-FileCopyrightText: 2024 Jorrit Rouwe
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <Jolt/Core/Atomics.h>
+#include <Jolt/Core/Mutex.h>
+#include <Jolt/Core/NonCopyable.h>
+#include <Jolt/Physics/Body/BodyManager.h>
+#include <Jolt/Physics/Collision/BroadPhase/BroadPhase.h>
+
+JPH_NAMESPACE_BEGIN
+
+/// Internal sweep and prune structure in broadphase, keeps a list of bodies sorted by the minimum of their bounding box along a single axis.
+/// The axis is chosen to be the one along which the bodies are spread out the most.
+/// Moving bodies doesn't change the sorted list, instead the bodies are queued and the maximum distance that a body moved away from its sort key is tracked and queries are widened by this distance.
+/// During the UpdatePrepare/Finalize() call only the queued bodies get a new sort key, they are sorted and merged back into the list.
+/// The spread of the bodies is tracked incrementally as well, the list is only fully resorted when another axis becomes significantly better.
+class JPH_EXPORT SweepAndPrune : public NonCopyable
+{
+public:
+	JPH_OVERRIDE_NEW_DELETE
+
+	/// Add bodies to the list, inBodies is the list of all bodies in the body manager
+	void						AddBodies(const BodyVector &inBodies, const BodyID *inBodyIDs, int inNumber);
+
+	/// Remove bodies from the list (can change order of ioBodyIDs array)
+	void						RemoveBodies(BodyID *ioBodyIDs, int inNumber);
+
+	/// Call whenever the aabb of a body changes
+	void						NotifyBodiesAABBChanged(const BodyVector &inBodies, const BodyID *inBodyIDs, int inNumber);
+
+	/// Check if there are any bodies in the list
+	inline bool					HasBodies() const							{ return mNumBodies.load(memory_order_relaxed) != 0; }
+
+	/// Check if bodies moved since the last update
+	inline bool					IsDirty() const								{ return mNumMovedBodies.load(memory_order_relaxed) != 0; }
+
+	/// Resort the list, this can run in a background thread without influencing queries. Returns false if there was nothing to do.
+	bool						UpdatePrepare(const BodyVector &inBodies);
+
+	/// Swap in the list that was sorted in UpdatePrepare (does nothing if UpdatePrepare returned false)
+	void						UpdateFinalize();
+
+	/// Cast a ray and get the intersecting bodies in ioCollector.
+	void						CastRay(const RayCast &inRay, RayCastBodyCollector &ioCollector, const ObjectLayerFilter &inObjectLayerFilter, const BodyVector &inBodies) const;
+
+	/// Get bodies intersecting with inBox in ioCollector
+	void						CollideAABox(const AABox &inBox, CollideShapeBodyCollector &ioCollector, const ObjectLayerFilter &inObjectLayerFilter, const BodyVector &inBodies) const;
+
+	/// Get bodies intersecting with a sphere in ioCollector
+	void						CollideSphere(Vec3Arg inCenter, float inRadius, CollideShapeBodyCollector &ioCollector, const ObjectLayerFilter &inObjectLayerFilter, const BodyVector &inBodies) const;
+
+	/// Get bodies intersecting with a point and any hits to ioCollector
+	void						CollidePoint(Vec3Arg inPoint, CollideShapeBodyCollector &ioCollector, const ObjectLayerFilter &inObjectLayerFilter, const BodyVector &inBodies) const;
+
+	/// Get bodies intersecting with an oriented box and any hits to ioCollector
+	void						CollideOrientedBox(const OrientedBox &inBox, CollideShapeBodyCollector &ioCollector, const ObjectLayerFilter &inObjectLayerFilter, const BodyVector &inBodies) const;
+
+	/// Cast a box and get intersecting bodies in ioCollector
+	void						CastAABox(const AABoxCast &inBox, CastShapeBodyCollector &ioCollector, const ObjectLayerFilter &inObjectLayerFilter, const BodyVector &inBodies) const;
+
+	/// Find all colliding pairs between dynamic bodies, calls ioPairCollector for every pair found
+	void						FindCollidingPairs(const BodyVector &inBodies, const BodyID *inActiveBodies, int inNumActiveBodies, float inSpeculativeContactDistance, BodyPairCollector &ioPairCollector, const ObjectLayerPairFilter &inObjectLayerPairFilter) const;
+
+	/// Get the bounding box of all bodies in the list
+	AABox						GetBounds(const BodyVector &inBodies) const;
+
+	/// Check that the list is sorted and that every body is stored with the sort key that was assigned to it (for validation)
+	bool						IsSorted() const;
+
+private:
+	/// A body in the sorted list
+	struct Entry
+	{
+		float					mKey;										///< Minimum of the bounding box of the body along the sort axis at the time the list was sorted
+		BodyID					mBodyID;									///< Body that this entry refers to
+	};
+
+	using Entries = Array<Entry>;
+
+	/// Add (inSign = 1) or remove (inSign = -1) the center of the bounding box of a body from the running sums that are used to pick the sort axis
+	inline void					AccumulateCenter(Vec3Arg inCenter, double inSign);
+
+	/// Visit all bodies that potentially overlap with the range [inMin, inMax] along the sort axis. inVisitor returns true when the walk should be aborted.
+	template <class Visitor>
+	inline void					WalkRange(float inMin, float inMax, const Visitor &inVisitor) const;
+
+	/// Lock that protects the sorted list, queries take a shared lock, modifications take a unique lock
+	mutable SharedMutex			mMutex;
+
+	/// List of bodies sorted on mKey
+	Entries						mEntries;
+
+	/// List of bodies that was sorted in UpdatePrepare, to be swapped in UpdateFinalize
+	Entries						mNextEntries;
+
+	/// For each body index the sort key that was used in the sorted list
+	Array<float>				mSortKeys;
+
+	/// Amount of bodies in the list
+	atomic<uint32>				mNumBodies { 0 };
+
+	/// Bodies that moved since the last update (can contain duplicates), has the same size as mSortKeys so that it can't overflow unless bodies are notified multiple times
+	Array<BodyID>				mMovedBodies;
+
+	/// Amount of bodies that were added to mMovedBodies, when this is bigger than the size of mMovedBodies the list overflowed and needs a full resort
+	atomic<uint32>				mNumMovedBodies { 0 };
+
+	/// Scratch area for UpdatePrepare: for each body index if the body moved
+	Array<bool>					mIsMoved;
+
+	/// Scratch area for UpdatePrepare: the sorted entries of the bodies that moved
+	Entries						mMovedEntries;
+
+	/// For each body index the center of its bounding box at the time it was last accounted for in mCenterSum and mCenterSqSum
+	Array<Float3>				mCenters;
+
+	/// Sum of the centers and squared centers of the bounding boxes of all bodies, used to determine the variance along each axis
+	DVec3						mCenterSum = DVec3::sZero();
+	DVec3						mCenterSqSum = DVec3::sZero();
+
+	/// Axis along which the list is sorted (0 = X, 1 = Y, 2 = Z)
+	uint						mAxis = 0;
+
+	/// Axis that was chosen by UpdatePrepare
+	uint						mNextAxis = 0;
+
+	/// If UpdatePrepare filled in mNextEntries
+	bool						mUpdatePrepared = false;
+
+	/// Maximum size of the bounding box of any body along the sort axis
+	atomic<float>				mMaxExtent { 0.0f };
+
+	/// Maximum size of the bounding box of any body along the sort axis as determined by UpdatePrepare
+	float						mNextMaxExtent = 0.0f;
+
+	/// Maximum distance between the minimum of the bounding box of a body along the sort axis and its sort key
+	atomic<float>				mMaxDrift { 0.0f };
+};
+
+JPH_NAMESPACE_END
@@ -6,6 +6,8 @@
 
 #include <Jolt/Physics/Collision/CollideSoftBodyVertexIterator.h>
 #include <Jolt/Geometry/ClosestPoint.h>
+#include <Jolt/Geometry/AABox.h>
+#include <Jolt/Physics/Collision/Shape/ScaleHelpers.h>
 
 JPH_NAMESPACE_BEGIN
 
@@ -87,4 +89,203 @@ public:
 	uint32				mSet;
 };
 
+/// Collision detection helper that collides a batch of soft body vertices vs triangles.
+/// Instead of walking the triangle tree once for every vertex, the tree is walked once to find the distance from the center of the batch to the closest triangle
+/// and once more to collect all triangles that are within a search distance derived from it of the bounds of the batch.
+/// The vertices are then tested against the collected triangles, 4 vertices at a time. A vertex for which the closest collected triangle is further away than the search distance
+/// could have a closer triangle that was not collected, so it is collided individually. If too many triangles are found, all vertices in the batch are collided individually.
+///
+/// The shape needs to derive a visitor from this class that adds all triangles that overlap with mQueryBounds through AddTriangle and aborts the walk when ShouldAbortBatch returns true.
+class JPH_EXPORT CollideSoftBodyVerticesVsTrianglesBatch
+{
+public:
+	/// Max number of vertices in a batch
+	static constexpr uint cMaxVertices = 16;
+
+	/// Max number of triangles that can be collected for a batch before we fall back to colliding the vertices one by one
+	static constexpr uint cMaxTriangles = 128;
+
+	/// Add a triangle that overlaps with mQueryBounds
+	JPH_INLINE void		AddTriangle(Vec3Arg inV0, Vec3Arg inV1, Vec3Arg inV2)
+	{
+		if (mNumTriangles >= cMaxTriangles)
+		{
+			mOverflow = true;
+			return;
+		}
+
+		Triangle &t = mTriangles[mNumTriangles++];
+		t.mV0 = inV0;
+		t.mV1 = inV1;
+		t.mV2 = inV2;
+		t.mBounds = AABox(Vec3::sMin(Vec3::sMin(inV0, inV1), inV2), Vec3::sMax(Vec3::sMax(inV0, inV1), inV2));
+	}
+
+	/// If the triangle walk should be aborted because there are too many triangles
+	JPH_INLINE bool		ShouldAbortBatch() const
+	{
+		return mOverflow;
+	}
+
+	/// Collide inNumVertices soft body vertices.
+	/// ioVertexVisitor is the visitor that collides a single vertex, ioBatchVisitor is the visitor derived from this class and inWalk is a function that walks all triangles of the shape with either visitor.
+	template <class VertexVisitor, class BatchVisitor, class Walk>
+	static void			sCollide(VertexVisitor &ioVertexVisitor, BatchVisitor &ioBatchVisitor, const CollideSoftBodyVertexIterator &inVertices, uint inNumVertices, int inCollidingShapeIndex, const Walk &inWalk)
+	{
+		for (CollideSoftBodyVertexIterator v = inVertices, sbv_end = inVertices + inNumVertices; v != sbv_end; )
+		{
+			// Gather the next batch of vertices
+			AABox bounds;
+			uint num_vertices = 0;
+			for (; v != sbv_end && num_vertices < cMaxVertices; ++v)
+				if (v.GetInvMass() > 0.0f)
+				{
+					Vec3 local_position = ioVertexVisitor.mInvTransform * v.GetPosition();
+					ioBatchVisitor.mVertices[num_vertices] = v;
+					ioBatchVisitor.mX[num_vertices] = local_position.GetX();
+					ioBatchVisitor.mY[num_vertices] = local_position.GetY();
+					ioBatchVisitor.mZ[num_vertices] = local_position.GetZ();
+					bounds.Encapsulate(local_position);
+					++num_vertices;
+				}
+
+			if (num_vertices >= 4)
+			{
+				// Find the distance from the center of the batch to the closest triangle
+				ioVertexVisitor.mLocalPosition = bounds.GetCenter();
+				ioVertexVisitor.mClosestDistanceSq = FLT_MAX;
+				inWalk(ioVertexVisitor);
+				if (ioVertexVisitor.mClosestDistanceSq == FLT_MAX)
+					continue; // There are no triangles, so nothing to collide with
+
+				// Collect all triangles that overlap with the bounds of the batch expanded by the search distance.
+				// Any triangle that is closer to a vertex than the search distance is guaranteed to be in this set.
+				float search_distance = sqrt(ioVertexVisitor.mClosestDistanceSq) + 0.5f * bounds.GetExtent().Length();
+				ioBatchVisitor.mQueryBounds = bounds;
+				ioBatchVisitor.mQueryBounds.ExpandBy(Vec3::sReplicate(search_distance));
+				ioBatchVisitor.mNumTriangles = 0;
+				ioBatchVisitor.mOverflow = false;
+				inWalk(ioBatchVisitor);
+				if (!ioBatchVisitor.mOverflow)
+				{
+					ioBatchVisitor.ProcessBatch(num_vertices);
+
+					// Report the vertices for which we found the closest triangle and collide the others individually
+					float search_distance_sq = Square(search_distance);
+					for (uint i = 0; i < num_vertices; ++i)
+						if (ioBatchVisitor.mClosestDistanceSq[i] <= search_distance_sq)
+							ioBatchVisitor.FinishVertex(ioVertexVisitor, i, inCollidingShapeIndex);
+						else
+							sCollideVertex(ioVertexVisitor, ioBatchVisitor.mVertices[i], inCollidingShapeIndex, inWalk);
+					continue;
+				}
+			}
+
+			// Fall back to colliding the vertices one by one
+			for (uint i = 0; i < num_vertices; ++i)
+				sCollideVertex(ioVertexVisitor, ioBatchVisitor.mVertices[i], inCollidingShapeIndex, inWalk);
+		}
+	}
+
+	AABox				mQueryBounds;								///< Bounds in the local space of the shape for which triangles need to be added
+
+private:
+	/// A triangle that was collected for the batch
+	struct Triangle
+	{
+		Vec3			mV0, mV1, mV2;
+		AABox			mBounds;
+	};
+
+	/// Collide a single vertex by walking the triangle tree
+	template <class VertexVisitor, class Walk>
+	static void			sCollideVertex(VertexVisitor &ioVertexVisitor, const CollideSoftBodyVertexIterator &inVertex, int inCollidingShapeIndex, const Walk &inWalk)
+	{
+		ioVertexVisitor.StartVertex(inVertex);
+		inWalk(ioVertexVisitor);
+		ioVertexVisitor.FinishVertex(inVertex, inCollidingShapeIndex);
+	}
+
+	/// Test all vertices in the batch against the collected triangles to find the closest triangle for every vertex
+	void				ProcessBatch(uint inNumVertices)
+	{
+		// Initialize the closest distance, padding vertices get a negative distance so they're never updated
+		for (uint i = 0; i < cMaxVertices; ++i)
+			mClosestDistanceSq[i] = i < inNumVertices? FLT_MAX : -1.0f;
+		uint num_vertices_padded = AlignUp(inNumVertices, 4);
+		for (uint i = inNumVertices; i < num_vertices_padded; ++i)
+			mX[i] = mY[i] = mZ[i] = 0.0f;
+
+		for (uint t = 0; t < mNumTriangles; ++t)
+		{
+			const Triangle &triangle = mTriangles[t];
+			Vec4 min_x = triangle.mBounds.mMin.SplatX(), min_y = triangle.mBounds.mMin.SplatY(), min_z = triangle.mBounds.mMin.SplatZ();
+			Vec4 max_x = triangle.mBounds.mMax.SplatX(), max_y = triangle.mBounds.mMax.SplatY(), max_z = triangle.mBounds.mMax.SplatZ();
+
+			for (uint i = 0; i < num_vertices_padded; i += 4)
+			{
+				// Calculate the distance between 4 vertices and the bounding box of the triangle
+				Vec4 x = Vec4::sLoadFloat4Aligned(reinterpret_cast<const Float4 *>(&mX[i]));
+				Vec4 y = Vec4::sLoadFloat4Aligned(reinterpret_cast<const Float4 *>(&mY[i]));
+				Vec4 z = Vec4::sLoadFloat4Aligned(reinterpret_cast<const Float4 *>(&mZ[i]));
+				Vec4 dx = Vec4::sMax(Vec4::sMax(min_x - x, x - max_x), Vec4::sZero());
+				Vec4 dy = Vec4::sMax(Vec4::sMax(min_y - y, y - max_y), Vec4::sZero());
+				Vec4 dz = Vec4::sMax(Vec4::sMax(min_z - z, z - max_z), Vec4::sZero());
+				Vec4 dist_sq = dx * dx + dy * dy + dz * dz;
+
+				// Only do the exact test for vertices for which the triangle can be closer than the closest triangle so far
+				int closer = Vec4::sLess(dist_sq, Vec4::sLoadFloat4Aligned(reinterpret_cast<const Float4 *>(&mClosestDistanceSq[i]))).GetTrues();
+				for (; closer != 0; closer &= closer - 1)
+				{
+					uint v = i + CountTrailingZeros(uint32(closer));
+					Vec3 position(mX[v], mY[v], mZ[v]);
+					uint32 set;
+					Vec3 closest_point = ClosestPoint::GetClosestPointOnTriangle(triangle.mV0 - position, triangle.mV1 - position, triangle.mV2 - position, set);
+					float closest_dist_sq = closest_point.LengthSq();
+					if (closest_dist_sq < mClosestDistanceSq[v])
+					{
+						mClosestDistanceSq[v] = closest_dist_sq;
+						mClosestTriangle[v] = t;
+						mClosestPoint[v] = closest_point;
+						mSet[v] = set;
+					}
+				}
+			}
+		}
+
+	}
+
+	/// Report the closest triangle of a vertex in the batch through the single vertex visitor
+	template <class VertexVisitor>
+	void				FinishVertex(VertexVisitor &ioVertexVisitor, uint inVertex, int inCollidingShapeIndex) const
+	{
+		const Triangle &triangle = mTriangles[mClosestTriangle[inVertex]];
+		ioVertexVisitor.mLocalPosition = Vec3(mX[inVertex], mY[inVertex], mZ[inVertex]);
+		ioVertexVisitor.mV0 = triangle.mV0;
+		ioVertexVisitor.mV1 = triangle.mV1;
+		ioVertexVisitor.mV2 = triangle.mV2;
+		ioVertexVisitor.mClosestPoint = mClosestPoint[inVertex];
+		ioVertexVisitor.mClosestDistanceSq = mClosestDistanceSq[inVertex];
+		ioVertexVisitor.mSet = mSet[inVertex];
+		ioVertexVisitor.FinishVertex(mVertices[inVertex], inCollidingShapeIndex);
+	}
+
+	// Vertices in the batch, positions are in the local space of the shape
+	CollideSoftBodyVertexIterator mVertices[cMaxVertices];
+	alignas(16) float	mX[cMaxVertices];
+	alignas(16) float	mY[cMaxVertices];
+	alignas(16) float	mZ[cMaxVertices];
+
+	// Closest triangle for every vertex
+	alignas(16) float	mClosestDistanceSq[cMaxVertices];
+	uint32				mClosestTriangle[cMaxVertices];
+	Vec3				mClosestPoint[cMaxVertices];
+	uint32				mSet[cMaxVertices];
+
+	// Triangles collected for the batch
+	Triangle			mTriangles[cMaxTriangles];
+	uint				mNumTriangles = 0;
+	bool				mOverflow = false;
+};
+
 JPH_NAMESPACE_END
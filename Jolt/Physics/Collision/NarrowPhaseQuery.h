@@ -22,8 +22,8 @@ class RayCastResult;
 class JPH_EXPORT NarrowPhaseQuery : public NonCopyable
 {
 public:
-	/// Initialize the interface (should only be called by PhysicsSystem)
-	void						Init(BodyLockInterface &inBodyLockInterface, BroadPhaseQuery &inBroadPhaseQuery) { mBodyLockInterface = &inBodyLockInterface; mBroadPhaseQuery = &inBroadPhaseQuery; }
+	/// Initialize the interface (called by PhysicsSystem, can also be used to run narrow phase queries on top of another broad phase query)
+	void						Init(const BodyLockInterface &inBodyLockInterface, const BroadPhaseQuery &inBroadPhaseQuery) { mBodyLockInterface = &inBodyLockInterface; mBroadPhaseQuery = &inBroadPhaseQuery; }
 
 	/// Cast a ray and find the closest hit. Returns true if it finds a hit. Hits further than ioHit.mFraction will not be considered and in this case ioHit will remain unmodified (and the function will return false).
 	/// Convex objects will be treated as solid (meaning if the ray starts inside, you'll get a hit fraction of 0) and back face hits against triangles are returned.
@@ -67,8 +67,8 @@ public:
 	void						CollectTransformedShapes(const AABox &inBox, TransformedShapeCollector &ioCollector, const BroadPhaseLayerFilter &inBroadPhaseLayerFilter = { }, const ObjectLayerFilter &inObjectLayerFilter = { }, const BodyFilter &inBodyFilter = { }, const ShapeFilter &inShapeFilter = { }) const;
 
 private:
-	BodyLockInterface *			mBodyLockInterface = nullptr;
-	BroadPhaseQuery *			mBroadPhaseQuery = nullptr;
+	const BodyLockInterface *	mBodyLockInterface = nullptr;
+	const BroadPhaseQuery *		mBroadPhaseQuery = nullptr;
 };
 
 JPH_NAMESPACE_END
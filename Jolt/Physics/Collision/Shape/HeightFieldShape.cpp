@@ -2239,15 +2239,35 @@ void HeightFieldShape::CollideSoftBodyVertices(Mat44Arg inCenterOfMassTransform,
 		float			mDistanceStack[cStackSize];
 	};
 
-	Visitor visitor(inCenterOfMassTransform, inScale);
+	struct BatchVisitor : public CollideSoftBodyVerticesVsTrianglesBatch
+	{
+		JPH_INLINE bool	ShouldAbort() const
+		{
+			return ShouldAbortBatch();
+		}
 
-	for (CollideSoftBodyVertexIterator v = inVertices, sbv_end = inVertices + inNumVertices; v != sbv_end; ++v)
-		if (v.GetInvMass() > 0.0f)
+		JPH_INLINE bool	ShouldVisitRangeBlock([[maybe_unused]] int inStackTop) const
 		{
-			visitor.StartVertex(v);
-			WalkHeightField(visitor);
-			visitor.FinishVertex(v, inCollidingShapeIndex);
+			return true;
 		}
+
+		JPH_INLINE int	VisitRangeBlock(Vec4Arg inBoundsMinX, Vec4Arg inBoundsMinY, Vec4Arg inBoundsMinZ, Vec4Arg inBoundsMaxX, Vec4Arg inBoundsMaxY, Vec4Arg inBoundsMaxZ, UVec4 &ioProperties, [[maybe_unused]] int inStackTop)
+		{
+			// Visit all valid range blocks that overlap with the query bounds
+			UVec4 collides = AABox4VsBox(mQueryBounds, inBoundsMinX, inBoundsMinY, inBoundsMinZ, inBoundsMaxX, inBoundsMaxY, inBoundsMaxZ);
+			collides = UVec4::sAnd(collides, Vec4::sLessOrEqual(inBoundsMinY, inBoundsMaxY));
+			return CountAndSortTrues(collides, ioProperties);
+		}
+
+		JPH_INLINE void	VisitTriangle([[maybe_unused]] uint inX, [[maybe_unused]] uint inY, [[maybe_unused]] uint inTriangle, Vec3Arg inV0, Vec3Arg inV1, Vec3Arg inV2)
+		{
+			AddTriangle(inV0, inV1, inV2);
+		}
+	};
+
+	Visitor visitor(inCenterOfMassTransform, inScale);
+	BatchVisitor batch_visitor;
+	CollideSoftBodyVerticesVsTrianglesBatch::sCollide(visitor, batch_visitor, inVertices, inNumVertices, inCollidingShapeIndex, [this](auto &ioVisitor) { WalkHeightField(ioVisitor); });
 }
 
 void HeightFieldShape::sCastConvexVsHeightField(const ShapeCast &inShapeCast, const ShapeCastSettings &inShapeCastSettings, const Shape *inShape, Vec3Arg inScale, [[maybe_unused]] const ShapeFilter &inShapeFilter, Mat44Arg inCenterOfMassTransform2, const SubShapeIDCreator &inSubShapeIDCreator1, const SubShapeIDCreator &inSubShapeIDCreator2, CastShapeCollector &ioCollector)
@@ -828,15 +828,34 @@ void MeshShape::CollideSoftBodyVertices(Mat44Arg inCenterOfMassTransform, Vec3Ar
 		float			mDistanceStack[NodeCodec::StackSize];
 	};
 
-	Visitor visitor(inCenterOfMassTransform, inScale);
+	struct BatchVisitor : public CollideSoftBodyVerticesVsTrianglesBatch
+	{
+		JPH_INLINE bool	ShouldAbort() const
+		{
+			return ShouldAbortBatch();
+		}
+
+		JPH_INLINE bool	ShouldVisitNode([[maybe_unused]] int inStackTop) const
+		{
+			return true;
+		}
 
-	for (CollideSoftBodyVertexIterator v = inVertices, sbv_end = inVertices + inNumVertices; v != sbv_end; ++v)
-		if (v.GetInvMass() > 0.0f)
+		JPH_INLINE int	VisitNodes(Vec4Arg inBoundsMinX, Vec4Arg inBoundsMinY, Vec4Arg inBoundsMinZ, Vec4Arg inBoundsMaxX, Vec4Arg inBoundsMaxY, Vec4Arg inBoundsMaxZ, UVec4 &ioProperties, [[maybe_unused]] int inStackTop)
 		{
-			visitor.StartVertex(v);
-			WalkTreePerTriangle(SubShapeIDCreator(), visitor);
-			visitor.FinishVertex(v, inCollidingShapeIndex);
+			// Visit all nodes that overlap with the query bounds
+			UVec4 collides = AABox4VsBox(mQueryBounds, inBoundsMinX, inBoundsMinY, inBoundsMinZ, inBoundsMaxX, inBoundsMaxY, inBoundsMaxZ);
+			return CountAndSortTrues(collides, ioProperties);
 		}
+
+		JPH_INLINE void	VisitTriangle(Vec3Arg inV0, Vec3Arg inV1, Vec3Arg inV2, [[maybe_unused]] uint8 inActiveEdges, [[maybe_unused]] SubShapeID inSubShapeID2)
+		{
+			AddTriangle(inV0, inV1, inV2);
+		}
+	};
+
+	Visitor visitor(inCenterOfMassTransform, inScale);
+	BatchVisitor batch_visitor;
+	CollideSoftBodyVerticesVsTrianglesBatch::sCollide(visitor, batch_visitor, inVertices, inNumVertices, inCollidingShapeIndex, [this](auto &ioVisitor) { WalkTreePerTriangle(SubShapeIDCreator(), ioVisitor); });
 }
 
 void MeshShape::sCastConvexVsMesh(const ShapeCast &inShapeCast, const ShapeCastSettings &inShapeCastSettings, const Shape *inShape, Vec3Arg inScale, [[maybe_unused]] const ShapeFilter &inShapeFilter, Mat44Arg inCenterOfMassTransform2, const SubShapeIDCreator &inSubShapeIDCreator1, const SubShapeIDCreator &inSubShapeIDCreator2, CastShapeCollector &ioCollector)
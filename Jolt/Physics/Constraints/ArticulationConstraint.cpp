@@ -0,0 +1,354 @@
+// Jolt Physics Library (https://github.com/jrouwe/JoltPhysics)
+// SPDX-FileCopyrightText: 2024 Jorrit Rouwe
+// SPDX-License-Identifier: MIT
+
+#include <Jolt/Jolt.h>
+
+#include <Jolt/Physics/Constraints/ArticulationConstraint.h>
+#include <Jolt/Physics/Body/Body.h>
+#include <Jolt/Physics/Body/BodyManager.h>
+#include <Jolt/Physics/IslandBuilder.h>
+#include <Jolt/Physics/LargeIslandSplitter.h>
+#include <Jolt/Core/Profiler.h>
+
+JPH_NAMESPACE_BEGIN
+
+ArticulationConstraint::ArticulationConstraint(Body *const *inBodies, const int *inParentIndices, const TwoBodyConstraint *const *inJoints, uint inNumBodies) :
+	Constraint(ConstraintSettings())
+{
+	mLinks.resize(inNumBodies);
+	for (uint i = 0; i < inNumBodies; ++i)
+	{
+		Link &link = mLinks[i];
+		link.mBody = inBodies[i];
+		link.mParent = inParentIndices[i];
+		link.mLocalPivotInParent = Vec3::sZero();
+		link.mLocalPivot = Vec3::sZero();
+
+		// A body that is not attached through a supported joint starts a new tree
+		const TwoBodyConstraint *joint = inJoints[i];
+		if (link.mParent < 0 || joint == nullptr || !sIsSupported(joint))
+		{
+			link.mParent = -1;
+			continue;
+		}
+
+		JPH_ASSERT(link.mParent < int(i), "Parent must come before its children");
+		JPH_ASSERT(joint->GetBody1() == inBodies[link.mParent] && joint->GetBody2() == inBodies[i]);
+		JPH_ASSERT(!inBodies[link.mParent]->IsDynamic() || inBodies[i]->IsDynamic(), "A non dynamic body cannot be the child of a dynamic body");
+		link.mLocalPivotInParent = joint->GetConstraintToBody1Matrix().GetTranslation();
+		link.mLocalPivot = joint->GetConstraintToBody2Matrix().GetTranslation();
+	}
+}
+
+bool ArticulationConstraint::sIsSupported(const TwoBodyConstraint *inJoint)
+{
+	switch (inJoint->GetSubType())
+	{
+	case EConstraintSubType::Fixed:
+	case EConstraintSubType::Point:
+	case EConstraintSubType::Hinge:
+	case EConstraintSubType::Cone:
+	case EConstraintSubType::SwingTwist:
+		return true;
+
+	default:
+		return false;
+	}
+}
+
+void ArticulationConstraint::NotifyShapeChanged(const BodyID &inBodyID, Vec3Arg inDeltaCOM)
+{
+	for (Link &link : mLinks)
+	{
+		if (link.mBody->GetID() == inBodyID)
+			link.mLocalPivot -= inDeltaCOM;
+		if (link.mParent >= 0 && mLinks[link.mParent].mBody->GetID() == inBodyID)
+			link.mLocalPivotInParent -= inDeltaCOM;
+	}
+}
+
+bool ArticulationConstraint::IsActive() const
+{
+	if (!Constraint::IsActive())
+		return false;
+
+	// We're active when any of the dynamic bodies is active
+	for (const Link &link : mLinks)
+		if (link.mBody->IsActive() && link.mBody->IsDynamic())
+			return true;
+	return false;
+}
+
+bool ArticulationConstraint::CalculateLinkProperties()
+{
+	for (Link &link : mLinks)
+	{
+		const Body *body = link.mBody;
+		Mat44 rotation = Mat44::sRotation(body->GetRotation());
+
+		// Get mass properties, the inertia needs to be invertible so we can't handle bodies with locked degrees of freedom
+		link.mIsDynamic = body->IsDynamic();
+		if (link.mIsDynamic)
+		{
+			const MotionProperties *mp = body->GetMotionProperties();
+			if (mp->GetAllowedDOFs() != EAllowedDOFs::All
+				|| mp->GetInverseMass() <= 0.0f
+				|| !link.mInertia.SetInversed3x3(mp->GetInverseInertiaForRotation(rotation)))
+				return false;
+			link.mMass = Mat44::sScale(1.0f / mp->GetInverseMass());
+		}
+
+		// Calculate the world space attachment points
+		if (link.mParent >= 0)
+		{
+			// A non dynamic child would constrain its dynamic parent like a body with infinite mass, this closes a loop in the tree which we can't solve
+			const Body *parent = mLinks[link.mParent].mBody;
+			if (!link.mIsDynamic && parent->IsDynamic())
+				return false;
+
+			Vec3 parent_com_to_pivot = parent->GetRotation() * link.mLocalPivotInParent;
+			link.mPivotToCOM = -(rotation.Multiply3x3(link.mLocalPivot));
+			link.mParentCOMToCOM = parent_com_to_pivot + link.mPivotToCOM;
+			link.mSeparation = Vec3(body->GetCenterOfMassPosition() - parent->GetCenterOfMassPosition()) - link.mParentCOMToCOM;
+		}
+	}
+
+	return true;
+}
+
+bool ArticulationConstraint::SolveTree(bool inPositionPass, float inBaumgarte)
+{
+	// Initialize the articulated inertia of each body with its own inertia
+	for (Link &link : mLinks)
+		if (link.mIsDynamic)
+		{
+			link.mA.mLL = link.mMass;
+			link.mA.mLA = Mat44::sZero();
+			link.mA.mAA = link.mInertia;
+			if (inPositionPass)
+			{
+				// We're solving for the smallest position change
+				link.mZLinear = Vec3::sZero();
+				link.mZAngular = Vec3::sZero();
+			}
+			else
+			{
+				// We're solving for the velocity closest to the current velocity
+				const MotionProperties *mp = link.mBody->GetMotionProperties();
+				link.mZLinear = link.mMass.Multiply3x3(mp->GetLinearVelocity());
+				link.mZAngular = link.mInertia.Multiply3x3(mp->GetAngularVelocity());
+			}
+		}
+
+	// Eliminate the bodies from the leaves to the root, since parents come before their children all children have been processed when we get to a body
+	for (Link *link = mLinks.data() + mLinks.size() - 1; link >= mLinks.data(); --link)
+		if (link->mIsDynamic && link->mParent >= 0) // CalculateLinkProperties ensures that all children of dynamic bodies are dynamic
+		{
+			const SpatialInertia &a = link->mA;
+
+			// S maps the relative angular velocity of the joint to a spatial velocity: S = [-[r]x; E] where r is the vector from attachment point to center of mass
+			Mat44 r = Mat44::sCrossProduct(link->mPivotToCOM);
+			link->mASLinear = a.mLA - a.mLL.Multiply3x3(r);
+			link->mASAngular = a.mAA - a.mLA.Transposed3x3().Multiply3x3(r);
+			if (!link->mK.SetInversed3x3(r.Multiply3x3(link->mASLinear) + link->mASAngular))
+				return false;
+
+			// Non dynamic parents have a known velocity, no need to propagate to them
+			Link &parent = mLinks[link->mParent];
+			if (!parent.mIsDynamic)
+				continue;
+
+			// Articulated inertia that the subtree exerts on the parent: A' = A - A S K S^T A
+			Mat44 k_as_lin_t = link->mK.Multiply3x3RightTransposed(link->mASLinear);
+			Mat44 k_as_ang_t = link->mK.Multiply3x3RightTransposed(link->mASAngular);
+			Mat44 ll = a.mLL - link->mASLinear.Multiply3x3(k_as_lin_t);
+			Mat44 la = a.mLA - link->mASLinear.Multiply3x3(k_as_ang_t);
+			Mat44 aa = a.mAA - link->mASAngular.Multiply3x3(k_as_ang_t);
+
+			// Articulated momentum: z' = z - A S K S^T z
+			Vec3 k_s_t_z = link->mK.Multiply3x3(r.Multiply3x3(link->mZLinear) + link->mZAngular);
+			Vec3 z_lin = link->mZLinear - link->mASLinear.Multiply3x3(k_s_t_z);
+			Vec3 z_ang = link->mZAngular - link->mASAngular.Multiply3x3(k_s_t_z);
+
+			// When solving positions, the attachment point of the child needs to move by d relative to the attachment point of the parent
+			if (inPositionPass)
+			{
+				Vec3 d = -inBaumgarte * link->mSeparation;
+				z_lin -= ll.Multiply3x3(d);
+				z_ang -= la.Multiply3x3Transposed(d);
+			}
+
+			// Transform to the center of mass of the parent: X = [E, -[p]x; 0, E] where p is the vector from parent to child center of mass, accumulate X^T A' X and X^T z'
+			Mat44 p = Mat44::sCrossProduct(link->mParentCOMToCOM);
+			parent.mA.mLL += ll;
+			parent.mA.mLA += la - ll.Multiply3x3(p);
+			parent.mA.mAA += aa - la.Multiply3x3LeftTransposed(p) + p.Multiply3x3(la) - p.Multiply3x3(ll.Multiply3x3(p));
+			parent.mZLinear += z_lin;
+			parent.mZAngular += p.Multiply3x3(z_lin) + z_ang;
+		}
+
+	// Solve the velocities from the root to the leaves
+	for (Link &link : mLinks)
+	{
+		if (!link.mIsDynamic)
+		{
+			// Velocity is known
+			if (inPositionPass)
+			{
+				link.mLinearVelocity = Vec3::sZero();
+				link.mAngularVelocity = Vec3::sZero();
+			}
+			else
+			{
+				link.mLinearVelocity = link.mBody->GetLinearVelocity();
+				link.mAngularVelocity = link.mBody->GetAngularVelocity();
+			}
+		}
+		else if (link.mParent < 0)
+		{
+			// Root: solve A u = z using the Schur complement of the linear block
+			const SpatialInertia &a = link.mA;
+			Mat44 ll_inv, schur_inv;
+			if (!ll_inv.SetInversed3x3(a.mLL))
+				return false;
+			Mat44 la_t_ll_inv = a.mLA.Transposed3x3().Multiply3x3(ll_inv);
+			if (!schur_inv.SetInversed3x3(a.mAA - la_t_ll_inv.Multiply3x3(a.mLA)))
+				return false;
+			link.mAngularVelocity = schur_inv.Multiply3x3(link.mZAngular - la_t_ll_inv.Multiply3x3(link.mZLinear));
+			link.mLinearVelocity = ll_inv.Multiply3x3(link.mZLinear - a.mLA.Multiply3x3(link.mAngularVelocity));
+		}
+		else
+		{
+			// Velocity of the child when the joint doesn't rotate: y = X u_parent + d
+			const Link &parent = mLinks[link.mParent];
+			Vec3 y_lin = parent.mLinearVelocity + parent.mAngularVelocity.Cross(link.mParentCOMToCOM);
+			if (inPositionPass)
+				y_lin -= inBaumgarte * link.mSeparation;
+			Vec3 y_ang = parent.mAngularVelocity;
+
+			// Relative angular velocity of the joint: w = K S^T (z - A y)
+			const SpatialInertia &a = link.mA;
+			Vec3 res_lin = link.mZLinear - a.mLL.Multiply3x3(y_lin) - a.mLA.Multiply3x3(y_ang);
+			Vec3 res_ang = link.mZAngular - a.mLA.Multiply3x3Transposed(y_lin) - a.mAA.Multiply3x3(y_ang);
+			Vec3 w = link.mK.Multiply3x3(link.mPivotToCOM.Cross(res_lin) + res_ang);
+
+			// u = y + S w
+			link.mLinearVelocity = y_lin + w.Cross(link.mPivotToCOM);
+			link.mAngularVelocity = y_ang + w;
+		}
+	}
+
+	return true;
+}
+
+void ArticulationConstraint::SetupVelocityConstraint(float inDeltaTime)
+{
+	mIsValid = CalculateLinkProperties();
+}
+
+bool ArticulationConstraint::SolveVelocityConstraint(float inDeltaTime)
+{
+	JPH_PROFILE_FUNCTION();
+
+	if (!mIsValid || !SolveTree(false, 0.0f))
+		return false;
+
+	// Apply the velocity changes
+	bool applied = false;
+	for (const Link &link : mLinks)
+		if (link.mIsDynamic)
+		{
+			MotionProperties *mp = link.mBody->GetMotionProperties();
+			Vec3 delta_linear = link.mLinearVelocity - mp->GetLinearVelocity();
+			Vec3 delta_angular = link.mAngularVelocity - mp->GetAngularVelocity();
+			if (!delta_linear.IsNearZero() || !delta_angular.IsNearZero())
+			{
+				mp->AddLinearVelocityStep(delta_linear);
+				mp->AddAngularVelocityStep(delta_angular);
+				applied = true;
+			}
+		}
+	return applied;
+}
+
+bool ArticulationConstraint::SolvePositionConstraint(float inDeltaTime, float inBaumgarte)
+{
+	JPH_PROFILE_FUNCTION();
+
+	// Bodies have moved, recalculate the world space properties
+	if (!mIsValid || !CalculateLinkProperties())
+		return false;
+
+	// Check if there's anything to correct
+	bool has_separation = false;
+	for (const Link &link : mLinks)
+		if (link.mParent >= 0 && !link.mSeparation.IsNearZero())
+		{
+			has_separation = true;
+			break;
+		}
+	if (!has_separation || !SolveTree(true, inBaumgarte))
+		return false;
+
+	// Apply the position changes
+	for (const Link &link : mLinks)
+		if (link.mIsDynamic)
+		{
+			link.mBody->AddPositionStep(link.mLinearVelocity);
+			link.mBody->AddRotationStep(link.mAngularVelocity);
+		}
+	return true;
+}
+
+void ArticulationConstraint::BuildIslands(uint32 inConstraintIndex, IslandBuilder &ioBuilder, BodyManager &inBodyManager)
+{
+	// Activate bodies
+	BodyID *body_ids = (BodyID *)JPH_STACK_ALLOC(mLinks.size() * sizeof(BodyID));
+	int num_bodies = 0;
+	for (const Link &link : mLinks)
+		if (link.mBody->IsDynamic() && !link.mBody->IsActive())
+			body_ids[num_bodies++] = link.mBody->GetID();
+	if (num_bodies > 0)
+		inBodyManager.ActivateBodies(body_ids, num_bodies);
+
+	// Find the first active body
+	uint32 min_active_index = Body::cInactiveIndex;
+	for (const Link &link : mLinks)
+		min_active_index = min(min_active_index, link.mBody->GetIndexInActiveBodiesInternal());
+
+	// Link all bodies into the same island
+	for (const Link &link : mLinks)
+		ioBuilder.LinkBodies(min_active_index, link.mBody->GetIndexInActiveBodiesInternal());
+	ioBuilder.LinkConstraint(inConstraintIndex, min_active_index, min_active_index);
+}
+
+uint ArticulationConstraint::BuildIslandSplits(LargeIslandSplitter &ioSplitter) const
+{
+	// The tree is solved as a whole, so none of the bodies can be solved in parallel
+	for (const Link &link : mLinks)
+		ioSplitter.AssignToNonParallelSplit(link.mBody);
+	return LargeIslandSplitter::cNonParallelSplitIdx;
+}
+
+float ArticulationConstraint::GetMaxJointSeparation() const
+{
+	float max_separation_sq = 0.0f;
+	for (const Link &link : mLinks)
+		if (link.mParent >= 0)
+		{
+			const Body *parent = mLinks[link.mParent].mBody;
+			RVec3 pivot1 = parent->GetCenterOfMassTransform() * link.mLocalPivotInParent;
+			RVec3 pivot2 = link.mBody->GetCenterOfMassTransform() * link.mLocalPivot;
+			max_separation_sq = max(max_separation_sq, Vec3(pivot2 - pivot1).LengthSq());
+		}
+	return sqrt(max_separation_sq);
+}
+
+Ref<ConstraintSettings> ArticulationConstraint::GetConstraintSettings() const
+{
+	JPH_ASSERT(false); // Not implemented yet
+	return nullptr;
+}
+
+JPH_NAMESPACE_END
@@ -0,0 +1,111 @@
+// Jolt Physics Library (https://github.com/jrouwe/JoltPhysics)
+// SPDX-FileCopyrightText: 2024 Jorrit Rouwe
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <Jolt/Physics/Constraints/TwoBodyConstraint.h>
+
+JPH_NAMESPACE_BEGIN
+
+/// A constraint that solves the attachment points of a tree of bodies exactly.
+///
+/// The bodies are connected through their regular constraints (e.g. SwingTwistConstraint), these still take care of the limits and motors.
+/// On top of that, every solver iteration this constraint projects the velocities (and positions) of the tree so that all attachment
+/// points of the joints coincide. The projection is the mass weighted smallest change that satisfies all joints and is calculated in O(N)
+/// by eliminating the bodies from the leaves towards the root, similar to Featherstone's articulated body algorithm.
+/// This means that long chains of bodies no longer stretch when using only a few solver iterations.
+///
+/// Only joints that keep the attachment points of both bodies together are taken into account (fixed, point, hinge, cone and swing twist constraints),
+/// a body that is attached through another type of constraint starts a new tree. Dynamic bodies must have all degrees of freedom allowed
+/// (see EAllowedDOFs) and all children of a dynamic body must be dynamic too (e.g. a kinematic hand of a dynamic arm),
+/// if this is not the case the constraint does nothing and the bodies are only held together by their regular constraints.
+class JPH_EXPORT ArticulationConstraint final : public Constraint
+{
+public:
+	JPH_OVERRIDE_NEW_DELETE
+
+	/// Constructor
+	/// @param inBodies The bodies in the tree
+	/// @param inParentIndices For each body the index of its parent body (must be less than the index of the body itself) or -1 if the body is a root
+	/// @param inJoints For each body the constraint that connects it to its parent (body 1 must be the parent, body 2 the body itself) or null if the body is a root
+	/// @param inNumBodies Number of bodies in the tree
+								ArticulationConstraint(Body *const *inBodies, const int *inParentIndices, const TwoBodyConstraint *const *inJoints, uint inNumBodies);
+
+	/// Returns if a constraint of this type can be used to connect two bodies in the tree
+	static bool					sIsSupported(const TwoBodyConstraint *inJoint);
+
+	// See: Constraint
+	virtual EConstraintSubType	GetSubType() const override					{ return EConstraintSubType::Articulation; }
+	virtual void				NotifyShapeChanged(const BodyID &inBodyID, Vec3Arg inDeltaCOM) override;
+	virtual bool				IsActive() const override;
+	virtual void				SetupVelocityConstraint(float inDeltaTime) override;
+	virtual void				ResetWarmStart() override					{ /* Do nothing */ }
+	virtual void				WarmStartVelocityConstraint(float inWarmStartImpulseRatio) override { /* Do nothing */ }
+	virtual bool				SolveVelocityConstraint(float inDeltaTime) override;
+	virtual bool				SolvePositionConstraint(float inDeltaTime, float inBaumgarte) override;
+	virtual void				BuildIslands(uint32 inConstraintIndex, IslandBuilder &ioBuilder, BodyManager &inBodyManager) override;
+	virtual uint				BuildIslandSplits(LargeIslandSplitter &ioSplitter) const override;
+#ifdef JPH_DEBUG_RENDERER
+	virtual void				DrawConstraint(DebugRenderer *inRenderer) const override { /* Do nothing, the joints draw themselves */ }
+#endif // JPH_DEBUG_RENDERER
+	virtual Ref<ConstraintSettings> GetConstraintSettings() const override;
+
+	/// Get the number of bodies in the tree
+	uint						GetNumBodies() const						{ return uint(mLinks.size()); }
+
+	/// Get the largest distance between the attachment points of the joints in the tree (in m), can be used to measure how well the joints are solved
+	float						GetMaxJointSeparation() const;
+
+private:
+	/// A 6x6 symmetric matrix [[LL, LA], [LA^T, AA]] that maps a (linear, angular) velocity to a (linear, angular) momentum, only the 3x3 part of each of the blocks is used
+	struct SpatialInertia
+	{
+		Mat44					mLL;
+		Mat44					mLA;
+		Mat44					mAA;
+	};
+
+	/// A body in the tree
+	struct Link
+	{
+		Body *					mBody;										///< The body
+		int						mParent;									///< Index of the parent link or -1 if this is a root
+		Vec3					mLocalPivotInParent;						///< Attachment point relative to the center of mass of the parent in the local space of the parent
+		Vec3					mLocalPivot;								///< Attachment point relative to the center of mass of this body in the local space of this body
+
+		// Calculated by CalculateLinkProperties
+		bool					mIsDynamic;									///< If the body is dynamic, non dynamic bodies have a known velocity
+		Vec3					mPivotToCOM;								///< Vector from attachment point to the center of mass of this body
+		Vec3					mParentCOMToCOM;							///< Vector from the center of mass of the parent to the center of mass of this body when the attachment points coincide
+		Vec3					mSeparation;								///< World space vector from the attachment point on the parent to the attachment point on this body
+		Mat44					mMass;										///< Mass as a 3x3 diagonal matrix
+		Mat44					mInertia;									///< World space inertia tensor
+
+		// Calculated by SolveTree
+		SpatialInertia			mA;											///< Articulated inertia of the subtree starting at this body
+		Vec3					mZLinear;									///< Articulated momentum of the subtree starting at this body (linear part)
+		Vec3					mZAngular;									///< Articulated momentum of the subtree starting at this body (angular part)
+		Mat44					mASLinear;									///< mA * S where S maps a relative angular velocity of the joint to a spatial velocity (linear part)
+		Mat44					mASAngular;									///< mA * S (angular part)
+		Mat44					mK;											///< (S^T * mA * S)^-1
+		Vec3					mLinearVelocity;							///< Solved linear velocity (or position change)
+		Vec3					mAngularVelocity;							///< Solved angular velocity (or rotation change)
+	};
+
+	/// Calculate the world space properties of all links, returns false if the tree cannot be solved
+	bool						CalculateLinkProperties();
+
+	/// Solve the tree. When inPositionPass is false it will find the velocities closest to the current velocities that satisfy the joints,
+	/// when it is true it will find the smallest position / rotation change that reduces the separation of the joints by inBaumgarte.
+	/// Returns false if the tree could not be solved.
+	bool						SolveTree(bool inPositionPass, float inBaumgarte);
+
+	/// The bodies in the tree, a parent always comes before its children
+	Array<Link>					mLinks;
+
+	/// If the tree can be solved this step
+	bool						mIsValid = false;
+};
+
+JPH_NAMESPACE_END
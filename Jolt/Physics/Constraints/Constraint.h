@@ -50,7 +50,10 @@ enum class EConstraintSubType
 	User1,
 	User2,
 	User3,
-	User4
+	User4,
+
+	/// Added after the user types so that their values don't change
+	Articulation,
 };
 
 /// Certain constraints support setting them up in local or world space. This governs what is used.
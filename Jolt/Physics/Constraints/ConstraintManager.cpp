@@ -8,6 +8,7 @@
 #include <Jolt/Physics/Constraints/CalculateSolverSteps.h>
 #include <Jolt/Physics/IslandBuilder.h>
 #include <Jolt/Physics/StateRecorder.h>
+#include <Jolt/Physics/StateRecorderDelta.h>
 #include <Jolt/Physics/PhysicsLock.h>
 #include <Jolt/Core/Profiler.h>
 #include <Jolt/Core/QuickSort.h>
@@ -286,4 +287,56 @@ bool ConstraintManager::RestoreState(StateRecorder &inStream)
 	return true;
 }
 
+void ConstraintManager::SaveStateReference(DeltaStateReference &ioReference) const
+{
+	UniqueLock lock(mConstraintsMutex JPH_IF_ENABLE_ASSERTS(, mLockContext, EPhysicsLockTypes::ConstraintsList));
+
+	ioReference.mConstraints.clear();
+	ioReference.mConstraintData.Clear();
+
+	// Write the state of all constraints in the format of SaveState and remember where the state of each constraint is stored
+	StateRecorderBuffer &data = ioReference.mConstraintData;
+	data.Write((uint32)mConstraints.size());
+	for (const Ref<Constraint> &c : mConstraints)
+	{
+		data.Write(c->mConstraintIndex);
+		uint32 offset = uint32(data.GetDataSize());
+		c->SaveState(data);
+		ioReference.mConstraints.push_back({ offset, uint32(data.GetDataSize()) - offset });
+	}
+}
+
+void ConstraintManager::SaveStateDelta(StateRecorder &inStream, const DeltaStateReference &inReference) const
+{
+	UniqueLock lock(mConstraintsMutex JPH_IF_ENABLE_ASSERTS(, mLockContext, EPhysicsLockTypes::ConstraintsList));
+
+	// Buffers that are reused between calls so that we don't allocate
+	StateRecorderBuffer &constraint_data = inReference.mScratch;
+	StateRecorderBuffer &changed_data = inReference.mChangedData;
+	changed_data.Clear();
+
+	// Collect the constraints that are new or whose state differs from the reference
+	uint32 num_changed = 0;
+	for (const Ref<Constraint> &c : mConstraints)
+	{
+		constraint_data.Clear();
+		c->SaveState(constraint_data);
+		if (c->mConstraintIndex < inReference.mConstraints.size())
+		{
+			const DeltaStateReference::ConstraintState &reference = inReference.mConstraints[c->mConstraintIndex];
+			if (reference.mSize == constraint_data.GetDataSize()
+				&& memcmp(constraint_data.GetData(), inReference.mConstraintData.GetData() + reference.mOffset, reference.mSize) == 0)
+				continue;
+		}
+
+		changed_data.Write(c->mConstraintIndex);
+		changed_data.WriteBytes(constraint_data.GetData(), constraint_data.GetDataSize());
+		++num_changed;
+	}
+
+	// Write them in the format of SaveState
+	inStream.Write(num_changed);
+	inStream.WriteBytes(changed_data.GetData(), changed_data.GetDataSize());
+}
+
 JPH_NAMESPACE_END
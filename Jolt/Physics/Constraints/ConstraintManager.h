@@ -13,6 +13,7 @@ JPH_NAMESPACE_BEGIN
 class IslandBuilder;
 class BodyManager;
 class StateRecorderFilter;
+class DeltaStateReference;
 #ifdef JPH_DEBUG_RENDERER
 class DebugRenderer;
 #endif // JPH_DEBUG_RENDERER
@@ -82,6 +83,13 @@ public:
 	/// Restore the state of constraints. Returns false if failed.
 	bool					RestoreState(StateRecorder &inStream);
 
+	/// Save the state of all constraints in ioReference so that SaveStateDelta can determine which constraints changed
+	void					SaveStateReference(DeltaStateReference &ioReference) const;
+
+	/// Save the state of the constraints that changed with respect to inReference.
+	/// Restore by calling RestoreState with the constraints of the reference followed by RestoreState with the delta.
+	void					SaveStateDelta(StateRecorder &inStream, const DeltaStateReference &inReference) const;
+
 	/// Lock all constraints. This should only be done during PhysicsSystem::Update().
 	void					LockAllConstraints()						{ PhysicsLock::sLock(mConstraintsMutex JPH_IF_ENABLE_ASSERTS(, mLockContext, EPhysicsLockTypes::ConstraintsList)); }
 	void					UnlockAllConstraints()						{ PhysicsLock::sUnlock(mConstraintsMutex JPH_IF_ENABLE_ASSERTS(, mLockContext, EPhysicsLockTypes::ConstraintsList)); }
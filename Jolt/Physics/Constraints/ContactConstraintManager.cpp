@@ -11,6 +11,9 @@
 #include <Jolt/Physics/PhysicsSettings.h>
 #include <Jolt/Physics/IslandBuilder.h>
 #include <Jolt/Physics/DeterminismLog.h>
+#include <Jolt/Physics/StateRecorderBuffer.h>
+#include <Jolt/Physics/StateRecorderDelta.h>
+#include <Jolt/Physics/StateRecorderJobs.h>
 #include <Jolt/Core/TempAllocator.h>
 #include <Jolt/Core/QuickSort.h>
 #ifdef JPH_DEBUG_RENDERER
@@ -387,7 +390,44 @@ void ContactConstraintManager::ManifoldCache::Finalize()
 
 #endif
 
-void ContactConstraintManager::ManifoldCache::SaveState(StateRecorder &inStream, const StateRecorderFilter *inFilter) const
+void ContactConstraintManager::ManifoldCache::SaveBodyPair(StateRecorder &inStream, const BPKeyValue *inBodyPair) const
+{
+	// Write body pair key
+	inStream.Write(inBodyPair->GetKey());
+
+	// Write body pair
+	const CachedBodyPair &bp = inBodyPair->GetValue();
+	bp.SaveState(inStream);
+
+	// Get attached manifolds
+	Array<const MKeyValue *> all_m;
+	GetAllManifoldsSorted(bp, all_m);
+
+	// Write num manifolds
+	uint32 num_manifolds = uint32(all_m.size());
+	inStream.Write(num_manifolds);
+
+	// Write all manifolds
+	for (const MKeyValue *m_kv : all_m)
+	{
+		// Write key
+		inStream.Write(m_kv->GetKey());
+		const CachedManifold &cm = m_kv->GetValue();
+		JPH_ASSERT((cm.mFlags & (uint16)CachedManifold::EFlags::CCDContact) == 0);
+
+		// Write amount of contacts
+		inStream.Write(cm.mNumContactPoints);
+
+		// Write manifold
+		cm.SaveState(inStream);
+
+		// Write contact points
+		for (uint32 i = 0; i < cm.mNumContactPoints; ++i)
+			cm.mContactPoints[i].SaveState(inStream);
+	}
+}
+
+void ContactConstraintManager::ManifoldCache::SaveState(StateRecorder &inStream, const StateRecorderFilter *inFilter, JobSystem *inJobSystem) const
 {
 	JPH_ASSERT(mIsFinalized);
 
@@ -410,43 +450,35 @@ void ContactConstraintManager::ManifoldCache::SaveState(StateRecorder &inStream,
 	// Write body pairs
 	uint32 num_body_pairs = uint32(selected_bp.size());
 	inStream.Write(num_body_pairs);
-	for (const BPKeyValue *bp_kv : selected_bp)
+	if (inJobSystem != nullptr && num_body_pairs > StateRecorderJobs::cBatchSize)
 	{
-		// Write body pair key
-		inStream.Write(bp_kv->GetKey());
-
-		// Write body pair
-		const CachedBodyPair &bp = bp_kv->GetValue();
-		bp.SaveState(inStream);
-
-		// Get attached manifolds
-		Array<const MKeyValue *> all_m;
-		GetAllManifoldsSorted(bp, all_m);
-
-		// Write num manifolds
-		uint32 num_manifolds = uint32(all_m.size());
-		inStream.Write(num_manifolds);
-
-		// Write all manifolds
-		for (const MKeyValue *m_kv : all_m)
+		// Save batches of body pairs in parallel and then concatenate them, the batch buffers keep their memory between saves
+		lock_guard lock(mSaveStateBatchesMutex);
+		uint num_batches = StateRecorderJobs::sGetNumBatches(num_body_pairs);
+		if (mSaveStateBatches.size() < num_batches)
+			mSaveStateBatches.resize(num_batches);
+		JobBatches::sRun(num_body_pairs, StateRecorderJobs::cBatchSize, "SaveContactState", *inJobSystem, [this, &selected_bp](uint inBatch, uint inBegin, uint inEnd)
 		{
-			// Write key
-			inStream.Write(m_kv->GetKey());
-			const CachedManifold &cm = m_kv->GetValue();
-			JPH_ASSERT((cm.mFlags & (uint16)CachedManifold::EFlags::CCDContact) == 0);
-
-			// Write amount of contacts
-			inStream.Write(cm.mNumContactPoints);
-
-			// Write manifold
-			cm.SaveState(inStream);
-
-			// Write contact points
-			for (uint32 i = 0; i < cm.mNumContactPoints; ++i)
-				cm.mContactPoints[i].SaveState(inStream);
-		}
+			StateRecorderBuffer &batch = mSaveStateBatches[inBatch];
+			batch.Clear();
+			for (uint i = inBegin; i < inEnd; ++i)
+				SaveBodyPair(batch, selected_bp[i]);
+		});
+		for (uint b = 0; b < num_batches; ++b)
+			inStream.WriteBytes(mSaveStateBatches[b].GetData(), mSaveStateBatches[b].GetDataSize());
 	}
+	else
+	{
+		for (const BPKeyValue *bp_kv : selected_bp)
+			SaveBodyPair(inStream, bp_kv);
+	}
+
+	// Write CCD manifolds
+	SaveCCDManifolds(inStream, inFilter);
+}
 
+void ContactConstraintManager::ManifoldCache::SaveCCDManifolds(StateRecorder &inStream, const StateRecorderFilter *inFilter) const
+{
 	// Get CCD manifolds
 	Array<const MKeyValue *> all_m;
 	GetAllCCDManifoldsSorted(all_m);
@@ -492,104 +524,23 @@ bool ContactConstraintManager::ManifoldCache::RestoreState(const ManifoldCache &
 
 	// Read entire cache
 	for (uint32 i = 0; i < num_body_pairs; ++i)
-	{
-		// Read key
-		BodyPair body_pair_key;
-		if (inStream.IsValidating() && i < all_bp.size())
-			body_pair_key = all_bp[i]->GetKey();
-		inStream.Read(body_pair_key);
-
-		// Check if we want to restore this contact
-		if (inFilter == nullptr || inFilter->ShouldRestoreContact(body_pair_key.mBodyA, body_pair_key.mBodyB))
+		if (!RestoreBodyPair(contact_allocator, inStream, inFilter, inReadCache, inStream.IsValidating() && i < all_bp.size()? all_bp[i] : nullptr))
 		{
-			// Create new entry for this body pair
-			uint64 body_pair_hash = body_pair_key.GetHash();
-			BPKeyValue *bp_kv = Create(contact_allocator, body_pair_key, body_pair_hash);
-			if (bp_kv == nullptr)
-			{
-				// Out of cache space
-				success = false;
-				break;
-			}
-			CachedBodyPair &bp = bp_kv->GetValue();
-
-			// Read body pair
-			if (inStream.IsValidating() && i < all_bp.size())
-				memcpy(&bp, &all_bp[i]->GetValue(), sizeof(CachedBodyPair));
-			bp.RestoreState(inStream);
-
-			// When validating, get all existing manifolds
-			Array<const MKeyValue *> all_m;
-			if (inStream.IsValidating())
-				inReadCache.GetAllManifoldsSorted(all_bp[i]->GetValue(), all_m);
-
-			// Read amount of manifolds
-			uint32 num_manifolds = 0;
-			if (inStream.IsValidating())
-				num_manifolds = uint32(all_m.size());
-			inStream.Read(num_manifolds);
-
-			uint32 handle = ManifoldMap::cInvalidHandle;
-			for (uint32 j = 0; j < num_manifolds; ++j)
-			{
-				// Read key
-				SubShapeIDPair sub_shape_key;
-				if (inStream.IsValidating() && j < all_m.size())
-					sub_shape_key = all_m[j]->GetKey();
-				inStream.Read(sub_shape_key);
-				uint64 sub_shape_key_hash = sub_shape_key.GetHash();
-
-				// Read amount of contact points
-				uint16 num_contact_points = 0;
-				if (inStream.IsValidating() && j < all_m.size())
-					num_contact_points = all_m[j]->GetValue().mNumContactPoints;
-				inStream.Read(num_contact_points);
-
-				// Read manifold
-				MKeyValue *m_kv = Create(contact_allocator, sub_shape_key, sub_shape_key_hash, num_contact_points);
-				if (m_kv == nullptr)
-				{
-					// Out of cache space
-					success = false;
-					break;
-				}
-				CachedManifold &cm = m_kv->GetValue();
-				if (inStream.IsValidating() && j < all_m.size())
-				{
-					memcpy(&cm, &all_m[j]->GetValue(), CachedManifold::sGetRequiredTotalSize(num_contact_points));
-					cm.mNumContactPoints = uint16(num_contact_points); // Restore num contact points
-				}
-				cm.RestoreState(inStream);
-				cm.mNextWithSameBodyPair = handle;
-				handle = ToHandle(m_kv);
-
-				// Read contact points
-				for (uint32 k = 0; k < num_contact_points; ++k)
-					cm.mContactPoints[k].RestoreState(inStream);
-			}
-			bp.mFirstCachedManifold = handle;
-		}
-		else
-		{
-			// Skip the contact
-			CachedBodyPair bp;
-			bp.RestoreState(inStream);
-			uint32 num_manifolds = 0;
-			inStream.Read(num_manifolds);
-			for (uint32 j = 0; j < num_manifolds; ++j)
-			{
-				SubShapeIDPair sub_shape_key;
-				inStream.Read(sub_shape_key);
-				uint16 num_contact_points;
-				inStream.Read(num_contact_points);
-				CachedManifold cm;
-				cm.RestoreState(inStream);
-				for (uint32 k = 0; k < num_contact_points; ++k)
-					cm.mContactPoints[0].RestoreState(inStream);
-			}
+			success = false;
+			break;
 		}
-	}
 
+	// Read CCD manifolds
+	if (!RestoreCCDManifolds(inReadCache, contact_allocator, inStream, inFilter))
+		success = false;
+
+	FinalizeRestore(inStream);
+
+	return success;
+}
+
+bool ContactConstraintManager::ManifoldCache::RestoreCCDManifolds(const ManifoldCache &inReadCache, ContactAllocator &ioContactAllocator, StateRecorder &inStream, const StateRecorderFilter *inFilter)
+{
 	// When validating, get all existing CCD manifolds
 	Array<const MKeyValue *> all_m;
 	if (inStream.IsValidating())
@@ -614,23 +565,202 @@ bool ContactConstraintManager::ManifoldCache::RestoreState(const ManifoldCache &
 		{
 			// Create CCD manifold
 			uint64 sub_shape_key_hash = sub_shape_key.GetHash();
-			MKeyValue *m_kv = Create(contact_allocator, sub_shape_key, sub_shape_key_hash, 0);
+			MKeyValue *m_kv = Create(ioContactAllocator, sub_shape_key, sub_shape_key_hash, 0);
 			if (m_kv == nullptr)
 			{
 				// Out of cache space
-				success = false;
-				break;
+				return false;
 			}
 			CachedManifold &cm = m_kv->GetValue();
 			cm.mFlags |= (uint16)CachedManifold::EFlags::CCDContact;
 		}
 	}
 
+	return true;
+}
+
+void ContactConstraintManager::ManifoldCache::FinalizeRestore([[maybe_unused]] const StateRecorder &inStream)
+{
 #ifdef JPH_ENABLE_ASSERTS
 	// We don't finalize until the last part is restored
 	if (inStream.IsLastPart())
 		mIsFinalized = true;
 #endif
+}
+
+bool ContactConstraintManager::ManifoldCache::RestoreBodyPair(ContactAllocator &ioContactAllocator, StateRecorder &inStream, const StateRecorderFilter *inFilter, const ManifoldCache &inReadCache, const BPKeyValue *inReadBodyPair)
+{
+	JPH_ASSERT(inReadBodyPair == nullptr || inStream.IsValidating());
+
+	// Read key
+	BodyPair body_pair_key;
+	if (inReadBodyPair != nullptr)
+		body_pair_key = inReadBodyPair->GetKey();
+	inStream.Read(body_pair_key);
+
+	// Check if we want to restore this contact
+	bool restore = inFilter == nullptr || inFilter->ShouldRestoreContact(body_pair_key.mBodyA, body_pair_key.mBodyB);
+
+	// Read body pair
+	CachedBodyPair skipped_bp;
+	BPKeyValue *bp_kv = nullptr;
+	if (restore)
+	{
+		bp_kv = Create(ioContactAllocator, body_pair_key, body_pair_key.GetHash());
+		if (bp_kv == nullptr)
+			return false; // Out of cache space
+	}
+	CachedBodyPair &bp = bp_kv != nullptr? bp_kv->GetValue() : skipped_bp;
+	if (inReadBodyPair != nullptr)
+		memcpy(&bp, &inReadBodyPair->GetValue(), sizeof(CachedBodyPair));
+	bp.RestoreState(inStream);
+
+	// When validating, get all existing manifolds
+	Array<const MKeyValue *> all_m;
+	if (inReadBodyPair != nullptr)
+		inReadCache.GetAllManifoldsSorted(inReadBodyPair->GetValue(), all_m);
+
+	// Read amount of manifolds
+	uint32 num_manifolds = uint32(all_m.size());
+	inStream.Read(num_manifolds);
+
+	uint32 handle = ManifoldMap::cInvalidHandle;
+	for (uint32 j = 0; j < num_manifolds; ++j)
+	{
+		const MKeyValue *read_m_kv = j < all_m.size()? all_m[j] : nullptr;
+
+		// Read key
+		SubShapeIDPair sub_shape_key;
+		if (read_m_kv != nullptr)
+			sub_shape_key = read_m_kv->GetKey();
+		inStream.Read(sub_shape_key);
+
+		// Read amount of contact points
+		uint16 num_contact_points = 0;
+		if (read_m_kv != nullptr)
+			num_contact_points = read_m_kv->GetValue().mNumContactPoints;
+		inStream.Read(num_contact_points);
+
+		if (restore)
+		{
+			// Read manifold
+			MKeyValue *m_kv = Create(ioContactAllocator, sub_shape_key, sub_shape_key.GetHash(), num_contact_points);
+			if (m_kv == nullptr)
+				return false; // Out of cache space
+			CachedManifold &cm = m_kv->GetValue();
+			if (read_m_kv != nullptr)
+			{
+				memcpy(&cm, &read_m_kv->GetValue(), CachedManifold::sGetRequiredTotalSize(min(num_contact_points, read_m_kv->GetValue().mNumContactPoints)));
+				cm.mNumContactPoints = num_contact_points; // Restore num contact points
+			}
+			cm.RestoreState(inStream);
+			cm.mNextWithSameBodyPair = handle;
+			handle = ToHandle(m_kv);
+
+			// Read contact points
+			for (uint32 k = 0; k < num_contact_points; ++k)
+				cm.mContactPoints[k].RestoreState(inStream);
+		}
+		else
+		{
+			// Skip the manifold
+			CachedManifold cm;
+			cm.RestoreState(inStream);
+			for (uint32 k = 0; k < num_contact_points; ++k)
+				cm.mContactPoints[0].RestoreState(inStream);
+		}
+	}
+	bp.mFirstCachedManifold = handle;
+
+	return true;
+}
+
+bool ContactConstraintManager::ManifoldCache::RestoreState(StateRecorderBuffer &inStream, const StateRecorderFilter *inFilter, JobSystem &inJobSystem)
+{
+	JPH_ASSERT(!mIsFinalized);
+	JPH_ASSERT(!inStream.IsValidating());
+
+	// Read amount of body pairs
+	uint32 num_body_pairs = 0;
+	inStream.Read(num_body_pairs);
+
+	// Determine the size of the records in the stream by saving empty ones
+	StateRecorderBuffer scratch;
+	CachedBodyPair bp = {};
+	bp.SaveState(scratch);
+	size_t body_pair_size = sizeof(BodyPair) + scratch.GetDataSize() + sizeof(uint32);
+	scratch.Clear();
+	CachedManifold cm;
+	cm.mContactNormal = Float3(0, 0, 0);
+	cm.SaveState(scratch);
+	size_t manifold_size = sizeof(SubShapeIDPair) + sizeof(uint16) + scratch.GetDataSize();
+	scratch.Clear();
+	CachedContactPoint cp = {};
+	cp.SaveState(scratch);
+	size_t contact_point_size = scratch.GetDataSize();
+
+	// Find where each batch of body pairs starts in the stream
+	const uint8 *data = inStream.GetData();
+	size_t offset = inStream.GetReadOffset(), data_size = inStream.GetDataSize();
+	uint num_batches = StateRecorderJobs::sGetNumBatches(num_body_pairs);
+	Array<size_t> batch_offsets;
+	batch_offsets.reserve(num_batches + 1);
+	for (uint32 i = 0; i < num_body_pairs && offset <= data_size; ++i)
+	{
+		if (i % StateRecorderJobs::cBatchSize == 0)
+			batch_offsets.push_back(offset);
+
+		// Skip body pair and read amount of manifolds
+		offset += body_pair_size;
+		if (offset > data_size)
+			break;
+		uint32 num_manifolds;
+		memcpy(&num_manifolds, data + offset - sizeof(uint32), sizeof(uint32));
+
+		// Skip manifolds
+		for (uint32 j = 0; j < num_manifolds && offset <= data_size; ++j)
+		{
+			if (offset + manifold_size > data_size)
+			{
+				offset = data_size + 1;
+				break;
+			}
+			uint16 num_contact_points;
+			memcpy(&num_contact_points, data + offset + sizeof(SubShapeIDPair), sizeof(uint16));
+			offset += manifold_size + num_contact_points * contact_point_size;
+		}
+	}
+	batch_offsets.push_back(offset);
+	if (offset > data_size)
+	{
+		JPH_ASSERT(false, "Not enough data");
+		return false;
+	}
+
+	// Restore batches of body pairs in parallel, each batch uses its own contact allocator
+	atomic<bool> success = true;
+	JobBatches::sRun(num_body_pairs, StateRecorderJobs::cBatchSize, "RestoreContactState", inJobSystem, [this, data, inFilter, &batch_offsets, &success](uint inBatch, uint inBegin, uint inEnd)
+	{
+		size_t batch_size = batch_offsets[inBatch + 1] - batch_offsets[inBatch];
+		StateRecorderBuffer batch(const_cast<uint8 *>(data + batch_offsets[inBatch]), batch_size);
+		batch.SetDataSize(batch_size);
+
+		ContactAllocator contact_allocator(GetContactAllocator());
+		for (uint i = inBegin; i < inEnd; ++i)
+			if (!RestoreBodyPair(contact_allocator, batch, inFilter, *this, nullptr))
+			{
+				success = false;
+				break;
+			}
+	});
+	inStream.SkipBytes(offset - inStream.GetReadOffset());
+
+	// Read CCD manifolds (the read cache is only used when validating)
+	ContactAllocator contact_allocator(GetContactAllocator());
+	if (!RestoreCCDManifolds(*this, contact_allocator, inStream, inFilter))
+		success = false;
+
+	FinalizeRestore(inStream);
 
 	return success;
 }
@@ -1667,6 +1797,30 @@ void ContactConstraintManager::StoreAppliedImpulses(const uint32 *inConstraintId
 	}
 }
 
+uint64 ContactConstraintManager::HashAppliedImpulses(const uint32 *inConstraintIdxBegin, const uint32 *inConstraintIdxEnd) const
+{
+	uint64 hash = 0;
+
+	for (const uint32 *constraint_idx = inConstraintIdxBegin; constraint_idx < inConstraintIdxEnd; ++constraint_idx)
+	{
+		const ContactConstraint &constraint = mConstraints[*constraint_idx];
+
+		// Hash the bodies and the total lambdas of all contact points
+		BodyID body_ids[] = { constraint.mBody1->GetID(), constraint.mBody2->GetID() };
+		uint64 constraint_hash = HashBytes(body_ids, sizeof(body_ids));
+		for (const WorldContactPoint &wcp : constraint.mContactPoints)
+		{
+			float lambdas[] = { wcp.mNonPenetrationConstraint.GetTotalLambda(), wcp.mFrictionConstraint1.GetTotalLambda(), wcp.mFrictionConstraint2.GetTotalLambda() };
+			constraint_hash = HashBytes(lambdas, sizeof(lambdas), constraint_hash);
+		}
+
+		// The order of the constraints depends on the order in which they were found, so combine them in an order independent way
+		hash += constraint_hash;
+	}
+
+	return hash;
+}
+
 bool ContactConstraintManager::SolvePositionConstraints(const uint32 *inConstraintIdxBegin, const uint32 *inConstraintIdxEnd)
 {
 	JPH_PROFILE_FUNCTION();
@@ -1731,9 +1885,9 @@ void ContactConstraintManager::FinishConstraintBuffer()
 	mUpdateContext = nullptr;
 }
 
-void ContactConstraintManager::SaveState(StateRecorder &inStream, const StateRecorderFilter *inFilter) const
+void ContactConstraintManager::SaveState(StateRecorder &inStream, const StateRecorderFilter *inFilter, JobSystem *inJobSystem) const
 {
-	mCache[mCacheWriteIdx ^ 1].SaveState(inStream, inFilter);
+	mCache[mCacheWriteIdx ^ 1].SaveState(inStream, inFilter, inJobSystem);
 }
 
 bool ContactConstraintManager::RestoreState(StateRecorder &inStream, const StateRecorderFilter *inFilter)
@@ -1750,4 +1904,153 @@ bool ContactConstraintManager::RestoreState(StateRecorder &inStream, const State
 	return success;
 }
 
+bool ContactConstraintManager::RestoreState(StateRecorderBuffer &inStream, const StateRecorderFilter *inFilter, JobSystem &inJobSystem)
+{
+	// Validation needs to compare against the existing cache in order, do it single threaded
+	if (inStream.IsValidating())
+		return RestoreState(static_cast<StateRecorder &>(inStream), inFilter);
+
+	bool success = mCache[mCacheWriteIdx].RestoreState(inStream, inFilter, inJobSystem);
+
+	// If this is the last part, the cache is finalized
+	if (inStream.IsLastPart())
+	{
+		mCacheWriteIdx ^= 1;
+		mCache[mCacheWriteIdx].Clear();
+	}
+
+	return success;
+}
+
+void ContactConstraintManager::SaveStateReference(DeltaStateReference &ioReference) const
+{
+	ioReference.mContacts.clear();
+	ioReference.mContactData.Clear();
+
+	// Write all body pairs and remember where they are stored
+	const ManifoldCache &cache = mCache[mCacheWriteIdx ^ 1];
+	Array<const BPKeyValue *> all_bp;
+	cache.GetAllBodyPairsSorted(all_bp);
+	for (const BPKeyValue *bp_kv : all_bp)
+	{
+		uint32 offset = uint32(ioReference.mContactData.GetDataSize());
+		cache.SaveBodyPair(ioReference.mContactData, bp_kv);
+		ioReference.mContacts.push_back({ bp_kv->GetKey(), offset, uint32(ioReference.mContactData.GetDataSize()) - offset });
+	}
+}
+
+void ContactConstraintManager::SaveStateDelta(StateRecorder &inStream, const DeltaStateReference &inReference) const
+{
+	const ManifoldCache &cache = mCache[mCacheWriteIdx ^ 1];
+	Array<const BPKeyValue *> all_bp;
+	cache.GetAllBodyPairsSorted(all_bp);
+
+	// Buffers that are reused between calls so that we don't allocate
+	StateRecorderBuffer &body_pair_data = inReference.mScratch;
+	StateRecorderBuffer &changed_data = inReference.mChangedData;
+	changed_data.Clear();
+	Array<BodyPair> &skipped = inReference.mSkippedContacts;
+	skipped.clear();
+
+	// Both lists are sorted by key, walk them together to find the body pairs that were added, changed or removed
+	const DeltaStateReference::ContactState *reference = inReference.mContacts.data(), *reference_end = reference + inReference.mContacts.size();
+	uint32 num_changed = 0;
+	for (const BPKeyValue *bp_kv : all_bp)
+	{
+		// Body pairs of the reference that come before this one were removed
+		const BodyPair &key = bp_kv->GetKey();
+		for (; reference < reference_end && reference->mKey < key; ++reference)
+			skipped.push_back(reference->mKey);
+
+		// Get the current state
+		body_pair_data.Clear();
+		cache.SaveBodyPair(body_pair_data, bp_kv);
+
+		if (reference < reference_end && reference->mKey == key)
+		{
+			// Skip the body pair if it didn't change, otherwise the body pair of the reference is replaced
+			bool unchanged = reference->mSize == body_pair_data.GetDataSize()
+				&& memcmp(body_pair_data.GetData(), inReference.mContactData.GetData() + reference->mOffset, reference->mSize) == 0;
+			++reference;
+			if (unchanged)
+				continue;
+			skipped.push_back(key);
+		}
+
+		changed_data.WriteBytes(body_pair_data.GetData(), body_pair_data.GetDataSize());
+		++num_changed;
+	}
+	for (; reference < reference_end; ++reference)
+		skipped.push_back(reference->mKey);
+
+	// Write the body pairs of the reference that should not be restored
+	inStream.Write(uint32(skipped.size()));
+	for (const BodyPair &key : skipped)
+		inStream.Write(key);
+
+	// Write the body pairs that were added or changed
+	inStream.Write(num_changed);
+	inStream.WriteBytes(changed_data.GetData(), changed_data.GetDataSize());
+
+	// CCD manifolds only live for a single step, store all of them
+	cache.SaveCCDManifolds(inStream, nullptr);
+}
+
+bool ContactConstraintManager::RestoreStateDelta(StateRecorder &inStream, DeltaStateReference &ioReference)
+{
+	JPH_ASSERT(!inStream.IsValidating(), "Validation is not supported for delta states");
+
+	ManifoldCache &cache = mCache[mCacheWriteIdx];
+	ContactAllocator contact_allocator(cache.GetContactAllocator());
+
+	// Read the body pairs of the reference that should not be restored
+	Array<BodyPair> &skipped = ioReference.mSkippedContacts;
+	uint32 num_skipped = 0;
+	inStream.Read(num_skipped);
+	if (inStream.IsEOF() || num_skipped > ioReference.mContacts.size())
+	{
+		JPH_ASSERT(false, "Delta doesn't match the reference");
+		return false;
+	}
+	skipped.resize(num_skipped);
+	for (BodyPair &key : skipped)
+		inStream.Read(key);
+
+	// Restore the body pairs of the reference that didn't change, both lists are sorted by key
+	bool success = true;
+	StateRecorderBuffer &reference_data = ioReference.mContactData;
+	reference_data.Rewind();
+	const BodyPair *next_skipped = skipped.data(), *skipped_end = next_skipped + skipped.size();
+	for (const DeltaStateReference::ContactState &reference : ioReference.mContacts)
+	{
+		if (next_skipped < skipped_end && *next_skipped == reference.mKey)
+		{
+			reference_data.SkipBytes(reference.mSize);
+			++next_skipped;
+		}
+		else if (!cache.RestoreBodyPair(contact_allocator, reference_data, nullptr, cache, nullptr))
+		{
+			success = false;
+			break;
+		}
+	}
+
+	// Restore the body pairs that were added or changed
+	uint32 num_changed = 0;
+	inStream.Read(num_changed);
+	for (uint32 i = 0; i < num_changed && success; ++i)
+		success = cache.RestoreBodyPair(contact_allocator, inStream, nullptr, cache, nullptr);
+
+	// Restore the CCD manifolds (the read cache is only used when validating)
+	if (success)
+		success = cache.RestoreCCDManifolds(cache, contact_allocator, inStream, nullptr);
+
+	// The cache is complete, swap it in
+	cache.FinalizeRestore(inStream);
+	mCacheWriteIdx ^= 1;
+	mCache[mCacheWriteIdx].Clear();
+
+	return success && !inStream.IsEOF();
+}
+
 JPH_NAMESPACE_END
@@ -12,7 +12,9 @@
 #include <Jolt/Physics/Collision/ManifoldBetweenTwoFaces.h>
 #include <Jolt/Physics/Constraints/ConstraintPart/AxisConstraintPart.h>
 #include <Jolt/Physics/Constraints/ConstraintPart/DualAxisConstraintPart.h>
+#include <Jolt/Physics/StateRecorderBuffer.h>
 #include <Jolt/Core/HashCombine.h>
+#include <Jolt/Core/Mutex.h>
 #include <Jolt/Core/NonCopyable.h>
 
 JPH_SUPPRESS_WARNINGS_STD_BEGIN
@@ -23,6 +25,8 @@ JPH_NAMESPACE_BEGIN
 
 struct PhysicsSettings;
 class PhysicsUpdateContext;
+class JobSystem;
+class DeltaStateReference;
 
 class JPH_EXPORT ContactConstraintManager : public NonCopyable
 {
@@ -207,6 +211,9 @@ public:
 	/// Save back the lambdas to the contact cache for the next warm start
 	void						StoreAppliedImpulses(const uint32 *inConstraintIdxBegin, const uint32 *inConstraintIdxEnd) const;
 
+	/// Calculate a hash of the impulses applied by the contact constraints, the result doesn't depend on the order of the constraints
+	uint64						HashAppliedImpulses(const uint32 *inConstraintIdxBegin, const uint32 *inConstraintIdxEnd) const;
+
 	/// Solve position constraints.
 	/// This is using the approach described in 'Modeling and Solving Constraints' by Erin Catto presented at GDC 2007.
 	/// On slide 78 it is suggested to split up the Baumgarte stabilization for positional drift so that it does not
@@ -247,12 +254,24 @@ public:
 	static bool					sDrawContactManifolds;
 #endif // JPH_DEBUG_RENDERER
 
-	/// Saving state for replay
-	void						SaveState(StateRecorder &inStream, const StateRecorderFilter *inFilter) const;
+	/// Saving state for replay. When inJobSystem is not null, the contacts are saved in parallel (this gives the same data).
+	void						SaveState(StateRecorder &inStream, const StateRecorderFilter *inFilter, JobSystem *inJobSystem = nullptr) const;
 
 	/// Restoring state for replay. Returns false when failed.
 	bool						RestoreState(StateRecorder &inStream, const StateRecorderFilter *inFilter);
 
+	/// Restoring state for replay, the contacts are restored in parallel using inJobSystem so inFilter must be thread safe. Returns false when failed.
+	bool						RestoreState(StateRecorderBuffer &inStream, const StateRecorderFilter *inFilter, JobSystem &inJobSystem);
+
+	/// Save all contacts in ioReference so that SaveStateDelta can determine which contacts changed
+	void						SaveStateReference(DeltaStateReference &ioReference) const;
+
+	/// Save the contacts that were added, changed or removed with respect to inReference
+	void						SaveStateDelta(StateRecorder &inStream, const DeltaStateReference &inReference) const;
+
+	/// Restore the contacts of ioReference and apply the changes saved by SaveStateDelta. Returns false when failed.
+	bool						RestoreStateDelta(StateRecorder &inStream, DeltaStateReference &ioReference);
+
 private:
 	/// Local space contact point, used for caching impulses
 	class CachedContactPoint
@@ -392,10 +411,30 @@ private:
 #endif
 
 		/// Saving / restoring state for replay
-		void					SaveState(StateRecorder &inStream, const StateRecorderFilter *inFilter) const;
+		void					SaveState(StateRecorder &inStream, const StateRecorderFilter *inFilter, JobSystem *inJobSystem) const;
 		bool					RestoreState(const ManifoldCache &inReadCache, StateRecorder &inStream, const StateRecorderFilter *inFilter);
 
+		/// Restoring state for replay using multiple jobs, doesn't support validation
+		bool					RestoreState(StateRecorderBuffer &inStream, const StateRecorderFilter *inFilter, JobSystem &inJobSystem);
+
+		/// Save a body pair and all of its manifolds
+		void					SaveBodyPair(StateRecorder &inStream, const BPKeyValue *inBodyPair) const;
+
+		/// Restore a body pair that was saved by SaveBodyPair or skip it when inFilter rejects it. Returns false when out of cache space.
+		/// When validating, inReadBodyPair is the body pair in inReadCache that the stream is compared against (or null if there is none).
+		bool					RestoreBodyPair(ContactAllocator &ioContactAllocator, StateRecorder &inStream, const StateRecorderFilter *inFilter, const ManifoldCache &inReadCache, const BPKeyValue *inReadBodyPair);
+
+		/// Save the keys of the CCD manifolds that pass inFilter
+		void					SaveCCDManifolds(StateRecorder &inStream, const StateRecorderFilter *inFilter) const;
+
+		/// Restore the CCD manifolds. Returns false when out of cache space.
+		bool					RestoreCCDManifolds(const ManifoldCache &inReadCache, ContactAllocator &ioContactAllocator, StateRecorder &inStream, const StateRecorderFilter *inFilter);
+
+		/// Mark the cache as complete after it has been restored
+		void					FinalizeRestore(const StateRecorder &inStream);
+
 	private:
+
 		/// Block size used when allocating new blocks in the contact cache
 		static constexpr uint32	cAllocatorBlockSize = 4096;
 
@@ -408,6 +447,10 @@ private:
 		/// Simple hash map for BodyPair -> CachedBodyPair
 		BodyPairMap				mCachedBodyPairs { mAllocator };
 
+		/// Buffers that batches of body pairs are saved to when saving the state in parallel, kept to avoid allocating on every save
+		mutable Array<StateRecorderBuffer> mSaveStateBatches;
+		mutable Mutex			mSaveStateBatchesMutex;						///< Protects mSaveStateBatches
+
 #ifdef JPH_ENABLE_ASSERTS
 		bool					mIsFinalized = false;						///< Marks if this buffer is complete
 #endif
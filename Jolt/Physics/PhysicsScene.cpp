@@ -8,6 +8,8 @@
 #include <Jolt/Physics/PhysicsSystem.h>
 #include <Jolt/Physics/Body/BodyLockMulti.h>
 #include <Jolt/ObjectStream/TypeDeclarations.h>
+#include <Jolt/Core/StreamInMemory.h>
+#include <Jolt/Core/Profiler.h>
 
 JPH_NAMESPACE_BEGIN
 
@@ -114,13 +116,18 @@ void PhysicsScene::SaveBinaryState(StreamOut &inStream, bool inSaveShapes, bool
 	BodyCreationSettings::ShapeToIDMap shape_to_id;
 	BodyCreationSettings::MaterialToIDMap material_to_id;
 	BodyCreationSettings::GroupFilterToIDMap group_filter_to_id;
-	SoftBodyCreationSettings::SharedSettingsToIDMap settings_to_id;
 
 	// Save bodies
 	inStream.Write((uint32)mBodies.size());
 	for (const BodyCreationSettings &b : mBodies)
 		b.SaveWithChildren(inStream, inSaveShapes? &shape_to_id : nullptr, inSaveShapes? &material_to_id : nullptr, inSaveGroupFilter? &group_filter_to_id : nullptr);
 
+	// Save constraints and soft bodies
+	SaveConstraintsAndSoftBodies(inStream, material_to_id, inSaveGroupFilter? &group_filter_to_id : nullptr);
+}
+
+void PhysicsScene::SaveConstraintsAndSoftBodies(StreamOut &inStream, SoftBodyCreationSettings::MaterialToIDMap &ioMaterialMap, SoftBodyCreationSettings::GroupFilterToIDMap *ioGroupFilterMap) const
+{
 	// Save constraints
 	inStream.Write((uint32)mConstraints.size());
 	for (const ConnectedConstraint &cc : mConstraints)
@@ -131,9 +138,10 @@ void PhysicsScene::SaveBinaryState(StreamOut &inStream, bool inSaveShapes, bool
 	}
 
 	// Save soft bodies
+	SoftBodyCreationSettings::SharedSettingsToIDMap settings_to_id;
 	inStream.Write((uint32)mSoftBodies.size());
 	for (const SoftBodyCreationSettings &b : mSoftBodies)
-		b.SaveWithChildren(inStream, &settings_to_id, &material_to_id, inSaveGroupFilter? &group_filter_to_id : nullptr);
+		b.SaveWithChildren(inStream, &settings_to_id, &ioMaterialMap, ioGroupFilterMap);
 }
 
 PhysicsScene::PhysicsSceneResult PhysicsScene::sRestoreFromBinaryState(StreamIn &inStream)
@@ -146,7 +154,6 @@ PhysicsScene::PhysicsSceneResult PhysicsScene::sRestoreFromBinaryState(StreamIn
 	BodyCreationSettings::IDToShapeMap id_to_shape;
 	BodyCreationSettings::IDToMaterialMap id_to_material;
 	BodyCreationSettings::IDToGroupFilterMap id_to_group_filter;
-	SoftBodyCreationSettings::IDToSharedSettingsMap id_to_settings;
 
 	// Reserve some memory to avoid frequent reallocations
 	id_to_shape.reserve(1024);
@@ -169,17 +176,27 @@ PhysicsScene::PhysicsSceneResult PhysicsScene::sRestoreFromBinaryState(StreamIn
 		b = bcs_result.Get();
 	}
 
+	// Read constraints and soft bodies
+	if (!scene->RestoreConstraintsAndSoftBodies(inStream, id_to_material, id_to_group_filter, result))
+		return result;
+
+	result.Set(scene);
+	return result;
+}
+
+bool PhysicsScene::RestoreConstraintsAndSoftBodies(StreamIn &inStream, SoftBodyCreationSettings::IDToMaterialMap &ioMaterialMap, SoftBodyCreationSettings::IDToGroupFilterMap &ioGroupFilterMap, PhysicsSceneResult &ioResult)
+{
 	// Read constraints
-	len = 0;
+	uint32 len = 0;
 	inStream.Read(len);
-	scene->mConstraints.resize(len);
-	for (ConnectedConstraint &cc : scene->mConstraints)
+	mConstraints.resize(len);
+	for (ConnectedConstraint &cc : mConstraints)
 	{
 		ConstraintSettings::ConstraintResult c_result = ConstraintSettings::sRestoreFromBinaryState(inStream);
 		if (c_result.HasError())
 		{
-			result.SetError(c_result.GetError());
-			return result;
+			ioResult.SetError(c_result.GetError());
+			return false;
 		}
 		cc.mSettings = StaticCast<TwoBodyConstraintSettings>(c_result.Get());
 		inStream.Read(cc.mBody1);
@@ -187,21 +204,298 @@ PhysicsScene::PhysicsSceneResult PhysicsScene::sRestoreFromBinaryState(StreamIn
 	}
 
 	// Read soft bodies
+	SoftBodyCreationSettings::IDToSharedSettingsMap id_to_settings;
 	len = 0;
 	inStream.Read(len);
-	scene->mSoftBodies.resize(len);
-	for (SoftBodyCreationSettings &b : scene->mSoftBodies)
+	mSoftBodies.resize(len);
+	for (SoftBodyCreationSettings &b : mSoftBodies)
 	{
 		// Read creation settings
-		SoftBodyCreationSettings::SBCSResult sbcs_result = SoftBodyCreationSettings::sRestoreWithChildren(inStream, id_to_settings, id_to_material, id_to_group_filter);
+		SoftBodyCreationSettings::SBCSResult sbcs_result = SoftBodyCreationSettings::sRestoreWithChildren(inStream, id_to_settings, ioMaterialMap, ioGroupFilterMap);
 		if (sbcs_result.HasError())
 		{
-			result.SetError(sbcs_result.GetError());
-			return result;
+			ioResult.SetError(sbcs_result.GetError());
+			return false;
 		}
 		b = sbcs_result.Get();
 	}
 
+	return true;
+}
+
+/// Header of the cooked format, see PhysicsScene::SaveCooked
+struct PhysicsSceneCookedHeader
+{
+	static constexpr uint32		cMagic = 0x4353504a;				///< 'JPSC'
+
+	uint32						mMagic;								///< Identifies the data as a cooked physics scene
+	uint32						mVersion;							///< PhysicsScene::cCookedVersion at the time of saving
+	uint32						mBodySize;							///< Size of a body record, this differs between configurations (e.g. single / double precision)
+	uint32						mNumShapes;							///< Number of entries in the shape table
+	uint32						mNumGroupFilters;					///< Number of entries in the group filter table
+	uint32						mNumBodies;							///< Number of entries in the body table
+};
+
+/// Fixed size record in the body table of the cooked format, all values of BodyCreationSettings that are saved by SaveBinaryState
+struct PhysicsSceneCookedBody
+{
+	/// Flags for the boolean values of BodyCreationSettings
+	enum EFlags : uint8
+	{
+		AllowDynamicOrKinematic			= 1 << 0,
+		IsSensor						= 1 << 1,
+		CollideKinematicVsNonDynamic	= 1 << 2,
+		UseManifoldReduction			= 1 << 3,
+		ApplyGyroscopicForce			= 1 << 4,
+		EnhancedInternalEdgeRemoval		= 1 << 5,
+		AllowSleeping					= 1 << 6,
+	};
+
+	Real						mPosition[3];
+	Float4						mRotation;
+	Float3						mLinearVelocity;
+	Float3						mAngularVelocity;
+	Float4						mInertia[4];						///< Inertia of mMassPropertiesOverride
+	float						mMass;								///< Mass of mMassPropertiesOverride
+	uint32						mShapeIndex;						///< Index in the shape table
+	uint32						mGroupFilterIndex;					///< Index in the group filter table or cNoGroupFilter
+	CollisionGroup::GroupID		mGroupID;
+	CollisionGroup::SubGroupID	mSubGroupID;
+	ObjectLayer					mObjectLayer;
+	EMotionType					mMotionType;
+	EAllowedDOFs				mAllowedDOFs;
+	EMotionQuality				mMotionQuality;
+	EOverrideMassProperties		mOverrideMassProperties;
+	uint8						mFlags;
+	float						mFriction;
+	float						mRestitution;
+	float						mLinearDamping;
+	float						mAngularDamping;
+	float						mMaxLinearVelocity;
+	float						mMaxAngularVelocity;
+	float						mGravityFactor;
+	float						mInertiaMultiplier;
+	uint32						mNumVelocityStepsOverride;
+	uint32						mNumPositionStepsOverride;
+
+	static constexpr uint32		cNoGroupFilter = ~uint32(0);
+};
+
+static_assert(std::is_trivially_copyable<PhysicsSceneCookedBody>(), "Body records are copied with memcpy");
+
+void PhysicsScene::SaveCooked(StreamOut &inStream) const
+{
+	JPH_PROFILE_FUNCTION();
+
+	// Collect all unique shapes and group filters
+	UnorderedMap<const Shape *, uint32> shape_to_index;
+	Array<const Shape *> shapes;
+	UnorderedMap<const GroupFilter *, uint32> group_filter_to_index;
+	Array<const GroupFilter *> group_filters;
+	for (const BodyCreationSettings &b : mBodies)
+	{
+		const Shape *shape = b.GetShape();
+		JPH_ASSERT(shape != nullptr);
+		if (shape_to_index.try_emplace(shape, uint32(shapes.size())).second)
+			shapes.push_back(shape);
+
+		const GroupFilter *group_filter = b.mCollisionGroup.GetGroupFilter();
+		if (group_filter != nullptr && group_filter_to_index.try_emplace(group_filter, uint32(group_filters.size())).second)
+			group_filters.push_back(group_filter);
+	}
+
+	// Write header
+	PhysicsSceneCookedHeader header;
+	header.mMagic = PhysicsSceneCookedHeader::cMagic;
+	header.mVersion = cCookedVersion;
+	header.mBodySize = sizeof(PhysicsSceneCookedBody);
+	header.mNumShapes = uint32(shapes.size());
+	header.mNumGroupFilters = uint32(group_filters.size());
+	header.mNumBodies = uint32(mBodies.size());
+	inStream.Write(header);
+
+	// Write shape table, shapes that share children or materials store them only once
+	BodyCreationSettings::ShapeToIDMap shape_to_id;
+	BodyCreationSettings::MaterialToIDMap material_to_id;
+	for (const Shape *shape : shapes)
+		shape->SaveWithChildren(inStream, shape_to_id, material_to_id);
+
+	// Write group filter table
+	BodyCreationSettings::GroupFilterToIDMap group_filter_to_id;
+	for (const GroupFilter *group_filter : group_filters)
+		StreamUtils::SaveObjectReference(inStream, group_filter, &group_filter_to_id);
+
+	// Write body table
+	Array<PhysicsSceneCookedBody> bodies(mBodies.size());
+	for (size_t i = 0; i < mBodies.size(); ++i)
+	{
+		const BodyCreationSettings &b = mBodies[i];
+		PhysicsSceneCookedBody &cb = bodies[i];
+		memset(&cb, 0, sizeof(cb)); // Don't write uninitialized padding bytes
+
+		cb.mPosition[0] = b.mPosition.GetX();
+		cb.mPosition[1] = b.mPosition.GetY();
+		cb.mPosition[2] = b.mPosition.GetZ();
+		b.mRotation.GetXYZW().StoreFloat4(&cb.mRotation);
+		b.mLinearVelocity.StoreFloat3(&cb.mLinearVelocity);
+		b.mAngularVelocity.StoreFloat3(&cb.mAngularVelocity);
+		b.mMassPropertiesOverride.mInertia.StoreFloat4x4(cb.mInertia);
+		cb.mMass = b.mMassPropertiesOverride.mMass;
+		cb.mShapeIndex = shape_to_index[b.GetShape()];
+		const GroupFilter *group_filter = b.mCollisionGroup.GetGroupFilter();
+		cb.mGroupFilterIndex = group_filter != nullptr? group_filter_to_index[group_filter] : PhysicsSceneCookedBody::cNoGroupFilter;
+		cb.mGroupID = b.mCollisionGroup.GetGroupID();
+		cb.mSubGroupID = b.mCollisionGroup.GetSubGroupID();
+		cb.mObjectLayer = b.mObjectLayer;
+		cb.mMotionType = b.mMotionType;
+		cb.mAllowedDOFs = b.mAllowedDOFs;
+		cb.mMotionQuality = b.mMotionQuality;
+		cb.mOverrideMassProperties = b.mOverrideMassProperties;
+		cb.mFlags = (b.mAllowDynamicOrKinematic? PhysicsSceneCookedBody::AllowDynamicOrKinematic : 0)
+			| (b.mIsSensor? PhysicsSceneCookedBody::IsSensor : 0)
+			| (b.mCollideKinematicVsNonDynamic? PhysicsSceneCookedBody::CollideKinematicVsNonDynamic : 0)
+			| (b.mUseManifoldReduction? PhysicsSceneCookedBody::UseManifoldReduction : 0)
+			| (b.mApplyGyroscopicForce? PhysicsSceneCookedBody::ApplyGyroscopicForce : 0)
+			| (b.mEnhancedInternalEdgeRemoval? PhysicsSceneCookedBody::EnhancedInternalEdgeRemoval : 0)
+			| (b.mAllowSleeping? PhysicsSceneCookedBody::AllowSleeping : 0);
+		cb.mFriction = b.mFriction;
+		cb.mRestitution = b.mRestitution;
+		cb.mLinearDamping = b.mLinearDamping;
+		cb.mAngularDamping = b.mAngularDamping;
+		cb.mMaxLinearVelocity = b.mMaxLinearVelocity;
+		cb.mMaxAngularVelocity = b.mMaxAngularVelocity;
+		cb.mGravityFactor = b.mGravityFactor;
+		cb.mInertiaMultiplier = b.mInertiaMultiplier;
+		cb.mNumVelocityStepsOverride = b.mNumVelocityStepsOverride;
+		cb.mNumPositionStepsOverride = b.mNumPositionStepsOverride;
+	}
+	if (!bodies.empty())
+		inStream.WriteBytes(bodies.data(), bodies.size() * sizeof(PhysicsSceneCookedBody));
+
+	// Write constraints and soft bodies
+	SaveConstraintsAndSoftBodies(inStream, material_to_id, &group_filter_to_id);
+}
+
+PhysicsScene::PhysicsSceneResult PhysicsScene::sRestoreFromCooked(const void *inData, size_t inSize)
+{
+	JPH_PROFILE_FUNCTION();
+
+	PhysicsSceneResult result;
+
+	StreamInMemory stream(inData, inSize);
+
+	// Read header
+	PhysicsSceneCookedHeader header;
+	stream.Read(header);
+	if (stream.IsEOF() || header.mMagic != PhysicsSceneCookedHeader::cMagic)
+	{
+		result.SetError("Not a cooked physics scene");
+		return result;
+	}
+	if (header.mVersion != cCookedVersion || header.mBodySize != sizeof(PhysicsSceneCookedBody))
+	{
+		result.SetError("Cooked physics scene was saved with an incompatible version or configuration");
+		return result;
+	}
+
+	// Read shape table
+	BodyCreationSettings::IDToShapeMap id_to_shape;
+	BodyCreationSettings::IDToMaterialMap id_to_material;
+	id_to_shape.reserve(header.mNumShapes);
+	Array<Ref<Shape>> shapes;
+	shapes.reserve(header.mNumShapes);
+	for (uint32 i = 0; i < header.mNumShapes; ++i)
+	{
+		Shape::ShapeResult shape_result = Shape::sRestoreWithChildren(stream, id_to_shape, id_to_material);
+		if (shape_result.HasError())
+		{
+			result.SetError(shape_result.GetError());
+			return result;
+		}
+		shapes.push_back(shape_result.Get());
+	}
+
+	// Read group filter table
+	BodyCreationSettings::IDToGroupFilterMap id_to_group_filter;
+	Array<Ref<GroupFilter>> group_filters;
+	group_filters.reserve(header.mNumGroupFilters);
+	for (uint32 i = 0; i < header.mNumGroupFilters; ++i)
+	{
+		Result group_filter_result = StreamUtils::RestoreObjectReference(stream, id_to_group_filter);
+		if (group_filter_result.HasError())
+		{
+			result.SetError(group_filter_result.GetError());
+			return result;
+		}
+		group_filters.push_back(group_filter_result.Get());
+	}
+
+	// The body table can be read in place
+	size_t body_table_size = size_t(header.mNumBodies) * sizeof(PhysicsSceneCookedBody);
+	const uint8 *body_table = stream.GetCurrent();
+	if (!stream.Skip(body_table_size))
+	{
+		result.SetError("Error reading cooked bodies");
+		return result;
+	}
+
+	// Create scene
+	Ref<PhysicsScene> scene = new PhysicsScene();
+
+	// Convert body records to body creation settings
+	scene->mBodies.resize(header.mNumBodies);
+	for (uint32 i = 0; i < header.mNumBodies; ++i)
+	{
+		// The data does not need to be aligned, so copy the record
+		PhysicsSceneCookedBody cb;
+		memcpy(&cb, body_table + i * sizeof(PhysicsSceneCookedBody), sizeof(PhysicsSceneCookedBody));
+		if (cb.mShapeIndex >= shapes.size()
+			|| (cb.mGroupFilterIndex != PhysicsSceneCookedBody::cNoGroupFilter && cb.mGroupFilterIndex >= group_filters.size()))
+		{
+			result.SetError("Invalid index in cooked body");
+			return result;
+		}
+
+		BodyCreationSettings &b = scene->mBodies[i];
+		b.mPosition = RVec3(cb.mPosition[0], cb.mPosition[1], cb.mPosition[2]);
+		b.mRotation = Quat(Vec4::sLoadFloat4(&cb.mRotation));
+		b.mLinearVelocity = Vec3(cb.mLinearVelocity);
+		b.mAngularVelocity = Vec3(cb.mAngularVelocity);
+		b.mMassPropertiesOverride.mInertia = Mat44::sLoadFloat4x4(cb.mInertia);
+		b.mMassPropertiesOverride.mMass = cb.mMass;
+		b.SetShape(shapes[cb.mShapeIndex]);
+		if (cb.mGroupFilterIndex != PhysicsSceneCookedBody::cNoGroupFilter)
+			b.mCollisionGroup.SetGroupFilter(group_filters[cb.mGroupFilterIndex]);
+		b.mCollisionGroup.SetGroupID(cb.mGroupID);
+		b.mCollisionGroup.SetSubGroupID(cb.mSubGroupID);
+		b.mObjectLayer = cb.mObjectLayer;
+		b.mMotionType = cb.mMotionType;
+		b.mAllowedDOFs = cb.mAllowedDOFs;
+		b.mMotionQuality = cb.mMotionQuality;
+		b.mOverrideMassProperties = cb.mOverrideMassProperties;
+		b.mAllowDynamicOrKinematic = (cb.mFlags & PhysicsSceneCookedBody::AllowDynamicOrKinematic) != 0;
+		b.mIsSensor = (cb.mFlags & PhysicsSceneCookedBody::IsSensor) != 0;
+		b.mCollideKinematicVsNonDynamic = (cb.mFlags & PhysicsSceneCookedBody::CollideKinematicVsNonDynamic) != 0;
+		b.mUseManifoldReduction = (cb.mFlags & PhysicsSceneCookedBody::UseManifoldReduction) != 0;
+		b.mApplyGyroscopicForce = (cb.mFlags & PhysicsSceneCookedBody::ApplyGyroscopicForce) != 0;
+		b.mEnhancedInternalEdgeRemoval = (cb.mFlags & PhysicsSceneCookedBody::EnhancedInternalEdgeRemoval) != 0;
+		b.mAllowSleeping = (cb.mFlags & PhysicsSceneCookedBody::AllowSleeping) != 0;
+		b.mFriction = cb.mFriction;
+		b.mRestitution = cb.mRestitution;
+		b.mLinearDamping = cb.mLinearDamping;
+		b.mAngularDamping = cb.mAngularDamping;
+		b.mMaxLinearVelocity = cb.mMaxLinearVelocity;
+		b.mMaxAngularVelocity = cb.mMaxAngularVelocity;
+		b.mGravityFactor = cb.mGravityFactor;
+		b.mInertiaMultiplier = cb.mInertiaMultiplier;
+		b.mNumVelocityStepsOverride = cb.mNumVelocityStepsOverride;
+		b.mNumPositionStepsOverride = cb.mNumPositionStepsOverride;
+	}
+
+	// Read constraints and soft bodies
+	if (!scene->RestoreConstraintsAndSoftBodies(stream, id_to_material, id_to_group_filter, result))
+		return result;
+
 	result.Set(scene);
 	return result;
 }
@@ -87,10 +87,27 @@ public:
 	/// Restore a saved scene from inStream
 	static PhysicsSceneResult				sRestoreFromBinaryState(StreamIn &inStream);
 
+	/// Version of the cooked format, this is increased when the layout of the cooked data changes
+	static constexpr uint32					cCookedVersion = 1;
+
+	/// Saves the scene including shapes and group filters in a cooked format that restores much faster than SaveBinaryState.
+	/// Every shape and group filter is stored once in a table, followed by a table of fixed size body records that reference them by index.
+	/// The cooked data can only be restored by the same version of the library on a platform with the same endianness and JPH_DOUBLE_PRECISION / JPH_OBJECT_LAYER_BITS settings.
+	void									SaveCooked(StreamOut &inStream) const;
+
+	/// Restore a scene from data written by SaveCooked. The data is read in place, so inData can e.g. point to a memory mapped file.
+	static PhysicsSceneResult				sRestoreFromCooked(const void *inData, size_t inSize);
+
 	/// For debugging purposes: Construct a scene from the current state of the physics system
 	void									FromPhysicsSystem(const PhysicsSystem *inSystem);
 
 private:
+	/// Save the constraints and soft bodies, these are stored in the same way by SaveBinaryState and SaveCooked
+	void									SaveConstraintsAndSoftBodies(StreamOut &inStream, SoftBodyCreationSettings::MaterialToIDMap &ioMaterialMap, SoftBodyCreationSettings::GroupFilterToIDMap *ioGroupFilterMap) const;
+
+	/// Restore the constraints and soft bodies, returns false and sets an error in ioResult when failed
+	bool									RestoreConstraintsAndSoftBodies(StreamIn &inStream, SoftBodyCreationSettings::IDToMaterialMap &ioMaterialMap, SoftBodyCreationSettings::IDToGroupFilterMap &ioGroupFilterMap, PhysicsSceneResult &ioResult);
+
 	/// The bodies that are part of this scene
 	Array<BodyCreationSettings>				mBodies;
 
@@ -89,9 +89,31 @@ struct PhysicsSettings
 	/// Velocity of points on bounding box of object below which an object can be considered sleeping (unit: m/s)
 	float		mPointVelocitySleepThreshold = 0.03f;
 
+	/// Maximum number of broadphase tree nodes to rebuild per update to keep the broadphase efficient without having to call PhysicsSystem::OptimizeBroadPhase (0 = disabled).
+	/// The rebuild happens as part of the broadphase update job, picking the parts of the tree that degraded the most first. Higher values keep the tree tighter at the cost of more work per update.
+	uint		mBroadPhaseIncrementalOptimizationBudget = 0;
+
+	/// When true, the broadphase remembers the bodies near each active body and reuses them in the next steps instead of querying the tree again.
+	/// This is faster when many bodies move slowly, the pairs that are found are identical to when the cache is disabled.
+	bool		mUseBroadPhasePairCache = false;
+
+	/// Distance by which the bounding box of a body is enlarged when its broadphase pairs are cached (unit: meters).
+	/// The cached pairs stay valid until the body leaves its enlarged box or the bodies around it moved further than this distance.
+	float		mBroadPhasePairCacheMargin = 0.1f;
+
+	/// The enlarged box of the broadphase pair cache is additionally enlarged by the linear velocity of the body times this value (unit: seconds)
+	float		mBroadPhasePairCacheVelocityScale = 0.05f;
+
 	/// By default the simulation is deterministic, it is possible to turn this off by setting this setting to false. This will make the simulation run faster but it will no longer be deterministic.
 	bool		mDeterministicSimulation = true;
 
+	/// When true, PhysicsSystem::Update calculates a hash of the position, rotation and velocity of all rigid bodies that were simulated, see PhysicsSystem::GetStateHash.
+	/// The hash is accumulated while the bounding boxes are updated at the end of the update, so comparing it between clients every frame to detect desyncs is very cheap.
+	bool		mCalculateStateHash = false;
+
+	/// When true (and mCalculateStateHash is true), the state hash also includes the impulses applied by the contact constraints
+	bool		mStateHashIncludesContactImpulses = false;
+
 	///@name These variables are mainly for debugging purposes, they allow turning on/off certain subsystems. You probably want to leave them alone.
 	///@{
 
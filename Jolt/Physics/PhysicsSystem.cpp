@@ -10,6 +10,7 @@
 #include <Jolt/Physics/PhysicsStepListener.h>
 #include <Jolt/Physics/Collision/BroadPhase/BroadPhaseBruteForce.h>
 #include <Jolt/Physics/Collision/BroadPhase/BroadPhaseQuadTree.h>
+#include <Jolt/Physics/Collision/BroadPhase/BroadPhaseSAP.h>
 #include <Jolt/Physics/Collision/CollisionDispatch.h>
 #include <Jolt/Physics/Collision/AABoxCast.h>
 #include <Jolt/Physics/Collision/ShapeCast.h>
@@ -23,6 +24,7 @@
 #include <Jolt/Physics/Constraints/CalculateSolverSteps.h>
 #include <Jolt/Physics/Constraints/ConstraintPart/AxisConstraintPart.h>
 #include <Jolt/Physics/DeterminismLog.h>
+#include <Jolt/Physics/StateRecorderDelta.h>
 #include <Jolt/Physics/SoftBody/SoftBodyMotionProperties.h>
 #include <Jolt/Physics/SoftBody/SoftBodyShape.h>
 #include <Jolt/Geometry/RayAABox.h>
@@ -41,9 +43,6 @@ JPH_NAMESPACE_BEGIN
 bool PhysicsSystem::sDrawMotionQualityLinearCast = false;
 #endif // JPH_DEBUG_RENDERER
 
-//#define BROAD_PHASE BroadPhaseBruteForce
-#define BROAD_PHASE BroadPhaseQuadTree
-
 static const Color cColorUpdateBroadPhaseFinalize = Color::sGetDistinctColor(1);
 static const Color cColorUpdateBroadPhasePrepare = Color::sGetDistinctColor(2);
 static const Color cColorFindCollisions = Color::sGetDistinctColor(3);
@@ -74,7 +73,7 @@ PhysicsSystem::~PhysicsSystem()
 	delete mBroadPhase;
 }
 
-void PhysicsSystem::Init(uint inMaxBodies, uint inNumBodyMutexes, uint inMaxBodyPairs, uint inMaxContactConstraints, const BroadPhaseLayerInterface &inBroadPhaseLayerInterface, const ObjectVsBroadPhaseLayerFilter &inObjectVsBroadPhaseLayerFilter, const ObjectLayerPairFilter &inObjectLayerPairFilter)
+void PhysicsSystem::Init(uint inMaxBodies, uint inNumBodyMutexes, uint inMaxBodyPairs, uint inMaxContactConstraints, const BroadPhaseLayerInterface &inBroadPhaseLayerInterface, const ObjectVsBroadPhaseLayerFilter &inObjectVsBroadPhaseLayerFilter, const ObjectLayerPairFilter &inObjectLayerPairFilter, EBroadPhaseType inBroadPhaseType)
 {
 	JPH_ASSERT(inMaxBodies <= BodyID::cMaxBodyIndex, "Cannot support this many bodies");
 
@@ -85,8 +84,22 @@ void PhysicsSystem::Init(uint inMaxBodies, uint inNumBodyMutexes, uint inMaxBody
 	mBodyManager.Init(inMaxBodies, inNumBodyMutexes, inBroadPhaseLayerInterface);
 
 	// Create broadphase
-	mBroadPhase = new BROAD_PHASE();
+	switch (inBroadPhaseType)
+	{
+	case EBroadPhaseType::QuadTree:
+		mBroadPhase = new BroadPhaseQuadTree();
+		break;
+
+	case EBroadPhaseType::SweepAndPrune:
+		mBroadPhase = new BroadPhaseSAP();
+		break;
+
+	case EBroadPhaseType::BruteForce:
+		mBroadPhase = new BroadPhaseBruteForce();
+		break;
+	}
 	mBroadPhase->Init(&mBodyManager, inBroadPhaseLayerInterface);
+	ApplyBroadPhaseSettings();
 
 	// Init contact constraint manager
 	mContactManager.Init(inMaxBodyPairs, inMaxContactConstraints);
@@ -126,6 +139,21 @@ void PhysicsSystem::RemoveStepListener(PhysicsStepListener *inListener)
 	mStepListeners.pop_back();
 }
 
+void PhysicsSystem::SetPhysicsSettings(const PhysicsSettings &inSettings)
+{
+	mPhysicsSettings = inSettings;
+
+	// Pass the new settings on to the broad phase (it is created in Init)
+	if (mBroadPhase != nullptr)
+		ApplyBroadPhaseSettings();
+}
+
+void PhysicsSystem::ApplyBroadPhaseSettings()
+{
+	mBroadPhase->SetIncrementalOptimizationBudget(mPhysicsSettings.mBroadPhaseIncrementalOptimizationBudget);
+	mBroadPhase->SetPairCache(mPhysicsSettings.mUseBroadPhasePairCache, mPhysicsSettings.mBroadPhasePairCacheMargin, mPhysicsSettings.mBroadPhasePairCacheVelocityScale);
+}
+
 EPhysicsUpdateError PhysicsSystem::Update(float inDeltaTime, int inCollisionSteps, TempAllocator *inTempAllocator, JobSystem *inJobSystem)
 {
 	JPH_PROFILE_FUNCTION();
@@ -138,6 +166,9 @@ EPhysicsUpdateError PhysicsSystem::Update(float inDeltaTime, int inCollisionStep
 	// Sync point for the broadphase. This will allow it to do clean up operations without having any mutexes locked yet.
 	mBroadPhase->FrameSync();
 
+	// Islands add their hash to the state hash at the end of the update
+	mStateHash.store(0, memory_order_relaxed);
+
 	// If there are no active bodies or there's no time delta
 	uint32 num_active_rigid_bodies = mBodyManager.GetNumActiveBodies(EBodyType::RigidBody);
 	uint32 num_active_soft_bodies = mBodyManager.GetNumActiveBodies(EBodyType::SoftBody);
@@ -2279,6 +2310,25 @@ private:
 	BodyID *				mBodiesToSleepCur;
 };
 
+// Hash the state of a body that is updated by the simulation
+static uint64 sHashBodyState(const Body &inBody)
+{
+	BodyID body_id = inBody.GetID();
+	uint64 hash = HashBytes(&body_id, sizeof(body_id));
+
+	// Only hash the x, y and z components, the w component of a vector is undefined
+	RVec3 position = inBody.GetCenterOfMassPosition();
+	Real xyz[] = { position.GetX(), position.GetY(), position.GetZ() };
+	hash = HashBytes(xyz, sizeof(xyz), hash);
+	Float4 rotation;
+	inBody.GetRotation().GetXYZW().StoreFloat4(&rotation);
+	hash = HashBytes(&rotation, sizeof(rotation), hash);
+	Float3 velocity[2];
+	inBody.GetLinearVelocity().StoreFloat3(&velocity[0]);
+	inBody.GetAngularVelocity().StoreFloat3(&velocity[1]);
+	return HashBytes(velocity, sizeof(velocity), hash);
+}
+
 void PhysicsSystem::CheckSleepAndUpdateBounds(uint32 inIslandIndex, const PhysicsUpdateContext *ioContext, const PhysicsUpdateContext::Step *ioStep, BodiesToSleep &ioBodiesToSleep)
 {
 	// Get the bodies that belong to this island
@@ -2297,6 +2347,9 @@ void PhysicsSystem::CheckSleepAndUpdateBounds(uint32 inIslandIndex, const Physic
 		float time_before_sleep = mPhysicsSettings.mTimeBeforeSleep;
 		float max_movement = mPhysicsSettings.mPointVelocitySleepThreshold * time_before_sleep;
 
+		bool calculate_hash = mPhysicsSettings.mCalculateStateHash;
+		uint64 hash = 0;
+
 		for (const BodyID *body_id = bodies_begin; body_id < bodies_end; ++body_id)
 		{
 			Body &body = mBodyManager.GetBody(*body_id);
@@ -2304,6 +2357,10 @@ void PhysicsSystem::CheckSleepAndUpdateBounds(uint32 inIslandIndex, const Physic
 			// Update bounding box
 			body.CalculateWorldSpaceBoundsInternal();
 
+			// Update state hash, the order of the bodies in an island is not deterministic so the hashes are summed
+			if (calculate_hash)
+				hash += sHashBodyState(body);
+
 			// Update sleeping
 			all_can_sleep &= int(body.UpdateSleepStateInternal(ioContext->mStepDeltaTime, max_movement, time_before_sleep));
 
@@ -2316,6 +2373,19 @@ void PhysicsSystem::CheckSleepAndUpdateBounds(uint32 inIslandIndex, const Physic
 		// If all bodies indicate they can sleep we can deactivate them
 		if (all_can_sleep == int(ECanSleep::CanSleep))
 			ioBodiesToSleep.PutToSleep(bodies_begin, bodies_end);
+
+		if (calculate_hash)
+		{
+			// Add the impulses of the contacts in this island
+			if (mPhysicsSettings.mStateHashIncludesContactImpulses)
+			{
+				uint32 *contacts_begin, *contacts_end;
+				mIslandBuilder.GetContactsInIsland(inIslandIndex, contacts_begin, contacts_end);
+				hash += mContactManager.HashAppliedImpulses(contacts_begin, contacts_end);
+			}
+
+			mStateHash.fetch_add(hash, memory_order_relaxed);
+		}
 	}
 	else
 	{
@@ -2337,8 +2407,8 @@ void PhysicsSystem::CheckSleepAndUpdateBounds(uint32 inIslandIndex, const Physic
 void PhysicsSystem::JobSolvePositionConstraints(PhysicsUpdateContext *ioContext, PhysicsUpdateContext::Step *ioStep)
 {
 #ifdef JPH_ENABLE_ASSERTS
-	// We fix up position errors
-	BodyAccess::Grant grant(BodyAccess::EAccess::None, BodyAccess::EAccess::ReadWrite);
+	// We fix up position errors, velocities are only read to calculate the state hash
+	BodyAccess::Grant grant(BodyAccess::EAccess::Read, BodyAccess::EAccess::ReadWrite);
 
 	// Can only deactivate bodies
 	BodyManager::GrantActiveBodiesAccess grant_active(false, true);
@@ -2451,6 +2521,25 @@ void PhysicsSystem::JobSoftBodyPrepare(PhysicsUpdateContext *ioContext, PhysicsU
 		BodyIDVector active_bodies;
 		mBodyManager.GetActiveBodies(EBodyType::SoftBody, active_bodies);
 
+		// Sort to get a deterministic update order
+		QuickSort(active_bodies.begin(), active_bodies.end());
+
+		// Remove the soft bodies that skip this step because of their update interval
+		Array<float> &delta_times = mSoftBodyDeltaTimes;
+		delta_times.clear();
+		delta_times.reserve(active_bodies.size());
+		BodyIDVector::iterator out = active_bodies.begin();
+		for (const BodyID &id : active_bodies)
+		{
+			float delta_time = static_cast<SoftBodyMotionProperties *>(mBodyManager.GetBody(id).GetMotionProperties())->AccumulateDeltaTime(ioContext->mStepDeltaTime);
+			if (delta_time > 0.0f)
+			{
+				*out++ = id;
+				delta_times.push_back(delta_time);
+			}
+		}
+		active_bodies.erase(out, active_bodies.end());
+
 		// Quit if there are no active soft bodies
 		if (active_bodies.empty())
 		{
@@ -2460,9 +2549,6 @@ void PhysicsSystem::JobSoftBodyPrepare(PhysicsUpdateContext *ioContext, PhysicsU
 			return;
 		}
 
-		// Sort to get a deterministic update order
-		QuickSort(active_bodies.begin(), active_bodies.end());
-
 		// Allocate soft body contexts
 		ioContext->mNumSoftBodies = (uint)active_bodies.size();
 		ioContext->mSoftBodyUpdateContexts = (SoftBodyUpdateContext *)ioContext->mTempAllocator->Allocate(ioContext->mNumSoftBodies * sizeof(SoftBodyUpdateContext));
@@ -2471,17 +2557,20 @@ void PhysicsSystem::JobSoftBodyPrepare(PhysicsUpdateContext *ioContext, PhysicsU
 		for (SoftBodyUpdateContext *sb_ctx = ioContext->mSoftBodyUpdateContexts, *sb_ctx_end = ioContext->mSoftBodyUpdateContexts + ioContext->mNumSoftBodies; sb_ctx < sb_ctx_end; ++sb_ctx)
 		{
 			new (sb_ctx) SoftBodyUpdateContext;
-			Body &body = mBodyManager.GetBody(active_bodies[sb_ctx - ioContext->mSoftBodyUpdateContexts]);
+			size_t idx = sb_ctx - ioContext->mSoftBodyUpdateContexts;
+			Body &body = mBodyManager.GetBody(active_bodies[idx]);
 			SoftBodyMotionProperties *mp = static_cast<SoftBodyMotionProperties *>(body.GetMotionProperties());
-			mp->InitializeUpdateContext(ioContext->mStepDeltaTime, body, *this, *sb_ctx);
+			mp->InitializeUpdateContext(delta_times[idx], body, *this, *sb_ctx);
 		}
 	}
 
-	// We're ready to collide the first soft body
+	// We're ready to collide and simulate the first soft body
 	ioContext->mSoftBodyToCollide.store(0, memory_order_release);
+	ioContext->mSoftBodyToSimulate.store(0, memory_order_release);
 
 	// Determine number of jobs to spawn
 	int num_soft_body_jobs = ioContext->GetMaxConcurrency();
+	int num_soft_body_simulate_jobs = min(num_soft_body_jobs, (int)ioContext->mNumSoftBodies);
 
 	// Create finalize job
 	ioStep->mSoftBodyFinalize = ioContext->mJobSystem->CreateJob("SoftBodyFinalize", cColorSoftBodyFinalize, [ioContext, ioStep]()
@@ -2491,15 +2580,15 @@ void PhysicsSystem::JobSoftBodyPrepare(PhysicsUpdateContext *ioContext, PhysicsU
 		// Kick the next step
 		if (ioStep->mStartNextStep.IsValid())
 			ioStep->mStartNextStep.RemoveDependency();
-	}, num_soft_body_jobs); // depends on: soft body simulate
+	}, num_soft_body_simulate_jobs); // depends on: soft body simulate (helper jobs add their own dependency)
 	ioContext->mBarrier->AddJob(ioStep->mSoftBodyFinalize);
 
 	// Create simulate jobs
-	ioStep->mSoftBodySimulate.resize(num_soft_body_jobs);
-	for (int i = 0; i < num_soft_body_jobs; ++i)
-		ioStep->mSoftBodySimulate[i] = ioContext->mJobSystem->CreateJob("SoftBodySimulate", cColorSoftBodySimulate, [ioStep, i]()
+	ioStep->mSoftBodySimulate.resize(num_soft_body_simulate_jobs);
+	for (int i = 0; i < num_soft_body_simulate_jobs; ++i)
+		ioStep->mSoftBodySimulate[i] = ioContext->mJobSystem->CreateJob("SoftBodySimulate", cColorSoftBodySimulate, [ioStep]()
 			{
-				ioStep->mContext->mPhysicsSystem->JobSoftBodySimulate(ioStep->mContext, i);
+				ioStep->mContext->mPhysicsSystem->JobSoftBodySimulate(ioStep->mContext, ioStep);
 
 				ioStep->mSoftBodyFinalize.RemoveDependency();
 			}, num_soft_body_jobs); // depends on: soft body collide
@@ -2538,44 +2627,87 @@ void PhysicsSystem::JobSoftBodyCollide(PhysicsUpdateContext *ioContext) const
 	}
 }
 
-void PhysicsSystem::JobSoftBodySimulate(PhysicsUpdateContext *ioContext, uint inThreadIndex) const
+void PhysicsSystem::JobSoftBodySimulate(PhysicsUpdateContext *ioContext, PhysicsUpdateContext::Step *ioStep) const
 {
 #ifdef JPH_ENABLE_ASSERTS
 	// Updating velocities of soft bodies, allow the contact listener to read the soft body state
 	BodyAccess::Grant grant(BodyAccess::EAccess::ReadWrite, BodyAccess::EAccess::Read);
 #endif
 
-	// Calculate at which body we start to distribute the workload across the threads
-	uint num_soft_bodies = ioContext->mNumSoftBodies;
-	uint start_idx = inThreadIndex * num_soft_bodies / ioContext->GetMaxConcurrency();
+	for (;;)
+	{
+		// Fetch the next soft body that hasn't been started yet
+		uint sb_idx = ioContext->mSoftBodyToSimulate.fetch_add(1, memory_order_relaxed);
+		if (sb_idx >= ioContext->mNumSoftBodies)
+			break;
 
-	// Keep running partial updates until everything has been updated
-	uint status;
+		// Start helpers for the first phase and work on the soft body ourselves.
+		// When we run out of work because other threads are still processing the last batches of a phase, we move on to the next soft body.
+		// The thread that finishes the phase will continue with the soft body, so we never have to wait.
+		SpawnSoftBodyHelpers(ioContext, ioStep, sb_idx);
+		SimulateSoftBody(ioContext, ioStep, sb_idx);
+	}
+}
+
+void PhysicsSystem::JobSoftBodySimulateHelper(PhysicsUpdateContext *ioContext, PhysicsUpdateContext::Step *ioStep, uint inSoftBodyIndex) const
+{
+#ifdef JPH_ENABLE_ASSERTS
+	// Updating velocities of soft bodies, allow the contact listener to read the soft body state
+	BodyAccess::Grant grant(BodyAccess::EAccess::ReadWrite, BodyAccess::EAccess::Read);
+#endif
+
+	SimulateSoftBody(ioContext, ioStep, inSoftBodyIndex);
+}
+
+void PhysicsSystem::SimulateSoftBody(PhysicsUpdateContext *ioContext, PhysicsUpdateContext::Step *ioStep, uint inSoftBodyIndex) const
+{
+	SoftBodyUpdateContext &sb_ctx = ioContext->mSoftBodyUpdateContexts[inSoftBodyIndex];
+
+	// To avoid trashing the cache too much, we stick to one soft body until we cannot progress it any further
+	while (sb_ctx.mMotionProperties->ParallelUpdate(sb_ctx, mPhysicsSettings) == SoftBodyMotionProperties::EStatus::DidWork)
+	{
+		// If a new phase started, the first thread that notices spawns helpers for it
+		uint phase = sb_ctx.mPhase.load(memory_order_acquire);
+		uint scheduled_phase = sb_ctx.mScheduledPhase.load(memory_order_relaxed);
+		if (phase > scheduled_phase
+			&& sb_ctx.mScheduledPhase.compare_exchange_strong(scheduled_phase, phase, memory_order_relaxed))
+			SpawnSoftBodyHelpers(ioContext, ioStep, inSoftBodyIndex);
+	}
+}
+
+void PhysicsSystem::SpawnSoftBodyHelpers(PhysicsUpdateContext *ioContext, PhysicsUpdateContext::Step *ioStep, uint inSoftBodyIndex) const
+{
+	// The calling thread works on the phase too, so we only need helpers for the remaining batches
+	const SoftBodyUpdateContext &sb_ctx = ioContext->mSoftBodyUpdateContexts[inSoftBodyIndex];
+	int num_helpers = (int)min(sb_ctx.mMotionProperties->GetNumParallelTasks(sb_ctx), (uint)ioContext->GetMaxConcurrency()) - 1;
+	if (num_helpers <= 0)
+		return;
+
+	// Limit the number of helpers that are queued or running to the number of threads.
+	// More helpers cannot run at the same time and would only fill up the job queue, which can deadlock when all threads are waiting to queue a job.
+	// A helper returns its slot when it finishes, so later phases and soft bodies can use it again.
+	int max_in_flight = ioContext->GetMaxConcurrency() - 1;
+	int in_flight = ioContext->mSoftBodyHelpersInFlight.load(memory_order_relaxed);
 	do
 	{
-		// Reset status
-		status = 0;
+		if (in_flight >= max_in_flight)
+			return;
+		num_helpers = min(num_helpers, max_in_flight - in_flight);
+	}
+	while (!ioContext->mSoftBodyHelpersInFlight.compare_exchange_weak(in_flight, in_flight + num_helpers, memory_order_relaxed));
 
-		// Update all soft bodies
-		for (uint i = 0; i < num_soft_bodies; ++i)
-		{
-			// Fetch the soft body context
-			SoftBodyUpdateContext &sb_ctx = ioContext->mSoftBodyUpdateContexts[(start_idx + i) % num_soft_bodies];
+	// The finalize job needs to wait for the helpers too. The calling job still holds a dependency on it, so it cannot have started yet.
+	// Because of this dependency the helpers don't need to be added to the barrier, which would only free their entries after all earlier jobs finished.
+	ioStep->mSoftBodyFinalize.AddDependency(num_helpers);
 
-			// To avoid trashing the cache too much, we prefer to stick to one soft body until we cannot progress it any further
-			uint sb_status;
-			do
+	for (int i = 0; i < num_helpers; ++i)
+		ioContext->mJobSystem->CreateJob("SoftBodySimulateHelper", cColorSoftBodySimulate, [ioContext, ioStep, inSoftBodyIndex]()
 			{
-				sb_status = (uint)sb_ctx.mMotionProperties->ParallelUpdate(sb_ctx, mPhysicsSettings);
-				status |= sb_status;
-			} while (sb_status == (uint)SoftBodyMotionProperties::EStatus::DidWork);
-		}
+				ioContext->mPhysicsSystem->JobSoftBodySimulateHelper(ioContext, ioStep, inSoftBodyIndex);
 
-		// If we didn't perform any work, yield the thread so that something else can run
-		if (!(status & (uint)SoftBodyMotionProperties::EStatus::DidWork))
-			std::this_thread::yield();
-	}
-	while (status != (uint)SoftBodyMotionProperties::EStatus::Done);
+				ioContext->mSoftBodyHelpersInFlight.fetch_sub(1, memory_order_relaxed);
+				ioStep->mSoftBodyFinalize.RemoveDependency();
+			});
 }
 
 void PhysicsSystem::JobSoftBodyFinalize(PhysicsUpdateContext *ioContext)
@@ -2639,6 +2771,18 @@ void PhysicsSystem::SaveState(StateRecorder &inStream, EStateRecorderState inSta
 {
 	JPH_PROFILE_FUNCTION();
 
+	SaveStateInternal(inStream, inState, inFilter, nullptr);
+}
+
+void PhysicsSystem::SaveState(StateRecorder &inStream, JobSystem &inJobSystem, EStateRecorderState inState, const StateRecorderFilter *inFilter) const
+{
+	JPH_PROFILE_FUNCTION();
+
+	SaveStateInternal(inStream, inState, inFilter, &inJobSystem);
+}
+
+void PhysicsSystem::SaveStateInternal(StateRecorder &inStream, EStateRecorderState inState, const StateRecorderFilter *inFilter, JobSystem *inJobSystem) const
+{
 	inStream.Write(inState);
 
 	if (uint8(inState) & uint8(EStateRecorderState::Global))
@@ -2648,10 +2792,10 @@ void PhysicsSystem::SaveState(StateRecorder &inStream, EStateRecorderState inSta
 	}
 
 	if (uint8(inState) & uint8(EStateRecorderState::Bodies))
-		mBodyManager.SaveState(inStream, inFilter);
+		mBodyManager.SaveState(inStream, inFilter, inJobSystem);
 
 	if (uint8(inState) & uint8(EStateRecorderState::Contacts))
-		mContactManager.SaveState(inStream, inFilter);
+		mContactManager.SaveState(inStream, inFilter, inJobSystem);
 
 	if (uint8(inState) & uint8(EStateRecorderState::Constraints))
 		mConstraintManager.SaveState(inStream, inFilter);
@@ -2677,14 +2821,7 @@ bool PhysicsSystem::RestoreState(StateRecorder &inStream, const StateRecorderFil
 
 		// Update bounding boxes for all bodies in the broadphase
 		if (inStream.IsLastPart())
-		{
-			Array<BodyID> bodies;
-			for (const Body *b : mBodyManager.GetBodies())
-				if (BodyManager::sIsValidBodyPointer(b) && b->IsInBroadPhase())
-					bodies.push_back(b->GetID());
-			if (!bodies.empty())
-				mBroadPhase->NotifyBodiesAABBChanged(&bodies[0], (int)bodies.size());
-		}
+			NotifyAllBodiesAABBChanged();
 	}
 
 	if (uint8(state) & uint8(EStateRecorderState::Contacts))
@@ -2702,6 +2839,123 @@ bool PhysicsSystem::RestoreState(StateRecorder &inStream, const StateRecorderFil
 	return true;
 }
 
+bool PhysicsSystem::RestoreState(StateRecorderBuffer &inStream, JobSystem &inJobSystem, const StateRecorderFilter *inFilter)
+{
+	JPH_PROFILE_FUNCTION();
+
+	// Validation compares with the current state in the order in which it is stored, do it single threaded
+	if (inStream.IsValidating())
+		return RestoreState(static_cast<StateRecorder &>(inStream), inFilter);
+
+	EStateRecorderState state = EStateRecorderState::All;
+	inStream.Read(state);
+
+	if (uint8(state) & uint8(EStateRecorderState::Global))
+	{
+		inStream.Read(mPreviousStepDeltaTime);
+		inStream.Read(mGravity);
+	}
+
+	if (uint8(state) & uint8(EStateRecorderState::Bodies))
+	{
+		if (!mBodyManager.RestoreState(inStream, inJobSystem))
+			return false;
+
+		// Update bounding boxes for all bodies in the broadphase
+		if (inStream.IsLastPart())
+			NotifyAllBodiesAABBChanged();
+	}
+
+	if (uint8(state) & uint8(EStateRecorderState::Contacts))
+	{
+		if (!mContactManager.RestoreState(inStream, inFilter, inJobSystem))
+			return false;
+	}
+
+	// Constraints are usually few compared to bodies and contacts, restore them single threaded
+	if (uint8(state) & uint8(EStateRecorderState::Constraints))
+	{
+		if (!mConstraintManager.RestoreState(inStream))
+			return false;
+	}
+
+	return true;
+}
+
+void PhysicsSystem::NotifyAllBodiesAABBChanged()
+{
+	Array<BodyID> bodies;
+	for (const Body *b : mBodyManager.GetBodies())
+		if (BodyManager::sIsValidBodyPointer(b) && b->IsInBroadPhase())
+			bodies.push_back(b->GetID());
+	if (!bodies.empty())
+		mBroadPhase->NotifyBodiesAABBChanged(&bodies[0], (int)bodies.size());
+}
+
+void PhysicsSystem::SaveStateReference(DeltaStateReference &ioReference) const
+{
+	JPH_PROFILE_FUNCTION();
+
+	ioReference.Clear();
+
+	SaveState(ioReference.mState);
+	mBodyManager.SaveStateReference(ioReference);
+	mContactManager.SaveStateReference(ioReference);
+	mConstraintManager.SaveStateReference(ioReference);
+}
+
+void PhysicsSystem::SaveStateDelta(StateRecorder &inStream, const DeltaStateReference &inReference, const DeltaStateSettings &inSettings) const
+{
+	JPH_PROFILE_FUNCTION();
+
+	JPH_ASSERT(!inReference.IsEmpty());
+
+	inStream.Write(mPreviousStepDeltaTime);
+	inStream.Write(mGravity);
+
+	// Bodies, contacts and constraints that changed
+	mBodyManager.SaveStateDelta(inStream, inReference, inSettings);
+	mContactManager.SaveStateDelta(inStream, inReference);
+	mConstraintManager.SaveStateDelta(inStream, inReference);
+}
+
+bool PhysicsSystem::RestoreStateDelta(StateRecorder &inStream, DeltaStateReference &ioReference)
+{
+	JPH_PROFILE_FUNCTION();
+
+	JPH_ASSERT(!ioReference.IsEmpty());
+	JPH_ASSERT(inStream.IsLastPart());
+
+	// Restore the bodies of the reference
+	StateRecorderBuffer &reference = ioReference.mState;
+	reference.Rewind();
+	EStateRecorderState state = EStateRecorderState::None;
+	reference.Read(state);
+	JPH_ASSERT(state == EStateRecorderState::All);
+	reference.Read(mPreviousStepDeltaTime);
+	reference.Read(mGravity);
+	if (!mBodyManager.RestoreState(reference))
+		return false;
+
+	// Apply the changes to the bodies
+	inStream.Read(mPreviousStepDeltaTime);
+	inStream.Read(mGravity);
+	if (!mBodyManager.RestoreStateDelta(inStream))
+		return false;
+
+	// Update bounding boxes for all bodies in the broadphase
+	NotifyAllBodiesAABBChanged();
+
+	// Restore the contacts of the reference that didn't change, followed by the contacts from the delta
+	if (!mContactManager.RestoreStateDelta(inStream, ioReference))
+		return false;
+
+	// Restore the constraints of the reference and then the ones that changed
+	StateRecorderBuffer &reference_constraints = ioReference.mConstraintData;
+	reference_constraints.Rewind();
+	return mConstraintManager.RestoreState(reference_constraints) && mConstraintManager.RestoreState(inStream);
+}
+
 void PhysicsSystem::SaveBodyState(const Body &inBody, StateRecorder &inStream) const
 {
 	mBodyManager.SaveBodyState(inBody, inStream);
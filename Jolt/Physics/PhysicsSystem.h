@@ -18,6 +18,9 @@ JPH_NAMESPACE_BEGIN
 
 class JobSystem;
 class StateRecorder;
+class StateRecorderBuffer;
+class DeltaStateReference;
+class DeltaStateSettings;
 class TempAllocator;
 class PhysicsStepListener;
 class SoftBodyContactListener;
@@ -42,7 +45,8 @@ public:
 	/// @param inBroadPhaseLayerInterface Information on the mapping of object layers to broad phase layers. Since this is a virtual interface, the instance needs to stay alive during the lifetime of the PhysicsSystem.
 	/// @param inObjectVsBroadPhaseLayerFilter Filter callback function that is used to determine if an object layer collides with a broad phase layer. Since this is a virtual interface, the instance needs to stay alive during the lifetime of the PhysicsSystem.
 	/// @param inObjectLayerPairFilter Filter callback function that is used to determine if two object layers collide. Since this is a virtual interface, the instance needs to stay alive during the lifetime of the PhysicsSystem.
-	void						Init(uint inMaxBodies, uint inNumBodyMutexes, uint inMaxBodyPairs, uint inMaxContactConstraints, const BroadPhaseLayerInterface &inBroadPhaseLayerInterface, const ObjectVsBroadPhaseLayerFilter &inObjectVsBroadPhaseLayerFilter, const ObjectLayerPairFilter &inObjectLayerPairFilter);
+	/// @param inBroadPhaseType Which broadphase implementation to use.
+	void						Init(uint inMaxBodies, uint inNumBodyMutexes, uint inMaxBodyPairs, uint inMaxContactConstraints, const BroadPhaseLayerInterface &inBroadPhaseLayerInterface, const ObjectVsBroadPhaseLayerFilter &inObjectVsBroadPhaseLayerFilter, const ObjectLayerPairFilter &inObjectLayerPairFilter, EBroadPhaseType inBroadPhaseType = EBroadPhaseType::QuadTree);
 
 	/// Listener that is notified whenever a body is activated/deactivated
 	void						SetBodyActivationListener(BodyActivationListener *inListener) { mBodyManager.SetBodyActivationListener(inListener); }
@@ -67,8 +71,9 @@ public:
 	void						SetCombineRestitution(ContactConstraintManager::CombineFunction inCombineRestition) { mContactManager.SetCombineRestitution(inCombineRestition); }
 	ContactConstraintManager::CombineFunction GetCombineRestitution() const					{ return mContactManager.GetCombineRestitution(); }
 
-	/// Control the main constants of the physics simulation
-	void						SetPhysicsSettings(const PhysicsSettings &inSettings)		{ mPhysicsSettings = inSettings; }
+	/// Control the main constants of the physics simulation.
+	/// Should not be called while Update() is running as it passes the broad phase settings on to the broad phase.
+	void						SetPhysicsSettings(const PhysicsSettings &inSettings);
 	const PhysicsSettings &		GetPhysicsSettings() const									{ return mPhysicsSettings; }
 
 	/// Access to the body interface. This interface allows to to create / remove bodies and to change their properties.
@@ -125,6 +130,23 @@ public:
 	/// Restoring state for replay. Returns false if failed.
 	bool						RestoreState(StateRecorder &inStream, const StateRecorderFilter *inFilter = nullptr);
 
+	/// Saving state for replay, bodies and contacts are saved in parallel using inJobSystem. This produces the same data as the single threaded SaveState.
+	void						SaveState(StateRecorder &inStream, JobSystem &inJobSystem, EStateRecorderState inState = EStateRecorderState::All, const StateRecorderFilter *inFilter = nullptr) const;
+
+	/// Restoring state for replay, bodies and contacts are restored in parallel using inJobSystem so inFilter must be thread safe.
+	/// When inStream is validating this falls back to the single threaded RestoreState. Returns false if failed.
+	bool						RestoreState(StateRecorderBuffer &inStream, JobSystem &inJobSystem, const StateRecorderFilter *inFilter = nullptr);
+
+	/// Save the full state of the simulation as a reference for SaveStateDelta and RestoreStateDelta
+	void						SaveStateReference(DeltaStateReference &ioReference) const;
+
+	/// Save only the state that changed with respect to inReference: the bodies that changed (see DeltaStateSettings), the contacts
+	/// that were added, changed or removed and the constraints that changed. Bodies and constraints cannot be added or removed between saving the reference and the delta.
+	void						SaveStateDelta(StateRecorder &inStream, const DeltaStateReference &inReference, const DeltaStateSettings &inSettings) const;
+
+	/// Restore ioReference and apply the delta that was saved against it. Returns false if failed.
+	bool						RestoreStateDelta(StateRecorder &inStream, DeltaStateReference &ioReference);
+
 	/// Saving state of a single body.
 	void						SaveBodyState(const Body &inBody, StateRecorder &inStream) const;
 
@@ -152,6 +174,11 @@ public:
 	void						SetGravity(Vec3Arg inGravity)								{ mGravity = inGravity; }
 	Vec3						GetGravity() const											{ return mGravity; }
 
+	/// Get the hash of the state of all rigid bodies that were simulated during the last call to Update (0 if nothing was simulated).
+	/// Only calculated when PhysicsSettings::mCalculateStateHash is true. The hash is independent of the number of threads,
+	/// so when two systems simulate the same state deterministically they produce the same hash.
+	uint64						GetStateHash() const										{ return mStateHash.load(memory_order_relaxed); }
+
 	/// Returns a locking interface that won't actually lock the body. Use with great care!
 	inline const BodyLockInterfaceNoLock &	GetBodyLockInterfaceNoLock() const				{ return mBodyLockInterfaceNoLock; }
 
@@ -229,9 +256,25 @@ private:
 	void						JobSolvePositionConstraints(PhysicsUpdateContext *ioContext, PhysicsUpdateContext::Step *ioStep);
 	void						JobSoftBodyPrepare(PhysicsUpdateContext *ioContext, PhysicsUpdateContext::Step *ioStep);
 	void						JobSoftBodyCollide(PhysicsUpdateContext *ioContext) const;
-	void						JobSoftBodySimulate(PhysicsUpdateContext *ioContext, uint inThreadIndex) const;
+	void						JobSoftBodySimulate(PhysicsUpdateContext *ioContext, PhysicsUpdateContext::Step *ioStep) const;
+	void						JobSoftBodySimulateHelper(PhysicsUpdateContext *ioContext, PhysicsUpdateContext::Step *ioStep, uint inSoftBodyIndex) const;
 	void						JobSoftBodyFinalize(PhysicsUpdateContext *ioContext);
 
+	/// Save the state, using multiple jobs when inJobSystem is not null
+	void						SaveStateInternal(StateRecorder &inStream, EStateRecorderState inState, const StateRecorderFilter *inFilter, JobSystem *inJobSystem) const;
+
+	/// Update the bounding boxes of all bodies in the broadphase after their state has been restored
+	void						NotifyAllBodiesAABBChanged();
+
+	/// Pass the broad phase related members of mPhysicsSettings on to the broad phase
+	void						ApplyBroadPhaseSettings();
+
+	/// Progress a soft body until no more work can be done on it by this thread, spawns helper jobs when a new phase of the update starts
+	void						SimulateSoftBody(PhysicsUpdateContext *ioContext, PhysicsUpdateContext::Step *ioStep, uint inSoftBodyIndex) const;
+
+	/// Spawn jobs that help processing the current phase of the update of a soft body in parallel
+	void						SpawnSoftBodyHelpers(PhysicsUpdateContext *ioContext, PhysicsUpdateContext::Step *ioStep, uint inSoftBodyIndex) const;
+
 	/// Tries to spawn a new FindCollisions job if max concurrency hasn't been reached yet
 	void						TrySpawnJobFindCollisions(PhysicsUpdateContext::Step *ioStep) const;
 
@@ -321,6 +364,12 @@ private:
 
 	/// Previous frame's delta time of one sub step to allow scaling previous frame's constraint impulses
 	float						mPreviousStepDeltaTime = 0.0f;
+
+	/// Delta time of each soft body that is simulated this step, used by JobSoftBodyPrepare. Kept between steps so that it only allocates when the number of soft bodies grows.
+	Array<float>				mSoftBodyDeltaTimes;
+
+	/// Hash of the state after the last update, see GetStateHash. Islands are added to it in any order so the hashes of the islands are summed.
+	atomic<uint64>				mStateHash { 0 };
 };
 
 JPH_NAMESPACE_END
@@ -167,6 +167,8 @@ public:
 	uint					mNumSoftBodies;											///< Number of active soft bodies in the simulation
 	SoftBodyUpdateContext *	mSoftBodyUpdateContexts = nullptr;						///< Contexts for updating soft bodies
 	atomic<uint>			mSoftBodyToCollide { 0 };								///< Next soft body to take when running SoftBodyCollide jobs
+	atomic<uint>			mSoftBodyToSimulate { 0 };								///< Next soft body to start when running SoftBodySimulate jobs
+	atomic<int>				mSoftBodyHelpersInFlight { 0 };							///< Number of SoftBodySimulateHelper jobs that have been spawned but have not finished yet
 };
 
 JPH_NAMESPACE_END
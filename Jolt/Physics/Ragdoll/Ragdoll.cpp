@@ -36,8 +36,12 @@ JPH_IMPLEMENT_SERIALIZABLE_NON_VIRTUAL(RagdollSettings)
 	JPH_ADD_ATTRIBUTE(RagdollSettings, mSkeleton)
 	JPH_ADD_ATTRIBUTE(RagdollSettings, mParts)
 	JPH_ADD_ATTRIBUTE(RagdollSettings, mAdditionalConstraints)
+	JPH_ADD_ATTRIBUTE(RagdollSettings, mUseArticulationConstraint)
 }
 
+/// Identifies the data written by RagdollSettings::SaveBinaryState
+static constexpr uint32 cBinaryStateMagic = 0x4452504a; // 'JPRD'
+
 static inline BodyInterface &sGetBodyInterface(PhysicsSystem *inSystem, bool inLockBodies)
 {
 	return inLockBodies? inSystem->GetBodyInterface() : inSystem->GetBodyInterfaceNoLock();
@@ -262,6 +266,10 @@ void RagdollSettings::SaveBinaryState(StreamOut &inStream, bool inSaveShapes, bo
 	BodyCreationSettings::MaterialToIDMap material_to_id;
 	BodyCreationSettings::GroupFilterToIDMap group_filter_to_id;
 
+	// Save header, streams saved before the header was introduced start with the number of joints of the skeleton which never matches the magic value
+	inStream.Write(cBinaryStateMagic);
+	inStream.Write(cBinaryStateVersion);
+
 	// Save skeleton
 	mSkeleton->SaveBinaryState(inStream);
 
@@ -288,12 +296,30 @@ void RagdollSettings::SaveBinaryState(StreamOut &inStream, bool inSaveShapes, bo
 		// Save constraint
 		c.mConstraint->SaveBinaryState(inStream);
 	}
+
+	// Save flags
+	inStream.Write(mUseArticulationConstraint);
 }
 
 RagdollSettings::RagdollResult RagdollSettings::sRestoreFromBinaryState(StreamIn &inStream)
 {
 	RagdollResult result;
 
+	// Read header
+	uint32 magic = 0, version = 0;
+	inStream.Read(magic);
+	inStream.Read(version);
+	if (inStream.IsEOF() || inStream.IsFailed() || magic != cBinaryStateMagic)
+	{
+		result.SetError("Not a ragdoll binary state or saved with an older version");
+		return result;
+	}
+	if (version != cBinaryStateVersion)
+	{
+		result.SetError("Ragdoll binary state was saved with an incompatible version");
+		return result;
+	}
+
 	// Restore skeleton
 	Skeleton::SkeletonResult skeleton_result = Skeleton::sRestoreFromBinaryState(inStream);
 	if (skeleton_result.HasError())
@@ -364,6 +390,9 @@ RagdollSettings::RagdollResult RagdollSettings::sRestoreFromBinaryState(StreamIn
 		c.mConstraint = DynamicCast<TwoBodyConstraintSettings>(constraint_result.Get());
 	}
 
+	// Read flags
+	inStream.Read(ragdoll->mUseArticulationConstraint);
+
 	// Create mapping tables
 	ragdoll->CalculateBodyIndexToConstraintIndex();
 	ragdoll->CalculateConstraintIndexToBodyIdxPair();
@@ -382,6 +411,8 @@ Ragdoll *RagdollSettings::CreateRagdoll(CollisionGroup::GroupID inCollisionGroup
 	// Create bodies and constraints
 	BodyInterface &bi = inSystem->GetBodyInterface();
 	Body **bodies = (Body **)JPH_STACK_ALLOC(mParts.size() * sizeof(Body *));
+	int *parent_indices = (int *)JPH_STACK_ALLOC(mParts.size() * sizeof(int));
+	const TwoBodyConstraint **joints = (const TwoBodyConstraint **)JPH_STACK_ALLOC(mParts.size() * sizeof(TwoBodyConstraint *));
 	int joint_idx = 0;
 	for (const Part &p : mParts)
 	{
@@ -399,10 +430,13 @@ Ragdoll *RagdollSettings::CreateRagdoll(CollisionGroup::GroupID inCollisionGroup
 		bodies[joint_idx] = body2;
 
 		// Create constraint
+		parent_indices[joint_idx] = mSkeleton->GetJoint(joint_idx).mParentJointIndex;
+		joints[joint_idx] = nullptr;
 		if (p.mToParent != nullptr)
 		{
-			Body *body1 = bodies[mSkeleton->GetJoint(joint_idx).mParentJointIndex];
+			Body *body1 = bodies[parent_indices[joint_idx]];
 			r->mConstraints.push_back(p.mToParent->Create(*body1, *body2));
+			joints[joint_idx] = r->mConstraints.back();
 		}
 
 		// Store body ID and constraint in parallel arrays
@@ -419,6 +453,10 @@ Ragdoll *RagdollSettings::CreateRagdoll(CollisionGroup::GroupID inCollisionGroup
 		r->mConstraints.push_back(c.mConstraint->Create(*body1, *body2));
 	}
 
+	// Create the constraint that solves the tree of bodies exactly
+	if (mUseArticulationConstraint)
+		r->mArticulationConstraint = new ArticulationConstraint(bodies, parent_indices, joints, (uint)mParts.size());
+
 	return r;
 }
 
@@ -483,11 +521,15 @@ void Ragdoll::AddToPhysicsSystem(EActivation inActivationMode, bool inLockBodies
 
 	// Add all constraints
 	mSystem->AddConstraints((Constraint **)mConstraints.data(), (int)mConstraints.size());
+	if (mArticulationConstraint != nullptr)
+		mSystem->AddConstraint(mArticulationConstraint);
 }
 
 void Ragdoll::RemoveFromPhysicsSystem(bool inLockBodies)
 {
 	// Remove all constraints before removing the bodies
+	if (mArticulationConstraint != nullptr)
+		mSystem->RemoveConstraint(mArticulationConstraint);
 	mSystem->RemoveConstraints((Constraint **)mConstraints.data(), (int)mConstraints.size());
 
 	// Scope for JPH_STACK_ALLOC
@@ -8,6 +8,7 @@
 #include <Jolt/Core/Result.h>
 #include <Jolt/Physics/Body/BodyCreationSettings.h>
 #include <Jolt/Physics/Constraints/TwoBodyConstraint.h>
+#include <Jolt/Physics/Constraints/ArticulationConstraint.h>
 #include <Jolt/Skeleton/Skeleton.h>
 #include <Jolt/Skeleton/SkeletonPose.h>
 #include <Jolt/Physics/EActivation.h>
@@ -47,6 +48,9 @@ public:
 	/// @param inSaveGroupFilter If the group filter should be saved as well (these could be shared)
 	void								SaveBinaryState(StreamOut &inStream, bool inSaveShapes, bool inSaveGroupFilter) const;
 
+	/// Version of the binary state, this is increased when the layout of the data written by SaveBinaryState changes
+	static constexpr uint32				cBinaryStateVersion = 1;
+
 	using RagdollResult = Result<Ref<RagdollSettings>>;
 
 	/// Restore a saved ragdoll from inStream
@@ -119,6 +123,10 @@ public:
 	/// A list of constraints that connects two bodies in a ragdoll (for non parent child related constraints)
 	AdditionalConstraintVector			mAdditionalConstraints;
 
+	/// If an ArticulationConstraint should be created that solves the attachment points of the parent child constraints exactly.
+	/// This keeps long chains of bodies from stretching with only a few solver iterations, see ArticulationConstraint.
+	bool								mUseArticulationConstraint = false;
+
 private:
 	/// Table that maps a body index (index in mBodyIDs) to the constraint index with which it is connected to its parent. -1 if there is no constraint associated with the body.
 	Array<int>							mBodyIndexToConstraintIndex;
@@ -214,6 +222,9 @@ public:
 	/// Access a constraint by index
 	const TwoBodyConstraint *			GetConstraint(int inConstraintIndex) const				{ return mConstraints[inConstraintIndex]; }
 
+	/// Access the constraint that solves the attachment points of the ragdoll exactly (null if RagdollSettings::mUseArticulationConstraint is false)
+	ArticulationConstraint *			GetArticulationConstraint() const						{ return mArticulationConstraint; }
+
 	/// Get world space bounding box for all bodies of the ragdoll
 	AABox								GetWorldSpaceBounds(bool inLockBodies = true) const;
 
@@ -224,6 +235,9 @@ private:
 	/// For RagdollSettings::CreateRagdoll function
 	friend class RagdollSettings;
 
+	/// For accessing the bodies of many ragdolls in parallel
+	friend class RagdollBatchDriver;
+
 	/// The settings that created this ragdoll
 	RefConst<RagdollSettings>			mRagdollSettings;
 
@@ -233,6 +247,9 @@ private:
 	/// Array of constraints that connect the bodies together
 	Array<Ref<TwoBodyConstraint>>		mConstraints;
 
+	/// Constraint that solves the parent child constraints exactly (optional)
+	Ref<ArticulationConstraint>			mArticulationConstraint;
+
 	/// Cached physics system
 	PhysicsSystem *						mSystem;
 };
@@ -0,0 +1,90 @@
+// Jolt Physics Library (https://github.com/jrouwe/JoltPhysics)
+// SPDX-FileCopyrightText: 2024 Jorrit Rouwe
+// SPDX-License-Identifier: MIT
+
+#include <Jolt/Jolt.h>
+
+#include <Jolt/Physics/Ragdoll/RagdollBatchDriver.h>
+#include <Jolt/Physics/PhysicsSystem.h>
+#include <Jolt/Core/JobBatches.h>
+#include <Jolt/Core/Profiler.h>
+
+JPH_NAMESPACE_BEGIN
+
+void RagdollBatchDriver::DriveToPoseUsingKinematics(Ragdoll *const *inRagdolls, const SkeletonPose *const *inPoses, uint inNumRagdolls, float inDeltaTime, JobSystem &inJobSystem)
+{
+	JPH_PROFILE_FUNCTION();
+
+	if (inNumRagdolls == 0)
+		return;
+
+	PhysicsSystem *system = inRagdolls[0]->mSystem;
+
+	// Reserve a slot for every body so that every ragdoll knows where to store the bodies that it wants to activate
+	mFirstBody.resize(inNumRagdolls);
+	uint num_bodies = 0;
+	for (uint r = 0; r < inNumRagdolls; ++r)
+	{
+		JPH_ASSERT(inRagdolls[r]->mSystem == system, "All ragdolls must belong to the same physics system");
+		mFirstBody[r] = num_bodies;
+		num_bodies += uint(inRagdolls[r]->mBodyIDs.size());
+	}
+	mBodiesToActivate.resize(num_bodies);
+
+	// Move the bodies, the bodies of different ragdolls are disjoint so we can access them without locking
+	const BodyLockInterfaceNoLock &lock_interface = system->GetBodyLockInterfaceNoLock();
+	JobBatches::sRun(inNumRagdolls, cRagdollsPerBatch, "DriveToPoseUsingKinematics", inJobSystem, [this, inRagdolls, inPoses, inDeltaTime, &lock_interface](uint, uint inBegin, uint inEnd)
+	{
+		for (uint r = inBegin; r < inEnd; ++r)
+		{
+			const Ragdoll *ragdoll = inRagdolls[r];
+			const SkeletonPose &pose = *inPoses[r];
+			JPH_ASSERT(pose.GetSkeleton() == ragdoll->mRagdollSettings->mSkeleton);
+
+			RVec3 root_offset = pose.GetRootOffset();
+			const Mat44 *joint_matrices = pose.GetJointMatrices().data();
+			BodyID *bodies_to_activate = mBodiesToActivate.data() + mFirstBody[r];
+			for (int i = 0; i < (int)ragdoll->mBodyIDs.size(); ++i)
+			{
+				BodyID body_id = ragdoll->mBodyIDs[i];
+				bodies_to_activate[i] = BodyID();
+
+				Body *body = lock_interface.TryGetBody(body_id);
+				if (body != nullptr)
+				{
+					const Mat44 &joint = joint_matrices[i];
+					body->MoveKinematic(root_offset + joint.GetTranslation(), joint.GetQuaternion(), inDeltaTime);
+
+					// Activating modifies the active body list, defer it until all jobs are done
+					if (!body->IsActive() && (!body->GetLinearVelocity().IsNearZero() || !body->GetAngularVelocity().IsNearZero()))
+						bodies_to_activate[i] = body_id;
+				}
+			}
+		}
+	});
+
+	// Remove the bodies that don't need activation
+	BodyID *bodies_to_activate_end = mBodiesToActivate.data();
+	for (const BodyID &body_id : mBodiesToActivate)
+		if (!body_id.IsInvalid())
+			*bodies_to_activate_end++ = body_id;
+
+	// Activate all bodies at once, in the same order as they would have been activated when driving the ragdolls one by one
+	int num_bodies_to_activate = int(bodies_to_activate_end - mBodiesToActivate.data());
+	if (num_bodies_to_activate > 0)
+		system->GetBodyInterfaceNoLock().ActivateBodies(mBodiesToActivate.data(), num_bodies_to_activate);
+}
+
+void RagdollBatchDriver::DriveToPoseUsingMotors(Ragdoll *const *inRagdolls, const SkeletonPose *const *inPoses, uint inNumRagdolls, JobSystem &inJobSystem)
+{
+	JPH_PROFILE_FUNCTION();
+
+	// Setting the motor targets only touches the constraints of the ragdoll itself
+	JobBatches::sRun(inNumRagdolls, cRagdollsPerBatch, "DriveToPoseUsingMotors", inJobSystem, [inRagdolls, inPoses](uint, uint inBegin, uint inEnd)
+	{
+		for (uint r = inBegin; r < inEnd; ++r)
+			inRagdolls[r]->DriveToPoseUsingMotors(*inPoses[r]);
+	});
+}
+
+JPH_NAMESPACE_END
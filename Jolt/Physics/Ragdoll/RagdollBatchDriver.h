@@ -0,0 +1,49 @@
+// Jolt Physics Library (https://github.com/jrouwe/JoltPhysics)
+// SPDX-FileCopyrightText: 2024 Jorrit Rouwe
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <Jolt/Physics/Ragdoll/Ragdoll.h>
+
+JPH_NAMESPACE_BEGIN
+
+class JobSystem;
+
+/// Drives the poses of many ragdolls in parallel on the job system.
+///
+/// The ragdolls are split in batches that are processed by separate jobs. Bodies are accessed through the non-locking body interface,
+/// which is safe because every body belongs to exactly one ragdoll. Bodies that need to be woken up are collected and activated with a
+/// single call after all jobs have finished, in the order in which the ragdolls were passed in, so the result is the same as calling
+/// Ragdoll::DriveToPoseUsingKinematics for every ragdoll one after another.
+///
+/// Note that while driving the ragdolls the physics system cannot be updated and the bodies of the ragdolls cannot be modified from other threads.
+class JPH_EXPORT RagdollBatchDriver : public NonCopyable
+{
+public:
+	JPH_OVERRIDE_NEW_DELETE
+
+	/// Number of ragdolls that are processed by a job before it fetches the next batch
+	static constexpr uint		cRagdollsPerBatch = 16;
+
+	/// Calls Ragdoll::DriveToPoseUsingKinematics for a list of ragdolls. All ragdolls must belong to the same PhysicsSystem.
+	/// @param inRagdolls List of ragdolls to drive
+	/// @param inPoses For each ragdoll the pose to drive to (joint matrices must have been calculated)
+	/// @param inNumRagdolls Number of ragdolls in inRagdolls and inPoses
+	/// @param inDeltaTime Time in which the ragdolls should reach the pose
+	/// @param inJobSystem The job system that is used to drive the ragdolls in parallel
+	void						DriveToPoseUsingKinematics(Ragdoll *const *inRagdolls, const SkeletonPose *const *inPoses, uint inNumRagdolls, float inDeltaTime, JobSystem &inJobSystem);
+
+	/// Calls Ragdoll::DriveToPoseUsingMotors for a list of ragdolls.
+	/// @param inRagdolls List of ragdolls to drive
+	/// @param inPoses For each ragdoll the pose to drive to
+	/// @param inNumRagdolls Number of ragdolls in inRagdolls and inPoses
+	/// @param inJobSystem The job system that is used to drive the ragdolls in parallel
+	void						DriveToPoseUsingMotors(Ragdoll *const *inRagdolls, const SkeletonPose *const *inPoses, uint inNumRagdolls, JobSystem &inJobSystem);
+
+private:
+	Array<uint>					mFirstBody;								///< For each ragdoll the index of its first body in mBodiesToActivate
+	Array<BodyID>				mBodiesToActivate;						///< For each body of each ragdoll the body ID if it needs to be activated or an invalid ID if not
+};
+
+JPH_NAMESPACE_END
@@ -20,6 +20,64 @@ JPH_NAMESPACE_BEGIN
 
 using namespace JPH::literals;
 
+/// 4 vectors stored as separate X, Y and Z components so that 4 constraints can be solved at the same time using SIMD
+struct SoftBodyVec3x4
+{
+	/// Load the positions of 4 vertices
+	static JPH_INLINE SoftBodyVec3x4 sGatherPositions(const SoftBodyVertex *inVertices, UVec4Arg inIndices)
+	{
+		Mat44 m = Mat44(Vec4(inVertices[inIndices.GetX()].mPosition, 0),
+						Vec4(inVertices[inIndices.GetY()].mPosition, 0),
+						Vec4(inVertices[inIndices.GetZ()].mPosition, 0),
+						Vec4(inVertices[inIndices.GetW()].mPosition, 0)).Transposed();
+		return { m.GetColumn4(0), m.GetColumn4(1), m.GetColumn4(2) };
+	}
+
+	/// Store the positions of 4 vertices
+	JPH_INLINE void			ScatterPositions(SoftBodyVertex *ioVertices, UVec4Arg inIndices) const
+	{
+		Mat44 m = Mat44(mX, mY, mZ, Vec4::sZero()).Transposed();
+		ioVertices[inIndices.GetX()].mPosition = Vec3(m.GetColumn4(0));
+		ioVertices[inIndices.GetY()].mPosition = Vec3(m.GetColumn4(1));
+		ioVertices[inIndices.GetZ()].mPosition = Vec3(m.GetColumn4(2));
+		ioVertices[inIndices.GetW()].mPosition = Vec3(m.GetColumn4(3));
+	}
+
+	/// Component wise select, when inControl has its high bit set use inSet, otherwise use inNotSet
+	static JPH_INLINE SoftBodyVec3x4 sSelect(const SoftBodyVec3x4 &inNotSet, const SoftBodyVec3x4 &inSet, UVec4Arg inControl)
+	{
+		return { Vec4::sSelect(inNotSet.mX, inSet.mX, inControl), Vec4::sSelect(inNotSet.mY, inSet.mY, inControl), Vec4::sSelect(inNotSet.mZ, inSet.mZ, inControl) };
+	}
+
+	JPH_INLINE SoftBodyVec3x4 operator + (const SoftBodyVec3x4 &inRHS) const	{ return { mX + inRHS.mX, mY + inRHS.mY, mZ + inRHS.mZ }; }
+	JPH_INLINE SoftBodyVec3x4 operator - (const SoftBodyVec3x4 &inRHS) const	{ return { mX - inRHS.mX, mY - inRHS.mY, mZ - inRHS.mZ }; }
+	JPH_INLINE SoftBodyVec3x4 operator - () const								{ return { -mX, -mY, -mZ }; }
+	JPH_INLINE SoftBodyVec3x4 operator * (Vec4Arg inRHS) const					{ return { mX * inRHS, mY * inRHS, mZ * inRHS }; }
+	JPH_INLINE SoftBodyVec3x4 operator / (Vec4Arg inRHS) const					{ return { mX / inRHS, mY / inRHS, mZ / inRHS }; }
+	JPH_INLINE Vec4			Dot(const SoftBodyVec3x4 &inRHS) const				{ return mX * inRHS.mX + mY * inRHS.mY + mZ * inRHS.mZ; }
+	JPH_INLINE Vec4			LengthSq() const									{ return Dot(*this); }
+	JPH_INLINE SoftBodyVec3x4 Cross(const SoftBodyVec3x4 &inRHS) const			{ return { mY * inRHS.mZ - mZ * inRHS.mY, mZ * inRHS.mX - mX * inRHS.mZ, mX * inRHS.mY - mY * inRHS.mX }; }
+
+	Vec4					mX;
+	Vec4					mY;
+	Vec4					mZ;
+};
+
+/// Load the inverse masses of 4 vertices
+static JPH_INLINE Vec4 sGatherInvMass(const SoftBodyVertex *inVertices, UVec4Arg inIndices)
+{
+	return Vec4(inVertices[inIndices.GetX()].mInvMass, inVertices[inIndices.GetY()].mInvMass, inVertices[inIndices.GetZ()].mInvMass, inVertices[inIndices.GetW()].mInvMass);
+}
+
+/// Returns a mask that is true when inV1[i] == inV2[j] for any i != j, used to check if 4 constraints share a vertex
+static JPH_INLINE UVec4 sEqualsOtherLane(UVec4Arg inV1, UVec4Arg inV2)
+{
+	return UVec4::sOr(UVec4::sOr(
+		UVec4::sEquals(inV1, inV2.Swizzle<SWIZZLE_Y, SWIZZLE_Z, SWIZZLE_W, SWIZZLE_X>()),
+		UVec4::sEquals(inV1, inV2.Swizzle<SWIZZLE_Z, SWIZZLE_W, SWIZZLE_X, SWIZZLE_Y>())),
+		UVec4::sEquals(inV1, inV2.Swizzle<SWIZZLE_W, SWIZZLE_X, SWIZZLE_Y, SWIZZLE_Z>()));
+}
+
 void SoftBodyMotionProperties::CalculateMassAndInertia()
 {
 	MassProperties mp;
@@ -81,6 +139,9 @@ void SoftBodyMotionProperties::Initialize(const SoftBodyCreationSettings &inSett
 	if (!inSettings.mSettings->mSkinnedConstraints.empty())
 		mSkinState.resize(mVertices.size());
 
+	// Build the hierarchy for self collision
+	mSelfCollision.Initialize(*mSettings, mVertices);
+
 	// We don't know delta time yet, so we can't predict the bounds and use the local bounds as the predicted bounds
 	mLocalPredictedBounds = mLocalBounds;
 
@@ -310,89 +371,185 @@ void SoftBodyMotionProperties::ApplyDihedralBendConstraints(const SoftBodyUpdate
 
 	float inv_dt_sq = 1.0f / Square(inContext.mSubStepDeltaTime);
 
-	for (const DihedralBend *b = mSettings->mDihedralBendConstraints.data() + inStartIndex, *b_end = mSettings->mDihedralBendConstraints.data() + inEndIndex; b < b_end; ++b)
+	for (const DihedralBend *b = mSettings->mDihedralBendConstraints.data() + inStartIndex, *b_end = mSettings->mDihedralBendConstraints.data() + inEndIndex; b < b_end; )
 	{
-		Vertex &v0 = mVertices[b->mVertex[0]];
-		Vertex &v1 = mVertices[b->mVertex[1]];
-		Vertex &v2 = mVertices[b->mVertex[2]];
-		Vertex &v3 = mVertices[b->mVertex[3]];
-
-		// Get positions
-		Vec3 x0 = v0.mPosition;
-		Vec3 x1 = v1.mPosition;
-		Vec3 x2 = v2.mPosition;
-		Vec3 x3 = v3.mPosition;
-
-		/*
-		   x2
-		e1/  \e3
-		 /    \
-		x0----x1
-		 \ e0 /
-		e2\  /e4
-		   x3
-		*/
-
-		// Calculate the shared edge of the triangles
-		Vec3 e = x1 - x0;
-		float e_len = e.Length();
-		if (e_len < 1.0e-6f)
-			continue;
+		if (mEnableSIMDConstraints && b_end - b >= 4)
+		{
+			// Get the vertex indices of the next 4 constraints
+			UVec4 i0(b[0].mVertex[0], b[1].mVertex[0], b[2].mVertex[0], b[3].mVertex[0]);
+			UVec4 i1(b[0].mVertex[1], b[1].mVertex[1], b[2].mVertex[1], b[3].mVertex[1]);
+			UVec4 i2(b[0].mVertex[2], b[1].mVertex[2], b[2].mVertex[2], b[3].mVertex[2]);
+			UVec4 i3(b[0].mVertex[3], b[1].mVertex[3], b[2].mVertex[3], b[3].mVertex[3]);
+
+			// If the constraints don't share any vertices, we can solve them at the same time
+			UVec4 shared = UVec4::sOr(UVec4::sOr(sEqualsOtherLane(i0, i0), sEqualsOtherLane(i1, i1)), UVec4::sOr(sEqualsOtherLane(i2, i2), sEqualsOtherLane(i3, i3)));
+			shared = UVec4::sOr(shared, UVec4::sOr(UVec4::sOr(sEqualsOtherLane(i0, i1), sEqualsOtherLane(i0, i2)), sEqualsOtherLane(i0, i3)));
+			shared = UVec4::sOr(shared, UVec4::sOr(UVec4::sOr(sEqualsOtherLane(i1, i2), sEqualsOtherLane(i1, i3)), sEqualsOtherLane(i2, i3)));
+			if (!shared.TestAnyTrue())
+			{
+				ApplyDihedralBendConstraints4(b, inv_dt_sq, i0, i1, i2, i3);
+				b += 4;
+				continue;
+			}
+		}
 
-		// Calculate the normals of the triangles
-		Vec3 x1x2 = x2 - x1;
-		Vec3 x1x3 = x3 - x1;
-		Vec3 n1 = (x2 - x0).Cross(x1x2);
-		Vec3 n2 = x1x3.Cross(x3 - x0);
-		float n1_len_sq = n1.LengthSq();
-		float n2_len_sq = n2.LengthSq();
-		float n1_len_sq_n2_len_sq = n1_len_sq * n2_len_sq;
-		if (n1_len_sq_n2_len_sq < 1.0e-24f)
-			continue;
+		// Solve a single constraint
+		ApplyDihedralBendConstraint(*b, inv_dt_sq);
+		++b;
+	}
+}
 
-		// Calculate constraint equation
-		// As per "Strain Based Dynamics" Appendix A we need to negate the gradients when (n1 x n2) . e > 0, instead we make sure that the sign of the constraint equation is correct
-		float sign = Sign(n2.Cross(n1).Dot(e));
-		float d = n1.Dot(n2) / sqrt(n1_len_sq_n2_len_sq);
-		float c = sign * ACosApproximate(d) - b->mInitialAngle;
+void SoftBodyMotionProperties::ApplyDihedralBendConstraint(const DihedralBend &inConstraint, float inInvDtSq)
+{
+	Vertex &v0 = mVertices[inConstraint.mVertex[0]];
+	Vertex &v1 = mVertices[inConstraint.mVertex[1]];
+	Vertex &v2 = mVertices[inConstraint.mVertex[2]];
+	Vertex &v3 = mVertices[inConstraint.mVertex[3]];
+
+	// Get positions
+	Vec3 x0 = v0.mPosition;
+	Vec3 x1 = v1.mPosition;
+	Vec3 x2 = v2.mPosition;
+	Vec3 x3 = v3.mPosition;
+
+	/*
+	   x2
+	e1/  \e3
+	 /    \
+	x0----x1
+	 \ e0 /
+	e2\  /e4
+	   x3
+	*/
+
+	// Calculate the shared edge of the triangles
+	Vec3 e = x1 - x0;
+	float e_len = e.Length();
+	if (e_len < 1.0e-6f)
+		return;
 
-		// Ensure the range is -PI to PI
-		if (c > JPH_PI)
-			c -= 2.0f * JPH_PI;
-		else if (c < -JPH_PI)
-			c += 2.0f * JPH_PI;
+	// Calculate the normals of the triangles
+	Vec3 x1x2 = x2 - x1;
+	Vec3 x1x3 = x3 - x1;
+	Vec3 n1 = (x2 - x0).Cross(x1x2);
+	Vec3 n2 = x1x3.Cross(x3 - x0);
+	float n1_len_sq = n1.LengthSq();
+	float n2_len_sq = n2.LengthSq();
+	float n1_len_sq_n2_len_sq = n1_len_sq * n2_len_sq;
+	if (n1_len_sq_n2_len_sq < 1.0e-24f)
+		return;
 
-		// Calculate gradient of constraint equation
-		// Taken from "Strain Based Dynamics" - Matthias Muller et al. (Appendix A)
-		// with p1 = x2, p2 = x3, p3 = x0 and p4 = x1
-		// which in turn is based on "Simulation of Clothing with Folds and Wrinkles" - R. Bridson et al. (Section 4)
-		n1 /= n1_len_sq;
-		n2 /= n2_len_sq;
-		Vec3 d0c = (x1x2.Dot(e) * n1 + x1x3.Dot(e) * n2) / e_len;
-		Vec3 d2c = e_len * n1;
-		Vec3 d3c = e_len * n2;
-
-		// The sum of the gradients must be zero (see "Strain Based Dynamics" section 4)
-		Vec3 d1c = -d0c - d2c - d3c;
+	// Calculate constraint equation
+	// As per "Strain Based Dynamics" Appendix A we need to negate the gradients when (n1 x n2) . e > 0, instead we make sure that the sign of the constraint equation is correct
+	float sign = Sign(n2.Cross(n1).Dot(e));
+	float d = n1.Dot(n2) / sqrt(n1_len_sq_n2_len_sq);
+	float c = sign * ACosApproximate(d) - inConstraint.mInitialAngle;
+
+	// Ensure the range is -PI to PI
+	if (c > JPH_PI)
+		c -= 2.0f * JPH_PI;
+	else if (c < -JPH_PI)
+		c += 2.0f * JPH_PI;
+
+	// Calculate gradient of constraint equation
+	// Taken from "Strain Based Dynamics" - Matthias Muller et al. (Appendix A)
+	// with p1 = x2, p2 = x3, p3 = x0 and p4 = x1
+	// which in turn is based on "Simulation of Clothing with Folds and Wrinkles" - R. Bridson et al. (Section 4)
+	n1 /= n1_len_sq;
+	n2 /= n2_len_sq;
+	Vec3 d0c = (x1x2.Dot(e) * n1 + x1x3.Dot(e) * n2) / e_len;
+	Vec3 d2c = e_len * n1;
+	Vec3 d3c = e_len * n2;
+
+	// The sum of the gradients must be zero (see "Strain Based Dynamics" section 4)
+	Vec3 d1c = -d0c - d2c - d3c;
+
+	// Get masses
+	float w0 = v0.mInvMass;
+	float w1 = v1.mInvMass;
+	float w2 = v2.mInvMass;
+	float w3 = v3.mInvMass;
+
+	// Calculate -lambda
+	float denom = w0 * d0c.LengthSq() + w1 * d1c.LengthSq() + w2 * d2c.LengthSq() + w3 * d3c.LengthSq() + inConstraint.mCompliance * inInvDtSq;
+	if (denom < 1.0e-12f)
+		return;
+	float minus_lambda = c / denom;
 
-		// Get masses
-		float w0 = v0.mInvMass;
-		float w1 = v1.mInvMass;
-		float w2 = v2.mInvMass;
-		float w3 = v3.mInvMass;
+	// Apply correction
+	v0.mPosition = x0 - minus_lambda * w0 * d0c;
+	v1.mPosition = x1 - minus_lambda * w1 * d1c;
+	v2.mPosition = x2 - minus_lambda * w2 * d2c;
+	v3.mPosition = x3 - minus_lambda * w3 * d3c;
+}
 
-		// Calculate -lambda
-		float denom = w0 * d0c.LengthSq() + w1 * d1c.LengthSq() + w2 * d2c.LengthSq() + w3 * d3c.LengthSq() + b->mCompliance * inv_dt_sq;
-		if (denom < 1.0e-12f)
-			continue;
-		float minus_lambda = c / denom;
+void SoftBodyMotionProperties::ApplyDihedralBendConstraints4(const DihedralBend *inConstraints, float inInvDtSq, UVec4Arg inV0, UVec4Arg inV1, UVec4Arg inV2, UVec4Arg inV3)
+{
+	// Note that this is the same algorithm as ApplyDihedralBendConstraint but operating on 4 constraints at the same time
+	Vertex *vertices = mVertices.data();
 
-		// Apply correction
-		v0.mPosition = x0 - minus_lambda * w0 * d0c;
-		v1.mPosition = x1 - minus_lambda * w1 * d1c;
-		v2.mPosition = x2 - minus_lambda * w2 * d2c;
-		v3.mPosition = x3 - minus_lambda * w3 * d3c;
-	}
+	// Get positions
+	SoftBodyVec3x4 x0 = SoftBodyVec3x4::sGatherPositions(vertices, inV0);
+	SoftBodyVec3x4 x1 = SoftBodyVec3x4::sGatherPositions(vertices, inV1);
+	SoftBodyVec3x4 x2 = SoftBodyVec3x4::sGatherPositions(vertices, inV2);
+	SoftBodyVec3x4 x3 = SoftBodyVec3x4::sGatherPositions(vertices, inV3);
+
+	// Calculate the shared edge of the triangles
+	SoftBodyVec3x4 e = x1 - x0;
+	Vec4 e_len = e.LengthSq().Sqrt();
+	UVec4 valid = Vec4::sGreaterOrEqual(e_len, Vec4::sReplicate(1.0e-6f));
+
+	// Calculate the normals of the triangles
+	SoftBodyVec3x4 x1x2 = x2 - x1;
+	SoftBodyVec3x4 x1x3 = x3 - x1;
+	SoftBodyVec3x4 n1 = (x2 - x0).Cross(x1x2);
+	SoftBodyVec3x4 n2 = x1x3.Cross(x3 - x0);
+	Vec4 n1_len_sq = n1.LengthSq();
+	Vec4 n2_len_sq = n2.LengthSq();
+	Vec4 n1_len_sq_n2_len_sq = n1_len_sq * n2_len_sq;
+	valid = UVec4::sAnd(valid, Vec4::sGreaterOrEqual(n1_len_sq_n2_len_sq, Vec4::sReplicate(1.0e-24f)));
+
+	// Replace the divisors of invalid constraints with 1 so that we never divide by zero (this would trap when floating point exceptions are enabled)
+	Vec4 one = Vec4::sReplicate(1.0f);
+	e_len = Vec4::sSelect(one, e_len, valid);
+	n1_len_sq = Vec4::sSelect(one, n1_len_sq, valid);
+	n2_len_sq = Vec4::sSelect(one, n2_len_sq, valid);
+	n1_len_sq_n2_len_sq = Vec4::sSelect(one, n1_len_sq_n2_len_sq, valid);
+
+	// Calculate constraint equation
+	Vec4 sign = Vec4::sSelect(Vec4::sReplicate(1.0f), Vec4::sReplicate(-1.0f), Vec4::sLess(n2.Cross(n1).Dot(e), Vec4::sZero()));
+	Vec4 d = n1.Dot(n2) / n1_len_sq_n2_len_sq.Sqrt();
+	Vec4 c = sign * ACosApproximate(d) - Vec4(inConstraints[0].mInitialAngle, inConstraints[1].mInitialAngle, inConstraints[2].mInitialAngle, inConstraints[3].mInitialAngle);
+
+	// Ensure the range is -PI to PI
+	c = Vec4::sSelect(c, c - Vec4::sReplicate(2.0f * JPH_PI), Vec4::sGreater(c, Vec4::sReplicate(JPH_PI)));
+	c = Vec4::sSelect(c, c + Vec4::sReplicate(2.0f * JPH_PI), Vec4::sLess(c, Vec4::sReplicate(-JPH_PI)));
+
+	// Calculate gradient of constraint equation
+	n1 = n1 / n1_len_sq;
+	n2 = n2 / n2_len_sq;
+	SoftBodyVec3x4 d0c = (n1 * x1x2.Dot(e) + n2 * x1x3.Dot(e)) / e_len;
+	SoftBodyVec3x4 d2c = n1 * e_len;
+	SoftBodyVec3x4 d3c = n2 * e_len;
+	SoftBodyVec3x4 d1c = -d0c - d2c - d3c;
+
+	// Get masses
+	Vec4 w0 = sGatherInvMass(vertices, inV0);
+	Vec4 w1 = sGatherInvMass(vertices, inV1);
+	Vec4 w2 = sGatherInvMass(vertices, inV2);
+	Vec4 w3 = sGatherInvMass(vertices, inV3);
+
+	// Calculate -lambda
+	Vec4 compliance(inConstraints[0].mCompliance, inConstraints[1].mCompliance, inConstraints[2].mCompliance, inConstraints[3].mCompliance);
+	Vec4 denom = w0 * d0c.LengthSq() + w1 * d1c.LengthSq() + w2 * d2c.LengthSq() + w3 * d3c.LengthSq() + compliance * inInvDtSq;
+	valid = UVec4::sAnd(valid, Vec4::sGreaterOrEqual(denom, Vec4::sReplicate(1.0e-12f)));
+	Vec4 minus_lambda = c / Vec4::sSelect(one, denom, valid);
+
+	// Apply correction, constraints that are not valid keep their original positions
+	SoftBodyVec3x4::sSelect(x0, x0 - d0c * (minus_lambda * w0), valid).ScatterPositions(vertices, inV0);
+	SoftBodyVec3x4::sSelect(x1, x1 - d1c * (minus_lambda * w1), valid).ScatterPositions(vertices, inV1);
+	SoftBodyVec3x4::sSelect(x2, x2 - d2c * (minus_lambda * w2), valid).ScatterPositions(vertices, inV2);
+	SoftBodyVec3x4::sSelect(x3, x3 - d3c * (minus_lambda * w3), valid).ScatterPositions(vertices, inV3);
 }
 
 void SoftBodyMotionProperties::ApplyVolumeConstraints(const SoftBodyUpdateContext &inContext, uint inStartIndex, uint inEndIndex)
@@ -517,10 +674,49 @@ void SoftBodyMotionProperties::ApplyEdgeConstraints(const SoftBodyUpdateContext
 	float inv_dt_sq = 1.0f / Square(inContext.mSubStepDeltaTime);
 
 	// Satisfy edge constraints
-	for (const Edge *e = mSettings->mEdgeConstraints.data() + inStartIndex, *e_end = mSettings->mEdgeConstraints.data() + inEndIndex; e < e_end; ++e)
+	Vertex *vertices = mVertices.data();
+	for (const Edge *e = mSettings->mEdgeConstraints.data() + inStartIndex, *e_end = mSettings->mEdgeConstraints.data() + inEndIndex; e < e_end; )
 	{
-		Vertex &v0 = mVertices[e->mVertex[0]];
-		Vertex &v1 = mVertices[e->mVertex[1]];
+		if (mEnableSIMDConstraints && e_end - e >= 4)
+		{
+			// Get the vertex indices of the next 4 constraints
+			UVec4 i0(e[0].mVertex[0], e[1].mVertex[0], e[2].mVertex[0], e[3].mVertex[0]);
+			UVec4 i1(e[0].mVertex[1], e[1].mVertex[1], e[2].mVertex[1], e[3].mVertex[1]);
+
+			// If the constraints don't share any vertices, we can solve them at the same time
+			if (!UVec4::sOr(UVec4::sOr(sEqualsOtherLane(i0, i0), sEqualsOtherLane(i1, i1)), sEqualsOtherLane(i0, i1)).TestAnyTrue())
+			{
+				// Get positions
+				SoftBodyVec3x4 x0 = SoftBodyVec3x4::sGatherPositions(vertices, i0);
+				SoftBodyVec3x4 x1 = SoftBodyVec3x4::sGatherPositions(vertices, i1);
+
+				// Get masses
+				Vec4 w0 = sGatherInvMass(vertices, i0);
+				Vec4 w1 = sGatherInvMass(vertices, i1);
+
+				// Calculate current length
+				SoftBodyVec3x4 delta = x1 - x0;
+				Vec4 length = delta.LengthSq().Sqrt();
+
+				// Apply correction, edges with a too small denominator get no correction.
+				// Their denominator is replaced with 1 before dividing so that we never divide by zero (this would trap when floating point exceptions are enabled).
+				Vec4 compliance(e[0].mCompliance, e[1].mCompliance, e[2].mCompliance, e[3].mCompliance);
+				Vec4 rest_length(e[0].mRestLength, e[1].mRestLength, e[2].mRestLength, e[3].mRestLength);
+				Vec4 denom = length * (w0 + w1 + compliance * inv_dt_sq);
+				UVec4 valid = Vec4::sGreaterOrEqual(denom, Vec4::sReplicate(1.0e-12f));
+				Vec4 safe_denom = Vec4::sSelect(Vec4::sReplicate(1.0f), denom, valid);
+				Vec4 factor = Vec4::sSelect(Vec4::sZero(), (length - rest_length) / safe_denom, valid);
+				SoftBodyVec3x4 correction = delta * factor;
+				(x0 + correction * w0).ScatterPositions(vertices, i0);
+				(x1 - correction * w1).ScatterPositions(vertices, i1);
+
+				e += 4;
+				continue;
+			}
+		}
+
+		Vertex &v0 = vertices[e->mVertex[0]];
+		Vertex &v1 = vertices[e->mVertex[1]];
 
 		// Get positions
 		Vec3 x0 = v0.mPosition;
@@ -532,11 +728,13 @@ void SoftBodyMotionProperties::ApplyEdgeConstraints(const SoftBodyUpdateContext
 
 		// Apply correction
 		float denom = length * (v0.mInvMass + v1.mInvMass + e->mCompliance * inv_dt_sq);
-		if (denom < 1.0e-12f)
-			continue;
-		Vec3 correction = delta * (length - e->mRestLength) / denom;
-		v0.mPosition = x0 + v0.mInvMass * correction;
-		v1.mPosition = x1 - v1.mInvMass * correction;
+		if (denom >= 1.0e-12f)
+		{
+			Vec3 correction = delta * (length - e->mRestLength) / denom;
+			v0.mPosition = x0 + v0.mInvMass * correction;
+			v1.mPosition = x1 - v1.mInvMass * correction;
+		}
+		++e;
 	}
 }
 
@@ -546,8 +744,35 @@ void SoftBodyMotionProperties::ApplyLRAConstraints(uint inStartIndex, uint inEnd
 
 	// Satisfy LRA constraints
 	Vertex *vertices = mVertices.data();
-	for (const LRA *lra = mSettings->mLRAConstraints.data() + inStartIndex, *lra_end = mSettings->mLRAConstraints.data() + inEndIndex; lra < lra_end; ++lra)
+	for (const LRA *lra = mSettings->mLRAConstraints.data() + inStartIndex, *lra_end = mSettings->mLRAConstraints.data() + inEndIndex; lra < lra_end; )
 	{
+		if (mEnableSIMDConstraints && lra_end - lra >= 4)
+		{
+			// Get the vertex indices of the next 4 constraints
+			UVec4 i0(lra[0].mVertex[0], lra[1].mVertex[0], lra[2].mVertex[0], lra[3].mVertex[0]);
+			UVec4 i1(lra[0].mVertex[1], lra[1].mVertex[1], lra[2].mVertex[1], lra[3].mVertex[1]);
+
+			// If the constraints don't share a vertex that is modified, we can solve them at the same time (the 1st vertex is only read)
+			if (!UVec4::sOr(sEqualsOtherLane(i1, i1), sEqualsOtherLane(i0, i1)).TestAnyTrue())
+			{
+				SoftBodyVec3x4 x0 = SoftBodyVec3x4::sGatherPositions(vertices, i0);
+				SoftBodyVec3x4 x1 = SoftBodyVec3x4::sGatherPositions(vertices, i1);
+				SoftBodyVec3x4 delta = x1 - x0;
+				Vec4 delta_len_sq = delta.LengthSq();
+				Vec4 max_distance(lra[0].mMaxDistance, lra[1].mMaxDistance, lra[2].mMaxDistance, lra[3].mMaxDistance);
+				UVec4 violated = Vec4::sGreater(delta_len_sq, max_distance * max_distance);
+				if (violated.TestAnyTrue())
+				{
+					// Lanes that are not violated can have a zero length (vertex on its anchor), use 1 for them so that we never divide by zero
+					Vec4 safe_delta_len_sq = Vec4::sSelect(Vec4::sReplicate(1.0f), delta_len_sq, violated);
+					SoftBodyVec3x4::sSelect(x1, x0 + delta * (max_distance / safe_delta_len_sq.Sqrt()), violated).ScatterPositions(vertices, i1);
+				}
+
+				lra += 4;
+				continue;
+			}
+		}
+
 		JPH_ASSERT(lra->mVertex[0] < mVertices.size());
 		JPH_ASSERT(lra->mVertex[1] < mVertices.size());
 		const Vertex &vertex0 = vertices[lra->mVertex[0]];
@@ -558,6 +783,7 @@ void SoftBodyMotionProperties::ApplyLRAConstraints(uint inStartIndex, uint inEnd
 		float delta_len_sq = delta.LengthSq();
 		if (delta_len_sq > Square(lra->mMaxDistance))
 			vertex1.mPosition = x0 + delta * lra->mMaxDistance / sqrt(delta_len_sq);
+		++lra;
 	}
 }
 
@@ -790,6 +1016,19 @@ void SoftBodyMotionProperties::UpdateRigidBodyVelocities(const SoftBodyUpdateCon
 	mCollidingSensors.clear();
 }
 
+float SoftBodyMotionProperties::AccumulateDeltaTime(float inDeltaTime)
+{
+	mTimeSinceLastUpdate += inDeltaTime;
+	if (++mStepsSinceLastUpdate < mUpdateInterval)
+		return 0.0f;
+
+	// Simulate this step with the accumulated time
+	float delta_time = mTimeSinceLastUpdate;
+	mStepsSinceLastUpdate = 0;
+	mTimeSinceLastUpdate = 0.0f;
+	return delta_time;
+}
+
 void SoftBodyMotionProperties::InitializeUpdateContext(float inDeltaTime, Body &inSoftBody, const PhysicsSystem &inSystem, SoftBodyUpdateContext &ioContext)
 {
 	JPH_PROFILE_FUNCTION();
@@ -828,6 +1067,20 @@ void SoftBodyMotionProperties::StartFirstIteration(SoftBodyUpdateContext &ioCont
 	JPH_ASSERT(iteration == 0);
 	StartNextIteration(ioContext);
 	ioContext.mState.store(SoftBodyUpdateContext::EState::ApplyConstraints, memory_order_release);
+	ioContext.mPhase.fetch_add(1, memory_order_release);
+}
+
+void SoftBodyMotionProperties::StartSelfCollisionOrFirstIteration(SoftBodyUpdateContext &ioContext)
+{
+	if (mSelfCollision.IsEnabled())
+	{
+		// Refit the self collision hierarchy before we start looking for candidate pairs in parallel
+		mSelfCollision.Prepare(mVertices, ioContext.mDeltaTime, ioContext.mDisplacementDueToGravity);
+		ioContext.mState.store(SoftBodyUpdateContext::EState::DetermineSelfCollisions, memory_order_release);
+		ioContext.mPhase.fetch_add(1, memory_order_release);
+	}
+	else
+		StartFirstIteration(ioContext);
 }
 
 SoftBodyMotionProperties::EStatus SoftBodyMotionProperties::ParallelDetermineCollisionPlanes(SoftBodyUpdateContext &ioContext)
@@ -848,9 +1101,12 @@ SoftBodyMotionProperties::EStatus SoftBodyMotionProperties::ParallelDetermineCol
 			{
 				// Determine next state
 				if (mCollidingSensors.empty())
-					StartFirstIteration(ioContext);
+					StartSelfCollisionOrFirstIteration(ioContext);
 				else
+				{
 					ioContext.mState.store(SoftBodyUpdateContext::EState::DetermineSensorCollisions, memory_order_release);
+					ioContext.mPhase.fetch_add(1, memory_order_release);
+				}
 			}
 			return EStatus::DidWork;
 		}
@@ -875,6 +1131,30 @@ SoftBodyMotionProperties::EStatus SoftBodyMotionProperties::ParallelDetermineSen
 			// Determine next state
 			uint sensors_processed = ioContext.mNumSensorsProcessed.fetch_add(1, memory_order_release) + 1;
 			if (sensors_processed >= num_sensors)
+				StartSelfCollisionOrFirstIteration(ioContext);
+			return EStatus::DidWork;
+		}
+	}
+
+	return EStatus::NoWork;
+}
+
+SoftBodyMotionProperties::EStatus SoftBodyMotionProperties::ParallelDetermineSelfCollisions(SoftBodyUpdateContext &ioContext)
+{
+	// Do a relaxed read to see if there are more batches to process
+	uint num_batches = mSelfCollision.GetNumBatches();
+	if (ioContext.mNextSelfCollisionBatch.load(memory_order_relaxed) < num_batches)
+	{
+		// Fetch next batch to process
+		uint batch = ioContext.mNextSelfCollisionBatch.fetch_add(1, memory_order_acquire);
+		if (batch < num_batches)
+		{
+			// Find the candidate pairs for this batch
+			mSelfCollision.FindCandidates(mVertices, batch);
+
+			// Determine next state
+			uint batches_processed = ioContext.mNumSelfCollisionBatchesProcessed.fetch_add(1, memory_order_acq_rel) + 1;
+			if (batches_processed >= num_batches)
 				StartFirstIteration(ioContext);
 			return EStatus::DidWork;
 		}
@@ -906,38 +1186,68 @@ void SoftBodyMotionProperties::ProcessGroup(const SoftBodyUpdateContext &ioConte
 	ApplyLRAConstraints(prev.mLRAEndIndex, current.mLRAEndIndex);
 }
 
+void SoftBodyMotionProperties::GetGroupsInLayer(uint inLayer, uint &outStartGroup, uint &outEndGroup) const
+{
+	const Array<uint> &layer_end = mSettings->mUpdateGroupLayerEnd;
+	outStartGroup = inLayer > 0? layer_end[inLayer - 1] : 0;
+	outEndGroup = inLayer < layer_end.size()? layer_end[inLayer] : outStartGroup;
+}
+
 SoftBodyMotionProperties::EStatus SoftBodyMotionProperties::ParallelApplyConstraints(SoftBodyUpdateContext &ioContext, const PhysicsSettings &inPhysicsSettings)
 {
 	uint num_groups = (uint)mSettings->mUpdateGroups.size();
 	JPH_ASSERT(num_groups > 0, "SoftBodySharedSettings::Optimize should have been called!");
 	--num_groups; // Last group is the non-parallel group, we don't want to execute it in parallel
 
+	// The parallel groups are executed in layers, the counter stores the layer in the upper bits and the group relative to the start of the layer in the lower bits
+	constexpr uint cGroupMask = (1 << SoftBodyUpdateContext::cConstraintGroupLayerShift) - 1;
+
 	// Do a relaxed read first to see if there is any work to do (this prevents us from doing expensive atomic operations and also prevents us from continuously incrementing the counter and overflowing it)
 	uint next_group = ioContext.mNextConstraintGroup.load(memory_order_relaxed);
-	if (next_group < num_groups || (num_groups == 0 && next_group == 0))
+	uint layer = next_group >> SoftBodyUpdateContext::cConstraintGroupLayerShift;
+	uint layer_start, layer_end;
+	GetGroupsInLayer(layer, layer_start, layer_end);
+	if ((next_group & cGroupMask) < layer_end - layer_start || (num_groups == 0 && next_group == 0))
 	{
 		// Fetch the next group process
 		next_group = ioContext.mNextConstraintGroup.fetch_add(1, memory_order_acquire);
-		if (next_group < num_groups || (num_groups == 0 && next_group == 0))
+		layer = next_group >> SoftBodyUpdateContext::cConstraintGroupLayerShift;
+		GetGroupsInLayer(layer, layer_start, layer_end);
+		uint group_in_layer = next_group & cGroupMask;
+		if (group_in_layer < layer_end - layer_start || (num_groups == 0 && next_group == 0))
 		{
-			uint num_groups_processed = 0;
+			bool layer_finished = true;
 			if (num_groups > 0)
 			{
 				// Process this group
-				ProcessGroup(ioContext, next_group);
+				ProcessGroup(ioContext, layer_start + group_in_layer);
 
-				// Increment total number of groups processed
-				num_groups_processed = ioContext.mNumConstraintGroupsProcessed.fetch_add(1, memory_order_relaxed) + 1;
+				// Increment total number of groups processed in this layer
+				uint num_groups_processed = ioContext.mNumConstraintGroupsProcessed.fetch_add(1, memory_order_acq_rel) + 1;
+				layer_finished = num_groups_processed >= layer_end - layer_start;
 			}
 
-			if (num_groups_processed >= num_groups)
+			if (layer_finished)
 			{
+				if (layer + 1 < mSettings->mUpdateGroupLayerEnd.size())
+				{
+					// Start the next layer
+					ioContext.mNumConstraintGroupsProcessed.store(0, memory_order_relaxed);
+					ioContext.mNextConstraintGroup.store((layer + 1) << SoftBodyUpdateContext::cConstraintGroupLayerShift, memory_order_release);
+					ioContext.mPhase.fetch_add(1, memory_order_release);
+					return EStatus::DidWork;
+				}
+
 				// Finish the iteration
 				JPH_PROFILE("FinishIteration");
 
 				// Process non-parallel group
 				ProcessGroup(ioContext, num_groups);
 
+				// Resolve self collisions
+				if (mSelfCollision.IsEnabled())
+					mSelfCollision.Solve(mVertices);
+
 				ApplyCollisionConstraintsAndUpdateVelocities(ioContext);
 
 				uint iteration = ioContext.mNextIteration.fetch_add(1, memory_order_relaxed);
@@ -949,6 +1259,7 @@ SoftBodyMotionProperties::EStatus SoftBodyMotionProperties::ParallelApplyConstra
 					// Reset group logic
 					ioContext.mNumConstraintGroupsProcessed.store(0, memory_order_relaxed);
 					ioContext.mNextConstraintGroup.store(0, memory_order_release);
+					ioContext.mPhase.fetch_add(1, memory_order_release);
 				}
 				else
 				{
@@ -966,6 +1277,33 @@ SoftBodyMotionProperties::EStatus SoftBodyMotionProperties::ParallelApplyConstra
 	return EStatus::NoWork;
 }
 
+uint SoftBodyMotionProperties::GetNumParallelTasks(const SoftBodyUpdateContext &inContext) const
+{
+	switch (inContext.mState.load(memory_order_relaxed))
+	{
+	case SoftBodyUpdateContext::EState::DetermineCollisionPlanes:
+		return ((uint)mVertices.size() + SoftBodyUpdateContext::cVertexCollisionBatch - 1) / SoftBodyUpdateContext::cVertexCollisionBatch;
+
+	case SoftBodyUpdateContext::EState::DetermineSensorCollisions:
+		return (uint)mCollidingSensors.size();
+
+	case SoftBodyUpdateContext::EState::DetermineSelfCollisions:
+		return mSelfCollision.GetNumBatches();
+
+	case SoftBodyUpdateContext::EState::ApplyConstraints:
+		{
+			// Number of groups in the current layer
+			uint start_group, end_group;
+			GetGroupsInLayer(inContext.mNextConstraintGroup.load(memory_order_relaxed) >> SoftBodyUpdateContext::cConstraintGroupLayerShift, start_group, end_group);
+			return max(1u, end_group - start_group);
+		}
+
+	case SoftBodyUpdateContext::EState::Done:
+	default:
+		return 0;
+	}
+}
+
 SoftBodyMotionProperties::EStatus SoftBodyMotionProperties::ParallelUpdate(SoftBodyUpdateContext &ioContext, const PhysicsSettings &inPhysicsSettings)
 {
 	switch (ioContext.mState.load(memory_order_relaxed))
@@ -976,6 +1314,9 @@ SoftBodyMotionProperties::EStatus SoftBodyMotionProperties::ParallelUpdate(SoftB
 	case SoftBodyUpdateContext::EState::DetermineSensorCollisions:
 		return ParallelDetermineSensorCollisions(ioContext);
 
+	case SoftBodyUpdateContext::EState::DetermineSelfCollisions:
+		return ParallelDetermineSelfCollisions(ioContext);
+
 	case SoftBodyUpdateContext::EState::ApplyConstraints:
 		return ParallelApplyConstraints(ioContext, inPhysicsSettings);
 
@@ -1258,6 +1599,8 @@ void SoftBodyMotionProperties::SaveState(StateRecorder &inStream) const
 	inStream.Write(mLocalBounds.mMax);
 	inStream.Write(mLocalPredictedBounds.mMin);
 	inStream.Write(mLocalPredictedBounds.mMax);
+	inStream.Write(mStepsSinceLastUpdate);
+	inStream.Write(mTimeSinceLastUpdate);
 }
 
 void SoftBodyMotionProperties::RestoreState(StateRecorder &inStream)
@@ -1282,6 +1625,8 @@ void SoftBodyMotionProperties::RestoreState(StateRecorder &inStream)
 	inStream.Read(mLocalBounds.mMax);
 	inStream.Read(mLocalPredictedBounds.mMin);
 	inStream.Read(mLocalPredictedBounds.mMax);
+	inStream.Read(mStepsSinceLastUpdate);
+	inStream.Read(mTimeSinceLastUpdate);
 }
 
 JPH_NAMESPACE_END
@@ -10,6 +10,7 @@
 #include <Jolt/Physics/SoftBody/SoftBodySharedSettings.h>
 #include <Jolt/Physics/SoftBody/SoftBodyVertex.h>
 #include <Jolt/Physics/SoftBody/SoftBodyUpdateContext.h>
+#include <Jolt/Physics/SoftBody/SoftBodySelfCollision.h>
 
 JPH_NAMESPACE_BEGIN
 
@@ -70,6 +71,15 @@ public:
 	uint32								GetNumIterations() const					{ return mNumIterations; }
 	void								SetNumIterations(uint32 inNumIterations)	{ mNumIterations = inNumIterations; }
 
+	/// Level of detail: only simulate the soft body once every inUpdateInterval physics steps using the accumulated delta time (1 means every step).
+	/// Together with SetNumIterations this can be used to reduce the cost of soft bodies that are far away from the viewer.
+	uint								GetUpdateInterval() const					{ return mUpdateInterval; }
+	void								SetUpdateInterval(uint inUpdateInterval)	{ JPH_ASSERT(inUpdateInterval > 0); mUpdateInterval = inUpdateInterval; }
+
+	/// Time that has passed since the soft body was last simulated. When the update interval is bigger than 1, this can be used to extrapolate the
+	/// vertex positions for rendering: Vertex::mPosition + Vertex::mVelocity * GetTimeSinceLastUpdate().
+	float								GetTimeSinceLastUpdate() const				{ return mTimeSinceLastUpdate; }
+
 	/// Get the pressure of the soft body
 	float								GetPressure() const							{ return mPressure; }
 	void								SetPressure(float inPressure)				{ mPressure = inPressure; }
@@ -82,6 +92,11 @@ public:
 	bool								GetEnableSkinConstraints() const			{ return mEnableSkinConstraints; }
 	void								SetEnableSkinConstraints(bool inEnableSkinConstraints) { mEnableSkinConstraints = inEnableSkinConstraints; }
 
+	/// Global setting to turn on/off solving batches of 4 edge, LRA and dihedral bend constraints that don't share vertices using SIMD instructions.
+	/// The results are the same as solving them one by one up to floating point round off.
+	bool								GetEnableSIMDConstraints() const			{ return mEnableSIMDConstraints; }
+	void								SetEnableSIMDConstraints(bool inEnableSIMDConstraints) { mEnableSIMDConstraints = inEnableSIMDConstraints; }
+
 	/// Multiplier applied to Skinned::mMaxDistance to allow tightening or loosening of the skin constraints. 0 to hard skin all vertices.
 	float								GetSkinnedMaxDistanceMultiplier() const		{ return mSkinnedMaxDistanceMultiplier; }
 	void								SetSkinnedMaxDistanceMultiplier(float inSkinnedMaxDistanceMultiplier) { mSkinnedMaxDistanceMultiplier = inSkinnedMaxDistanceMultiplier; }
@@ -138,6 +153,9 @@ public:
 	// FUNCTIONS BELOW THIS LINE ARE FOR INTERNAL USE ONLY
 	////////////////////////////////////////////////////////////
 
+	/// Accumulate the delta time of a physics step. Returns the delta time that the soft body should be simulated with or 0 if it should skip this step. Not part of the public API.
+	float								AccumulateDeltaTime(float inDeltaTime);
+
 	/// Initialize the update context. Not part of the public API.
 	void								InitializeUpdateContext(float inDeltaTime, Body &inSoftBody, const PhysicsSystem &inSystem, SoftBodyUpdateContext &ioContext);
 
@@ -155,6 +173,9 @@ public:
 	/// Update the soft body, will process a batch of work. Not part of the public API.
 	EStatus								ParallelUpdate(SoftBodyUpdateContext &ioContext, const PhysicsSettings &inPhysicsSettings);
 
+	/// Get the number of batches of work that ParallelUpdate can process in parallel in the current state of the update, used to determine how many jobs to run. Not part of the public API.
+	uint								GetNumParallelTasks(const SoftBodyUpdateContext &inContext) const;
+
 	/// Update the velocities of all rigid bodies that we collided with. Not part of the public API.
 	void								UpdateRigidBodyVelocities(const SoftBodyUpdateContext &inContext, BodyInterface &inBodyInterface);
 
@@ -219,6 +240,12 @@ private:
 	/// Enforce all bend constraints
 	void								ApplyDihedralBendConstraints(const SoftBodyUpdateContext &inContext, uint inStartIndex, uint inEndIndex);
 
+	/// Enforce a single bend constraint
+	void								ApplyDihedralBendConstraint(const DihedralBend &inConstraint, float inInvDtSq);
+
+	/// Enforce 4 bend constraints that don't share any vertices using SIMD, inV0 .. inV3 contain the vertex indices of the constraints
+	void								ApplyDihedralBendConstraints4(const DihedralBend *inConstraints, float inInvDtSq, UVec4Arg inV0, UVec4Arg inV1, UVec4Arg inV2, UVec4Arg inV3);
+
 	/// Enforce all volume constraints
 	void								ApplyVolumeConstraints(const SoftBodyUpdateContext &inContext, uint inStartIndex, uint inEndIndex);
 
@@ -240,6 +267,9 @@ private:
 	/// Start the first solver iteration
 	void								StartFirstIteration(SoftBodyUpdateContext &ioContext);
 
+	/// Go to the self collision state if self collision is enabled, otherwise start the first solver iteration
+	void								StartSelfCollisionOrFirstIteration(SoftBodyUpdateContext &ioContext);
+
 	/// Executes tasks that need to run on the start of an iteration (i.e. the stuff that can't run in parallel)
 	void								StartNextIteration(const SoftBodyUpdateContext &ioContext);
 
@@ -249,6 +279,12 @@ private:
 	/// Helper function for ParallelUpdate that works on sensor collisions
 	EStatus								ParallelDetermineSensorCollisions(SoftBodyUpdateContext &ioContext);
 
+	/// Helper function for ParallelUpdate that works on batches of self collision candidates
+	EStatus								ParallelDetermineSelfCollisions(SoftBodyUpdateContext &ioContext);
+
+	/// Get the range of parallel constraint groups that belong to a layer
+	void								GetGroupsInLayer(uint inLayer, uint &outStartGroup, uint &outEndGroup) const;
+
 	/// Helper function for ParallelUpdate that works on batches of constraints
 	EStatus								ParallelApplyConstraints(SoftBodyUpdateContext &ioContext, const PhysicsSettings &inPhysicsSettings);
 
@@ -270,15 +306,20 @@ private:
 	Array<Vertex>						mVertices;									///< Current state of all vertices in the simulation
 	Array<CollidingShape>				mCollidingShapes;							///< List of colliding shapes retrieved during the last update
 	Array<CollidingSensor>				mCollidingSensors;							///< List of colliding sensors retrieved during the last update
+	SoftBodySelfCollision				mSelfCollision;								///< Hierarchy and candidate pairs for collision of the soft body with itself
 	Array<SkinState>					mSkinState;									///< List of skinned positions (1-on-1 with mVertices but only those that are used by the skinning constraints are filled in)
 	AABox								mLocalBounds;								///< Bounding box of all vertices
 	AABox								mLocalPredictedBounds;						///< Predicted bounding box for all vertices using extrapolation of velocity by last step delta time
 	uint32								mNumIterations;								///< Number of solver iterations
+	uint								mUpdateInterval = 1;						///< Simulate the soft body once every mUpdateInterval physics steps
+	uint								mStepsSinceLastUpdate = 0;					///< Number of physics steps that were skipped since the soft body was last simulated
+	float								mTimeSinceLastUpdate = 0.0f;				///< Delta time accumulated over the skipped physics steps
 	float								mPressure;									///< n * R * T, amount of substance * ideal gas constant * absolute temperature, see https://en.wikipedia.org/wiki/Pressure
 	float								mSkinnedMaxDistanceMultiplier = 1.0f;		///< Multiplier applied to Skinned::mMaxDistance to allow tightening or loosening of the skin constraints
 	bool								mUpdatePosition;							///< Update the position of the body while simulating (set to false for something that is attached to the static world)
 	bool								mNeedContactCallback = false;						///< True if the soft body has collided with anything in the last update
 	bool								mEnableSkinConstraints = true;				///< If skin constraints are enabled
+	bool								mEnableSIMDConstraints = true;				///< If batches of constraints that don't share vertices are solved using SIMD
 	bool								mSkinStatePreviousPositionValid = false;	///< True if the skinning was updated in the last update so that the previous position of the skin state is valid
 };
 
@@ -0,0 +1,339 @@
+// Jolt Physics Library (https://github.com/jrouwe/JoltPhysics)
+// SPDX-FileCopyrightText: 2024 Jorrit Rouwe
+// SPDX-License-Identifier: MIT
+
+#include <Jolt/Jolt.h>
+
+#include <Jolt/Physics/SoftBody/SoftBodySelfCollision.h>
+#include <Jolt/Physics/SoftBody/SoftBodySharedSettings.h>
+#include <Jolt/Geometry/ClosestPoint.h>
+#include <Jolt/Core/Profiler.h>
+#include <Jolt/Core/QuickSort.h>
+#include <Jolt/Core/UnorderedMap.h>
+
+JPH_NAMESPACE_BEGIN
+
+/// Maximum number of faces in a leaf node
+static constexpr uint cMaxFacesPerLeaf = 4;
+
+void SoftBodySelfCollision::Initialize(const SoftBodySharedSettings &inSettings, const Array<Vertex> &inVertices)
+{
+	mDistance = inSettings.mSelfCollisionDistance;
+	mNodes.clear();
+	if (mDistance <= 0.0f || inSettings.mFaces.empty())
+		return;
+
+	// Copy the vertex indices of the faces and find the unique edges
+	uint num_faces = (uint)inSettings.mFaces.size();
+	mFaceVertices.resize(3 * num_faces);
+	mFaceEdges.resize(3 * num_faces);
+	UnorderedMap<uint64, uint32> edge_map;
+	for (uint f = 0; f < num_faces; ++f)
+	{
+		const SoftBodySharedSettings::Face &face = inSettings.mFaces[f];
+		for (uint i = 0; i < 3; ++i)
+		{
+			mFaceVertices[3 * f + i] = face.mVertex[i];
+
+			uint32 v0 = face.mVertex[i], v1 = face.mVertex[(i + 1) % 3];
+			uint64 key = (uint64(min(v0, v1)) << 32) | max(v0, v1);
+			UnorderedMap<uint64, uint32>::iterator it = edge_map.find(key);
+			if (it == edge_map.end())
+			{
+				// New edge, this face owns it
+				uint32 edge_idx = uint32(mEdgeOwner.size());
+				edge_map.insert({ key, edge_idx });
+				mEdges.push_back(v0);
+				mEdges.push_back(v1);
+				mEdgeOwner.push_back(f);
+				mFaceEdges[3 * f + i] = edge_idx;
+			}
+			else
+				mFaceEdges[3 * f + i] = it->second;
+		}
+	}
+
+	// Build the hierarchy
+	mFaceOrder.resize(num_faces);
+	for (uint f = 0; f < num_faces; ++f)
+		mFaceOrder[f] = f;
+	mNodes.reserve(2 * (num_faces / cMaxFacesPerLeaf + 1));
+	BuildNode(inVertices, 0, num_faces);
+
+	// Allocate space for the candidates
+	mVertexCandidates.resize((inVertices.size() + cBatchSize - 1) / cBatchSize);
+	mEdgeCandidates.resize((mEdgeOwner.size() + cBatchSize - 1) / cBatchSize);
+}
+
+uint32 SoftBodySelfCollision::BuildNode(const Array<Vertex> &inVertices, uint inStart, uint inEnd)
+{
+	uint32 node_idx = uint32(mNodes.size());
+	mNodes.push_back({ AABox(), inStart, inEnd - inStart });
+	if (inEnd - inStart <= cMaxFacesPerLeaf)
+		return node_idx;
+
+	// Determine the longest axis of the centroids
+	auto get_centroid = [this, &inVertices](uint32 inFace) {
+		const uint32 *v = &mFaceVertices[3 * inFace];
+		return inVertices[v[0]].mPosition + inVertices[v[1]].mPosition + inVertices[v[2]].mPosition;
+	};
+	AABox centroid_bounds;
+	for (uint i = inStart; i < inEnd; ++i)
+		centroid_bounds.Encapsulate(get_centroid(mFaceOrder[i]));
+	uint axis = centroid_bounds.GetSize().GetHighestComponentIndex();
+
+	// Split in the middle of the sorted centroids
+	QuickSort(mFaceOrder.begin() + inStart, mFaceOrder.begin() + inEnd, [axis, &get_centroid](uint32 inLHS, uint32 inRHS) {
+		float c1 = get_centroid(inLHS)[axis], c2 = get_centroid(inRHS)[axis];
+		return c1 < c2 || (c1 == c2 && inLHS < inRHS);
+	});
+	uint middle = (inStart + inEnd) / 2;
+
+	// Turn this node into an internal node, left child follows immediately
+	mNodes[node_idx].mNumFaces = 0;
+	BuildNode(inVertices, inStart, middle);
+	uint32 right = BuildNode(inVertices, middle, inEnd);
+	mNodes[node_idx].mIndex = right;
+	return node_idx;
+}
+
+void SoftBodySelfCollision::Prepare(const Array<Vertex> &inVertices, float inDeltaTime, Vec3Arg inDisplacementDueToGravity)
+{
+	JPH_PROFILE_FUNCTION();
+
+	// Determine how far the vertices can move this step
+	float max_velocity_sq = 0.0f;
+	for (const Vertex &v : inVertices)
+		if (v.mInvMass > 0.0f)
+			max_velocity_sq = max(max_velocity_sq, v.mVelocity.LengthSq());
+	mMargin = sqrt(max_velocity_sq) * inDeltaTime + inDisplacementDueToGravity.Length();
+	Vec3 expand = Vec3::sReplicate(mMargin);
+
+	// Refit the hierarchy, children are stored after their parents so we can iterate backwards
+	for (Node *n = mNodes.data() + mNodes.size() - 1; n >= mNodes.data(); --n)
+		if (n->IsLeaf())
+		{
+			n->mBounds = AABox();
+			for (const uint32 *f = mFaceOrder.data() + n->mIndex, *f_end = f + n->mNumFaces; f < f_end; ++f)
+				for (const uint32 *v = &mFaceVertices[3 * *f], *v_end = v + 3; v < v_end; ++v)
+					n->mBounds.Encapsulate(inVertices[*v].mPosition);
+			n->mBounds.ExpandBy(expand);
+		}
+		else
+		{
+			n->mBounds = n[1].mBounds;
+			n->mBounds.Encapsulate(mNodes[n->mIndex].mBounds);
+		}
+}
+
+template <class Visitor>
+inline void SoftBodySelfCollision::VisitFaces(const AABox &inBox, const Visitor &inVisitor) const
+{
+	uint32 stack[64];
+	int top = 0;
+	stack[0] = 0;
+	do
+	{
+		const Node &node = mNodes[stack[top]];
+		if (node.mBounds.Overlaps(inBox))
+		{
+			if (node.IsLeaf())
+			{
+				for (const uint32 *f = mFaceOrder.data() + node.mIndex, *f_end = f + node.mNumFaces; f < f_end; ++f)
+					inVisitor(*f);
+				--top;
+			}
+			else
+			{
+				JPH_ASSERT(top < 62);
+				uint32 left = stack[top] + 1;
+				stack[top] = node.mIndex;
+				stack[++top] = left;
+			}
+		}
+		else
+			--top;
+	}
+	while (top >= 0);
+}
+
+void SoftBodySelfCollision::FindCandidates(const Array<Vertex> &inVertices, uint inBatch)
+{
+	JPH_PROFILE_FUNCTION();
+
+	// Both the query box and the faces in the tree are expanded by the margin as both can move
+	Vec3 expand = Vec3::sReplicate(mDistance + mMargin);
+
+	uint num_vertex_batches = (uint)mVertexCandidates.size();
+	if (inBatch < num_vertex_batches)
+	{
+		// Find faces that are close to the vertices in this batch
+		Array<VertexFace> &candidates = mVertexCandidates[inBatch];
+		candidates.clear();
+		for (uint32 v = inBatch * cBatchSize, v_end = min(v + cBatchSize, (uint32)inVertices.size()); v < v_end; ++v)
+		{
+			const Vertex &vertex = inVertices[v];
+			Vec3 position = vertex.mPosition;
+			VisitFaces(AABox(position - expand, position + expand), [this, v, &vertex, position, &inVertices, &candidates](uint32 inFace) {
+				// Skip faces that contain the vertex
+				const uint32 *fv = &mFaceVertices[3 * inFace];
+				if (fv[0] == v || fv[1] == v || fv[2] == v)
+					return;
+
+				// Skip if none of the vertices can move
+				const Vertex &v0 = inVertices[fv[0]], &v1 = inVertices[fv[1]], &v2 = inVertices[fv[2]];
+				if (vertex.mInvMass == 0.0f && v0.mInvMass == 0.0f && v1.mInvMass == 0.0f && v2.mInvMass == 0.0f)
+					return;
+
+				// Remember on which side of the face the vertex is
+				Vec3 normal = (v1.mPosition - v0.mPosition).Cross(v2.mPosition - v0.mPosition);
+				float side = normal.Dot(position - v0.mPosition) < 0.0f? -1.0f : 1.0f;
+				candidates.push_back({ v, inFace, side });
+			});
+		}
+	}
+	else
+	{
+		// Find edges that are close to the edges in this batch
+		uint edge_batch = inBatch - num_vertex_batches;
+		Array<EdgeEdge> &candidates = mEdgeCandidates[edge_batch];
+		candidates.clear();
+		for (uint32 e = edge_batch * cBatchSize, e_end = min(e + cBatchSize, (uint32)mEdgeOwner.size()); e < e_end; ++e)
+		{
+			uint32 e0 = mEdges[2 * e], e1 = mEdges[2 * e + 1];
+			const Vertex &v0 = inVertices[e0], &v1 = inVertices[e1];
+			AABox bounds(Vec3::sMin(v0.mPosition, v1.mPosition) - expand, Vec3::sMax(v0.mPosition, v1.mPosition) + expand);
+			bool is_static = v0.mInvMass == 0.0f && v1.mInvMass == 0.0f;
+			VisitFaces(bounds, [this, e, e0, e1, is_static, &inVertices, &candidates](uint32 inFace) {
+				for (const uint32 *fe = &mFaceEdges[3 * inFace], *fe_end = fe + 3; fe < fe_end; ++fe)
+				{
+					// Report every pair only once and only through the face that owns the other edge
+					uint32 other = *fe;
+					if (other <= e || mEdgeOwner[other] != inFace)
+						continue;
+
+					// Skip edges that share a vertex
+					uint32 o0 = mEdges[2 * other], o1 = mEdges[2 * other + 1];
+					if (o0 == e0 || o0 == e1 || o1 == e0 || o1 == e1)
+						continue;
+
+					// Skip if none of the vertices can move
+					if (is_static && inVertices[o0].mInvMass == 0.0f && inVertices[o1].mInvMass == 0.0f)
+						continue;
+
+					candidates.push_back({ { e, other } });
+				}
+			});
+		}
+	}
+}
+
+void SoftBodySelfCollision::Solve(Array<Vertex> &ioVertices) const
+{
+	JPH_PROFILE_FUNCTION();
+
+	Vertex *vertices = ioVertices.data();
+
+	// Push vertices out of faces
+	for (const Array<VertexFace> &batch : mVertexCandidates)
+		for (const VertexFace &c : batch)
+		{
+			const uint32 *fv = &mFaceVertices[3 * c.mFace];
+			Vertex &p = vertices[c.mVertex];
+			Vertex &v0 = vertices[fv[0]], &v1 = vertices[fv[1]], &v2 = vertices[fv[2]];
+			Vec3 x0 = v0.mPosition, x1 = v1.mPosition, x2 = v2.mPosition;
+
+			// Calculate the normal of the face
+			Vec3 normal = (x1 - x0).Cross(x2 - x0);
+			float normal_len = normal.Length();
+			if (normal_len < 1.0e-12f)
+				continue;
+			normal *= c.mSide / normal_len;
+
+			// Check if the vertex is too close to the plane of the face, on the side where it started
+			float distance = normal.Dot(p.mPosition - x0);
+			if (distance >= mDistance)
+				continue;
+
+			// Project the vertex on the plane and check that it lies inside the face
+			Vec3 projected = p.mPosition - distance * normal;
+			float u, v, w;
+			if (!ClosestPoint::GetBaryCentricCoordinates(x0 - projected, x1 - projected, x2 - projected, u, v, w)
+				|| u < 0.0f || v < 0.0f || w < 0.0f)
+				continue;
+
+			// Calculate -lambda, the gradient for the vertex is the normal, for the face vertices it is -normal times the barycentric coordinate
+			float denom = p.mInvMass + Square(u) * v0.mInvMass + Square(v) * v1.mInvMass + Square(w) * v2.mInvMass;
+			if (denom < 1.0e-12f)
+				continue;
+			Vec3 correction = ((mDistance - distance) / denom) * normal;
+
+			// Apply correction
+			p.mPosition += p.mInvMass * correction;
+			v0.mPosition = x0 - (u * v0.mInvMass) * correction;
+			v1.mPosition = x1 - (v * v1.mInvMass) * correction;
+			v2.mPosition = x2 - (w * v2.mInvMass) * correction;
+		}
+
+	// Push edges away from each other
+	for (const Array<EdgeEdge> &batch : mEdgeCandidates)
+		for (const EdgeEdge &c : batch)
+		{
+			Vertex &a0 = vertices[mEdges[2 * c.mEdge[0]]], &a1 = vertices[mEdges[2 * c.mEdge[0] + 1]];
+			Vertex &b0 = vertices[mEdges[2 * c.mEdge[1]]], &b1 = vertices[mEdges[2 * c.mEdge[1] + 1]];
+
+			// Find the closest points between the two segments, see: Real-Time Collision Detection - Christer Ericson, section 5.1.9
+			Vec3 d1 = a1.mPosition - a0.mPosition;
+			Vec3 d2 = b1.mPosition - b0.mPosition;
+			Vec3 r = a0.mPosition - b0.mPosition;
+			float a = d1.LengthSq(), e = d2.LengthSq(), f = d2.Dot(r);
+			if (a < 1.0e-12f || e < 1.0e-12f)
+				continue;
+			float c1 = d1.Dot(r), b = d1.Dot(d2);
+			float denom = a * e - b * b;
+			float s = denom > 1.0e-12f? Clamp((b * f - c1 * e) / denom, 0.0f, 1.0f) : 0.0f;
+			float t = (b * s + f) / e;
+			if (t < 0.0f)
+			{
+				t = 0.0f;
+				s = Clamp(-c1 / a, 0.0f, 1.0f);
+			}
+			else if (t > 1.0f)
+			{
+				t = 1.0f;
+				s = Clamp((b - c1) / a, 0.0f, 1.0f);
+			}
+
+			// Check if the edges are too close
+			Vec3 delta = a0.mPosition + s * d1 - b0.mPosition - t * d2;
+			float distance_sq = delta.LengthSq();
+			if (distance_sq >= Square(mDistance) || distance_sq < 1.0e-12f)
+				continue;
+			float distance = sqrt(distance_sq);
+
+			// Calculate -lambda
+			float wa0 = (1.0f - s) * a0.mInvMass, wa1 = s * a1.mInvMass, wb0 = (1.0f - t) * b0.mInvMass, wb1 = t * b1.mInvMass;
+			float w = (1.0f - s) * wa0 + s * wa1 + (1.0f - t) * wb0 + t * wb1;
+			if (w < 1.0e-12f)
+				continue;
+			Vec3 correction = ((mDistance - distance) / (w * distance)) * delta;
+
+			// Apply correction
+			a0.mPosition += wa0 * correction;
+			a1.mPosition += wa1 * correction;
+			b0.mPosition -= wb0 * correction;
+			b1.mPosition -= wb1 * correction;
+		}
+}
+
+uint SoftBodySelfCollision::GetNumCandidates() const
+{
+	uint num_candidates = 0;
+	for (const Array<VertexFace> &batch : mVertexCandidates)
+		num_candidates += (uint)batch.size();
+	for (const Array<EdgeEdge> &batch : mEdgeCandidates)
+		num_candidates += (uint)batch.size();
+	return num_candidates;
+}
+
+JPH_NAMESPACE_END
@@ -0,0 +1,92 @@
+// Jolt Physics Library (https://github.com/jrouwe/JoltPhysics)
+// SPDX-FileCopyrightText: 2024 Jorrit Rouwe
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <Jolt/Geometry/AABox.h>
+#include <Jolt/Physics/SoftBody/SoftBodyVertex.h>
+
+JPH_NAMESPACE_BEGIN
+
+class SoftBodySharedSettings;
+
+/// Internal class that handles collision of a soft body with itself.
+/// It keeps a bounding volume hierarchy over the faces of the soft body that is refitted at the start of every simulation step.
+/// The hierarchy is used to find vertex-triangle and edge-edge pairs that can come within SoftBodySharedSettings::mSelfCollisionDistance during the step.
+/// Finding these candidate pairs is split up in batches that can be processed in parallel, the pairs are then resolved every sub step.
+class JPH_EXPORT SoftBodySelfCollision
+{
+public:
+	using Vertex = SoftBodyVertex;
+
+	/// Number of vertices or edges to process in a batch in FindCandidates
+	static constexpr uint		cBatchSize = 64;
+
+	/// Build the hierarchy and the list of edges from the faces of the soft body
+	void						Initialize(const SoftBodySharedSettings &inSettings, const Array<Vertex> &inVertices);
+
+	/// Check if self collision is enabled for this soft body
+	inline bool					IsEnabled() const						{ return !mNodes.empty(); }
+
+	/// Refit the hierarchy to the current vertex positions. inDeltaTime is the time step, it is used together with the velocity of the vertices and inDisplacementDueToGravity to determine how much the bounds need to be expanded to remain valid for the entire step.
+	void						Prepare(const Array<Vertex> &inVertices, float inDeltaTime, Vec3Arg inDisplacementDueToGravity);
+
+	/// Get the number of batches that FindCandidates should be called for
+	inline uint					GetNumBatches() const					{ return uint(mVertexCandidates.size() + mEdgeCandidates.size()); }
+
+	/// Find candidate pairs for a single batch, can be called in parallel for different batches
+	void						FindCandidates(const Array<Vertex> &inVertices, uint inBatch);
+
+	/// Push vertex-triangle and edge-edge pairs that are too close apart
+	void						Solve(Array<Vertex> &ioVertices) const;
+
+	/// Get the total number of candidate pairs that were found during the last step
+	uint						GetNumCandidates() const;
+
+private:
+	/// A node in the hierarchy, nodes are stored depth first so that the left child of a node immediately follows its parent
+	struct Node
+	{
+		/// Check if this node is a leaf node
+		inline bool				IsLeaf() const							{ return mNumFaces > 0; }
+
+		AABox					mBounds;								///< Bounding box of all faces in this node
+		uint32					mIndex;									///< Leaf node: Index of first face in mFaceOrder, internal node: Index of the right child
+		uint32					mNumFaces;								///< Number of faces in this node, 0 for an internal node
+	};
+
+	/// A vertex that is close to a face
+	struct VertexFace
+	{
+		uint32					mVertex;								///< Index of the vertex
+		uint32					mFace;									///< Index of the face
+		float					mSide;									///< 1 if the vertex was in front of the face when the pair was found, -1 if it was behind
+	};
+
+	/// Two edges that are close to each other
+	struct EdgeEdge
+	{
+		uint32					mEdge[2];								///< Indices of the edges in mEdges
+	};
+
+	/// Recursively build the hierarchy
+	uint32						BuildNode(const Array<Vertex> &inVertices, uint inStart, uint inEnd);
+
+	/// Visit all faces of which the bounding box overlaps with inBox
+	template <class Visitor>
+	inline void					VisitFaces(const AABox &inBox, const Visitor &inVisitor) const;
+
+	float						mDistance = 0.0f;						///< Minimal distance between the vertices and the faces / edges of the soft body
+	float						mMargin = 0.0f;							///< Amount that the bounding boxes were expanded by in Prepare
+	Array<Node>					mNodes;									///< Nodes of the hierarchy, the first node is the root
+	Array<uint32>				mFaceOrder;								///< Indices of the faces in the order they're referenced by the leaf nodes
+	Array<uint32>				mFaceVertices;							///< 3 vertex indices per face
+	Array<uint32>				mFaceEdges;								///< 3 edge indices per face
+	Array<uint32>				mEdges;									///< 2 vertex indices per unique edge
+	Array<uint32>				mEdgeOwner;								///< For each edge the first face that uses it, used to report each edge only once
+	Array<Array<VertexFace>>	mVertexCandidates;						///< Vertex-triangle pairs per batch
+	Array<Array<EdgeEdge>>		mEdgeCandidates;						///< Edge-edge pairs per batch
+};
+
+JPH_NAMESPACE_END
@@ -94,6 +94,7 @@ JPH_IMPLEMENT_SERIALIZABLE_NON_VIRTUAL(SoftBodySharedSettings)
 	JPH_ADD_ATTRIBUTE(SoftBodySharedSettings, mLRAConstraints)
 	JPH_ADD_ATTRIBUTE(SoftBodySharedSettings, mMaterials)
 	JPH_ADD_ATTRIBUTE(SoftBodySharedSettings, mVertexRadius)
+	JPH_ADD_ATTRIBUTE(SoftBodySharedSettings, mSelfCollisionDistance)
 }
 
 void SoftBodySharedSettings::CalculateClosestKinematic()
@@ -461,7 +462,62 @@ void SoftBodySharedSettings::CalculateSkinnedConstraintNormals()
 	mSkinnedConstraintNormals.shrink_to_fit();
 }
 
-void SoftBodySharedSettings::Optimize(OptimizationResults &outResults)
+/// Reorder a sorted list of constraints so that as many consecutive batches of 4 constraints as possible don't share any vertices.
+/// These batches can be solved using SIMD instructions, see SoftBodyMotionProperties::ApplyEdgeConstraints.
+/// Constraints are only pulled forward from a small window so that the order determined by sorting is mostly preserved.
+template <class Constraint, class SharesVertex>
+static void sReorderForSIMDBatches(Array<uint> &ioConstraints, const Array<Constraint> &inConstraints, const SharesVertex &inSharesVertex)
+{
+	constexpr uint cBatchSize = 4;
+	constexpr uint cMaxLookAhead = 32;
+
+	uint num_constraints = (uint)ioConstraints.size();
+	if (num_constraints <= cBatchSize)
+		return;
+
+	Array<uint> result;
+	result.reserve(num_constraints);
+	Array<bool> used;
+	used.resize(num_constraints, false);
+
+	uint first_unused = 0;
+	while (first_unused < num_constraints)
+	{
+		// Start a new batch with the first constraint that has not been used yet
+		uint batch[cBatchSize] = { first_unused };
+		uint batch_size = 1;
+		used[first_unused] = true;
+
+		// Fill up the batch with constraints that don't share vertices with the constraints in the batch
+		for (uint i = first_unused + 1, num_checked = 0; i < num_constraints && batch_size < cBatchSize && num_checked < cMaxLookAhead; ++i)
+			if (!used[i])
+			{
+				++num_checked;
+
+				const Constraint &c = inConstraints[ioConstraints[i]];
+				bool shares_vertex = false;
+				for (uint b = 0; b < batch_size && !shares_vertex; ++b)
+					shares_vertex = inSharesVertex(c, inConstraints[ioConstraints[batch[b]]]);
+				if (!shares_vertex)
+				{
+					batch[batch_size++] = i;
+					used[i] = true;
+				}
+			}
+
+		// Output the batch
+		for (uint b = 0; b < batch_size; ++b)
+			result.push_back(ioConstraints[batch[b]]);
+
+		// Find the next constraint that has not been used
+		while (first_unused < num_constraints && used[first_unused])
+			++first_unused;
+	}
+
+	ioConstraints.swap(result);
+}
+
+void SoftBodySharedSettings::Optimize(OptimizationResults &outResults, EOptimizationQuality inQuality)
 {
 	// Clear any previous results
 	mUpdateGroups.clear();
@@ -705,6 +761,89 @@ void SoftBodySharedSettings::Optimize(OptimizationResults &outResults)
 	// Sort the parallel groups from big to small (this means the big groups will be scheduled first and have more time to complete)
 	QuickSort(groups.begin(), groups.end() - 1, [](const Group &inLHS, const Group &inRHS) { return inLHS.GetSize() > inRHS.GetSize(); });
 
+	// Remove parallel groups that ended up without constraints, they are at the end
+	while (groups.size() > 1 && groups[groups.size() - 2].GetSize() == 0)
+		groups.erase(groups.end() - 2);
+
+	// The parallel groups are executed in layers, all groups in a layer need to finish before the next layer starts.
+	// The first layer contains the groups that were created by grouping connected vertices.
+	Array<uint> layer_num_groups;
+	if (groups.size() > 1)
+		layer_num_groups.push_back(uint(groups.size() - 1));
+
+	if (inQuality == EOptimizationQuality::High)
+	{
+		// Greedily color the constraints in the non-parallel group so that constraints with the same color don't share any vertices
+		constexpr uint cMaxColors = 32;
+		Array<uint32> vertex_colors; // Bit mask of colors that are used by the constraints of each vertex
+		vertex_colors.resize(mVertices.size(), 0);
+		auto assign_color = [&vertex_colors](const uint32 *inVertices, uint inNumVertices) {
+			uint32 used = 0;
+			for (const uint32 *v = inVertices; v < inVertices + inNumVertices; ++v)
+				used |= vertex_colors[*v];
+			if (used == 0xffffffff)
+				return cMaxColors;
+			uint color = CountTrailingZeros(~used);
+			for (const uint32 *v = inVertices; v < inVertices + inNumVertices; ++v)
+				vertex_colors[*v] |= 1 << color;
+			return color;
+		};
+
+		Array<Group> colors;
+		colors.resize(cMaxColors + 1); // + constraints that could not be colored
+		const Group &non_parallel = groups.back();
+		for (uint idx : non_parallel.mEdgeConstraints)
+			colors[assign_color(mEdgeConstraints[idx].mVertex, 2)].mEdgeConstraints.push_back(idx);
+		for (uint idx : non_parallel.mLRAConstraints)
+			colors[assign_color(mLRAConstraints[idx].mVertex, 2)].mLRAConstraints.push_back(idx);
+		for (uint idx : non_parallel.mDihedralBendConstraints)
+			colors[assign_color(mDihedralBendConstraints[idx].mVertex, 4)].mDihedralBendConstraints.push_back(idx);
+		for (uint idx : non_parallel.mVolumeConstraints)
+			colors[assign_color(mVolumeConstraints[idx].mVertex, 4)].mVolumeConstraints.push_back(idx);
+		for (uint idx : non_parallel.mSkinnedConstraints)
+			colors[assign_color(&mSkinnedConstraints[idx].mVertex, 1)].mSkinnedConstraints.push_back(idx);
+		groups.pop_back();
+
+		// Every color that has enough constraints to be split into multiple groups becomes a new layer, the other constraints go back to the non-parallel group.
+		// Constraints within a color don't share vertices, so any split into groups can be executed in parallel.
+		constexpr uint cConstraintsPerGroup = SoftBodyUpdateContext::cVertexConstraintBatch / 2;
+		constexpr uint cMaxLayers = 8;
+		Group remaining;
+		for (uint c = 0; c < cMaxColors + 1; ++c)
+		{
+			Group &color = colors[c];
+			uint size = color.GetSize();
+			if (c < cMaxColors && size >= 2 * cConstraintsPerGroup && layer_num_groups.size() < cMaxLayers)
+			{
+				// Split the color in groups, constraints of the same type that are next to each other stay together
+				uint num_groups = (size + cConstraintsPerGroup - 1) / cConstraintsPerGroup;
+				uint first_group = (uint)groups.size();
+				groups.resize(first_group + num_groups);
+				uint constraint = 0;
+				auto split = [&groups, first_group, num_groups, size, &constraint](const Array<uint> &inConstraints, Array<uint> Group::*inMember) {
+					for (uint idx : inConstraints)
+						(groups[first_group + constraint++ * num_groups / size].*inMember).push_back(idx);
+				};
+				split(color.mEdgeConstraints, &Group::mEdgeConstraints);
+				split(color.mLRAConstraints, &Group::mLRAConstraints);
+				split(color.mDihedralBendConstraints, &Group::mDihedralBendConstraints);
+				split(color.mVolumeConstraints, &Group::mVolumeConstraints);
+				split(color.mSkinnedConstraints, &Group::mSkinnedConstraints);
+				layer_num_groups.push_back(num_groups);
+			}
+			else
+			{
+				// Move the constraints back to the non-parallel group
+				remaining.mEdgeConstraints.insert(remaining.mEdgeConstraints.end(), color.mEdgeConstraints.begin(), color.mEdgeConstraints.end());
+				remaining.mLRAConstraints.insert(remaining.mLRAConstraints.end(), color.mLRAConstraints.begin(), color.mLRAConstraints.end());
+				remaining.mDihedralBendConstraints.insert(remaining.mDihedralBendConstraints.end(), color.mDihedralBendConstraints.begin(), color.mDihedralBendConstraints.end());
+				remaining.mVolumeConstraints.insert(remaining.mVolumeConstraints.end(), color.mVolumeConstraints.begin(), color.mVolumeConstraints.end());
+				remaining.mSkinnedConstraints.insert(remaining.mSkinnedConstraints.end(), color.mSkinnedConstraints.begin(), color.mSkinnedConstraints.end());
+			}
+		}
+		groups.push_back(std::move(remaining));
+	}
+
 	// Make sure we know the closest kinematic vertex so we can sort
 	CalculateClosestKinematic();
 
@@ -816,6 +955,27 @@ void SoftBodySharedSettings::Optimize(OptimizationResults &outResults)
 
 				return inLHS < inRHS;
 			});
+
+		// Form batches of constraints that don't share vertices so they can be solved using SIMD
+		sReorderForSIMDBatches(group.mEdgeConstraints, mEdgeConstraints, [](const Edge &inLHS, const Edge &inRHS)
+			{
+				for (uint32 v : inLHS.mVertex)
+					if (v == inRHS.mVertex[0] || v == inRHS.mVertex[1])
+						return true;
+				return false;
+			});
+		sReorderForSIMDBatches(group.mLRAConstraints, mLRAConstraints, [](const LRA &inLHS, const LRA &inRHS)
+			{
+				// Only the 2nd vertex is modified, so it is fine if multiple constraints share the same 1st vertex
+				return inLHS.mVertex[1] == inRHS.mVertex[0] || inLHS.mVertex[1] == inRHS.mVertex[1] || inLHS.mVertex[0] == inRHS.mVertex[1];
+			});
+		sReorderForSIMDBatches(group.mDihedralBendConstraints, mDihedralBendConstraints, [](const DihedralBend &inLHS, const DihedralBend &inRHS)
+			{
+				for (uint32 v : inLHS.mVertex)
+					if (v == inRHS.mVertex[0] || v == inRHS.mVertex[1] || v == inRHS.mVertex[2] || v == inRHS.mVertex[3])
+						return true;
+				return false;
+			});
 	}
 
 	// Temporary store constraints as we reorder them
@@ -886,11 +1046,52 @@ void SoftBodySharedSettings::Optimize(OptimizationResults &outResults)
 		mUpdateGroups.push_back({ (uint)mEdgeConstraints.size(), (uint)mLRAConstraints.size(), (uint)mDihedralBendConstraints.size(), (uint)mVolumeConstraints.size(), (uint)mSkinnedConstraints.size() });
 	}
 
+	// Store the end of each layer of parallel groups
+	mUpdateGroupLayerEnd.clear();
+	uint layer_end = 0;
+	for (uint num_groups : layer_num_groups)
+	{
+		layer_end += num_groups;
+		mUpdateGroupLayerEnd.push_back(layer_end);
+	}
+
 	// Free closest kinematic buffer
 	mClosestKinematic.clear();
 	mClosestKinematic.shrink_to_fit();
 }
 
+SoftBodySharedSettings::UpdateGroupStats SoftBodySharedSettings::GetUpdateGroupStats() const
+{
+	UpdateGroupStats stats;
+	if (mUpdateGroups.empty())
+		return stats;
+
+	stats.mNumParallelGroups = (uint)mUpdateGroups.size() - 1;
+	stats.mNumLayers = (uint)mUpdateGroupLayerEnd.size();
+	stats.mMinParallelGroupSize = stats.mNumParallelGroups > 0? UINT_MAX : 0;
+
+	UpdateGroup prev { 0, 0, 0, 0, 0 };
+	for (const UpdateGroup &group : mUpdateGroups)
+	{
+		uint size = group.mEdgeEndIndex - prev.mEdgeEndIndex
+			+ group.mLRAEndIndex - prev.mLRAEndIndex
+			+ group.mDihedralBendEndIndex - prev.mDihedralBendEndIndex
+			+ group.mVolumeEndIndex - prev.mVolumeEndIndex
+			+ group.mSkinnedEndIndex - prev.mSkinnedEndIndex;
+		if (&group == &mUpdateGroups.back())
+			stats.mNonParallelGroupSize = size;
+		else
+		{
+			stats.mMinParallelGroupSize = min(stats.mMinParallelGroupSize, size);
+			stats.mMaxParallelGroupSize = max(stats.mMaxParallelGroupSize, size);
+		}
+		stats.mNumConstraints += size;
+		prev = group;
+	}
+
+	return stats;
+}
+
 Ref<SoftBodySharedSettings> SoftBodySharedSettings::Clone() const
 {
 	Ref<SoftBodySharedSettings> clone = new SoftBodySharedSettings;
@@ -905,7 +1106,9 @@ Ref<SoftBodySharedSettings> SoftBodySharedSettings::Clone() const
 	clone->mLRAConstraints = mLRAConstraints;
 	clone->mMaterials = mMaterials;
 	clone->mVertexRadius = mVertexRadius;
+	clone->mSelfCollisionDistance = mSelfCollisionDistance;
 	clone->mUpdateGroups = mUpdateGroups;
+	clone->mUpdateGroupLayerEnd = mUpdateGroupLayerEnd;
 	return clone;
 }
 
@@ -920,7 +1123,9 @@ void SoftBodySharedSettings::SaveBinaryState(StreamOut &inStream) const
 	inStream.Write(mSkinnedConstraintNormals);
 	inStream.Write(mLRAConstraints);
 	inStream.Write(mVertexRadius);
+	inStream.Write(mSelfCollisionDistance);
 	inStream.Write(mUpdateGroups);
+	inStream.Write(mUpdateGroupLayerEnd);
 
 	// Can't write mInvBindMatrices directly because the class contains padding
 	inStream.Write(mInvBindMatrices, [](const InvBind &inElement, StreamOut &inS) {
@@ -940,7 +1145,9 @@ void SoftBodySharedSettings::RestoreBinaryState(StreamIn &inStream)
 	inStream.Read(mSkinnedConstraintNormals);
 	inStream.Read(mLRAConstraints);
 	inStream.Read(mVertexRadius);
+	inStream.Read(mSelfCollisionDistance);
 	inStream.Read(mUpdateGroups);
+	inStream.Read(mUpdateGroupLayerEnd);
 
 	inStream.Read(mInvBindMatrices, [](StreamIn &inS, InvBind &outElement) {
 		inS.Read(outElement.mJointIndex);
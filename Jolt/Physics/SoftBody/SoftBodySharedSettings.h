@@ -83,16 +83,38 @@ public:
 		Array<uint>		mSkinnedRemap;								///< Maps old skinned constraint index to new skinned constraint index
 	};
 
+	/// How much time Optimize should spend on reducing the amount of constraints that cannot be executed in parallel
+	enum class EOptimizationQuality
+	{
+		Fast,														///< Greedily group connected vertices, suitable for optimizing at load time
+		High,														///< After grouping, color the constraints that cross groups so that they can be executed in parallel in additional layers of groups. Intended to be used in an offline asset pipeline, see SaveBinaryState.
+	};
+
 	/// Optimize the soft body settings for simulation. This will reorder constraints so they can be executed in parallel.
-	void				Optimize(OptimizationResults &outResults);
+	void				Optimize(OptimizationResults &outResults, EOptimizationQuality inQuality = EOptimizationQuality::Fast);
 
 	/// Optimize the soft body settings without results
-	void				Optimize()									{ OptimizationResults results; Optimize(results); }
+	void				Optimize(EOptimizationQuality inQuality = EOptimizationQuality::Fast) { OptimizationResults results; Optimize(results, inQuality); }
+
+	/// Statistics on how the constraints were divided into groups by Optimize
+	struct UpdateGroupStats
+	{
+		uint			mNumParallelGroups = 0;						///< Number of groups of constraints that can be executed in parallel
+		uint			mNumLayers = 0;								///< Number of layers of parallel groups, all groups in a layer need to finish before the next layer can start
+		uint			mMinParallelGroupSize = 0;					///< Number of constraints in the smallest parallel group
+		uint			mMaxParallelGroupSize = 0;					///< Number of constraints in the largest parallel group
+		uint			mNonParallelGroupSize = 0;					///< Number of constraints in the group that is executed by a single thread after all parallel groups have finished
+		uint			mNumConstraints = 0;						///< Total number of constraints
+	};
+
+	/// Get statistics on the groups that were created by Optimize
+	UpdateGroupStats	GetUpdateGroupStats() const;
 
 	/// Clone this object
 	Ref<SoftBodySharedSettings> Clone() const;
 
 	/// Saves the state of this object in binary form to inStream. Doesn't store the material list.
+	/// The result of Optimize is stored too, so settings can be optimized offline and don't need to be optimized again after they have been restored.
 	void				SaveBinaryState(StreamOut &inStream) const;
 
 	/// Restore the state of this object from inStream. Doesn't restore the material list.
@@ -303,6 +325,7 @@ public:
 	Array<LRA>			mLRAConstraints;							///< The list of long range attachment constraints
 	PhysicsMaterialList mMaterials { PhysicsMaterial::sDefault };	///< The materials of the faces of the body, referenced by Face::mMaterialIndex
 	float				mVertexRadius = 0.0f;						///< How big the particles are, can be used to push the vertices a little bit away from the surface of other bodies to prevent z-fighting
+	float				mSelfCollisionDistance = 0.0f;				///< When > 0, the soft body collides with itself: vertices are kept this distance away from the faces and the edges of the faces are kept this distance away from each other
 
 private:
 	friend class SoftBodyMotionProperties;
@@ -329,6 +352,7 @@ private:
 
 	Array<ClosestKinematic> mClosestKinematic;						///< The closest kinematic vertex to each vertex in mVertices
 	Array<UpdateGroup>	mUpdateGroups;								///< The end indices for each group of constraints that can be updated in parallel
+	Array<uint>			mUpdateGroupLayerEnd;						///< For each layer of groups that can be updated in parallel, the index in mUpdateGroups of the end of the layer
 	Array<uint32>		mSkinnedConstraintNormals;					///< A list of indices in the mFaces array used by mSkinnedConstraints, calculated by CalculateSkinnedConstraintNormals()
 };
 
@@ -19,6 +19,7 @@ class SoftBodyUpdateContext : public NonCopyable
 public:
 	static constexpr uint				cVertexCollisionBatch = 64;					///< Number of vertices to process in a batch in DetermineCollisionPlanes
 	static constexpr uint				cVertexConstraintBatch = 256;				///< Number of vertices to group for processing batches of constraints in ApplyEdgeConstraints
+	static constexpr uint				cConstraintGroupLayerShift = 16;			///< mNextConstraintGroup stores the layer of the constraint group in the bits above this shift
 
 	// Input
 	Body *								mBody;										///< Body that is being updated
@@ -35,6 +36,7 @@ public:
 	{
 		DetermineCollisionPlanes,													///< Determine collision planes for vertices in parallel
 		DetermineSensorCollisions,													///< Determine collisions with sensors in parallel
+		DetermineSelfCollisions,													///< Determine self collision candidates in parallel
 		ApplyConstraints,															///< Apply constraints in parallel
 		Done																		///< Update is finished
 	};
@@ -45,9 +47,13 @@ public:
 	atomic<uint>						mNumCollisionVerticesProcessed { 0 };		///< Number of vertices processed by DetermineCollisionPlanes, used to determine if we can go to the next step
 	atomic<uint>						mNextSensorIndex { 0 };						///< Next sensor to process for DetermineCollisionPlanes
 	atomic<uint>						mNumSensorsProcessed { 0 };					///< Number of sensors processed by DetermineSensorCollisions, used to determine if we can go to the next step
+	atomic<uint>						mNextSelfCollisionBatch { 0 };				///< Next batch to process for DetermineSelfCollisions
+	atomic<uint>						mNumSelfCollisionBatchesProcessed { 0 };	///< Number of batches processed by DetermineSelfCollisions, used to determine if we can go to the next step
 	atomic<uint>						mNextIteration { 0 };						///< Next simulation iteration to process
-	atomic<uint>						mNextConstraintGroup { 0 };					///< Next constraint group to process
+	atomic<uint>						mNextConstraintGroup { 0 };					///< Next constraint group to process, relative to the start of the current layer which is stored in the upper bits
 	atomic<uint>						mNumConstraintGroupsProcessed { 0 };		///< Number of groups processed, used to determine if we can go to the next iteration
+	atomic<uint>						mPhase { 0 };								///< Incremented every time the update moves to a new state or iteration that can be processed in parallel
+	atomic<uint>						mScheduledPhase { 0 };						///< Last phase for which the job scheduler spawned jobs
 
 	// Output
 	Vec3								mDeltaPosition;								///< Delta position of the body in the current time step, should be applied after the update
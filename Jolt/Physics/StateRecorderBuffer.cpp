@@ -0,0 +1,129 @@
+// Jolt Physics Library (https://github.com/jrouwe/JoltPhysics)
+// SPDX-FileCopyrightText: 2024 Jorrit Rouwe
+// SPDX-License-Identifier: MIT
+
+#include <Jolt/Jolt.h>
+
+#include <Jolt/Physics/StateRecorderBuffer.h>
+
+JPH_NAMESPACE_BEGIN
+
+StateRecorderBuffer::StateRecorderBuffer(StateRecorderBuffer &&inRHS) :
+	StateRecorder(inRHS),
+	mOwnedBuffer(std::move(inRHS.mOwnedBuffer)),
+	mData(inRHS.mData),
+	mCapacity(inRHS.mCapacity),
+	mWriteOffset(inRHS.mWriteOffset),
+	mReadOffset(inRHS.mReadOffset),
+	mOwnsBuffer(inRHS.mOwnsBuffer),
+	mIsEOF(inRHS.mIsEOF),
+	mIsFailed(inRHS.mIsFailed)
+{
+	// Leave the other recorder empty
+	inRHS.mData = nullptr;
+	inRHS.mCapacity = 0;
+	inRHS.mWriteOffset = 0;
+	inRHS.mReadOffset = 0;
+	inRHS.mOwnsBuffer = true;
+}
+
+void StateRecorderBuffer::Reserve(size_t inSize)
+{
+	JPH_ASSERT(mOwnsBuffer, "Can't grow memory that was provided by the caller");
+
+	if (inSize > mCapacity && mOwnsBuffer)
+	{
+		// Array::resize copies the data that was already written
+		mOwnedBuffer.resize(inSize);
+		mData = mOwnedBuffer.data();
+		mCapacity = inSize;
+	}
+}
+
+void StateRecorderBuffer::WriteBytes(const void *inData, size_t inNumBytes)
+{
+	size_t new_size = mWriteOffset + inNumBytes;
+	if (new_size > mCapacity)
+	{
+		// Memory provided by the caller can't grow
+		if (!mOwnsBuffer)
+		{
+			mIsFailed = true;
+			return;
+		}
+
+		// Grow geometrically so that the number of allocations stays low while the buffer is filled for the first time
+		Reserve(max(new_size, 2 * mCapacity));
+	}
+
+	memcpy(mData + mWriteOffset, inData, inNumBytes);
+	mWriteOffset = new_size;
+}
+
+void StateRecorderBuffer::ReadBytes(void *outData, size_t inNumBytes)
+{
+	// Check if there's enough data left
+	if (inNumBytes > mWriteOffset - mReadOffset)
+	{
+		mIsEOF = true;
+		mIsFailed = true;
+		return;
+	}
+
+	const uint8 *data = mData + mReadOffset;
+	mReadOffset += inNumBytes;
+
+	if (IsValidating())
+	{
+		// Compare the recorded data with the current value
+		if (memcmp(data, outData, inNumBytes) != 0)
+		{
+			// Mismatch, print error
+			Trace("Mismatch reading %u bytes", (uint)inNumBytes);
+			for (size_t i = 0; i < inNumBytes; ++i)
+			{
+				int b1 = reinterpret_cast<uint8 *>(outData)[i];
+				int b2 = data[i];
+				if (b1 != b2)
+					Trace("Offset %d: %02X -> %02X", i, b1, b2);
+			}
+			JPH_BREAKPOINT;
+		}
+	}
+
+	memcpy(outData, data, inNumBytes);
+}
+
+void StateRecorderBuffer::SkipBytes(size_t inNumBytes)
+{
+	if (inNumBytes > mWriteOffset - mReadOffset)
+	{
+		mIsEOF = true;
+		mIsFailed = true;
+		return;
+	}
+
+	mReadOffset += inNumBytes;
+}
+
+bool StateRecorderBuffer::IsEqual(const StateRecorderBuffer &inReference) const
+{
+	// Compare size
+	if (mWriteOffset != inReference.mWriteOffset)
+	{
+		Trace("Failed to properly recover state, different stream length!");
+		return false;
+	}
+
+	// Find the first byte that differs
+	for (size_t i = 0; i < mWriteOffset; ++i)
+		if (mData[i] != inReference.mData[i])
+		{
+			Trace("Failed to properly recover state, different at offset %d!", (int)i);
+			return false;
+		}
+
+	return true;
+}
+
+JPH_NAMESPACE_END
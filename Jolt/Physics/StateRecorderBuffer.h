@@ -0,0 +1,83 @@
+// Jolt Physics Library (https://github.com/jrouwe/JoltPhysics)
+// SPDX-FileCopyrightText: 2024 Jorrit Rouwe
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <Jolt/Physics/StateRecorder.h>
+
+JPH_NAMESPACE_BEGIN
+
+/// Implementation of the StateRecorder class that uses a flat block of memory as underlying store.
+///
+/// Contrary to StateRecorderImpl, which goes through a stringstream, this class does not allocate when it is reused:
+/// Clear keeps the memory so that saving the state every frame (e.g. for rollback networking) is allocation free once the buffer has grown to the size of the state.
+/// The memory can either be owned by the recorder (in which case it grows when needed) or provided by the caller (in which case writing past the end fails).
+class JPH_EXPORT StateRecorderBuffer final : public StateRecorder
+{
+public:
+	/// Constructor, the recorder owns its memory and grows it when needed
+						StateRecorderBuffer() = default;
+
+	/// Constructor, the recorder uses the memory provided by the caller and cannot grow. The memory must outlive the recorder.
+	/// @param inBuffer Memory to write the state to
+	/// @param inSize Size of the memory in bytes
+						StateRecorderBuffer(void *inBuffer, size_t inSize)			: mData(static_cast<uint8 *>(inBuffer)), mCapacity(inSize), mOwnsBuffer(false) { }
+
+	/// Move constructor
+						StateRecorderBuffer(StateRecorderBuffer &&inRHS);
+
+	/// Ensure that at least inSize bytes can be written without allocating (only for recorders that own their memory)
+	void				Reserve(size_t inSize);
+
+	/// Write a string of bytes to the buffer
+	virtual void		WriteBytes(const void *inData, size_t inNumBytes) override;
+
+	/// Rewind the buffer for reading
+	void				Rewind()													{ mReadOffset = 0; mIsEOF = false; }
+
+	/// Clear the buffer for reuse, this keeps the memory
+	void				Clear()														{ mWriteOffset = 0; mReadOffset = 0; mIsEOF = false; mIsFailed = false; }
+
+	/// Read a string of bytes from the buffer
+	virtual void		ReadBytes(void *outData, size_t inNumBytes) override;
+
+	// See StreamIn
+	virtual bool		IsEOF() const override										{ return mIsEOF; }
+
+	// See StreamIn / StreamOut
+	virtual bool		IsFailed() const override									{ return mIsFailed; }
+
+	/// Compare this state with a reference state and ensure they are the same
+	bool				IsEqual(const StateRecorderBuffer &inReference) const;
+
+	/// Get the binary data
+	const uint8 *		GetData() const												{ return mData; }
+
+	/// Get size of the binary data in bytes
+	size_t				GetDataSize() const											{ return mWriteOffset; }
+
+	/// Get the number of bytes that can be written without allocating
+	size_t				GetCapacity() const											{ return mCapacity; }
+
+	/// Set the size of the binary data in bytes, use this when the data was copied into the memory directly (e.g. when it was received over the network)
+	void				SetDataSize(size_t inSize)									{ JPH_ASSERT(inSize <= mCapacity); mWriteOffset = inSize; }
+
+	/// Get the offset of the next byte to read
+	size_t				GetReadOffset() const										{ return mReadOffset; }
+
+	/// Skip inNumBytes bytes when reading
+	void				SkipBytes(size_t inNumBytes);
+
+private:
+	Array<uint8>		mOwnedBuffer;												///< Memory owned by this recorder, empty if the memory was provided by the caller
+	uint8 *				mData = nullptr;											///< Start of the memory
+	size_t				mCapacity = 0;												///< Size of the memory in bytes
+	size_t				mWriteOffset = 0;											///< Number of bytes written
+	size_t				mReadOffset = 0;											///< Number of bytes read
+	bool				mOwnsBuffer = true;											///< If the memory is owned by this recorder and can grow
+	bool				mIsEOF = false;												///< If a read went past the end of the data
+	bool				mIsFailed = false;											///< If a read or write failed
+};
+
+JPH_NAMESPACE_END
@@ -0,0 +1,90 @@
+// Jolt Physics Library (https://github.com/jrouwe/JoltPhysics)
+// SPDX-FileCopyrightText: 2024 Jorrit Rouwe
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <Jolt/Physics/StateRecorderBuffer.h>
+#include <Jolt/Physics/Body/BodyPair.h>
+
+JPH_NAMESPACE_BEGIN
+
+/// Settings that determine how PhysicsSystem::SaveStateDelta stores the bodies that changed
+class JPH_EXPORT DeltaStateSettings
+{
+public:
+	/// When false the state of changed bodies is stored exactly and restoring the delta gives the same state as restoring a full state.
+	/// When true position, rotation and velocity changes are stored with limited precision, this makes the delta smaller but the restored state will differ
+	/// slightly from the saved state (the simulation is no longer deterministic after restoring). Changes smaller than the precision are not stored at all.
+	bool				mQuantize = false;
+
+	/// Precision of the change in position (m) relative to the reference when mQuantize is true. Changes that are larger than 32767 * mPositionPrecision are stored exactly.
+	/// A precision of 0 (for either value) disables quantization.
+	float				mPositionPrecision = 1.0e-3f;
+
+	/// Precision of the change in linear (m/s) and angular (rad/s) velocity relative to the reference when mQuantize is true. Changes that are larger than 32767 * mVelocityPrecision are stored exactly.
+	float				mVelocityPrecision = 1.0e-3f;
+};
+
+/// A full state of the physics system that delta states are saved against and restored on top of, see PhysicsSystem::SaveStateReference.
+///
+/// For rollback networking you save a reference every couple of frames and for every frame in between a delta against that reference.
+/// Each delta only depends on the reference, so any frame can be restored without restoring the frames before it.
+/// Bodies, contacts and constraints that haven't changed since the reference are not stored in the delta.
+class JPH_EXPORT DeltaStateReference : public NonCopyable
+{
+public:
+	/// Clear the reference for reuse, this keeps the memory
+	void				Clear()														{ mState.Clear(); mBodies.clear(); mBodyData.Clear(); mContacts.clear(); mContactData.Clear(); mConstraints.clear(); mConstraintData.Clear(); }
+
+	/// Check if a reference has been saved
+	bool				IsEmpty() const												{ return mState.GetDataSize() == 0; }
+
+	/// Get the full state of the physics system, this can also be restored with PhysicsSystem::RestoreState
+	const StateRecorderBuffer &	GetState() const									{ return mState; }
+
+private:
+	friend class PhysicsSystem;
+	friend class BodyManager;
+	friend class ContactConstraintManager;
+	friend class ConstraintManager;
+
+	/// State of a body in mBodyData
+	struct BodyState
+	{
+		BodyID			mID;														///< ID of the body
+		uint32			mOffset;													///< Offset in mBodyData of the data written by Body::SaveState
+		uint32			mSize;														///< Size of the data written by Body::SaveState
+		bool			mIsActive;													///< If the body was active
+	};
+
+	/// State of a body pair and its manifolds in mContactData
+	struct ContactState
+	{
+		BodyPair		mKey;														///< Key of the body pair
+		uint32			mOffset;													///< Offset in mContactData of the data written by ManifoldCache::SaveBodyPair
+		uint32			mSize;														///< Size of the data written by ManifoldCache::SaveBodyPair
+	};
+
+	/// State of a constraint in mConstraintData
+	struct ConstraintState
+	{
+		uint32			mOffset;													///< Offset in mConstraintData of the data written by Constraint::SaveState
+		uint32			mSize;														///< Size of the data written by Constraint::SaveState
+	};
+
+	StateRecorderBuffer	mState;														///< Full state as written by PhysicsSystem::SaveState
+	Array<BodyState>	mBodies;													///< State of all bodies in order of body index
+	StateRecorderBuffer	mBodyData;													///< Data written by Body::SaveState for all bodies, used to determine which bodies changed
+	Array<ContactState>	mContacts;													///< State of all body pairs in the contact cache sorted by key
+	StateRecorderBuffer	mContactData;												///< Data of all body pairs, restored for the body pairs that didn't change
+	Array<ConstraintState> mConstraints;											///< State of all constraints in order of constraint index
+	StateRecorderBuffer	mConstraintData;											///< Data of all constraints in the format of ConstraintManager::SaveState, restored before the constraints of the delta
+
+	// Scratch memory that is reused so that saving and restoring a delta doesn't allocate once it has grown, this means that a reference cannot be used by multiple threads at the same time
+	mutable StateRecorderBuffer	mScratch;											///< State of a single body, body pair or constraint while saving a delta
+	mutable StateRecorderBuffer	mChangedData;										///< Body pairs or constraints that changed while saving a delta
+	mutable Array<BodyPair> mSkippedContacts;										///< Body pairs of the reference that are not restored
+};
+
+JPH_NAMESPACE_END
@@ -0,0 +1,23 @@
+// Jolt Physics Library (https://github.com/jrouwe/JoltPhysics)
+// SPDX-FileCopyrightText: 2024 Jorrit Rouwe
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <Jolt/Core/JobBatches.h>
+
+JPH_NAMESPACE_BEGIN
+
+/// Constants to save / restore the state of a physics system using multiple jobs through JobBatches.
+/// The items (bodies, body pairs) are split in batches of consecutive items so that the data of a batch is a consecutive range in the stream.
+class StateRecorderJobs
+{
+public:
+	/// Number of items in a batch
+	static constexpr uint	cBatchSize = 256;
+
+	/// Get the number of batches needed for inNumItems
+	static uint				sGetNumBatches(uint inNumItems)					{ return JobBatches::sGetNumBatches(inNumItems, cBatchSize); }
+};
+
+JPH_NAMESPACE_END
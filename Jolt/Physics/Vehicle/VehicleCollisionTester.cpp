@@ -12,11 +12,120 @@
 #include <Jolt/Physics/Collision/Shape/SphereShape.h>
 #include <Jolt/Physics/Collision/Shape/CylinderShape.h>
 #include <Jolt/Physics/Collision/CollisionCollectorImpl.h>
+#include <Jolt/Physics/Collision/BroadPhase/BroadPhaseBodyList.h>
 #include <Jolt/Physics/PhysicsSystem.h>
+#include <Jolt/Core/StaticArray.h>
+#include <Jolt/Core/QuickSort.h>
+#include <Jolt/Core/Profiler.h>
 
 JPH_NAMESPACE_BEGIN
 
+void VehicleCollisionTester::CollideWheels(PhysicsSystem &inPhysicsSystem, const VehicleConstraint &inVehicleConstraint, const BodyID &inVehicleBodyID, WheelCollision *ioWheels, uint inNumWheels) const
+{
+	// Test the wheels one by one
+	for (WheelCollision *w = ioWheels, *w_end = ioWheels + inNumWheels; w < w_end; ++w)
+		if (!Collide(inPhysicsSystem, inVehicleConstraint, w->mWheelIndex, w->mOrigin, w->mDirection, inVehicleBodyID, w->mBody, w->mSubShapeID, w->mContactPosition, w->mContactNormal, w->mSuspensionLength))
+			w->mBody = nullptr;
+}
+
+template <class CollideWheelFunction>
+void VehicleCollisionTester::CollideWheelsShared(PhysicsSystem &inPhysicsSystem, const VehicleConstraint &inVehicleConstraint, WheelCollision *ioWheels, uint inNumWheels, const CollideWheelFunction &inCollideWheel) const
+{
+	JPH_PROFILE_FUNCTION();
+
+	WheelCollision *w_end = ioWheels + inNumWheels;
+
+	// A single wheel doesn't benefit from sharing the broad phase query
+	if (inNumWheels > 1)
+	{
+		const DefaultBroadPhaseLayerFilter default_broadphase_layer_filter = inPhysicsSystem.GetDefaultBroadPhaseLayerFilter(mObjectLayer);
+		const BroadPhaseLayerFilter &broadphase_layer_filter = mBroadPhaseLayerFilter != nullptr? *mBroadPhaseLayerFilter : default_broadphase_layer_filter;
+
+		const DefaultObjectLayerFilter default_object_layer_filter = inPhysicsSystem.GetDefaultLayerFilter(mObjectLayer);
+		const ObjectLayerFilter &object_layer_filter = mObjectLayerFilter != nullptr? *mObjectLayerFilter : default_object_layer_filter;
+
+		// Calculate the bounds of the space that the wheels can touch, the suspension is tested from the origin down to the max suspension length plus the wheel radius.
+		// The test shape fits in a sphere that encloses the wheel, queries that don't fit in these bounds fall back to the real broad phase.
+		AABox bounds;
+		for (const WheelCollision *w = ioWheels; w < w_end; ++w)
+		{
+			const WheelSettings *wheel_settings = inVehicleConstraint.GetWheel(w->mWheelIndex)->GetSettings();
+			Vec3 origin(w->mOrigin);
+			AABox wheel_bounds(origin, origin);
+			wheel_bounds.Encapsulate(origin + (wheel_settings->mSuspensionMaxLength + wheel_settings->mRadius) * w->mDirection);
+			wheel_bounds.ExpandBy(Vec3::sReplicate(sqrt(Square(wheel_settings->mRadius) + Square(0.5f * wheel_settings->mWidth))));
+			bounds.Encapsulate(wheel_bounds);
+		}
+
+		// Collector that collects the bodies in the bounds
+		class MyCollector : public CollideShapeBodyCollector
+		{
+		public:
+			explicit			MyCollector(const BodyLockInterfaceNoLock &inBodyLockInterface) : mBodyLockInterface(inBodyLockInterface) { }
+
+			virtual void		AddHit(const ResultType &inResult) override
+			{
+				if (mBodies.size() == mBodies.capacity())
+				{
+					// Too many bodies, stop collecting
+					mOverflow = true;
+					ForceEarlyOut();
+					return;
+				}
+
+				const Body *body = mBodyLockInterface.TryGetBody(inResult);
+				if (body != nullptr)
+					mBodies.push_back(body);
+			}
+
+			const BodyLockInterfaceNoLock &	mBodyLockInterface;
+			StaticArray<const Body *, cMaxSharedBodies> mBodies;
+			bool				mOverflow = false;
+		};
+
+		// Do a single broad phase query for all wheels
+		MyCollector collector(inPhysicsSystem.GetBodyLockInterfaceNoLock());
+		inPhysicsSystem.GetBroadPhaseQuery().CollideAABox(bounds, collector, broadphase_layer_filter, object_layer_filter);
+		if (!collector.mOverflow)
+		{
+			// The order in which the broad phase returns bodies is not deterministic, sort them so that ties between hits are resolved the same way every time
+			QuickSort(collector.mBodies.begin(), collector.mBodies.end(), [](const Body *inLHS, const Body *inRHS) { return inLHS->GetID() < inRHS->GetID(); });
+
+			// Create a narrow phase query that only tests against the collected bodies
+			BroadPhaseBodyList body_list;
+			body_list.mBroadPhaseQuery = &inPhysicsSystem.GetBroadPhaseQuery();
+			body_list.mBounds = bounds;
+			body_list.mBodies = collector.mBodies.data();
+			body_list.mNumBodies = collector.mBodies.size();
+			NarrowPhaseQuery narrow_phase_query;
+			narrow_phase_query.Init(inPhysicsSystem.GetBodyLockInterfaceNoLock(), body_list);
+
+			for (WheelCollision *w = ioWheels; w < w_end; ++w)
+				if (!inCollideWheel(narrow_phase_query, *w))
+					w->mBody = nullptr;
+			return;
+		}
+	}
+
+	// Test each wheel against the full world
+	for (WheelCollision *w = ioWheels; w < w_end; ++w)
+		if (!inCollideWheel(inPhysicsSystem.GetNarrowPhaseQueryNoLock(), *w))
+			w->mBody = nullptr;
+}
+
 bool VehicleCollisionTesterRay::Collide(PhysicsSystem &inPhysicsSystem, const VehicleConstraint &inVehicleConstraint, uint inWheelIndex, RVec3Arg inOrigin, Vec3Arg inDirection, const BodyID &inVehicleBodyID, Body *&outBody, SubShapeID &outSubShapeID, RVec3 &outContactPosition, Vec3 &outContactNormal, float &outSuspensionLength) const
+{
+	return CollideWithQuery(inPhysicsSystem.GetNarrowPhaseQueryNoLock(), inPhysicsSystem, inVehicleConstraint, inWheelIndex, inOrigin, inDirection, inVehicleBodyID, outBody, outSubShapeID, outContactPosition, outContactNormal, outSuspensionLength);
+}
+
+void VehicleCollisionTesterRay::CollideWheels(PhysicsSystem &inPhysicsSystem, const VehicleConstraint &inVehicleConstraint, const BodyID &inVehicleBodyID, WheelCollision *ioWheels, uint inNumWheels) const
+{
+	CollideWheelsShared(inPhysicsSystem, inVehicleConstraint, ioWheels, inNumWheels, [this, &inPhysicsSystem, &inVehicleConstraint, &inVehicleBodyID](const NarrowPhaseQuery &inNarrowPhaseQuery, WheelCollision &ioWheel) {
+		return CollideWithQuery(inNarrowPhaseQuery, inPhysicsSystem, inVehicleConstraint, ioWheel.mWheelIndex, ioWheel.mOrigin, ioWheel.mDirection, inVehicleBodyID, ioWheel.mBody, ioWheel.mSubShapeID, ioWheel.mContactPosition, ioWheel.mContactNormal, ioWheel.mSuspensionLength);
+	});
+}
+
+bool VehicleCollisionTesterRay::CollideWithQuery(const NarrowPhaseQuery &inNarrowPhaseQuery, PhysicsSystem &inPhysicsSystem, const VehicleConstraint &inVehicleConstraint, uint inWheelIndex, RVec3Arg inOrigin, Vec3Arg inDirection, const BodyID &inVehicleBodyID, Body *&outBody, SubShapeID &outSubShapeID, RVec3 &outContactPosition, Vec3 &outContactNormal, float &outSuspensionLength) const
 {
 	const DefaultBroadPhaseLayerFilter default_broadphase_layer_filter = inPhysicsSystem.GetDefaultBroadPhaseLayerFilter(mObjectLayer);
 	const BroadPhaseLayerFilter &broadphase_layer_filter = mBroadPhaseLayerFilter != nullptr? *mBroadPhaseLayerFilter : default_broadphase_layer_filter;
@@ -89,7 +198,7 @@ bool VehicleCollisionTesterRay::Collide(PhysicsSystem &inPhysicsSystem, const Ve
 	RayCastSettings settings;
 
 	MyCollector collector(inPhysicsSystem, ray, mUp, mCosMaxSlopeAngle);
-	inPhysicsSystem.GetNarrowPhaseQueryNoLock().CastRay(ray, settings, collector, broadphase_layer_filter, object_layer_filter, body_filter);
+	inNarrowPhaseQuery.CastRay(ray, settings, collector, broadphase_layer_filter, object_layer_filter, body_filter);
 	if (collector.mBody == nullptr)
 		return false;
 
@@ -123,6 +232,18 @@ void VehicleCollisionTesterRay::PredictContactProperties(PhysicsSystem &inPhysic
 }
 
 bool VehicleCollisionTesterCastSphere::Collide(PhysicsSystem &inPhysicsSystem, const VehicleConstraint &inVehicleConstraint, uint inWheelIndex, RVec3Arg inOrigin, Vec3Arg inDirection, const BodyID &inVehicleBodyID, Body *&outBody, SubShapeID &outSubShapeID, RVec3 &outContactPosition, Vec3 &outContactNormal, float &outSuspensionLength) const
+{
+	return CollideWithQuery(inPhysicsSystem.GetNarrowPhaseQueryNoLock(), inPhysicsSystem, inVehicleConstraint, inWheelIndex, inOrigin, inDirection, inVehicleBodyID, outBody, outSubShapeID, outContactPosition, outContactNormal, outSuspensionLength);
+}
+
+void VehicleCollisionTesterCastSphere::CollideWheels(PhysicsSystem &inPhysicsSystem, const VehicleConstraint &inVehicleConstraint, const BodyID &inVehicleBodyID, WheelCollision *ioWheels, uint inNumWheels) const
+{
+	CollideWheelsShared(inPhysicsSystem, inVehicleConstraint, ioWheels, inNumWheels, [this, &inPhysicsSystem, &inVehicleConstraint, &inVehicleBodyID](const NarrowPhaseQuery &inNarrowPhaseQuery, WheelCollision &ioWheel) {
+		return CollideWithQuery(inNarrowPhaseQuery, inPhysicsSystem, inVehicleConstraint, ioWheel.mWheelIndex, ioWheel.mOrigin, ioWheel.mDirection, inVehicleBodyID, ioWheel.mBody, ioWheel.mSubShapeID, ioWheel.mContactPosition, ioWheel.mContactNormal, ioWheel.mSuspensionLength);
+	});
+}
+
+bool VehicleCollisionTesterCastSphere::CollideWithQuery(const NarrowPhaseQuery &inNarrowPhaseQuery, PhysicsSystem &inPhysicsSystem, const VehicleConstraint &inVehicleConstraint, uint inWheelIndex, RVec3Arg inOrigin, Vec3Arg inDirection, const BodyID &inVehicleBodyID, Body *&outBody, SubShapeID &outSubShapeID, RVec3 &outContactPosition, Vec3 &outContactNormal, float &outSuspensionLength) const
 {
 	const DefaultBroadPhaseLayerFilter default_broadphase_layer_filter = inPhysicsSystem.GetDefaultBroadPhaseLayerFilter(mObjectLayer);
 	const BroadPhaseLayerFilter &broadphase_layer_filter = mBroadPhaseLayerFilter != nullptr? *mBroadPhaseLayerFilter : default_broadphase_layer_filter;
@@ -202,7 +323,7 @@ bool VehicleCollisionTesterCastSphere::Collide(PhysicsSystem &inPhysicsSystem, c
 	};
 
 	MyCollector collector(inPhysicsSystem, shape_cast, mUp, mCosMaxSlopeAngle);
-	inPhysicsSystem.GetNarrowPhaseQueryNoLock().CastShape(shape_cast, settings, shape_cast.mCenterOfMassStart.GetTranslation(), collector, broadphase_layer_filter, object_layer_filter, body_filter);
+	inNarrowPhaseQuery.CastShape(shape_cast, settings, shape_cast.mCenterOfMassStart.GetTranslation(), collector, broadphase_layer_filter, object_layer_filter, body_filter);
 	if (collector.mBody == nullptr)
 		return false;
 
@@ -239,6 +360,18 @@ void VehicleCollisionTesterCastSphere::PredictContactProperties(PhysicsSystem &i
 }
 
 bool VehicleCollisionTesterCastCylinder::Collide(PhysicsSystem &inPhysicsSystem, const VehicleConstraint &inVehicleConstraint, uint inWheelIndex, RVec3Arg inOrigin, Vec3Arg inDirection, const BodyID &inVehicleBodyID, Body *&outBody, SubShapeID &outSubShapeID, RVec3 &outContactPosition, Vec3 &outContactNormal, float &outSuspensionLength) const
+{
+	return CollideWithQuery(inPhysicsSystem.GetNarrowPhaseQueryNoLock(), inPhysicsSystem, inVehicleConstraint, inWheelIndex, inOrigin, inDirection, inVehicleBodyID, outBody, outSubShapeID, outContactPosition, outContactNormal, outSuspensionLength);
+}
+
+void VehicleCollisionTesterCastCylinder::CollideWheels(PhysicsSystem &inPhysicsSystem, const VehicleConstraint &inVehicleConstraint, const BodyID &inVehicleBodyID, WheelCollision *ioWheels, uint inNumWheels) const
+{
+	CollideWheelsShared(inPhysicsSystem, inVehicleConstraint, ioWheels, inNumWheels, [this, &inPhysicsSystem, &inVehicleConstraint, &inVehicleBodyID](const NarrowPhaseQuery &inNarrowPhaseQuery, WheelCollision &ioWheel) {
+		return CollideWithQuery(inNarrowPhaseQuery, inPhysicsSystem, inVehicleConstraint, ioWheel.mWheelIndex, ioWheel.mOrigin, ioWheel.mDirection, inVehicleBodyID, ioWheel.mBody, ioWheel.mSubShapeID, ioWheel.mContactPosition, ioWheel.mContactNormal, ioWheel.mSuspensionLength);
+	});
+}
+
+bool VehicleCollisionTesterCastCylinder::CollideWithQuery(const NarrowPhaseQuery &inNarrowPhaseQuery, PhysicsSystem &inPhysicsSystem, const VehicleConstraint &inVehicleConstraint, uint inWheelIndex, RVec3Arg inOrigin, Vec3Arg inDirection, const BodyID &inVehicleBodyID, Body *&outBody, SubShapeID &outSubShapeID, RVec3 &outContactPosition, Vec3 &outContactNormal, float &outSuspensionLength) const
 {
 	const DefaultBroadPhaseLayerFilter default_broadphase_layer_filter = inPhysicsSystem.GetDefaultBroadPhaseLayerFilter(mObjectLayer);
 	const BroadPhaseLayerFilter &broadphase_layer_filter = mBroadPhaseLayerFilter != nullptr? *mBroadPhaseLayerFilter : default_broadphase_layer_filter;
@@ -315,7 +448,7 @@ bool VehicleCollisionTesterCastCylinder::Collide(PhysicsSystem &inPhysicsSystem,
 	};
 
 	MyCollector collector(inPhysicsSystem, shape_cast);
-	inPhysicsSystem.GetNarrowPhaseQueryNoLock().CastShape(shape_cast, settings, shape_cast.mCenterOfMassStart.GetTranslation(), collector, broadphase_layer_filter, object_layer_filter, body_filter);
+	inNarrowPhaseQuery.CastShape(shape_cast, settings, shape_cast.mCenterOfMassStart.GetTranslation(), collector, broadphase_layer_filter, object_layer_filter, body_filter);
 	if (collector.mBody == nullptr)
 		return false;
 
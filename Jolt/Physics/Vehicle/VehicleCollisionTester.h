@@ -14,6 +14,7 @@ class VehicleConstraint;
 class BroadPhaseLayerFilter;
 class ObjectLayerFilter;
 class BodyFilter;
+class NarrowPhaseQuery;
 
 /// Class that does collision detection between wheels and ground
 class JPH_EXPORT VehicleCollisionTester : public RefTarget<VehicleCollisionTester>, public NonCopyable
@@ -73,7 +74,38 @@ public:
 	/// @param ioSuspensionLength New length of the suspension [0, inSuspensionMaxLength]
 	virtual void					PredictContactProperties(PhysicsSystem &inPhysicsSystem, const VehicleConstraint &inVehicleConstraint, uint inWheelIndex, RVec3Arg inOrigin, Vec3Arg inDirection, const BodyID &inVehicleBodyID, Body *&ioBody, SubShapeID &ioSubShapeID, RVec3 &ioContactPosition, Vec3 &ioContactNormal, float &ioSuspensionLength) const = 0;
 
+	/// Input and output of the collision test of a single wheel, see CollideWheels
+	struct WheelCollision
+	{
+		uint						mWheelIndex;										///< Index of the wheel that we're testing collision for
+		RVec3						mOrigin;											///< Origin for the test, corresponds to the world space position for the suspension attachment point
+		Vec3						mDirection;											///< Direction for the test (unit vector, world space)
+		Body *						mBody = nullptr;									///< Body that the wheel collided with, nullptr if no collision was found
+		SubShapeID					mSubShapeID;										///< Sub shape ID that the wheel collided with
+		RVec3						mContactPosition;									///< Contact point between wheel and floor, in world space
+		Vec3						mContactNormal;										///< Contact normal between wheel and floor, pointing away from the floor
+		float						mSuspensionLength;									///< New length of the suspension [0, inSuspensionMaxLength]
+	};
+
+	/// Do a collision test with the world for multiple wheels of the same vehicle at once.
+	/// The default implementation calls Collide for every wheel. The testers in this file collect the bodies around all wheels
+	/// with a single broad phase query and test each wheel against these bodies, which is cheaper than a full query per wheel.
+	/// @param inPhysicsSystem The physics system that should be tested against
+	/// @param inVehicleConstraint The vehicle constraint
+	/// @param inVehicleBodyID This body should be filtered out during collision detection to avoid self collisions
+	/// @param ioWheels The wheels to test, on output mBody is set when a collision was found together with the other contact properties
+	/// @param inNumWheels Number of wheels in ioWheels
+	virtual void					CollideWheels(PhysicsSystem &inPhysicsSystem, const VehicleConstraint &inVehicleConstraint, const BodyID &inVehicleBodyID, WheelCollision *ioWheels, uint inNumWheels) const;
+
+	/// Max number of bodies that can be shared between the wheels of a vehicle, if more bodies are found every wheel does its own broad phase query
+	static constexpr uint			cMaxSharedBodies = 64;
+
 protected:
+	/// Helper for CollideWheels: collects the bodies around all wheels with a single broad phase query and calls inCollideWheel(narrow_phase_query, wheel) for every wheel,
+	/// where narrow_phase_query only tests against the collected bodies
+	template <class CollideWheelFunction>
+	void							CollideWheelsShared(PhysicsSystem &inPhysicsSystem, const VehicleConstraint &inVehicleConstraint, WheelCollision *ioWheels, uint inNumWheels, const CollideWheelFunction &inCollideWheel) const;
+
 	const BroadPhaseLayerFilter	*	mBroadPhaseLayerFilter = nullptr;
 	const ObjectLayerFilter *		mObjectLayerFilter = nullptr;
 	const BodyFilter *				mBodyFilter = nullptr;
@@ -95,8 +127,12 @@ public:
 	// See: VehicleCollisionTester
 	virtual bool					Collide(PhysicsSystem &inPhysicsSystem, const VehicleConstraint &inVehicleConstraint, uint inWheelIndex, RVec3Arg inOrigin, Vec3Arg inDirection, const BodyID &inVehicleBodyID, Body *&outBody, SubShapeID &outSubShapeID, RVec3 &outContactPosition, Vec3 &outContactNormal, float &outSuspensionLength) const override;
 	virtual void					PredictContactProperties(PhysicsSystem &inPhysicsSystem, const VehicleConstraint &inVehicleConstraint, uint inWheelIndex, RVec3Arg inOrigin, Vec3Arg inDirection, const BodyID &inVehicleBodyID, Body *&ioBody, SubShapeID &ioSubShapeID, RVec3 &ioContactPosition, Vec3 &ioContactNormal, float &ioSuspensionLength) const override;
+	virtual void					CollideWheels(PhysicsSystem &inPhysicsSystem, const VehicleConstraint &inVehicleConstraint, const BodyID &inVehicleBodyID, WheelCollision *ioWheels, uint inNumWheels) const override;
 
 private:
+	/// Implementation of Collide that uses inNarrowPhaseQuery to query the world
+	bool							CollideWithQuery(const NarrowPhaseQuery &inNarrowPhaseQuery, PhysicsSystem &inPhysicsSystem, const VehicleConstraint &inVehicleConstraint, uint inWheelIndex, RVec3Arg inOrigin, Vec3Arg inDirection, const BodyID &inVehicleBodyID, Body *&outBody, SubShapeID &outSubShapeID, RVec3 &outContactPosition, Vec3 &outContactNormal, float &outSuspensionLength) const;
+
 	Vec3							mUp;
 	float							mCosMaxSlopeAngle;
 };
@@ -117,8 +153,12 @@ public:
 	// See: VehicleCollisionTester
 	virtual bool					Collide(PhysicsSystem &inPhysicsSystem, const VehicleConstraint &inVehicleConstraint, uint inWheelIndex, RVec3Arg inOrigin, Vec3Arg inDirection, const BodyID &inVehicleBodyID, Body *&outBody, SubShapeID &outSubShapeID, RVec3 &outContactPosition, Vec3 &outContactNormal, float &outSuspensionLength) const override;
 	virtual void					PredictContactProperties(PhysicsSystem &inPhysicsSystem, const VehicleConstraint &inVehicleConstraint, uint inWheelIndex, RVec3Arg inOrigin, Vec3Arg inDirection, const BodyID &inVehicleBodyID, Body *&ioBody, SubShapeID &ioSubShapeID, RVec3 &ioContactPosition, Vec3 &ioContactNormal, float &ioSuspensionLength) const override;
+	virtual void					CollideWheels(PhysicsSystem &inPhysicsSystem, const VehicleConstraint &inVehicleConstraint, const BodyID &inVehicleBodyID, WheelCollision *ioWheels, uint inNumWheels) const override;
 
 private:
+	/// Implementation of Collide that uses inNarrowPhaseQuery to query the world
+	bool							CollideWithQuery(const NarrowPhaseQuery &inNarrowPhaseQuery, PhysicsSystem &inPhysicsSystem, const VehicleConstraint &inVehicleConstraint, uint inWheelIndex, RVec3Arg inOrigin, Vec3Arg inDirection, const BodyID &inVehicleBodyID, Body *&outBody, SubShapeID &outSubShapeID, RVec3 &outContactPosition, Vec3 &outContactNormal, float &outSuspensionLength) const;
+
 	float							mRadius;
 	Vec3							mUp;
 	float							mCosMaxSlopeAngle;
@@ -138,8 +178,12 @@ public:
 	// See: VehicleCollisionTester
 	virtual bool					Collide(PhysicsSystem &inPhysicsSystem, const VehicleConstraint &inVehicleConstraint, uint inWheelIndex, RVec3Arg inOrigin, Vec3Arg inDirection, const BodyID &inVehicleBodyID, Body *&outBody, SubShapeID &outSubShapeID, RVec3 &outContactPosition, Vec3 &outContactNormal, float &outSuspensionLength) const override;
 	virtual void					PredictContactProperties(PhysicsSystem &inPhysicsSystem, const VehicleConstraint &inVehicleConstraint, uint inWheelIndex, RVec3Arg inOrigin, Vec3Arg inDirection, const BodyID &inVehicleBodyID, Body *&ioBody, SubShapeID &ioSubShapeID, RVec3 &ioContactPosition, Vec3 &ioContactNormal, float &ioSuspensionLength) const override;
+	virtual void					CollideWheels(PhysicsSystem &inPhysicsSystem, const VehicleConstraint &inVehicleConstraint, const BodyID &inVehicleBodyID, WheelCollision *ioWheels, uint inNumWheels) const override;
 
 private:
+	/// Implementation of Collide that uses inNarrowPhaseQuery to query the world
+	bool							CollideWithQuery(const NarrowPhaseQuery &inNarrowPhaseQuery, PhysicsSystem &inPhysicsSystem, const VehicleConstraint &inVehicleConstraint, uint inWheelIndex, RVec3Arg inOrigin, Vec3Arg inDirection, const BodyID &inVehicleBodyID, Body *&outBody, SubShapeID &outSubShapeID, RVec3 &outContactPosition, Vec3 &outContactNormal, float &outSuspensionLength) const;
+
 	float							mConvexRadiusFraction;
 };
 
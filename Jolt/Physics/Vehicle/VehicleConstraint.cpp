@@ -107,6 +107,9 @@ VehicleConstraint::VehicleConstraint(Body &inVehicleBody, const VehicleConstrain
 	for (uint i = 0; i < mWheels.size(); ++i)
 		mWheels[i] = mController->ConstructWheel(*inSettings.mWheels[i]);
 
+	// Determine which wheels share an axle
+	CalculateAxles();
+
 	// Use the body ID as a seed for the step counter so that not all vehicles will update at the same time
 	mCurrentStep = uint32(Hash64(inVehicleBody.GetID().GetIndex()));
 }
@@ -157,6 +160,84 @@ RMat44 VehicleConstraint::GetWheelWorldTransform(uint inWheelIndex, Vec3Arg inWh
 	return mBody->GetWorldTransform() * GetWheelLocalTransform(inWheelIndex, inWheelRight, inWheelUp);
 }
 
+void VehicleConstraint::SetLOD(EVehicleLOD inLOD)
+{
+	if (mLOD == inLOD)
+		return;
+
+	if (inLOD == EVehicleLOD::Reduced)
+	{
+		// Remember the step overrides so that we can restore them when switching back
+		const MotionProperties *mp = mBody->GetMotionProperties();
+		mFullLODBodyNumVelocitySteps = uint8(mp->GetNumVelocityStepsOverride());
+		mFullLODBodyNumPositionSteps = uint8(mp->GetNumPositionStepsOverride());
+		mFullLODNumVelocitySteps = uint8(GetNumVelocityStepsOverride());
+		mFullLODNumPositionSteps = uint8(GetNumPositionStepsOverride());
+	}
+
+	mLOD = inLOD;
+	ApplyLODNumSteps();
+}
+
+void VehicleConstraint::SetReducedLODNumSteps(uint inNumVelocitySteps, uint inNumPositionSteps)
+{
+	JPH_ASSERT(inNumVelocitySteps < 256 && inNumPositionSteps < 256);
+
+	mReducedLODNumVelocitySteps = uint8(inNumVelocitySteps);
+	mReducedLODNumPositionSteps = uint8(inNumPositionSteps);
+
+	if (mLOD == EVehicleLOD::Reduced)
+		ApplyLODNumSteps();
+}
+
+void VehicleConstraint::ApplyLODNumSteps()
+{
+	MotionProperties *mp = mBody->GetMotionProperties();
+	if (mLOD == EVehicleLOD::Reduced)
+	{
+		// The number of solver steps of an island is the max of all bodies and constraints, so both the body and the constraint need to be overridden
+		mp->SetNumVelocityStepsOverride(mReducedLODNumVelocitySteps);
+		mp->SetNumPositionStepsOverride(mReducedLODNumPositionSteps);
+		SetNumVelocityStepsOverride(mReducedLODNumVelocitySteps);
+		SetNumPositionStepsOverride(mReducedLODNumPositionSteps);
+	}
+	else
+	{
+		// Restore the original overrides
+		mp->SetNumVelocityStepsOverride(mFullLODBodyNumVelocitySteps);
+		mp->SetNumPositionStepsOverride(mFullLODBodyNumPositionSteps);
+		SetNumVelocityStepsOverride(mFullLODNumVelocitySteps);
+		SetNumPositionStepsOverride(mFullLODNumPositionSteps);
+	}
+}
+
+void VehicleConstraint::CalculateAxles()
+{
+	// Wheels that are at the same position along the forward axis are considered to be on the same axle
+	constexpr float cAxleTolerance = 1.0e-2f;
+
+	mWheelAxles.resize(mWheels.size());
+	for (uint i = 0; i < mWheels.size(); ++i)
+	{
+		float forward_i = mWheels[i]->mSettings->mPosition.Dot(mForward);
+
+		WheelAxle &axle = mWheelAxles[i];
+		axle.mFirstWheelInAxle = i;
+		axle.mIndexInAxle = 0;
+		axle.mNumWheelsInAxle = 0;
+		for (uint j = 0; j < mWheels.size(); ++j)
+			if (abs(mWheels[j]->mSettings->mPosition.Dot(mForward) - forward_i) < cAxleTolerance)
+			{
+				if (j < i)
+				{
+					axle.mFirstWheelInAxle = min(axle.mFirstWheelInAxle, j);
+					++axle.mIndexInAxle;
+				}
+				++axle.mNumWheelsInAxle;
+			}
+	}
+}
+
 void VehicleConstraint::OnStep(const PhysicsStepListenerContext &inContext)
 {
 	JPH_PROFILE_FUNCTION();
@@ -195,7 +276,12 @@ void VehicleConstraint::OnStep(const PhysicsStepListenerContext &inContext)
 
 	RMat44 body_transform = mBody->GetWorldTransform();
 
+	// Wheels can be added or removed through GetWheels, make sure we know which axle they're on
+	if (mWheelAxles.size() != mWheels.size())
+		CalculateAxles();
+
 	// Test collision for wheels
+	mWheelCollisions.clear();
 	for (uint wheel_index = 0; wheel_index < mWheels.size(); ++wheel_index)
 	{
 		Wheel *w = mWheels[wheel_index];
@@ -206,8 +292,21 @@ void VehicleConstraint::OnStep(const PhysicsStepListenerContext &inContext)
 		Vec3 ws_direction = body_transform.Multiply3x3(settings->mSuspensionDirection);
 
 		// Test if we need to update this wheel
-		if (num_steps_between_collisions == 0
-			|| (mCurrentStep + wheel_index) % num_steps_between_collisions != 0)
+		bool test_wheel = false;
+		if (num_steps_between_collisions != 0)
+		{
+			if (mLOD == EVehicleLOD::Full)
+				test_wheel = (mCurrentStep + wheel_index) % num_steps_between_collisions == 0;
+			else
+			{
+				// In reduced LOD the axle is scheduled as a whole and each step that the axle is tested, the next wheel of the axle is tested in a round robin fashion
+				const WheelAxle &axle = mWheelAxles[wheel_index];
+				uint axle_step = mCurrentStep + axle.mFirstWheelInAxle;
+				test_wheel = axle_step % num_steps_between_collisions == 0
+					&& (axle_step / num_steps_between_collisions) % axle.mNumWheelsInAxle == axle.mIndexInAxle;
+			}
+		}
+		if (!test_wheel)
 		{
 			// Simplified wheel contact test
 			if (!w->mContactBodyID.IsInvalid())
@@ -236,16 +335,43 @@ void VehicleConstraint::OnStep(const PhysicsStepListenerContext &inContext)
 			w->mContactSubShapeID = SubShapeID();
 			w->mSuspensionLength = settings->mSuspensionMaxLength;
 
-			// Test collision to find the floor
-			if (mVehicleCollisionTester->Collide(*inContext.mPhysicsSystem, *this, wheel_index, ws_origin, ws_direction, mBody->GetID(), w->mContactBody, w->mContactSubShapeID, w->mContactPosition, w->mContactNormal, w->mSuspensionLength))
+			// Queue the wheel so that all wheels can be tested in a single batch
+			VehicleCollisionTester::WheelCollision &collision = mWheelCollisions.emplace_back();
+			collision.mWheelIndex = wheel_index;
+			collision.mOrigin = ws_origin;
+			collision.mDirection = ws_direction;
+		}
+	}
+
+	// Test collision to find the floor for all queued wheels
+	if (!mWheelCollisions.empty())
+	{
+		mVehicleCollisionTester->CollideWheels(*inContext.mPhysicsSystem, *this, mBody->GetID(), mWheelCollisions.data(), uint(mWheelCollisions.size()));
+		for (const VehicleCollisionTester::WheelCollision &collision : mWheelCollisions)
+			if (collision.mBody != nullptr)
 			{
+				Wheel *w = mWheels[collision.mWheelIndex];
+				w->mContactBody = collision.mBody;
+				w->mContactSubShapeID = collision.mSubShapeID;
+				w->mContactPosition = collision.mContactPosition;
+				w->mContactNormal = collision.mContactNormal;
+				w->mSuspensionLength = collision.mSuspensionLength;
+
 				// Store ID (pointer is not valid outside of the simulation step)
-				w->mContactBodyID = w->mContactBody->GetID();
+				w->mContactBodyID = collision.mBody->GetID();
 			}
-		}
+	}
 
+	// Update the contact properties of the wheels
+	for (Wheel *w : mWheels)
+	{
 		if (w->mContactBody != nullptr)
 		{
+			// Calculate suspension origin and direction
+			const WheelSettings *settings = w->mSettings;
+			RVec3 ws_origin = body_transform * settings->mPosition;
+			Vec3 ws_direction = body_transform.Multiply3x3(settings->mSuspensionDirection);
+
 			// Store contact velocity, cache this as the contact body may be removed
 			w->mContactPointVelocity = w->mContactBody->GetPointVelocity(w->mContactPosition);
 
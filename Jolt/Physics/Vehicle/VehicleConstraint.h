@@ -16,6 +16,13 @@ JPH_NAMESPACE_BEGIN
 
 class PhysicsSystem;
 
+/// Level of detail of the simulation of a vehicle
+enum class EVehicleLOD : uint8
+{
+	Full,																	///< Test all wheels every step, simulate the full drivetrain and use the default number of solver steps
+	Reduced,																///< Test a single wheel per axle every step, skip drivetrain integration and use fewer solver steps (for vehicles in the distance)
+};
+
 /// Configuration for constraint that simulates a wheeled vehicle.
 ///
 /// The properties in this constraint are largely based on "Car Physics for Games" by Marco Monster.
@@ -176,6 +183,21 @@ public:
 	void						SetNumStepsBetweenCollisionTestInactive(uint inSteps) { mNumStepsBetweenCollisionTestInactive = inSteps; }
 	uint						GetNumStepsBetweenCollisionTestInactive() const { return mNumStepsBetweenCollisionTestInactive; }
 
+	/// Level of detail of the vehicle simulation. Default is EVehicleLOD::Full.
+	/// In EVehicleLOD::Reduced only one wheel per axle is collision tested on each step that the axle is tested (in a round robin fashion, see SetNumStepsBetweenCollisionTestActive),
+	/// the other wheels extrapolate their contact using VehicleCollisionTester::PredictContactProperties. Every wheel is tested at least once every number of steps between collision tests times the number of wheels on its axle.
+	/// The controller can use a cheaper model too, e.g. WheeledVehicleController couples the engine directly to the wheels instead of integrating the drivetrain.
+	/// The body and the constraint will use the reduced number of solver steps, see SetReducedLODNumSteps.
+	/// The LOD can be changed at any time outside of the physics update, the wheel and engine state are kept consistent so the vehicle doesn't change speed when switching.
+	void						SetLOD(EVehicleLOD inLOD);
+	EVehicleLOD					GetLOD() const								{ return mLOD; }
+
+	/// Number of solver velocity and position steps to use when the LOD is EVehicleLOD::Reduced. Default is 2 velocity steps and 1 position step.
+	/// While the vehicle is in reduced LOD, these replace the step overrides of the vehicle body and this constraint, the original overrides are restored when switching back to EVehicleLOD::Full.
+	void						SetReducedLODNumSteps(uint inNumVelocitySteps, uint inNumPositionSteps);
+	uint						GetReducedLODNumVelocitySteps() const		{ return mReducedLODNumVelocitySteps; }
+	uint						GetReducedLODNumPositionSteps() const		{ return mReducedLODNumPositionSteps; }
+
 	// Generic interface of a constraint
 	virtual bool				IsActive() const override					{ return mIsActive && Constraint::IsActive(); }
 	virtual void				NotifyShapeChanged(const BodyID &inBodyID, Vec3Arg inDeltaCOM) override { /* Do nothing */ }
@@ -204,6 +226,20 @@ private:
 	// Calculate the constraint properties for mPitchRollPart
 	void						CalculatePitchRollConstraintProperties(RMat44Arg inBodyTransform);
 
+	// Apply or remove the solver step overrides for the reduced LOD
+	void						ApplyLODNumSteps();
+
+	// Group the wheels in axles based on their position along the forward axis
+	void						CalculateAxles();
+
+	// Location of a wheel in its axle, used to pick the wheel that is tested in reduced LOD
+	struct WheelAxle
+	{
+		uint					mFirstWheelInAxle;							///< Index of the first wheel of the axle in mWheels
+		uint					mIndexInAxle;								///< Index of the wheel within its axle
+		uint					mNumWheelsInAxle;							///< Number of wheels on the axle
+	};
+
 	// Gravity override
 	bool						mIsGravityOverridden = false;				///< If the gravity is currently overridden
 	Vec3						mGravityOverride = Vec3::sZero();			///< Gravity override value, replaces PhysicsSystem::GetGravity() when mIsGravityOverridden is true
@@ -220,6 +256,17 @@ private:
 	uint						mNumStepsBetweenCollisionTestActive = 1;	///< Number of simulation steps between wheel collision tests when the vehicle is active
 	uint						mNumStepsBetweenCollisionTestInactive = 1;	///< Number of simulation steps between wheel collision tests when the vehicle is inactive
 	uint						mCurrentStep = 0;							///< Current step number, used to determine when to test a wheel
+	Array<VehicleCollisionTester::WheelCollision> mWheelCollisions;			///< Wheels that need a full collision test this step, reused between steps to avoid allocations
+
+	// Level of detail
+	EVehicleLOD					mLOD = EVehicleLOD::Full;					///< Current level of detail
+	Array<WheelAxle>			mWheelAxles;								///< For each wheel the axle it belongs to
+	uint8						mReducedLODNumVelocitySteps = 2;			///< Number of solver velocity steps in reduced LOD
+	uint8						mReducedLODNumPositionSteps = 1;			///< Number of solver position steps in reduced LOD
+	uint8						mFullLODBodyNumVelocitySteps = 0;			///< Velocity step override of the body to restore when switching back to full LOD
+	uint8						mFullLODBodyNumPositionSteps = 0;			///< Position step override of the body to restore when switching back to full LOD
+	uint8						mFullLODNumVelocitySteps = 0;				///< Velocity step override of this constraint to restore when switching back to full LOD
+	uint8						mFullLODNumPositionSteps = 0;				///< Position step override of this constraint to restore when switching back to full LOD
 
 	// Prevent vehicle from toppling over
 	float						mCosMaxPitchRollAngle;						///< Cos of the max pitch/roll angle
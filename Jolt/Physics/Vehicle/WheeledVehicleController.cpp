@@ -261,9 +261,6 @@ void WheeledVehicleController::PostCollide(float inDeltaTime, PhysicsSystem &inP
 {
 	JPH_PROFILE_FUNCTION();
 
-	// Remember old RPM so we can detect if we're increasing or decreasing
-	float old_engine_rpm = mEngine.GetCurrentRPM();
-
 	Wheels &wheels = mConstraint.GetWheels();
 
 	// Update wheel angle, do this before applying torque to the wheels (as friction will slow them down again)
@@ -273,6 +270,55 @@ void WheeledVehicleController::PostCollide(float inDeltaTime, PhysicsSystem &inP
 		w->Update(wheel_index, inDeltaTime, mConstraint);
 	}
 
+	// Update engine, transmission and driven wheels
+	if (mConstraint.GetLOD() == EVehicleLOD::Reduced)
+		UpdateDrivetrainReduced(inDeltaTime);
+	else
+		UpdateDrivetrain(inDeltaTime);
+
+	// Braking
+	for (Wheel *w_base : wheels)
+	{
+		WheelWV *w = static_cast<WheelWV *>(w_base);
+		const WheelSettingsWV *settings = w->GetSettings();
+
+		// Combine brake with hand brake torque
+		float brake_torque = mBrakeInput * settings->mMaxBrakeTorque + mHandBrakeInput * settings->mMaxHandBrakeTorque;
+		if (brake_torque > 0.0f)
+		{
+			// Calculate how much torque is needed to stop the wheels from rotating in this time step
+			float brake_torque_to_lock_wheels = abs(w->GetAngularVelocity()) * settings->mInertia / inDeltaTime;
+			if (brake_torque > brake_torque_to_lock_wheels)
+			{
+				// Wheels are locked
+				w->SetAngularVelocity(0.0f);
+				w->mBrakeImpulse = (brake_torque - brake_torque_to_lock_wheels) * inDeltaTime / settings->mRadius;
+			}
+			else
+			{
+				// Slow down the wheels
+				w->ApplyTorque(-Sign(w->GetAngularVelocity()) * brake_torque, inDeltaTime);
+				w->mBrakeImpulse = 0.0f;
+			}
+		}
+		else
+		{
+			// Not braking
+			w->mBrakeImpulse = 0.0f;
+		}
+	}
+
+	// Remember previous delta time so we can scale the impulses correctly
+	mPreviousDeltaTime = inDeltaTime;
+}
+
+void WheeledVehicleController::UpdateDrivetrain(float inDeltaTime)
+{
+	// Remember old RPM so we can detect if we're increasing or decreasing
+	float old_engine_rpm = mEngine.GetCurrentRPM();
+
+	Wheels &wheels = mConstraint.GetWheels();
+
 	// In auto transmission mode, don't accelerate the engine when switching gears
 	float forward_input = abs(mForwardInput);
 	if (mTransmission.mMode == ETransmissionMode::Auto)
@@ -612,41 +658,75 @@ void WheeledVehicleController::PostCollide(float inDeltaTime, PhysicsSystem &inP
 
 	// Update transmission
 	mTransmission.Update(inDeltaTime, mEngine.GetCurrentRPM(), mForwardInput, can_shift_up);
+}
 
-	// Braking
-	for (Wheel *w_base : wheels)
-	{
-		WheelWV *w = static_cast<WheelWV *>(w_base);
-		const WheelSettingsWV *settings = w->GetSettings();
+void WheeledVehicleController::UpdateDrivetrainReduced(float inDeltaTime)
+{
+	// Remember old RPM so we can detect if we're increasing or decreasing
+	float old_engine_rpm = mEngine.GetCurrentRPM();
 
-		// Combine brake with hand brake torque
-		float brake_torque = mBrakeInput * settings->mMaxBrakeTorque + mHandBrakeInput * settings->mMaxHandBrakeTorque;
-		if (brake_torque > 0.0f)
+	Wheels &wheels = mConstraint.GetWheels();
+
+	// In auto transmission mode, don't accelerate the engine when switching gears
+	float forward_input = abs(mForwardInput);
+	if (mTransmission.mMode == ETransmissionMode::Auto)
+		forward_input *= mTransmission.GetClutchFriction();
+
+	// Apply engine damping
+	mEngine.ApplyDamping(inDeltaTime);
+
+	// Calculate engine torque
+	float engine_torque = mEngine.GetTorque(forward_input);
+
+	// Instead of solving the coupled engine / wheel system, we treat the clutch as a rigid connection and apply the engine torque directly to the driven wheels
+	float transmission_ratio = mTransmission.GetCurrentRatio();
+	float clutch_friction = transmission_ratio != 0.0f? mTransmission.GetClutchFriction() : 0.0f;
+	bool has_driven_wheels = false;
+	if (clutch_friction > 0.0f)
+		for (const VehicleDifferentialSettings &d : mDifferentials)
 		{
-			// Calculate how much torque is needed to stop the wheels from rotating in this time step
-			float brake_torque_to_lock_wheels = abs(w->GetAngularVelocity()) * settings->mInertia / inDeltaTime;
-			if (brake_torque > brake_torque_to_lock_wheels)
+			WheelWV *wl = d.mLeftWheel != -1? static_cast<WheelWV *>(wheels[d.mLeftWheel]) : nullptr;
+			WheelWV *wr = d.mRightWheel != -1? static_cast<WheelWV *>(wheels[d.mRightWheel]) : nullptr;
+
+			// Torque delivered to this differential
+			float differential_torque = clutch_friction * engine_torque * transmission_ratio * d.mDifferentialRatio * d.mEngineTorqueRatio;
+
+			if (wl != nullptr && wr != nullptr)
 			{
-				// Wheels are locked
-				w->SetAngularVelocity(0.0f);
-				w->mBrakeImpulse = (brake_torque - brake_torque_to_lock_wheels) * inDeltaTime / settings->mRadius;
+				// Split the torque over both wheels
+				float ratio_l, ratio_r;
+				d.CalculateTorqueRatio(wl->GetAngularVelocity(), wr->GetAngularVelocity(), ratio_l, ratio_r);
+				wl->ApplyTorque(ratio_l * differential_torque, inDeltaTime);
+				wr->ApplyTorque(ratio_r * differential_torque, inDeltaTime);
+				has_driven_wheels = true;
 			}
-			else
+			else if (wl != nullptr)
 			{
-				// Slow down the wheels
-				w->ApplyTorque(-Sign(w->GetAngularVelocity()) * brake_torque, inDeltaTime);
-				w->mBrakeImpulse = 0.0f;
+				// Only left wheel, all power to left
+				wl->ApplyTorque(differential_torque, inDeltaTime);
+				has_driven_wheels = true;
+			}
+			else if (wr != nullptr)
+			{
+				// Only right wheel, all power to right
+				wr->ApplyTorque(differential_torque, inDeltaTime);
+				has_driven_wheels = true;
 			}
 		}
-		else
-		{
-			// Not braking
-			w->mBrakeImpulse = 0.0f;
-		}
+
+	if (has_driven_wheels)
+	{
+		// Engine follows the wheels, this keeps engine and wheel speeds in sync so that switching back to the full model doesn't cause a jump in torque
+		mEngine.SetCurrentRPM(Clamp(GetWheelSpeedAtClutch(), mEngine.mMinRPM, mEngine.mMaxRPM));
+	}
+	else
+	{
+		// Engine not connected to wheels, apply all torque to engine rotation
+		mEngine.ApplyTorque(engine_torque, inDeltaTime);
 	}
 
-	// Remember previous delta time so we can scale the impulses correctly
-	mPreviousDeltaTime = inDeltaTime;
+	// Update transmission, only allow shifting up when we're increasing our RPM
+	mTransmission.Update(inDeltaTime, mEngine.GetCurrentRPM(), mForwardInput, mEngine.GetCurrentRPM() >= old_engine_rpm);
 }
 
 bool WheeledVehicleController::SolveLongitudinalAndLateralConstraints(float inDeltaTime)
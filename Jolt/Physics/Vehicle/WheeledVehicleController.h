@@ -168,6 +168,12 @@ protected:
 	virtual void				Draw(DebugRenderer *inRenderer) const override;
 #endif // JPH_DEBUG_RENDERER
 
+	/// Update the engine, transmission and driven wheels by solving the coupled engine / wheel system
+	void						UpdateDrivetrain(float inDeltaTime);
+
+	/// Update the engine, transmission and driven wheels for EVehicleLOD::Reduced, the engine is rigidly connected to the driven wheels
+	void						UpdateDrivetrainReduced(float inDeltaTime);
+
 	// Control information
 	float						mForwardInput = 0.0f;						///< Value between -1 and 1 for auto transmission and value between 0 and 1 indicating desired driving direction and amount the gas pedal is pressed
 	float						mRightInput = 0.0f;							///< Value between -1 and 1 indicating desired steering angle
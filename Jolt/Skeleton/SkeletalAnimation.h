@@ -73,6 +73,10 @@ public:
 	/// Get the (interpolated) joint transforms at time inTime
 	void								Sample(float inTime, SkeletonPose &ioPose) const;
 
+	/// If this animation loops back to start
+	bool								IsLooping() const									{ return mIsLooping; }
+	void								SetIsLooping(bool inIsLooping)						{ mIsLooping = inIsLooping; }
+
 	/// Get joint samples
 	const AnimatedJointVector &			GetAnimatedJoints() const							{ return mAnimatedJoints; }
 	AnimatedJointVector &				GetAnimatedJoints()									{ return mAnimatedJoints; }
@@ -0,0 +1,391 @@
+// Jolt Physics Library (https://github.com/jrouwe/JoltPhysics)
+// SPDX-FileCopyrightText: 2024 Jorrit Rouwe
+// SPDX-License-Identifier: MIT
+
+#include <Jolt/Jolt.h>
+
+#include <Jolt/Skeleton/SkeletalAnimationSampler.h>
+#include <Jolt/Skeleton/SkeletonPose.h>
+#include <Jolt/Core/Profiler.h>
+#include <Jolt/Core/QuickSort.h>
+
+JPH_NAMESPACE_BEGIN
+
+/// Sample the keyframes of a single joint at inTime, gives the same result as SkeletalAnimation::Sample
+static void sSampleKeyframes(const SkeletalAnimation::KeyframeVector &inKeyframes, float inTime, Vec3 &outTranslation, Quat &outRotation)
+{
+	// Find the first keyframe at or after inTime
+	int high = (int)inKeyframes.size(), low = -1;
+	while (high - low > 1)
+	{
+		int probe = (high + low) / 2;
+		if (inKeyframes[probe].mTime < inTime)
+			low = probe;
+		else
+			high = probe;
+	}
+
+	if (low == -1 || (high < (int)inKeyframes.size() && inKeyframes[high].mTime == inTime))
+	{
+		// Before first key or exactly on a key, return the key
+		const SkeletalAnimation::Keyframe &key = inKeyframes[low == -1? 0 : high];
+		outTranslation = key.mTranslation;
+		outRotation = key.mRotation;
+	}
+	else if (high == (int)inKeyframes.size())
+	{
+		// Beyond last key, return last key
+		outTranslation = inKeyframes.back().mTranslation;
+		outRotation = inKeyframes.back().mRotation;
+	}
+	else
+	{
+		// Interpolate
+		const SkeletalAnimation::Keyframe &s1 = inKeyframes[low];
+		const SkeletalAnimation::Keyframe &s2 = inKeyframes[low + 1];
+		float fraction = (inTime - s1.mTime) / (s2.mTime - s1.mTime);
+		outTranslation = (1.0f - fraction) * s1.mTranslation + fraction * s2.mTranslation;
+		outRotation = s1.mRotation.SLERP(s2.mRotation, fraction);
+	}
+}
+
+void SkeletalAnimationSampler::Init(const SkeletalAnimation *inAnimation, const Skeleton *inSkeleton)
+{
+	mSkeleton = inSkeleton;
+	mDuration = inAnimation->GetDuration();
+	mIsLooping = inAnimation->IsLooping();
+
+	// Find the animated joint for each joint in the skeleton
+	const SkeletalAnimation::AnimatedJointVector &animated_joints = inAnimation->GetAnimatedJoints();
+	Array<const SkeletalAnimation::AnimatedJoint *> joint_to_animated_joint(inSkeleton->GetJointCount(), nullptr);
+	for (const SkeletalAnimation::AnimatedJoint &aj : animated_joints)
+	{
+		int joint_index = inSkeleton->GetJointIndex(aj.mJointName);
+		if (joint_index >= 0 && !aj.mKeyframes.empty())
+			joint_to_animated_joint[joint_index] = &aj;
+	}
+
+	// Convert the keyframes into groups of 4 joints
+	uint num_joints = uint(inSkeleton->GetJointCount());
+	mGroups.resize((num_joints + 3) / 4);
+	mKeyTimes.clear();
+	mKeyBlocks.clear();
+	mSharedKeyGroup = -1;
+	bool shared_key_times = true;
+	Array<float> times;
+	for (uint g = 0; g < mGroups.size(); ++g)
+	{
+		Group &group = mGroups[g];
+		group.mFirstKey = uint(mKeyTimes.size());
+		group.mNumKeys = 0;
+		group.mAnimatedMask = 0;
+
+		// Collect the keyframe times of all joints in the group, unused lanes count as animated so they don't need to be loaded from the pose
+		times.clear();
+		for (uint l = 0; l < 4; ++l)
+		{
+			uint joint = 4 * g + l;
+			if (joint >= num_joints)
+				group.mAnimatedMask |= 1 << l;
+			else if (joint_to_animated_joint[joint] != nullptr)
+			{
+				group.mAnimatedMask |= 1 << l;
+				for (const SkeletalAnimation::Keyframe &k : joint_to_animated_joint[joint]->mKeyframes)
+					times.push_back(k.mTime);
+			}
+		}
+		if (times.empty())
+		{
+			// Not animated, keep the current state
+			group.mAnimatedMask = 0;
+			continue;
+		}
+		QuickSort(times.begin(), times.end());
+		times.erase(std::unique(times.begin(), times.end()), times.end());
+
+		// Resample all joints at the union of the keyframe times
+		group.mNumKeys = uint(times.size());
+		for (float t : times)
+		{
+			mKeyTimes.push_back(t);
+			alignas(JPH_VECTOR_ALIGNMENT) Float4 translation[3], rotation[4];
+			for (uint l = 0; l < 4; ++l)
+			{
+				Vec3 joint_translation = Vec3::sZero();
+				Quat joint_rotation = Quat::sIdentity();
+				uint joint = 4 * g + l;
+				if (joint < num_joints && joint_to_animated_joint[joint] != nullptr)
+					sSampleKeyframes(joint_to_animated_joint[joint]->mKeyframes, t, joint_translation, joint_rotation);
+				JPH_ASSERT(joint_rotation.IsNormalized());
+				for (int c = 0; c < 3; ++c)
+					(&translation[c].x)[l] = joint_translation[c];
+				for (int c = 0; c < 4; ++c)
+					(&rotation[c].x)[l] = joint_rotation.GetXYZW()[c];
+			}
+			KeyBlock &block = mKeyBlocks.emplace_back();
+			for (int c = 0; c < 3; ++c)
+				block.mTranslation[c] = Vec4::sLoadFloat4Aligned(&translation[c]);
+			for (int c = 0; c < 4; ++c)
+				block.mRotation[c] = Vec4::sLoadFloat4Aligned(&rotation[c]);
+		}
+
+		// Check if the keyframe times are the same as the first animated group
+		if (mSharedKeyGroup < 0)
+			mSharedKeyGroup = int(g);
+		else if (shared_key_times)
+		{
+			const Group &shared = mGroups[mSharedKeyGroup];
+			shared_key_times = shared.mNumKeys == group.mNumKeys
+				&& memcmp(&mKeyTimes[shared.mFirstKey], &mKeyTimes[group.mFirstKey], group.mNumKeys * sizeof(float)) == 0;
+		}
+	}
+	if (!shared_key_times)
+		mSharedKeyGroup = -1;
+}
+
+float SkeletalAnimationSampler::GetLocalTime(float inTime) const
+{
+	// Correct time when animation is looping
+	JPH_ASSERT(inTime >= 0.0f);
+	return mDuration > 0.0f && mIsLooping? fmod(inTime, mDuration) : inTime;
+}
+
+SkeletalAnimationSampler::KeyLookup SkeletalAnimationSampler::FindKeys(const Group &inGroup, float inLocalTime) const
+{
+	// Do binary search for keyframe
+	const float *times = mKeyTimes.data() + inGroup.mFirstKey;
+	int high = (int)inGroup.mNumKeys, low = -1;
+	while (high - low > 1)
+	{
+		int probe = (high + low) / 2;
+		if (times[probe] < inLocalTime)
+			low = probe;
+		else
+			high = probe;
+	}
+
+	if (low == -1)
+	{
+		// Before first key, return first key
+		return { 0, 0, 0.0f };
+	}
+	else if (high == (int)inGroup.mNumKeys)
+	{
+		// Beyond last key, return last key
+		return { inGroup.mNumKeys - 1, inGroup.mNumKeys - 1, 0.0f };
+	}
+	else
+	{
+		// Interpolate
+		float fraction = (inLocalTime - times[low]) / (times[low + 1] - times[low]);
+		JPH_ASSERT(fraction >= 0.0f && fraction <= 1.0f);
+		return { uint(low), uint(low + 1), fraction };
+	}
+}
+
+void SkeletalAnimationSampler::SampleGroup(const Group &inGroup, const KeyLookup *inSharedLookup, float inLocalTime, Vec4 *outTranslation, Vec4 *outRotation) const
+{
+	JPH_ASSERT(inGroup.mNumKeys > 0);
+
+	// Get the keyframes to interpolate between
+	KeyLookup lookup = inSharedLookup != nullptr? *inSharedLookup : FindKeys(inGroup, inLocalTime);
+	const KeyBlock &key1 = mKeyBlocks[inGroup.mFirstKey + lookup.mKey1];
+	const KeyBlock &key2 = mKeyBlocks[inGroup.mFirstKey + lookup.mKey2];
+	Vec4 f = Vec4::sReplicate(lookup.mFraction);
+	Vec4 one_min_f = Vec4::sReplicate(1.0f - lookup.mFraction);
+
+	// Interpolate translation
+	for (int c = 0; c < 3; ++c)
+		outTranslation[c] = one_min_f * key1.mTranslation[c] + f * key2.mTranslation[c];
+
+	// Calculate cosine of angle between rotations and take the shortest path, see Quat::SLERP
+	const Vec4 *r1 = key1.mRotation, *r2 = key2.mRotation;
+	Vec4 cos_omega = r1[0] * r2[0] + r1[1] * r2[1] + r1[2] * r2[2] + r1[3] * r2[3];
+	Vec4 sign = Vec4::sSelect(Vec4::sReplicate(1.0f), Vec4::sReplicate(-1.0f), Vec4::sLess(cos_omega, Vec4::sZero()));
+	cos_omega *= sign;
+
+	// Calculate coefficients, when the rotations are very close we do a linear interpolation
+	UVec4 is_close = Vec4::sLessOrEqual(Vec4::sReplicate(1.0f) - cos_omega, Vec4::sReplicate(0.0001f));
+	Vec4 omega = Vec4::sMin(cos_omega, Vec4::sReplicate(1.0f)).ACos();
+	Vec4 sin_omega, sin_scale0, sin_scale1, cos_unused;
+	omega.SinCos(sin_omega, cos_unused);
+	(one_min_f * omega).SinCos(sin_scale0, cos_unused);
+	(f * omega).SinCos(sin_scale1, cos_unused);
+	Vec4 inv_sin_omega = Vec4::sSelect(sin_omega, Vec4::sReplicate(1.0f), is_close).Reciprocal();
+	Vec4 scale0 = Vec4::sSelect(sin_scale0 * inv_sin_omega, one_min_f, is_close);
+	Vec4 scale1 = sign * Vec4::sSelect(sin_scale1 * inv_sin_omega, f, is_close);
+
+	// Interpolate rotation
+	for (int c = 0; c < 4; ++c)
+		outRotation[c] = scale0 * r1[c] + scale1 * r2[c];
+}
+
+void SkeletalAnimationSampler::sLoadJoints(uint inFirstJoint, const SkeletonPose &inPose, Vec4 *outTranslation, Vec4 *outRotation)
+{
+	// Gather the joints, pad with identity
+	Vec4 translation[4], rotation[4];
+	for (uint l = 0; l < 4; ++l)
+	{
+		uint joint = inFirstJoint + l;
+		if (joint < uint(inPose.GetJointCount()))
+		{
+			const SkeletalAnimation::JointState &state = inPose.GetJoint(joint);
+			translation[l] = Vec4(state.mTranslation, 0.0f);
+			rotation[l] = state.mRotation.GetXYZW();
+		}
+		else
+		{
+			translation[l] = Vec4::sZero();
+			rotation[l] = Quat::sIdentity().GetXYZW();
+		}
+	}
+
+	// Transpose so that each lane contains a joint
+	Mat44 t = Mat44(translation[0], translation[1], translation[2], translation[3]).Transposed();
+	Mat44 r = Mat44(rotation[0], rotation[1], rotation[2], rotation[3]).Transposed();
+	for (int c = 0; c < 3; ++c)
+		outTranslation[c] = t.GetColumn4(c);
+	for (int c = 0; c < 4; ++c)
+		outRotation[c] = r.GetColumn4(c);
+}
+
+void SkeletalAnimationSampler::sStoreJoints(uint inFirstJoint, uint inMask, const Vec4 *inTranslation, const Vec4 *inRotation, SkeletonPose &ioPose)
+{
+	// Transpose back and store
+	Mat44 t = Mat44(inTranslation[0], inTranslation[1], inTranslation[2], Vec4::sZero()).Transposed();
+	Mat44 r = Mat44(inRotation[0], inRotation[1], inRotation[2], inRotation[3]).Transposed();
+	SkeletalAnimation::JointState *joints = ioPose.GetJoints().data();
+	for (uint l = 0, num_lanes = min(4u, uint(ioPose.GetJointCount()) - inFirstJoint); l < num_lanes; ++l)
+		if (inMask & (1 << l))
+		{
+			SkeletalAnimation::JointState &state = joints[inFirstJoint + l];
+			state.mTranslation = Vec3(t.GetColumn4(l));
+			state.mRotation = Quat(r.GetColumn4(l));
+		}
+}
+
+void SkeletalAnimationSampler::Sample(float inTime, SkeletonPose &ioPose) const
+{
+	JPH_PROFILE_FUNCTION();
+
+	JPH_ASSERT(ioPose.GetSkeleton() == mSkeleton);
+
+	float local_time = GetLocalTime(inTime);
+	KeyLookup shared_lookup;
+	const KeyLookup *shared = FindSharedKeys(local_time, shared_lookup);
+
+	for (const Group &group : mGroups)
+		if (group.mNumKeys > 0)
+		{
+			// Sample the group and store the joints that are animated, the others keep their current state
+			Vec4 translation[3], rotation[4];
+			SampleGroup(group, shared, local_time, translation, rotation);
+			sStoreJoints(4 * uint(&group - mGroups.data()), group.mAnimatedMask, translation, rotation, ioPose);
+		}
+}
+
+void SkeletalAnimationSampler::sSampleAndBlend(const BlendInput *inInputs, uint inNumInputs, SkeletonPose &ioPose)
+{
+	JPH_PROFILE_FUNCTION();
+
+	if (inNumInputs == 0)
+		return;
+
+	// Prepare the inputs
+	float total_weight = 0.0f;
+	float *local_times = (float *)JPH_STACK_ALLOC(inNumInputs * sizeof(float));
+	KeyLookup *shared_lookups = (KeyLookup *)JPH_STACK_ALLOC(inNumInputs * sizeof(KeyLookup));
+	const KeyLookup **shared = (const KeyLookup **)JPH_STACK_ALLOC(inNumInputs * sizeof(const KeyLookup *));
+	for (uint i = 0; i < inNumInputs; ++i)
+	{
+		const BlendInput &input = inInputs[i];
+		JPH_ASSERT(input.mSampler->mSkeleton == ioPose.GetSkeleton());
+		JPH_ASSERT(input.mWeight >= 0.0f);
+		total_weight += input.mWeight;
+		local_times[i] = input.mSampler->GetLocalTime(input.mTime);
+		shared[i] = input.mSampler->FindSharedKeys(local_times[i], shared_lookups[i]);
+	}
+	if (total_weight <= 0.0f)
+		return;
+	Vec4 inv_total_weight = Vec4::sReplicate(1.0f / total_weight);
+
+	const UVec4 lane_bits(1, 2, 4, 8);
+	uint num_groups = (uint(ioPose.GetJointCount()) + 3) / 4;
+	for (uint g = 0; g < num_groups; ++g)
+	{
+		uint first_joint = 4 * g;
+
+		// The current state of the joints, only loaded when an animation doesn't animate all joints in the group
+		Vec4 pose_translation[3], pose_rotation[4];
+		bool pose_loaded = false;
+
+		// Accumulate the weighted joint states of all animations
+		Vec4 sum_translation[3], sum_rotation[4];
+		for (uint i = 0; i < inNumInputs; ++i)
+		{
+			const SkeletalAnimationSampler *sampler = inInputs[i].mSampler;
+			const Group &group = sampler->mGroups[g];
+
+			// Get the joint states for this animation
+			Vec4 translation[3], rotation[4];
+			if (group.mAnimatedMask != cAllAnimated && !pose_loaded)
+			{
+				sLoadJoints(first_joint, ioPose, pose_translation, pose_rotation);
+				pose_loaded = true;
+			}
+			if (group.mNumKeys == 0)
+			{
+				// Not animated, use the current state
+				for (int c = 0; c < 3; ++c)
+					translation[c] = pose_translation[c];
+				for (int c = 0; c < 4; ++c)
+					rotation[c] = pose_rotation[c];
+			}
+			else
+			{
+				sampler->SampleGroup(group, shared[i], local_times[i], translation, rotation);
+				if (group.mAnimatedMask != cAllAnimated)
+				{
+					// Use the current state for the joints that are not animated
+					UVec4 is_animated = UVec4::sEquals(UVec4::sAnd(UVec4::sReplicate(group.mAnimatedMask), lane_bits), lane_bits);
+					for (int c = 0; c < 3; ++c)
+						translation[c] = Vec4::sSelect(pose_translation[c], translation[c], is_animated);
+					for (int c = 0; c < 4; ++c)
+						rotation[c] = Vec4::sSelect(pose_rotation[c], rotation[c], is_animated);
+				}
+			}
+
+			Vec4 weight = Vec4::sReplicate(inInputs[i].mWeight);
+			if (i == 0)
+			{
+				for (int c = 0; c < 3; ++c)
+					sum_translation[c] = weight * translation[c];
+				for (int c = 0; c < 4; ++c)
+					sum_rotation[c] = weight * rotation[c];
+			}
+			else
+			{
+				for (int c = 0; c < 3; ++c)
+					sum_translation[c] += weight * translation[c];
+
+				// Make sure the rotation is in the same hemisphere as the accumulated rotation
+				Vec4 dot = sum_rotation[0] * rotation[0] + sum_rotation[1] * rotation[1] + sum_rotation[2] * rotation[2] + sum_rotation[3] * rotation[3];
+				weight = Vec4::sSelect(weight, -weight, Vec4::sLess(dot, Vec4::sZero()));
+				for (int c = 0; c < 4; ++c)
+					sum_rotation[c] += weight * rotation[c];
+			}
+		}
+
+		// Normalize
+		for (int c = 0; c < 3; ++c)
+			sum_translation[c] *= inv_total_weight;
+		Vec4 len_sq = sum_rotation[0] * sum_rotation[0] + sum_rotation[1] * sum_rotation[1] + sum_rotation[2] * sum_rotation[2] + sum_rotation[3] * sum_rotation[3];
+		Vec4 inv_len = Vec4::sMax(len_sq, Vec4::sReplicate(1.0e-12f)).Sqrt().Reciprocal();
+		for (int c = 0; c < 4; ++c)
+			sum_rotation[c] *= inv_len;
+
+		sStoreJoints(first_joint, cAllAnimated, sum_translation, sum_rotation, ioPose);
+	}
+}
+
+JPH_NAMESPACE_END
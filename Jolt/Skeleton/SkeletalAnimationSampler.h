@@ -0,0 +1,109 @@
+// Jolt Physics Library (https://github.com/jrouwe/JoltPhysics)
+// SPDX-FileCopyrightText: 2024 Jorrit Rouwe
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <Jolt/Core/NonCopyable.h>
+#include <Jolt/Skeleton/SkeletalAnimation.h>
+#include <Jolt/Skeleton/Skeleton.h>
+
+JPH_NAMESPACE_BEGIN
+
+/// Samples a SkeletalAnimation for a particular Skeleton, intended for when many poses need to be sampled each frame.
+///
+/// Compared to SkeletalAnimation::Sample this class resolves the joint names only once and stores the keyframes in blocks of 4 joints,
+/// where each lane of a Vec4 contains one joint, so that 4 joints are interpolated with straight vector loads.
+/// The joints in a block are resampled at the union of their keyframe times, which doesn't change the result because interpolating
+/// between points on the same (linear or spherical) segment gives the same point. When all blocks share the same keyframe times
+/// (which is usually the case for exported animations) the keyframe lookup is done only once for all joints.
+class JPH_EXPORT SkeletalAnimationSampler : public NonCopyable
+{
+public:
+	JPH_OVERRIDE_NEW_DELETE
+
+	/// Constructor
+								SkeletalAnimationSampler() = default;
+								SkeletalAnimationSampler(const SkeletalAnimation *inAnimation, const Skeleton *inSkeleton) { Init(inAnimation, inSkeleton); }
+
+	/// Convert the keyframes of inAnimation for sampling poses of inSkeleton. Animated joints that are not in the skeleton are ignored.
+	void						Init(const SkeletalAnimation *inAnimation, const Skeleton *inSkeleton);
+
+	/// Get the skeleton that this sampler was created for
+	const Skeleton *			GetSkeleton() const												{ return mSkeleton; }
+
+	/// Get the length (in seconds) of the animation
+	float						GetDuration() const												{ return mDuration; }
+
+	/// Get the (interpolated) joint transforms at time inTime, gives the same result as SkeletalAnimation::Sample (up to floating point accuracy).
+	/// Joints that are not animated keep their value in ioPose.
+	void						Sample(float inTime, SkeletonPose &ioPose) const;
+
+	/// An animation to blend
+	struct BlendInput
+	{
+		const SkeletalAnimationSampler *mSampler;												///< The animation to sample
+		float					mTime;															///< Time at which to sample the animation
+		float					mWeight;														///< Relative weight of the animation, the weights are normalized so they don't need to add up to 1
+	};
+
+	/// Sample multiple animations and blend them together. Translations are blended linearly, rotations are blended using a normalized weighted sum.
+	/// All samplers must have been created for the skeleton of ioPose. If an animation doesn't animate a joint, the joint in ioPose is used instead.
+	static void					sSampleAndBlend(const BlendInput *inInputs, uint inNumInputs, SkeletonPose &ioPose);
+
+private:
+	/// Keyframe of a group of 4 consecutive joints, each lane contains a joint
+	struct KeyBlock
+	{
+		Vec4					mTranslation[3];												///< X, Y and Z components of the translations
+		Vec4					mRotation[4];													///< X, Y, Z and W components of the rotations
+	};
+
+	/// Keyframes for a group of 4 consecutive joints of the skeleton
+	struct Group
+	{
+		uint					mFirstKey;														///< Index of the first keyframe in mKeyTimes and mKeyBlocks
+		uint					mNumKeys;														///< Number of keyframes, 0 if none of the joints in the group are animated
+		uint					mAnimatedMask;													///< Bit N is set when joint N of the group is animated (or when the group has less than 4 joints and lane N is unused)
+	};
+
+	/// The keyframes to interpolate between, relative to the first keyframe of a group
+	struct KeyLookup
+	{
+		uint					mKey1;
+		uint					mKey2;
+		float					mFraction;
+	};
+
+	/// Bit mask for Group::mAnimatedMask when all 4 joints are animated
+	static constexpr uint		cAllAnimated = 0b1111;
+
+	/// Correct the time for looping animations
+	float						GetLocalTime(float inTime) const;
+
+	/// Find the keyframes to interpolate between for a group
+	KeyLookup					FindKeys(const Group &inGroup, float inLocalTime) const;
+
+	/// If all groups share the same keyframe times, find the keyframes to interpolate between once. Returns null if the groups don't share keyframe times.
+	const KeyLookup *			FindSharedKeys(float inLocalTime, KeyLookup &outLookup) const	{ return mSharedKeyGroup >= 0? &(outLookup = FindKeys(mGroups[mSharedKeyGroup], inLocalTime)) : nullptr; }
+
+	/// Interpolate the keyframes of a group that has keyframes, outputs the translation as (x, y, z) and rotation as (x, y, z, w) components where each lane is a joint.
+	/// When inSharedLookup is not null, it is used instead of searching for the keyframes of the group.
+	void						SampleGroup(const Group &inGroup, const KeyLookup *inSharedLookup, float inLocalTime, Vec4 *outTranslation, Vec4 *outRotation) const;
+
+	/// Load joints inFirstJoint .. inFirstJoint + 3 of inPose in the same layout as SampleGroup outputs them
+	static void					sLoadJoints(uint inFirstJoint, const SkeletonPose &inPose, Vec4 *outTranslation, Vec4 *outRotation);
+
+	/// Store the lanes of inTranslation and inRotation for which the bit in inMask is set in joints inFirstJoint .. inFirstJoint + 3 of ioPose
+	static void					sStoreJoints(uint inFirstJoint, uint inMask, const Vec4 *inTranslation, const Vec4 *inRotation, SkeletonPose &ioPose);
+
+	RefConst<Skeleton>			mSkeleton;														///< Skeleton that this sampler was created for
+	Array<Group>				mGroups;														///< Keyframes for each group of 4 joints in the skeleton
+	Array<float>				mKeyTimes;														///< Time of all keyframes of all groups
+	Array<KeyBlock>				mKeyBlocks;														///< Translations and rotations of all keyframes of all groups
+	float						mDuration = 0.0f;												///< Length of the animation in seconds
+	bool						mIsLooping = true;												///< If the animation loops back to start
+	int							mSharedKeyGroup = -1;											///< If all animated groups have the same keyframe times, the index of one of these groups, -1 otherwise
+};
+
+JPH_NAMESPACE_END
@@ -27,10 +27,15 @@ JPH_IMPLEMENT_SERIALIZABLE_NON_VIRTUAL(Skeleton)
 #ifdef JPH_OBJECT_STREAM
 int Skeleton::AddJoint(const string_view &inName, const string_view &inParentName)
 {
+	const Joint *old_joints = mJoints.data();
 	mJoints.emplace_back(inName, inParentName, -1);
 
 	int i = (int)mJoints.size() - 1;
 
+	// When the joints were reallocated the map refers to names that no longer exist, rebuild it before using it
+	if (old_joints != mJoints.data())
+		RebuildJointNameMap(i);
+
 	JointNameMap::const_iterator j = mJointNameMap.find(mJoints[i].mName);
 	JPH_ASSERT(mJointNameMap.end() == j);
 	mJointNameMap.emplace_hint(mJointNameMap.end(), mJoints[i].mName, i);
@@ -41,6 +46,7 @@ int Skeleton::AddJoint(const string_view &inName, const string_view &inParentNam
 
 int Skeleton::AddJoint(const string_view &inName, int inParentIndex)
 {
+	const Joint *old_joints = mJoints.data();
 	mJoints.emplace_back(
 		inName,
 #ifdef JPH_OBJECT_STREAM
@@ -50,6 +56,10 @@ int Skeleton::AddJoint(const string_view &inName, int inParentIndex)
 
 	int i = (int)mJoints.size() - 1;
 
+	// When the joints were reallocated the map refers to names that no longer exist, rebuild it before using it
+	if (old_joints != mJoints.data())
+		RebuildJointNameMap(i);
+
 	JointNameMap::const_iterator j = mJointNameMap.find(mJoints[i].mName);
 	JPH_ASSERT(mJointNameMap.end() == j);
 	mJointNameMap.emplace_hint(j, mJoints[i].mName, i);
@@ -57,6 +67,14 @@ int Skeleton::AddJoint(const string_view &inName, int inParentIndex)
 	return i;
 }
 
+void Skeleton::RebuildJointNameMap(int inNumJoints)
+{
+	// The map refers to the names stored in mJoints, when the joints are reallocated the names move so the map needs to be rebuilt
+	mJointNameMap.clear();
+	for (int i = 0; i < inNumJoints; ++i)
+		mJointNameMap.emplace(mJoints[i].mName, i);
+}
+
 int Skeleton::GetJointIndex(const string_view &inName) const
 {
 	JointNameMap::const_iterator j = mJointNameMap.find(inName);
@@ -95,6 +95,9 @@ public:
 #endif
 
 private:
+	/// Rebuild mJointNameMap from the first inNumJoints joints in mJoints
+	void					RebuildJointNameMap(int inNumJoints);
+
 	/// Joints
 	JointVector				mJoints;
 	/// Joint Names
@@ -0,0 +1,209 @@
+// Jolt Physics Library (https://github.com/jrouwe/JoltPhysics)
+// SPDX-FileCopyrightText: 2024 Jorrit Rouwe
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+// Jolt includes
+#include <Jolt/Physics/Ragdoll/RagdollBatchDriver.h>
+#include <Jolt/Skeleton/SkeletalAnimationSampler.h>
+#include <Jolt/ObjectStream/ObjectStreamIn.h>
+
+// Local includes
+#include "PerformanceTestScene.h"
+#include "Layers.h"
+
+#ifdef JPH_OBJECT_STREAM
+
+// A scene with many kinematic ragdolls that every frame are driven to a blend of a walk and a sprint animation.
+// This scene measures the cost of sampling and blending animations on top of the physics update, the sampling is also
+// timed separately and compared against sampling through SkeletalAnimation::Sample when the test stops.
+class AnimatedRagdollScene : public PerformanceTestScene
+{
+public:
+	virtual const char *	GetName() const override
+	{
+		return "AnimatedRagdoll";
+	}
+
+	virtual bool			Load() override
+	{
+		// Load ragdoll
+		if (!ObjectStreamIn::sReadObject("Assets/Human.tof", mRagdollSettings))
+		{
+			cerr << "Unable to load ragdoll" << endl;
+			return false;
+		}
+		for (BodyCreationSettings &body : mRagdollSettings->mParts)
+		{
+			body.mMotionType = EMotionType::Kinematic;
+			body.mObjectLayer = Layers::MOVING;
+		}
+		mRagdollSettings->GetSkeleton()->CalculateParentJointIndices();
+
+		// Load animations
+		if (!ObjectStreamIn::sReadObject("Assets/Human/walk.tof", mWalkAnimation)
+			|| !ObjectStreamIn::sReadObject("Assets/Human/sprint.tof", mSprintAnimation))
+		{
+			cerr << "Unable to load animation" << endl;
+			return false;
+		}
+		mWalk.Init(mWalkAnimation, mRagdollSettings->GetSkeleton());
+		mSprint.Init(mSprintAnimation, mRagdollSettings->GetSkeleton());
+
+		return true;
+	}
+
+	virtual void			StartTest(PhysicsSystem &inPhysicsSystem, EMotionQuality inMotionQuality) override
+	{
+		// Test configuration
+		const int cNumRagdollsPerAxis = 16;
+		const Real cSeparation = 2.0_r;
+
+		mTime = 0.0f;
+		mNumFrames = 0;
+		mSamplingDuration = chrono::nanoseconds(0);
+
+		// Create a grid of ragdolls
+		CollisionGroup::GroupID group_id = 1;
+		const uint num_ragdolls = cNumRagdollsPerAxis * cNumRagdollsPerAxis;
+		mRagdolls.reserve(num_ragdolls);
+		mPoses.reserve(num_ragdolls);
+		for (int row = 0; row < cNumRagdollsPerAxis; ++row)
+			for (int col = 0; col < cNumRagdollsPerAxis; ++col)
+			{
+				Ref<Ragdoll> ragdoll = mRagdollSettings->CreateRagdoll(group_id++, 0, &inPhysicsSystem);
+				ragdoll->AddToPhysicsSystem(EActivation::Activate);
+				mRagdolls.push_back(ragdoll);
+
+				SkeletonPose &pose = mPoses.emplace_back();
+				pose.SetSkeleton(mRagdollSettings->GetSkeleton());
+				pose.SetRootOffset(RVec3(cSeparation * col, 0, cSeparation * row));
+			}
+
+		// Collect the pointers that are passed to the driver every frame
+		mRagdollPtrs.reserve(num_ragdolls);
+		mPosePtrs.reserve(num_ragdolls);
+		for (uint r = 0; r < num_ragdolls; ++r)
+		{
+			mRagdollPtrs.push_back(mRagdolls[r]);
+			mPosePtrs.push_back(&mPoses[r]);
+		}
+
+		// Scratch poses for the baseline
+		for (SkeletonPose &pose : mBaselinePoses)
+			pose.SetSkeleton(mRagdollSettings->GetSkeleton());
+
+		SamplePoses(mTime);
+		CalculateJointMatrices();
+		for (uint r = 0; r < mRagdolls.size(); ++r)
+			mRagdolls[r]->SetPose(mPoses[r]);
+	}
+
+	virtual void			UpdateTest(PhysicsSystem &inPhysicsSystem, JobSystem &inJobSystem, float inDeltaTime) override
+	{
+		mTime += inDeltaTime;
+
+		// Sample the animations, timed separately from the physics update
+		chrono::high_resolution_clock::time_point clock_start = chrono::high_resolution_clock::now();
+		SamplePoses(mTime);
+		mSamplingDuration += chrono::duration_cast<chrono::nanoseconds>(chrono::high_resolution_clock::now() - clock_start);
+		++mNumFrames;
+
+		CalculateJointMatrices();
+
+		// Drive the ragdolls to the new poses
+		mDriver.DriveToPoseUsingKinematics(mRagdollPtrs.data(), mPosePtrs.data(), uint(mRagdollPtrs.size()), inDeltaTime, inJobSystem);
+	}
+
+	virtual void			StopTest(PhysicsSystem &inPhysicsSystem) override
+	{
+		// Time the same frames using SkeletalAnimation::Sample as a baseline, this doesn't affect the simulation
+		if (mNumFrames > 0)
+		{
+			const float cDeltaTime = mTime / mNumFrames;
+			chrono::nanoseconds baseline_duration(0);
+			for (uint frame = 1; frame <= mNumFrames; ++frame)
+			{
+				chrono::high_resolution_clock::time_point clock_start = chrono::high_resolution_clock::now();
+				SamplePosesBaseline(cDeltaTime * frame);
+				baseline_duration += chrono::duration_cast<chrono::nanoseconds>(chrono::high_resolution_clock::now() - clock_start);
+			}
+			Trace("Animation sampling, SkeletalAnimationSampler: %f ms / frame, SkeletalAnimation::Sample: %f ms / frame",
+				1.0e-6 * mSamplingDuration.count() / mNumFrames, 1.0e-6 * baseline_duration.count() / mNumFrames);
+		}
+
+		// Remove ragdolls
+		for (Ragdoll *ragdoll : mRagdolls)
+			ragdoll->RemoveFromPhysicsSystem();
+		mRagdollPtrs.clear();
+		mPosePtrs.clear();
+		mRagdolls.clear();
+		mPoses.clear();
+	}
+
+private:
+	// Every ragdoll has a different phase and walk / sprint ratio
+	static float			sGetPhase(uint inRagdoll)					{ return 0.1f * inRagdoll; }
+	static float			sGetSprintWeight(uint inRagdoll)			{ return float(inRagdoll % 11) / 10.0f; }
+
+	// Sample and blend the animations for all ragdolls
+	void					SamplePoses(float inTime)
+	{
+		for (uint r = 0; r < mPoses.size(); ++r)
+		{
+			float time = inTime + sGetPhase(r);
+			float sprint_weight = sGetSprintWeight(r);
+			SkeletalAnimationSampler::BlendInput inputs[] = {
+				{ &mWalk, time, 1.0f - sprint_weight },
+				{ &mSprint, time, sprint_weight }
+			};
+			SkeletalAnimationSampler::sSampleAndBlend(inputs, 2, mPoses[r]);
+		}
+	}
+
+	// Same as SamplePoses but samples each animation with SkeletalAnimation::Sample and blends joint by joint
+	void					SamplePosesBaseline(float inTime)
+	{
+		SkeletonPose &walk = mBaselinePoses[0], &sprint = mBaselinePoses[1], &blended = mBaselinePoses[2];
+		for (uint r = 0; r < mPoses.size(); ++r)
+		{
+			float time = inTime + sGetPhase(r);
+			float sprint_weight = sGetSprintWeight(r);
+			mWalkAnimation->Sample(time, walk);
+			mSprintAnimation->Sample(time, sprint);
+			for (int j = 0; j < blended.GetJointCount(); ++j)
+			{
+				const SkeletalAnimation::JointState &j1 = walk.GetJoint(j), &j2 = sprint.GetJoint(j);
+				SkeletalAnimation::JointState &out = blended.GetJoint(j);
+				out.mTranslation = (1.0f - sprint_weight) * j1.mTranslation + sprint_weight * j2.mTranslation;
+				float w2 = j1.mRotation.Dot(j2.mRotation) < 0.0f? -sprint_weight : sprint_weight;
+				out.mRotation = ((1.0f - sprint_weight) * j1.mRotation + w2 * j2.mRotation).Normalized();
+			}
+		}
+	}
+
+	// Calculate the joint matrices for all ragdolls
+	void					CalculateJointMatrices()
+	{
+		for (SkeletonPose &pose : mPoses)
+			pose.CalculateJointMatrices();
+	}
+
+	Ref<RagdollSettings>	mRagdollSettings;
+	Ref<SkeletalAnimation>	mWalkAnimation;
+	Ref<SkeletalAnimation>	mSprintAnimation;
+	SkeletalAnimationSampler mWalk;
+	SkeletalAnimationSampler mSprint;
+	RagdollBatchDriver		mDriver;
+	Array<Ref<Ragdoll>>		mRagdolls;
+	Array<SkeletonPose>		mPoses;
+	Array<Ragdoll *>		mRagdollPtrs;
+	Array<const SkeletonPose *> mPosePtrs;
+	SkeletonPose			mBaselinePoses[3];
+	float					mTime = 0.0f;
+	uint					mNumFrames = 0;
+	chrono::nanoseconds		mSamplingDuration { 0 };
+};
+
+#endif // JPH_OBJECT_STREAM
@@ -0,0 +1,57 @@
+// Jolt Physics Library (https://github.com/jrouwe/JoltPhysics)
+// SPDX-FileCopyrightText: 2024 Jorrit Rouwe
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+// Jolt includes
+#include <Jolt/Physics/Collision/Shape/BoxShape.h>
+
+// Local includes
+#include "PerformanceTestScene.h"
+#include "Layers.h"
+
+// A scene that creates many small bodies that move along the X axis on parallel lanes, like cars on a highway.
+// This scene can be used to compare the different broadphase types (see the -bp command line option).
+class HighwayScene : public PerformanceTestScene
+{
+public:
+	virtual const char *	GetName() const override
+	{
+		return "Highway";
+	}
+
+	virtual void			StartTest(PhysicsSystem &inPhysicsSystem, EMotionQuality inMotionQuality) override
+	{
+		BodyInterface &bi = inPhysicsSystem.GetBodyInterface();
+
+		const int cNumLanes = 16;
+		const int cCarsPerLane = 400;
+		const float cLaneWidth = 4.0f;
+		const float cCarSpacing = 6.0f;
+		const float cRoadLength = cCarsPerLane * cCarSpacing;
+
+		// Road
+		BodyCreationSettings road_settings(new BoxShape(Vec3(0.5f * cRoadLength + 100.0f, 1.0f, 0.5f * cNumLanes * cLaneWidth + 10.0f), 0.0f), RVec3(0.5_r * cRoadLength, -1.0_r, 0.5_r * cNumLanes * cLaneWidth), Quat::sIdentity(), EMotionType::Static, Layers::NON_MOVING);
+		road_settings.mFriction = 0.0f;
+		bi.CreateAndAddBody(road_settings, EActivation::DontActivate);
+
+		// Cars, every lane drives with a different speed so that the cars overtake each other and change order along the X axis
+		RefConst<Shape> car_shape = new BoxShape(Vec3(2.0f, 0.75f, 1.0f));
+		for (int lane = 0; lane < cNumLanes; ++lane)
+		{
+			float speed = (lane & 1? -1.0f : 1.0f) * (10.0f + 2.0f * lane);
+			for (int car = 0; car < cCarsPerLane; ++car)
+			{
+				BodyCreationSettings settings(car_shape, RVec3(Real(car * cCarSpacing), 0.75_r, Real((lane + 0.5f) * cLaneWidth)), Quat::sIdentity(), EMotionType::Dynamic, Layers::MOVING);
+				settings.mMotionQuality = inMotionQuality;
+				settings.mFriction = 0.0f;
+				settings.mLinearDamping = 0.0f;
+				settings.mAllowSleeping = false;
+				settings.mLinearVelocity = Vec3(speed, 0, 0);
+				settings.mAllowedDOFs = EAllowedDOFs::TranslationX | EAllowedDOFs::TranslationY; // Keep the cars in their lane
+				bi.CreateAndAddBody(settings, EActivation::Activate);
+			}
+		}
+	}
+};
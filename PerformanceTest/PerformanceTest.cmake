@@ -3,11 +3,15 @@ set(PERFORMANCE_TEST_ROOT ${PHYSICS_REPO_ROOT}/PerformanceTest)
 
 # Source files
 set(PERFORMANCE_TEST_SRC_FILES
+	${PERFORMANCE_TEST_ROOT}/AnimatedRagdollScene.h
 	${PERFORMANCE_TEST_ROOT}/PyramidScene.h
+	${PERFORMANCE_TEST_ROOT}/HighwayScene.h
 	${PERFORMANCE_TEST_ROOT}/PerformanceTest.cpp
 	${PERFORMANCE_TEST_ROOT}/PerformanceTest.cmake
 	${PERFORMANCE_TEST_ROOT}/PerformanceTestScene.h
+	${PERFORMANCE_TEST_ROOT}/PhysicsSceneCacheBenchmark.h
 	${PERFORMANCE_TEST_ROOT}/RagdollScene.h
+	${PERFORMANCE_TEST_ROOT}/StateRecorderBenchmark.h
 	${PERFORMANCE_TEST_ROOT}/ConvexVsMeshScene.h
 	${PERFORMANCE_TEST_ROOT}/Layers.h
 )
@@ -41,8 +41,12 @@ JPH_SUPPRESS_WARNINGS
 
 // Local includes
 #include "RagdollScene.h"
+#include "AnimatedRagdollScene.h"
 #include "ConvexVsMeshScene.h"
 #include "PyramidScene.h"
+#include "HighwayScene.h"
+#include "StateRecorderBenchmark.h"
+#include "PhysicsSceneCacheBenchmark.h"
 
 // Time step for physics
 constexpr float cDeltaTime = 1.0f / 60.0f;
@@ -92,9 +96,13 @@ int main(int argc, char** argv)
 	bool enable_per_frame_recording = false;
 	bool record_state = false;
 	bool validate_state = false;
+	bool state_benchmark = false;
+	bool scene_cache_benchmark = false;
 	unique_ptr<PerformanceTestScene> scene;
 	const char *validate_hash = nullptr;
 	int repeat = 1;
+	EBroadPhaseType broad_phase_type = EBroadPhaseType::QuadTree;
+	const char *broad_phase_name = "QuadTree";
 	for (int argidx = 1; argidx < argc; ++argidx)
 	{
 		const char *arg = argv[argidx];
@@ -107,17 +115,35 @@ int main(int argc, char** argv)
 #ifdef JPH_OBJECT_STREAM
 			else if (strcmp(arg + 3, "RagdollSinglePile") == 0)
 				scene = unique_ptr<PerformanceTestScene>(new RagdollScene(1, 160, 0.4f));
+			else if (strcmp(arg + 3, "AnimatedRagdoll") == 0)
+				scene = unique_ptr<PerformanceTestScene>(new AnimatedRagdollScene);
 #endif // JPH_OBJECT_STREAM
 			else if (strcmp(arg + 3, "ConvexVsMesh") == 0)
 				scene = unique_ptr<PerformanceTestScene>(new ConvexVsMeshScene);
 			else if (strcmp(arg + 3, "Pyramid") == 0)
 				scene = unique_ptr<PerformanceTestScene>(new PyramidScene);
+			else if (strcmp(arg + 3, "Highway") == 0)
+				scene = unique_ptr<PerformanceTestScene>(new HighwayScene);
 			else
 			{
 				Trace("Invalid scene");
 				return 1;
 			}
 		}
+		else if (strncmp(arg, "-bp=", 4) == 0)
+		{
+			// Parse broadphase type
+			broad_phase_name = arg + 4;
+			if (strcmp(broad_phase_name, "QuadTree") == 0)
+				broad_phase_type = EBroadPhaseType::QuadTree;
+			else if (strcmp(broad_phase_name, "SAP") == 0)
+				broad_phase_type = EBroadPhaseType::SweepAndPrune;
+			else
+			{
+				Trace("Invalid broadphase");
+				return 1;
+			}
+		}
 		else if (strncmp(arg, "-i=", 3) == 0)
 		{
 			// Parse max iterations
@@ -172,6 +198,14 @@ int main(int argc, char** argv)
 		{
 			validate_state = true;
 		}
+		else if (strcmp(arg, "-state_benchmark") == 0)
+		{
+			state_benchmark = true;
+		}
+		else if (strcmp(arg, "-scene_cache_benchmark") == 0)
+		{
+			scene_cache_benchmark = true;
+		}
 		else if (strncmp(arg, "-validate_hash=", 15) == 0)
 		{
 			validate_hash = arg + 15;
@@ -185,7 +219,8 @@ int main(int argc, char** argv)
 		{
 			// Print usage
 			Trace("Usage:\n"
-				  "-s=<scene>: Select scene (Ragdoll, RagdollSinglePile, ConvexVsMesh, Pyramid)\n"
+				  "-s=<scene>: Select scene (Ragdoll, RagdollSinglePile, AnimatedRagdoll, ConvexVsMesh, Pyramid, Highway)\n"
+				  "-bp=<broadphase>: Select broadphase (QuadTree, SAP)\n"
 				  "-i=<num physics steps>: Number of physics steps to simulate (default 500)\n"
 				  "-q=<quality>: Test only with specified quality (Discrete, LinearCast)\n"
 				  "-t=<num threads>: Test only with N threads (default is to iterate over 1 .. num hardware threads)\n"
@@ -196,6 +231,8 @@ int main(int argc, char** argv)
 				  "-no_sleep: Disable sleeping\n"
 				  "-rs: Record state\n"
 				  "-vs: Validate state\n"
+				  "-state_benchmark: Measure save / restore state throughput for 10k bodies instead of running a scene (uses -i and -t)\n"
+				  "-scene_cache_benchmark: Measure the time to load a 100k body scene in the binary and cooked formats instead of running a scene (uses -i)\n"
 				  "-validate_hash=<hash>: Validate hash (return 0 if successful, 1 if failed)\n"
 				  "-repeat=<num>: Repeat all tests <num> times");
 			return 0;
@@ -211,6 +248,44 @@ int main(int argc, char** argv)
 	// Create temp allocator
 	TempAllocatorImpl temp_allocator(32 * 1024 * 1024);
 
+	// Run the scene cache benchmark instead of a scene
+	if (scene_cache_benchmark)
+	{
+		{
+			PhysicsSceneCacheBenchmark benchmark;
+			benchmark.Init();
+			benchmark.Run(max_iterations);
+		}
+
+		UnregisterTypes();
+		delete Factory::sInstance;
+		Factory::sInstance = nullptr;
+		return 0;
+	}
+
+	// Run the state recorder benchmark instead of a scene
+	if (state_benchmark)
+	{
+		BPLayerInterfaceImpl broad_phase_layer_interface;
+		ObjectVsBroadPhaseLayerFilterImpl object_vs_broadphase_layer_filter;
+		ObjectLayerPairFilterImpl object_vs_object_layer_filter;
+
+		{
+			JobSystemThreadPool job_system(cMaxPhysicsJobs, cMaxPhysicsBarriers, specified_threads > 0? specified_threads - 1 : thread::hardware_concurrency() - 1);
+			PhysicsSystem physics_system;
+			physics_system.Init(10240, 0, 65536, 20480, broad_phase_layer_interface, object_vs_broadphase_layer_filter, object_vs_object_layer_filter, broad_phase_type);
+
+			StateRecorderBenchmark benchmark;
+			benchmark.Init(physics_system, temp_allocator, job_system);
+			benchmark.Run(physics_system, job_system, max_iterations);
+		}
+
+		UnregisterTypes();
+		delete Factory::sInstance;
+		Factory::sInstance = nullptr;
+		return 0;
+	}
+
 	// Load the scene
 	if (scene == nullptr)
 		scene = create_ragdoll_scene();
@@ -222,6 +297,7 @@ int main(int argc, char** argv)
 
 	// Output scene we're running
 	Trace("Running scene: %s", scene->GetName());
+	Trace("Using broadphase: %s", broad_phase_name);
 
 	// Create mapping table from object layer to broadphase layer
 	BPLayerInterfaceImpl broad_phase_layer_interface;
@@ -268,7 +344,7 @@ int main(int argc, char** argv)
 
 				// Create physics system
 				PhysicsSystem physics_system;
-				physics_system.Init(10240, 0, 65536, 20480, broad_phase_layer_interface, object_vs_broadphase_layer_filter, object_vs_object_layer_filter);
+				physics_system.Init(10240, 0, 65536, 20480, broad_phase_layer_interface, object_vs_broadphase_layer_filter, object_vs_object_layer_filter, broad_phase_type);
 
 				// Start test scene
 				scene->StartTest(physics_system, motion_quality);
@@ -332,6 +408,9 @@ int main(int argc, char** argv)
 					// Start measuring
 					chrono::high_resolution_clock::time_point clock_start = chrono::high_resolution_clock::now();
 
+					// Update the scene
+					scene->UpdateTest(physics_system, job_system, cDeltaTime);
+
 					// Do a physics step
 					physics_system.Update(cDeltaTime, 1, &temp_allocator, &job_system);
 
@@ -20,6 +20,9 @@ public:
 	// Start a new test by adding objects to inPhysicsSystem
 	virtual void			StartTest(PhysicsSystem &inPhysicsSystem, EMotionQuality inMotionQuality) = 0;
 
+	// Called every frame before the physics update, time spent here is included in the measurement
+	virtual void			UpdateTest(PhysicsSystem &inPhysicsSystem, JobSystem &inJobSystem, float inDeltaTime) { }
+
 	// Stop a test and remove objects from inPhysicsSystem
 	virtual void			StopTest(PhysicsSystem &inPhysicsSystem)		{ }
 };
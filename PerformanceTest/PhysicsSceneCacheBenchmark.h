@@ -0,0 +1,112 @@
+// Jolt Physics Library (https://github.com/jrouwe/JoltPhysics)
+// SPDX-FileCopyrightText: 2024 Jorrit Rouwe
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+// Jolt includes
+#include <Jolt/Physics/PhysicsScene.h>
+#include <Jolt/Physics/Collision/Shape/BoxShape.h>
+#include <Jolt/Physics/Collision/Shape/SphereShape.h>
+#include <Jolt/Physics/Collision/Shape/CapsuleShape.h>
+#include <Jolt/Physics/Collision/Shape/ConvexHullShape.h>
+#include <Jolt/Core/StreamWrapper.h>
+
+// Local includes
+#include "Layers.h"
+
+// Measures how fast a scene with many bodies can be loaded from the binary format and from the cooked format
+class PhysicsSceneCacheBenchmark
+{
+public:
+	// Number of bodies in the scene
+	static constexpr int	cNumBodies = 100000;
+
+	// Every cUniqueShapeInterval-th body gets its own convex hull, the others share a couple of primitive shapes
+	static constexpr int	cUniqueShapeInterval = 100;
+
+	// Create the scene
+	void					Init()
+	{
+		mScene = new PhysicsScene();
+
+		default_random_engine random;
+		uniform_real_distribution<float> hull_point(-0.5f, 0.5f);
+
+		RefConst<Shape> shared_shapes[] = { new BoxShape(Vec3(0.5f, 0.25f, 1.0f)), new SphereShape(0.5f), new CapsuleShape(0.5f, 0.25f) };
+		for (int i = 0; i < cNumBodies; ++i)
+		{
+			RefConst<Shape> shape;
+			if (i % cUniqueShapeInterval == 0)
+			{
+				Array<Vec3> points;
+				for (int p = 0; p < 16; ++p)
+					points.push_back(Vec3(hull_point(random), hull_point(random), hull_point(random)));
+				shape = ConvexHullShapeSettings(points).Create().Get();
+			}
+			else
+				shape = shared_shapes[i % size(shared_shapes)];
+
+			RVec3 position(Real(i % 316), Real(i / 100000), Real((i / 316) % 316));
+			mScene->AddBody(BodyCreationSettings(shape, position, Quat::sIdentity(), EMotionType::Dynamic, Layers::MOVING));
+		}
+	}
+
+	// Load the scene inIterations times and report the average load time for both formats
+	void					Run(uint inIterations)
+	{
+		// Save in the binary format
+		stringstream binary_stream;
+		StreamOutWrapper binary_out(binary_stream);
+		mScene->SaveBinaryState(binary_out, true, true);
+		string binary_data = binary_stream.str();
+
+		// Save in the cooked format
+		stringstream cooked_stream;
+		StreamOutWrapper cooked_out(cooked_stream);
+		mScene->SaveCooked(cooked_out);
+		string cooked_data = cooked_stream.str();
+
+		Trace("Bodies: %d, Unique shapes: %d", cNumBodies, cNumBodies / cUniqueShapeInterval + 3);
+		Trace("Format, Size (MB), Load time (ms), Load MB / Second");
+
+		// Restore from the binary format, reading from a stream as is done when loading a file
+		Run(inIterations, "Binary", binary_data.size(), [&binary_data]() {
+			stringstream data(binary_data);
+			StreamInWrapper stream_in(data);
+			return PhysicsScene::sRestoreFromBinaryState(stream_in);
+		});
+
+		// Restore from the cooked format in memory, as is done when the file is memory mapped
+		Run(inIterations, "Cooked", cooked_data.size(), [&cooked_data]() {
+			return PhysicsScene::sRestoreFromCooked(cooked_data.data(), cooked_data.size());
+		});
+	}
+
+private:
+	// Call inRestore inIterations times and report the timing
+	template <class Restore>
+	void					Run(uint inIterations, const char *inName, size_t inDataSize, Restore inRestore)
+	{
+		chrono::nanoseconds duration(0);
+		for (uint i = 0; i < inIterations; ++i)
+		{
+			chrono::high_resolution_clock::time_point start = chrono::high_resolution_clock::now();
+			PhysicsScene::PhysicsSceneResult result = inRestore();
+			chrono::high_resolution_clock::time_point end = chrono::high_resolution_clock::now();
+			duration += chrono::duration_cast<chrono::nanoseconds>(end - start);
+
+			if (result.HasError() || result.Get()->GetNumBodies() != cNumBodies)
+			{
+				Trace("%s: Failed to restore scene", inName);
+				return;
+			}
+		}
+
+		double seconds = 1.0e-9 * duration.count() / inIterations;
+		double megabytes = 1.0e-6 * double(inDataSize);
+		Trace("%s, %f, %f, %f", inName, megabytes, 1.0e3 * seconds, megabytes / seconds);
+	}
+
+	Ref<PhysicsScene>		mScene;
+};
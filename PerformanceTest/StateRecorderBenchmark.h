@@ -0,0 +1,112 @@
+// Jolt Physics Library (https://github.com/jrouwe/JoltPhysics)
+// SPDX-FileCopyrightText: 2024 Jorrit Rouwe
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+// Jolt includes
+#include <Jolt/Physics/Collision/Shape/BoxShape.h>
+#include <Jolt/Physics/StateRecorderImpl.h>
+#include <Jolt/Physics/StateRecorderBuffer.h>
+
+// Local includes
+#include "Layers.h"
+
+// Measures how fast the state of a physics system with many bodies can be saved and restored, as is done every frame for rollback networking
+class StateRecorderBenchmark
+{
+public:
+	// Number of bodies to save / restore
+	static constexpr int	cNumBodiesX = 100;
+	static constexpr int	cNumBodiesZ = 100;
+
+	// Set up a physics system with cNumBodiesX * cNumBodiesZ boxes resting on a floor
+	void					Init(PhysicsSystem &inPhysicsSystem, TempAllocator &inTempAllocator, JobSystem &inJobSystem)
+	{
+		BodyInterface &bi = inPhysicsSystem.GetBodyInterface();
+
+		// Floor
+		bi.CreateAndAddBody(BodyCreationSettings(new BoxShape(Vec3(200.0f, 1.0f, 200.0f), 0.0f), RVec3(0, -1, 0), Quat::sIdentity(), EMotionType::Static, Layers::NON_MOVING), EActivation::DontActivate);
+
+		// Grid of boxes, not allowed to sleep so that they have contacts and all state is saved
+		RefConst<Shape> box_shape = new BoxShape(Vec3::sReplicate(0.5f));
+		for (int x = 0; x < cNumBodiesX; ++x)
+			for (int z = 0; z < cNumBodiesZ; ++z)
+			{
+				BodyCreationSettings settings(box_shape, RVec3(Real(2 * x - cNumBodiesX), 0.5_r, Real(2 * z - cNumBodiesZ)), Quat::sIdentity(), EMotionType::Dynamic, Layers::MOVING);
+				settings.mAllowSleeping = false;
+				bi.CreateAndAddBody(settings, EActivation::Activate);
+			}
+
+		// Step a couple of times to create contacts
+		inPhysicsSystem.OptimizeBroadPhase();
+		for (int i = 0; i < 10; ++i)
+			inPhysicsSystem.Update(1.0f / 60.0f, 1, &inTempAllocator, &inJobSystem);
+	}
+
+	// Save and restore inIterations times by calling inSave and inRestore
+	template <class Save, class Restore>
+	void					Run(uint inIterations, const char *inName, Save inSave, Restore inRestore, size_t inDataSize)
+	{
+		chrono::nanoseconds save_duration(0), restore_duration(0);
+		for (uint i = 0; i < inIterations; ++i)
+		{
+			// Save
+			chrono::high_resolution_clock::time_point save_start = chrono::high_resolution_clock::now();
+			inSave();
+			chrono::high_resolution_clock::time_point save_end = chrono::high_resolution_clock::now();
+			save_duration += chrono::duration_cast<chrono::nanoseconds>(save_end - save_start);
+
+			// Restore
+			inRestore();
+			chrono::high_resolution_clock::time_point restore_end = chrono::high_resolution_clock::now();
+			restore_duration += chrono::duration_cast<chrono::nanoseconds>(restore_end - save_end);
+		}
+
+		double save_seconds = 1.0e-9 * save_duration.count();
+		double restore_seconds = 1.0e-9 * restore_duration.count();
+		double megabytes = 1.0e-6 * double(inDataSize) * inIterations;
+		Trace("%s, %f, %f, %f, %f", inName, inIterations / save_seconds, megabytes / save_seconds, inIterations / restore_seconds, megabytes / restore_seconds);
+	}
+
+	// Save and restore inIterations times using inRecorder, inClear is called before saving
+	template <class Recorder, class Clear>
+	void					Run(PhysicsSystem &inPhysicsSystem, uint inIterations, const char *inName, Recorder &inRecorder, Clear inClear, size_t inDataSize)
+	{
+		Run(inIterations, inName,
+			[&inPhysicsSystem, &inRecorder, &inClear]() { inClear(); inPhysicsSystem.SaveState(inRecorder); },
+			[&inPhysicsSystem, &inRecorder]() { inRecorder.Rewind(); inPhysicsSystem.RestoreState(inRecorder); },
+			inDataSize);
+	}
+
+	// Run the benchmark for all recorder types
+	void					Run(PhysicsSystem &inPhysicsSystem, JobSystem &inJobSystem, uint inIterations)
+	{
+		// Determine the size of the state
+		StateRecorderImpl sizer;
+		inPhysicsSystem.SaveState(sizer);
+		size_t data_size = sizer.GetDataSize();
+		Trace("State size: %u bytes", uint(data_size));
+
+		Trace("Recorder, Saves / Second, Save MB / Second, Restores / Second, Restore MB / Second");
+
+		// Stringstream based recorder
+		StateRecorderImpl impl;
+		Run(inPhysicsSystem, inIterations, "StateRecorderImpl", impl, [&impl]() { impl.Clear(); }, data_size);
+
+		// Buffer that grows as needed, it reaches its final size in the first iteration
+		StateRecorderBuffer growing_buffer;
+		Run(inPhysicsSystem, inIterations, "StateRecorderBuffer", growing_buffer, [&growing_buffer]() { growing_buffer.Clear(); }, data_size);
+
+		// Buffer in memory provided by the caller
+		Array<uint8> memory(data_size);
+		StateRecorderBuffer caller_buffer(memory.data(), memory.size());
+		Run(inPhysicsSystem, inIterations, "StateRecorderBuffer (caller memory)", caller_buffer, [&caller_buffer]() { caller_buffer.Clear(); }, data_size);
+
+		// Save and restore bodies and contacts using multiple jobs
+		Run(inIterations, "StateRecorderBuffer (parallel)",
+			[&inPhysicsSystem, &inJobSystem, &growing_buffer]() { growing_buffer.Clear(); inPhysicsSystem.SaveState(growing_buffer, inJobSystem); },
+			[&inPhysicsSystem, &inJobSystem, &growing_buffer]() { growing_buffer.Rewind(); inPhysicsSystem.RestoreState(growing_buffer, inJobSystem); },
+			data_size);
+	}
+};
@@ -87,6 +87,16 @@ public:
 		mObjectToBroadPhase[Layers::HQ_DEBRIS] = BroadPhaseLayers::MOVING; // HQ_DEBRIS is also in the MOVING layer as an example on how to map multiple layers onto the same broadphase layer
 		mObjectToBroadPhase[Layers::LQ_DEBRIS] = BroadPhaseLayers::LQ_DEBRIS;
 		mObjectToBroadPhase[Layers::SENSOR] = BroadPhaseLayers::SENSOR;
+
+		// By default all layers use a quad tree
+		for (EBroadPhaseLayerType &type : mBroadPhaseLayerTypes)
+			type = EBroadPhaseLayerType::QuadTree;
+	}
+
+	/// Change the acceleration structure of a broadphase layer, must be called before the broadphase is initialized
+	void							SetBroadPhaseLayerType(BroadPhaseLayer inLayer, EBroadPhaseLayerType inType)
+	{
+		mBroadPhaseLayerTypes[(BroadPhaseLayer::Type)inLayer] = inType;
 	}
 
 	virtual uint					GetNumBroadPhaseLayers() const override
@@ -100,6 +110,11 @@ public:
 		return mObjectToBroadPhase[inLayer];
 	}
 
+	virtual EBroadPhaseLayerType	GetBroadPhaseLayerType(BroadPhaseLayer inLayer) const override
+	{
+		return mBroadPhaseLayerTypes[(BroadPhaseLayer::Type)inLayer];
+	}
+
 #if defined(JPH_EXTERNAL_PROFILE) || defined(JPH_PROFILE_ENABLED)
 	virtual const char *			GetBroadPhaseLayerName(BroadPhaseLayer inLayer) const override
 	{
@@ -118,6 +133,7 @@ public:
 
 private:
 	BroadPhaseLayer					mObjectToBroadPhase[Layers::NUM_LAYERS];
+	EBroadPhaseLayerType			mBroadPhaseLayerTypes[BroadPhaseLayers::NUM_LAYERS];
 };
 
 /// Class that determines if an object layer can collide with a broadphase layer
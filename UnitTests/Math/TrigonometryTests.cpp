@@ -24,4 +24,19 @@ TEST_SUITE("TrigonometryTests")
 		CHECK(ACosApproximate(-1.0e-12f) == JPH_PI / 2);
 		CHECK(ACosApproximate(-1.0f) == JPH_PI);
 	}
+
+	TEST_CASE("TestACosApproximateVec4")
+	{
+		// The vectorized version should give the same results as the scalar version
+		for (int i = -1000; i <= 1000; i += 4)
+		{
+			Vec4 x = Vec4(float(i), float(i + 1), float(i + 2), float(i + 3)) / 1000.0f;
+			Vec4 acos = ACosApproximate(x);
+			for (int j = 0; j < 4; ++j)
+				CHECK(acos[j] == ACosApproximate(x[j]));
+		}
+
+		// Check edge cases for exact matches
+		CHECK(ACosApproximate(Vec4(1.0f, 1.0e-12f, -1.0e-12f, -1.0f)) == Vec4(0.0f, JPH_PI / 2, JPH_PI / 2, JPH_PI));
+	}
 }
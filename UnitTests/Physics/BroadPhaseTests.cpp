@@ -4,12 +4,17 @@
 
 #include "UnitTestFramework.h"
 #include <Jolt/Physics/Collision/BroadPhase/BroadPhaseQuadTree.h>
+#include <Jolt/Physics/Collision/BroadPhase/BroadPhaseSAP.h>
 #include <Jolt/Physics/Collision/Shape/BoxShape.h>
 #include <Jolt/Physics/Collision/CollisionCollectorImpl.h>
 #include <Jolt/Physics/Collision/RayCast.h>
+#include <Jolt/Physics/Collision/AABoxCast.h>
 #include <Jolt/Physics/Collision/CastResult.h>
 #include <Jolt/Physics/Body/BodyManager.h>
 #include <Jolt/Physics/Body/BodyCreationSettings.h>
+#include <Jolt/Geometry/RayAABox.h>
+#include <Jolt/Core/QuickSort.h>
+#include "PhysicsTestContext.h"
 #include "Layers.h"
 
 TEST_SUITE("BroadPhaseTests")
@@ -112,4 +117,696 @@ TEST_SUITE("BroadPhaseTests")
 		CHECK_APPROX_EQUAL(collector.mHits[0].mFraction, 0.5f);
 		collector.Reset();
 	}
+
+	TEST_CASE("TestBroadPhaseIncrementalOptimization")
+	{
+		BPLayerInterfaceImpl broad_phase_layer_interface;
+
+		// Create body manager
+		constexpr int cNumBatches = 4;
+		constexpr int cBodiesPerBatch = 32;
+		constexpr int cNumBodies = cNumBatches * cBodiesPerBatch;
+		BodyManager body_manager;
+		body_manager.Init(cNumBodies, 0, broad_phase_layer_interface);
+
+		// Create quad tree
+		BroadPhaseQuadTree broadphase;
+		broadphase.Init(&body_manager, broad_phase_layer_interface);
+		broadphase.SetIncrementalOptimizationBudget(16);
+
+		// Add batches of boxes that are interleaved so that the batches all overlap each other
+		RefConst<Shape> box = new BoxShape(Vec3::sReplicate(0.5f));
+		BodyID ids[cNumBodies];
+		for (int batch = 0; batch < cNumBatches; ++batch)
+		{
+			BodyID *batch_ids = ids + batch * cBodiesPerBatch;
+			for (int i = 0; i < cBodiesPerBatch; ++i)
+			{
+				BodyCreationSettings settings(box, RVec3(Real(4 * (i * cNumBatches + batch)), 0, 0), Quat::sIdentity(), EMotionType::Static, Layers::NON_MOVING);
+				Body &body = *body_manager.AllocateBody(settings);
+				body_manager.AddBody(&body);
+				batch_ids[i] = body.GetID();
+			}
+			BroadPhase::AddState add_state = broadphase.AddBodiesPrepare(batch_ids, cBodiesPerBatch);
+			broadphase.AddBodiesFinalize(batch_ids, cBodiesPerBatch, add_state);
+		}
+
+		// Run a number of updates, each will rebuild a part of the tree
+		for (int update = 0; update < 20; ++update)
+		{
+			broadphase.FrameSync();
+			broadphase.LockModifications();
+			BroadPhase::UpdateState update_state = broadphase.UpdatePrepare();
+			broadphase.UpdateFinalize(update_state);
+			broadphase.UnlockModifications();
+
+			// Check that all bodies can still be found and that we don't find anything in between
+			for (int i = 0; i < cNumBodies; ++i)
+			{
+				AllHitCollisionCollector<RayCastBodyCollector> collector;
+				broadphase.CastRay({ Vec3(float(4 * i), 2, 0), Vec3(0, -4, 0) }, collector, BroadPhaseLayerFilter(), ObjectLayerFilter());
+				CHECK(collector.mHits.size() == 1);
+				collector.Reset();
+				broadphase.CastRay({ Vec3(float(4 * i + 2), 2, 0), Vec3(0, -4, 0) }, collector, BroadPhaseLayerFilter(), ObjectLayerFilter());
+				CHECK(collector.mHits.empty());
+			}
+		}
+	}
+
+	TEST_CASE("TestQuadTreeIncrementalOptimizationReducesCost")
+	{
+		BPLayerInterfaceImpl broad_phase_layer_interface;
+
+		// Create body manager
+		constexpr int cNumBatches = 4;
+		constexpr int cBodiesPerBatch = 32;
+		constexpr int cNumBodies = cNumBatches * cBodiesPerBatch;
+		BodyManager body_manager;
+		body_manager.Init(cNumBodies, 0, broad_phase_layer_interface);
+
+		// Create quad tree
+		QuadTree::Allocator allocator;
+		allocator.Init(1024, 256);
+		QuadTree tree;
+		tree.Init(allocator);
+		QuadTree::TrackingVector tracking(cNumBodies);
+
+		// Add batches of boxes that are interleaved so that the batches all overlap each other
+		RefConst<Shape> box = new BoxShape(Vec3::sReplicate(0.5f));
+		BodyID ids[cNumBodies];
+		for (int batch = 0; batch < cNumBatches; ++batch)
+		{
+			BodyID *batch_ids = ids + batch * cBodiesPerBatch;
+			for (int i = 0; i < cBodiesPerBatch; ++i)
+			{
+				BodyCreationSettings settings(box, RVec3(Real(4 * (i * cNumBatches + batch)), 0, 0), Quat::sIdentity(), EMotionType::Static, Layers::NON_MOVING);
+				Body &body = *body_manager.AllocateBody(settings);
+				body_manager.AddBody(&body);
+				batch_ids[i] = body.GetID();
+				tracking[body.GetID().GetIndex()].mObjectLayer = Layers::NON_MOVING;
+			}
+			QuadTree::AddState add_state;
+			tree.AddBodiesPrepare(body_manager.GetBodies(), tracking, batch_ids, cBodiesPerBatch, add_state);
+			tree.AddBodiesFinalize(tracking, cBodiesPerBatch, add_state);
+		}
+
+		// A normal update doesn't split up the batches
+		auto update = [&tree, &body_manager, &tracking]()
+		{
+			tree.DiscardOldTree();
+			QuadTree::UpdateState update_state;
+			tree.UpdatePrepare(body_manager.GetBodies(), tracking, update_state, false);
+			tree.UpdateFinalize(body_manager.GetBodies(), tracking, update_state);
+		};
+		update();
+		float initial_cost = tree.GetSurfaceAreaHeuristicCost();
+
+		// Incrementally optimize the tree until there's nothing left to improve
+		int num_updates = 0;
+		for (; num_updates < 20; ++num_updates)
+		{
+			tree.DiscardOldTree();
+			if (!tree.MarkWorstSubtreesChanged(16))
+				break;
+			update();
+		}
+		CHECK(num_updates > 0);
+		CHECK(num_updates < 20);
+
+		// The batches should have been merged, so queries have to visit fewer nodes
+		float optimized_cost = tree.GetSurfaceAreaHeuristicCost();
+		CHECK(optimized_cost < 0.75f * initial_cost);
+
+		// A freshly built tree has nothing to optimize
+		tree.DiscardOldTree();
+		QuadTree::UpdateState update_state;
+		tree.UpdatePrepare(body_manager.GetBodies(), tracking, update_state, true);
+		tree.UpdateFinalize(body_manager.GetBodies(), tracking, update_state);
+		tree.DiscardOldTree();
+		CHECK(!tree.MarkWorstSubtreesChanged(16));
+	}
+
+	TEST_CASE("TestQuadTreeIncrementalOptimizationPicksWorstSubtree")
+	{
+		BPLayerInterfaceImpl broad_phase_layer_interface;
+
+		// Two regions with interleaved batches, the batches of the large boxes degrade the tree much more than the batches of the small boxes.
+		// There are more small batches than the number of candidates that are considered in a single update.
+		constexpr int cBodiesPerBatch = 8;
+		constexpr int cNumSmallBatches = 12;
+		constexpr int cNumLargeBatches = 4;
+		constexpr int cNumBodies = (cNumSmallBatches + cNumLargeBatches) * cBodiesPerBatch;
+		RefConst<Shape> small_box = new BoxShape(Vec3::sReplicate(0.5f));
+		RefConst<Shape> large_box = new BoxShape(Vec3::sReplicate(5.0f));
+
+		// Place the large boxes on both sides so that the result doesn't depend on the order in which the tree is walked
+		for (float large_offset : { -1000.0f, 1000.0f })
+		{
+			// Create body manager
+			BodyManager body_manager;
+			body_manager.Init(cNumBodies, 0, broad_phase_layer_interface);
+
+			// Create quad tree
+			QuadTree::Allocator allocator;
+			allocator.Init(1024, 256);
+			QuadTree tree;
+			tree.Init(allocator);
+			QuadTree::TrackingVector tracking(cNumBodies);
+
+			// Add the batches of both regions
+			Array<BodyID> large_ids;
+			for (int large = 0; large < 2; ++large)
+			{
+				int num_batches = large? cNumLargeBatches : cNumSmallBatches;
+				float spacing = large? 20.0f : 2.0f;
+				float offset = large? large_offset : 0.0f;
+				for (int batch = 0; batch < num_batches; ++batch)
+				{
+					BodyID batch_ids[cBodiesPerBatch];
+					for (int i = 0; i < cBodiesPerBatch; ++i)
+					{
+						BodyCreationSettings settings(large? large_box : small_box, RVec3(Real(offset + spacing * (i * num_batches + batch)), 0, 0), Quat::sIdentity(), EMotionType::Static, Layers::NON_MOVING);
+						Body &body = *body_manager.AllocateBody(settings);
+						body_manager.AddBody(&body);
+						batch_ids[i] = body.GetID();
+						tracking[body.GetID().GetIndex()].mObjectLayer = Layers::NON_MOVING;
+						if (large)
+							large_ids.push_back(body.GetID());
+					}
+					QuadTree::AddState add_state;
+					tree.AddBodiesPrepare(body_manager.GetBodies(), tracking, batch_ids, cBodiesPerBatch, add_state);
+					tree.AddBodiesFinalize(tracking, cBodiesPerBatch, add_state);
+				}
+			}
+
+			// A normal update doesn't split up the batches
+			auto update = [&tree, &body_manager, &tracking]()
+			{
+				tree.DiscardOldTree();
+				QuadTree::UpdateState update_state;
+				tree.UpdatePrepare(body_manager.GetBodies(), tracking, update_state, false);
+				tree.UpdateFinalize(body_manager.GetBodies(), tracking, update_state);
+			};
+			update();
+
+			// Remember where the large boxes are stored in the tree
+			Array<uint32> large_locations;
+			for (BodyID id : large_ids)
+				large_locations.push_back(tracking[id.GetIndex()].mBodyLocation);
+
+			// A single update with a budget that is only enough to rebuild the large batches should rebuild all of them
+			tree.DiscardOldTree();
+			CHECK(tree.MarkWorstSubtreesChanged(cNumLargeBatches * 5)); // A batch of 8 bodies is stored in 5 nodes
+			update();
+			for (size_t i = 0; i < large_ids.size(); ++i)
+				CHECK(tracking[large_ids[i].GetIndex()].mBodyLocation != large_locations[i]);
+		}
+	}
+
+	// Simulate a pile of boxes for 2 seconds and return the final positions of the boxes, inPreStep is called before every step
+	static Array<RVec3> sSimulateBoxPile(PhysicsTestContext &ioContext, const function<void()> &inPreStep = []() { })
+	{
+		ioContext.CreateFloor();
+
+		Array<BodyID> body_ids;
+		for (int y = 0; y < 4; ++y)
+			for (int x = 0; x < 4; ++x)
+				for (int z = 0; z < 4; ++z)
+					body_ids.push_back(ioContext.CreateBox(RVec3(1.1_r * x + 0.1_r * y, 0.6_r + 1.1_r * y, 1.1_r * z), Quat::sRotation(Vec3::sAxisY(), 0.1f * y), EMotionType::Dynamic, EMotionQuality::Discrete, Layers::MOVING, Vec3::sReplicate(0.5f)).GetID());
+
+		ioContext.Simulate(2.0f, inPreStep);
+
+		Array<RVec3> positions;
+		for (const BodyID &id : body_ids)
+			positions.push_back(ioContext.GetBodyInterface().GetPosition(id));
+		return positions;
+	}
+
+	TEST_CASE("TestBroadPhasePairCache")
+	{
+		// Simulate a pile of boxes with and without the pair cache
+		Array<RVec3> positions[2];
+		for (int use_cache = 0; use_cache < 2; ++use_cache)
+		{
+			PhysicsTestContext c;
+
+			// Use a small margin so that both cached and refreshed pairs are tested
+			PhysicsSettings settings = c.GetSystem()->GetPhysicsSettings();
+			settings.mUseBroadPhasePairCache = use_cache != 0;
+			settings.mBroadPhasePairCacheMargin = 0.02f;
+			settings.mBroadPhasePairCacheVelocityScale = 0.02f;
+			c.GetSystem()->SetPhysicsSettings(settings);
+
+			positions[use_cache] = sSimulateBoxPile(c);
+		}
+
+		// The pair cache should find exactly the same pairs, so the simulation should be identical
+		CHECK(positions[0] == positions[1]);
+	}
+
+	TEST_CASE("TestBroadPhasePairCacheHitsAndInvalidation")
+	{
+		// Object layer pair filter that counts how often it is called, when the pair cache is used it is only called when the candidates of a body are collected
+		class CountingObjectLayerPairFilter : public ObjectLayerPairFilterImpl
+		{
+		public:
+			virtual bool		ShouldCollide(ObjectLayer inObject1, ObjectLayer inObject2) const override
+			{
+				++mNumCalls;
+				return ObjectLayerPairFilterImpl::ShouldCollide(inObject1, inObject2);
+			}
+
+			mutable int			mNumCalls = 0;
+		};
+
+		BPLayerInterfaceImpl broad_phase_layer_interface;
+		ObjectVsBroadPhaseLayerFilterImpl object_vs_broadphase_layer_filter;
+		CountingObjectLayerPairFilter object_vs_object_layer_filter;
+
+		// Create body manager
+		BodyManager body_manager;
+		body_manager.Init(3, 0, broad_phase_layer_interface);
+
+		// Create broadphase with the pair cache enabled
+		BroadPhaseQuadTree broadphase;
+		broadphase.Init(&body_manager, broad_phase_layer_interface);
+		broadphase.SetPairCache(true, 0.5f, 0.0f);
+
+		// Create a static floor and a dynamic box resting on it
+		BodyCreationSettings floor_settings(new BoxShape(Vec3(10, 1, 10)), RVec3::sZero(), Quat::sIdentity(), EMotionType::Static, Layers::NON_MOVING);
+		Body &floor = *body_manager.AllocateBody(floor_settings);
+		body_manager.AddBody(&floor);
+		BodyCreationSettings box_settings(new BoxShape(Vec3::sReplicate(0.5f)), RVec3(0, 1.5_r, 0), Quat::sIdentity(), EMotionType::Dynamic, Layers::MOVING);
+		Body &box = *body_manager.AllocateBody(box_settings);
+		body_manager.AddBody(&box);
+		BodyID ids[] = { floor.GetID(), box.GetID() };
+		BroadPhase::AddState add_state = broadphase.AddBodiesPrepare(ids, 2);
+		broadphase.AddBodiesFinalize(ids, 2, add_state);
+
+		// Find the pairs of the box and return if the candidates were collected again
+		BodyID active_body = box.GetID();
+		body_manager.ActivateBodies(&active_body, 1);
+		AllHitCollisionCollector<BodyPairCollector> pair_collector;
+		auto find_pairs = [&]()
+		{
+			pair_collector.Reset();
+			int num_calls = object_vs_object_layer_filter.mNumCalls;
+			broadphase.FindCollidingPairs(&active_body, 1, 0.0f, object_vs_broadphase_layer_filter, object_vs_object_layer_filter, pair_collector);
+			return object_vs_object_layer_filter.mNumCalls != num_calls;
+		};
+
+		// The first time the candidates are collected, after that they are reused
+		CHECK(find_pairs());
+		CHECK(pair_collector.mHits.size() == 1);
+		CHECK(!find_pairs());
+		CHECK(pair_collector.mHits.size() == 1);
+
+		// Moving the box less than the margin keeps the candidates
+		box.SetPositionAndRotationInternal(RVec3(0.1_r, 1.5_r, 0), Quat::sIdentity());
+		broadphase.NotifyBodiesAABBChanged(&active_body, 1, true);
+		CHECK(!find_pairs());
+		CHECK(pair_collector.mHits.size() == 1);
+
+		// Adding a body invalidates the cache, so the new body is found
+		BodyCreationSettings block_settings(new BoxShape(Vec3::sReplicate(0.5f)), RVec3(1, 1.5_r, 0), Quat::sIdentity(), EMotionType::Static, Layers::NON_MOVING);
+		Body &block = *body_manager.AllocateBody(block_settings);
+		body_manager.AddBody(&block);
+		BodyID block_id = block.GetID();
+		add_state = broadphase.AddBodiesPrepare(&block_id, 1);
+		broadphase.AddBodiesFinalize(&block_id, 1, add_state);
+		CHECK(find_pairs());
+		CHECK(pair_collector.mHits.size() == 2);
+		CHECK(!find_pairs());
+
+		// Moving the box out of its enlarged bounds collects the candidates again
+		box.SetPositionAndRotationInternal(RVec3(0, 5, 0), Quat::sIdentity());
+		broadphase.NotifyBodiesAABBChanged(&active_body, 1, true);
+		CHECK(find_pairs());
+		CHECK(pair_collector.mHits.empty());
+	}
+
+	TEST_CASE("TestBroadPhaseSAPQueries")
+	{
+		PhysicsTestContext c(1.0f / 60.0f, 1, 0, 1024, 4096, 1024, EBroadPhaseType::SweepAndPrune);
+		BodyInterface &bi = c.GetBodyInterface();
+		const BroadPhaseQuery &query = c.GetSystem()->GetBroadPhaseQuery();
+
+		// Create a row of boxes along the X axis
+		constexpr int cNumBodies = 64;
+		BodyID ids[cNumBodies];
+		for (int i = 0; i < cNumBodies; ++i)
+			ids[i] = c.CreateBox(RVec3(Real(2 * i), 0, 0), Quat::sIdentity(), EMotionType::Kinematic, EMotionQuality::Discrete, Layers::MOVING, Vec3::sReplicate(0.5f), EActivation::DontActivate).GetID();
+		c.GetSystem()->OptimizeBroadPhase();
+
+		// Move a body far away without updating the broadphase
+		bi.SetPosition(ids[10], RVec3(1000, 0, 0), EActivation::DontActivate);
+
+		for (int update = 0; update < 2; ++update)
+		{
+			// Check that the body is found at its new location and not at the old
+			AllHitCollisionCollector<CollideShapeBodyCollector> collector;
+			query.CollideAABox(AABox(Vec3(999, -1, -1), Vec3(1001, 1, 1)), collector);
+			CHECK(collector.mHits.size() == 1);
+			CHECK(collector.mHits[0] == ids[10]);
+			collector.Reset();
+			query.CollidePoint(Vec3(20, 0, 0), collector);
+			CHECK(collector.mHits.empty());
+			collector.Reset();
+			query.CollideSphere(Vec3(22, 0, 0), 0.1f, collector);
+			CHECK(collector.mHits.size() == 1);
+			CHECK(collector.mHits[0] == ids[11]);
+
+			// A ray along the row should hit all bodies
+			AllHitCollisionCollector<RayCastBodyCollector> ray_collector;
+			query.CastRay({ Vec3(-10, 0, 0), Vec3(2000, 0, 0) }, ray_collector);
+			CHECK(ray_collector.mHits.size() == cNumBodies);
+
+			// Casting a box down should only hit the moved body
+			AllHitCollisionCollector<CastShapeBodyCollector> cast_collector;
+			query.CastAABox({ AABox(Vec3(999.5f, 10, -0.5f), Vec3(1000.5f, 11, 0.5f)), Vec3(0, -20, 0) }, cast_collector);
+			CHECK(cast_collector.mHits.size() == 1);
+
+			// Sort the lists again, the results should be the same
+			c.GetSystem()->OptimizeBroadPhase();
+		}
+
+		// Remove the body, it should no longer be found
+		bi.RemoveBody(ids[10]);
+		AllHitCollisionCollector<CollideShapeBodyCollector> collector;
+		query.CollideAABox(AABox(Vec3(999, -1, -1), Vec3(1001, 1, 1)), collector);
+		CHECK(collector.mHits.empty());
+	}
+
+	TEST_CASE("TestBroadPhaseSAPSimulation")
+	{
+		// Simulate a pile of boxes with the quad tree and with sweep and prune
+		Array<RVec3> positions[2];
+		EBroadPhaseType types[] = { EBroadPhaseType::QuadTree, EBroadPhaseType::SweepAndPrune };
+		for (int t = 0; t < 2; ++t)
+		{
+			PhysicsTestContext c(1.0f / 60.0f, 1, 0, 1024, 4096, 1024, types[t]);
+
+			// The sorted lists are only partially resorted every step, check that they remain sorted
+			int num_unsorted_steps = 0;
+			auto check_sorted = [&c, &num_unsorted_steps]()
+			{
+				if (!static_cast<const BroadPhaseSAP &>(c.GetSystem()->GetBroadPhaseQuery()).IsSorted())
+					++num_unsorted_steps;
+			};
+			positions[t] = types[t] == EBroadPhaseType::SweepAndPrune? sSimulateBoxPile(c, check_sorted) : sSimulateBoxPile(c);
+			CHECK(num_unsorted_steps == 0);
+		}
+
+		// Both broadphases should find the same pairs, so the simulation should be identical
+		CHECK(positions[0] == positions[1]);
+	}
+
+	TEST_CASE("TestBroadPhaseMixedLayerTypes")
+	{
+		for (EBroadPhaseLayerType type : { EBroadPhaseLayerType::SweepAndPrune, EBroadPhaseLayerType::HashGrid })
+		{
+			// Store the moving layer in a different structure and the non moving layer in a quad tree
+			BPLayerInterfaceImpl broad_phase_layer_interface;
+			broad_phase_layer_interface.SetBroadPhaseLayerType(BroadPhaseLayers::MOVING, type);
+			ObjectVsBroadPhaseLayerFilterImpl object_vs_broadphase_layer_filter;
+			ObjectLayerPairFilterImpl object_vs_object_layer_filter;
+
+			// Create body manager
+			BodyManager body_manager;
+			body_manager.Init(2, 0, broad_phase_layer_interface);
+
+			// Create broadphase
+			BroadPhaseQuadTree broadphase;
+			broadphase.Init(&body_manager, broad_phase_layer_interface);
+
+			// Create a static floor and a dynamic box resting on it
+			BodyCreationSettings floor_settings(new BoxShape(Vec3(10, 1, 10)), RVec3::sZero(), Quat::sIdentity(), EMotionType::Static, Layers::NON_MOVING);
+			Body &floor = *body_manager.AllocateBody(floor_settings);
+			body_manager.AddBody(&floor);
+			BodyCreationSettings box_settings(new BoxShape(Vec3::sReplicate(0.5f)), RVec3(0, 1.5_r, 0), Quat::sIdentity(), EMotionType::Dynamic, Layers::MOVING);
+			Body &box = *body_manager.AllocateBody(box_settings);
+			body_manager.AddBody(&box);
+
+			// Add them to the broadphase
+			BodyID ids[] = { floor.GetID(), box.GetID() };
+			BroadPhase::AddState add_state = broadphase.AddBodiesPrepare(ids, 2);
+			broadphase.AddBodiesFinalize(ids, 2, add_state);
+
+			// Queries should find the bodies in both layers
+			AllHitCollisionCollector<RayCastBodyCollector> ray_collector;
+			broadphase.CastRay({ Vec3(0, 5, 0), Vec3(0, -10, 0) }, ray_collector, BroadPhaseLayerFilter(), ObjectLayerFilter());
+			CHECK(ray_collector.mHits.size() == 2);
+			AllHitCollisionCollector<CollideShapeBodyCollector> collector;
+			broadphase.CollideAABox(AABox(Vec3(-0.1f, 1.4f, -0.1f), Vec3(0.1f, 1.6f, 0.1f)), collector, BroadPhaseLayerFilter(), ObjectLayerFilter());
+			CHECK(collector.mHits.size() == 1);
+			CHECK(collector.mHits[0] == box.GetID());
+			CHECK(broadphase.GetBounds().mMax.GetY() == 2.0f);
+
+			// The box should collide with the floor
+			BodyID active_body = box.GetID();
+			body_manager.ActivateBodies(&active_body, 1);
+			AllHitCollisionCollector<BodyPairCollector> pair_collector;
+			broadphase.FindCollidingPairs(&active_body, 1, 0.0f, object_vs_broadphase_layer_filter, object_vs_object_layer_filter, pair_collector);
+			CHECK(pair_collector.mHits.size() == 1);
+
+			// Move the box above the floor without updating the sorted list
+			box.SetPositionAndRotationInternal(RVec3(0, 5, 0), Quat::sIdentity());
+			broadphase.NotifyBodiesAABBChanged(&active_body, 1, true);
+
+			for (int update = 0; update < 2; ++update)
+			{
+				// The box should be found at its new location and no longer collide with the floor
+				collector.Reset();
+				broadphase.CollideAABox(AABox(Vec3(-0.1f, 4.9f, -0.1f), Vec3(0.1f, 5.1f, 0.1f)), collector, BroadPhaseLayerFilter(), ObjectLayerFilter());
+				CHECK(collector.mHits.size() == 1);
+				pair_collector.Reset();
+				broadphase.FindCollidingPairs(&active_body, 1, 0.0f, object_vs_broadphase_layer_filter, object_vs_object_layer_filter, pair_collector);
+				CHECK(pair_collector.mHits.empty());
+
+				// Update the broadphase, the results should be the same
+				broadphase.Optimize();
+			}
+
+			// Remove the box, only the floor should remain
+			broadphase.RemoveBodies(&active_body, 1);
+			ray_collector.Reset();
+			broadphase.CastRay({ Vec3(0, 10, 0), Vec3(0, -20, 0) }, ray_collector, BroadPhaseLayerFilter(), ObjectLayerFilter());
+			CHECK(ray_collector.mHits.size() == 1);
+			CHECK(ray_collector.mHits[0].mBodyID == floor.GetID());
+		}
+	}
+
+	TEST_CASE("TestBroadPhaseLayerTypesRandomQueries")
+	{
+		for (EBroadPhaseLayerType type : { EBroadPhaseLayerType::SweepAndPrune, EBroadPhaseLayerType::HashGrid })
+		{
+			BPLayerInterfaceImpl broad_phase_layer_interface;
+			broad_phase_layer_interface.SetBroadPhaseLayerType(BroadPhaseLayers::MOVING, type);
+
+			// Create body manager
+			constexpr int cNumBodies = 500;
+			BodyManager body_manager;
+			body_manager.Init(cNumBodies, 0, broad_phase_layer_interface);
+
+			// Create broadphase
+			BroadPhaseQuadTree broadphase;
+			broadphase.Init(&body_manager, broad_phase_layer_interface);
+
+			// Create bodies of random size at random locations
+			UnitTestRandom random;
+			uniform_real_distribution<float> size_distribution(0.1f, 0.5f);
+			uniform_real_distribution<float> position_distribution(-25.0f, 25.0f);
+			Array<BodyID> ids;
+			for (int i = 0; i < cNumBodies; ++i)
+			{
+				BodyCreationSettings settings(new BoxShape(Vec3(size_distribution(random), size_distribution(random), size_distribution(random))), RVec3(position_distribution(random), position_distribution(random), position_distribution(random)), Quat::sIdentity(), EMotionType::Dynamic, Layers::MOVING);
+				Body &body = *body_manager.AllocateBody(settings);
+				body_manager.AddBody(&body);
+				ids.push_back(body.GetID());
+			}
+			BroadPhase::AddState add_state = broadphase.AddBodiesPrepare(ids.data(), cNumBodies);
+			broadphase.AddBodiesFinalize(ids.data(), cNumBodies, add_state);
+
+			// Get all bodies that are in the broadphase sorted by ID
+			auto sort_and_check = [](Array<BodyID> &ioActual, Array<BodyID> &ioExpected)
+			{
+				QuickSort(ioActual.begin(), ioActual.end());
+				QuickSort(ioExpected.begin(), ioExpected.end());
+				CHECK(ioActual == ioExpected);
+			};
+
+			for (int iteration = 0; iteration < 20; ++iteration)
+			{
+				// Move some bodies, some of them far
+				Array<BodyID> moved;
+				for (int i = 0; i < cNumBodies / 4; ++i)
+				{
+					Body &body = *body_manager.GetBodies()[ids[random() % cNumBodies].GetIndex()];
+					Vec3 offset(position_distribution(random), position_distribution(random), position_distribution(random));
+					if (i % 5 != 0)
+						offset *= 0.02f;
+					body.SetPositionAndRotationInternal(body.GetPosition() + offset, Quat::sIdentity());
+					moved.push_back(body.GetID());
+				}
+				broadphase.NotifyBodiesAABBChanged(moved.data(), int(moved.size()), true);
+
+				// Update the broadphase every other iteration so that queries are tested with and without pending moves
+				if (iteration & 1)
+					broadphase.Optimize();
+
+				for (int query = 0; query < 10; ++query)
+				{
+					Vec3 center(position_distribution(random), position_distribution(random), position_distribution(random));
+
+					// Test box query
+					AABox box(center, 2.0f * size_distribution(random) * query);
+					AllHitCollisionCollector<CollideShapeBodyCollector> collector;
+					broadphase.CollideAABox(box, collector, BroadPhaseLayerFilter(), ObjectLayerFilter());
+					Array<BodyID> expected;
+					for (const BodyID &id : ids)
+						if (body_manager.GetBodies()[id.GetIndex()]->GetWorldSpaceBounds().Overlaps(box))
+							expected.push_back(id);
+					sort_and_check(collector.mHits, expected);
+
+					// Test sphere query
+					float radius = 2.0f * size_distribution(random) * query;
+					collector.Reset();
+					broadphase.CollideSphere(center, radius, collector, BroadPhaseLayerFilter(), ObjectLayerFilter());
+					expected.clear();
+					for (const BodyID &id : ids)
+						if (body_manager.GetBodies()[id.GetIndex()]->GetWorldSpaceBounds().GetSqDistanceTo(center) <= Square(radius))
+							expected.push_back(id);
+					sort_and_check(collector.mHits, expected);
+
+					// Test ray cast
+					Vec3 direction(position_distribution(random), position_distribution(random), position_distribution(random));
+					AllHitCollisionCollector<RayCastBodyCollector> ray_collector;
+					broadphase.CastRay({ center, direction }, ray_collector, BroadPhaseLayerFilter(), ObjectLayerFilter());
+					Array<BodyID> actual;
+					for (const BroadPhaseCastResult &hit : ray_collector.mHits)
+						actual.push_back(hit.mBodyID);
+					expected.clear();
+					RayInvDirection inv_direction(direction);
+					for (const BodyID &id : ids)
+					{
+						const AABox &bounds = body_manager.GetBodies()[id.GetIndex()]->GetWorldSpaceBounds();
+						if (RayAABox(center, inv_direction, bounds.mMin, bounds.mMax) <= 1.0f)
+							expected.push_back(id);
+					}
+					sort_and_check(actual, expected);
+				}
+
+				// Remove and add some bodies
+				if (iteration % 5 == 4)
+				{
+					Array<BodyID> removed(ids.begin(), ids.begin() + 50);
+					broadphase.RemoveBodies(removed.data(), int(removed.size()));
+					add_state = broadphase.AddBodiesPrepare(removed.data(), int(removed.size()));
+					broadphase.AddBodiesFinalize(removed.data(), int(removed.size()), add_state);
+				}
+			}
+		}
+	}
+
+	TEST_CASE("TestBroadPhaseSAPIncrementalUpdate")
+	{
+		BPLayerInterfaceImpl broad_phase_layer_interface;
+
+		// Create body manager
+		constexpr int cNumBodies = 300;
+		BodyManager body_manager;
+		body_manager.Init(cNumBodies, 0, broad_phase_layer_interface);
+
+		// Create broadphase
+		BroadPhaseSAP broadphase;
+		broadphase.Init(&body_manager, broad_phase_layer_interface);
+
+		// Create bodies that are spread out along the X axis
+		UnitTestRandom random;
+		uniform_real_distribution<float> size_distribution(0.1f, 0.5f);
+		uniform_real_distribution<float> long_distribution(-100.0f, 100.0f);
+		uniform_real_distribution<float> short_distribution(-5.0f, 5.0f);
+		Array<BodyID> ids;
+		for (int i = 0; i < cNumBodies; ++i)
+		{
+			BodyCreationSettings settings(new BoxShape(Vec3::sReplicate(size_distribution(random))), RVec3(long_distribution(random), short_distribution(random), short_distribution(random)), Quat::sIdentity(), EMotionType::Dynamic, Layers::MOVING);
+			Body &body = *body_manager.AllocateBody(settings);
+			body_manager.AddBody(&body);
+			ids.push_back(body.GetID());
+		}
+		broadphase.AddBodiesFinalize(ids.data(), cNumBodies, nullptr);
+		broadphase.Optimize();
+
+		Array<BodyID> in_broadphase = ids;
+		for (int iteration = 0; iteration < 20; ++iteration)
+		{
+			Array<BodyID> moved;
+			if (iteration == 5)
+			{
+				// Move all bodies a little and notify them twice so that the queue of moved bodies overflows and the list is fully resorted
+				for (const BodyID &id : in_broadphase)
+				{
+					Body &body = *body_manager.GetBodies()[id.GetIndex()];
+					body.SetPositionAndRotationInternal(body.GetPosition() + 0.1f * Vec3(short_distribution(random), short_distribution(random), short_distribution(random)), Quat::sIdentity());
+					moved.push_back(id);
+					moved.push_back(id);
+				}
+			}
+			else if (iteration == 10)
+			{
+				// Spread all bodies out along the Z axis so that the list is resorted on another axis
+				for (const BodyID &id : in_broadphase)
+				{
+					Body &body = *body_manager.GetBodies()[id.GetIndex()];
+					body.SetPositionAndRotationInternal(RVec3(short_distribution(random), short_distribution(random), long_distribution(random)), Quat::sIdentity());
+					moved.push_back(id);
+				}
+			}
+			else
+			{
+				// Move some bodies, some of them far and some of them more than once
+				for (int i = 0; i < cNumBodies / 10; ++i)
+				{
+					Body &body = *body_manager.GetBodies()[in_broadphase[random() % in_broadphase.size()].GetIndex()];
+					Vec3 offset(long_distribution(random), short_distribution(random), short_distribution(random));
+					if (i % 5 != 0)
+						offset *= 0.02f;
+					body.SetPositionAndRotationInternal(body.GetPosition() + offset, Quat::sIdentity());
+					moved.push_back(body.GetID());
+				}
+			}
+			broadphase.NotifyBodiesAABBChanged(moved.data(), int(moved.size()), true);
+
+			// Remove a body that is queued and add one back so that the queue needs to be updated
+			if (iteration & 1)
+			{
+				BodyID removed = in_broadphase.back();
+				in_broadphase.pop_back();
+				broadphase.RemoveBodies(&removed, 1);
+			}
+			else if (in_broadphase.size() < ids.size())
+			{
+				BodyID added = ids[in_broadphase.size()];
+				in_broadphase.push_back(added);
+				broadphase.AddBodiesFinalize(&added, 1, nullptr);
+			}
+
+			// Resort the lists and check that queries return the same as a brute force test
+			broadphase.Optimize();
+			for (int query = 0; query < 10; ++query)
+			{
+				AABox box(Vec3(short_distribution(random), short_distribution(random), long_distribution(random)), float(query));
+				box.Encapsulate(Vec3(long_distribution(random), 0, 0));
+				AllHitCollisionCollector<CollideShapeBodyCollector> collector;
+				broadphase.CollideAABox(box, collector, BroadPhaseLayerFilter(), ObjectLayerFilter());
+				Array<BodyID> expected;
+				for (const BodyID &id : in_broadphase)
+					if (body_manager.GetBodies()[id.GetIndex()]->GetWorldSpaceBounds().Overlaps(box))
+						expected.push_back(id);
+				QuickSort(collector.mHits.begin(), collector.mHits.end());
+				QuickSort(expected.begin(), expected.end());
+				CHECK(collector.mHits == expected);
+			}
+		}
+	}
 }
@@ -10,6 +10,11 @@
 #include <Jolt/Physics/Collision/Shape/MeshShape.h>
 #include <Jolt/Physics/Collision/Shape/BoxShape.h>
 #include <Jolt/Physics/Character/CharacterVirtual.h>
+#include <Jolt/Physics/Character/CharacterVirtualBatchUpdater.h>
+#include <Jolt/Physics/Character/CharacterVsCharacterCollisionGrid.h>
+#include <Jolt/Physics/Collision/CollideShape.h>
+#include <Jolt/Core/TempAllocator.h>
+#include <Jolt/Core/QuickSort.h>
 #include "Layers.h"
 
 TEST_SUITE("CharacterVirtualTests")
@@ -849,4 +854,247 @@ TEST_SUITE("CharacterVirtualTests")
 		CHECK(character1.HasCollidedWith(floor_id));
 		CHECK(character1.HasCollidedWith(box_id));
 	}
+
+	TEST_CASE("TestBatchUpdate")
+	{
+		constexpr int cNumCharacters = 48;
+		constexpr float cSpeed = 2.0f;
+
+		// Final positions of the characters when updated by the batch updater single threaded, multi threaded and when updated one by one
+		Array<RVec3> positions[3];
+		for (int run = 0; run < 3; ++run)
+		{
+			PhysicsTestContext c(1.0f / 60.0f, 1, run == 1? 4 : 0);
+			c.CreateFloor();
+
+			// Create an obstacle in the center and a dynamic box that the characters can push around
+			c.CreateBox(RVec3(0, 0.5f, 0), Quat::sIdentity(), EMotionType::Static, EMotionQuality::Discrete, Layers::NON_MOVING, Vec3::sReplicate(0.5f), EActivation::DontActivate);
+			c.CreateBox(RVec3(2.0f, 0.5f, 0), Quat::sIdentity(), EMotionType::Dynamic, EMotionQuality::Discrete, Layers::MOVING, Vec3::sReplicate(0.5f));
+
+			// Create characters in clusters on a ring that all walk towards the center
+			CharacterVirtualSettings settings;
+			settings.mShape = RotatedTranslatedShapeSettings(Vec3(0, 0.9f, 0), Quat::sIdentity(), new CapsuleShape(0.6f, 0.3f)).Create().Get();
+			CharacterVsCharacterCollisionSimple character_vs_character;
+			Array<Ref<CharacterVirtual>> characters;
+			Array<CharacterVirtual *> character_ptrs;
+			for (int i = 0; i < cNumCharacters; ++i)
+			{
+				float angle = 2.0f * JPH_PI * (i / 4) / (cNumCharacters / 4);
+				RVec3 position = RVec3(6.0f * Cos(angle), 0, 6.0f * Sin(angle)) + RVec3(0.7f * (i % 2), 0, 0.7f * ((i / 2) % 2));
+				CharacterVirtual *character = new CharacterVirtual(&settings, position, Quat::sIdentity(), 0, c.GetSystem());
+				character->SetCharacterVsCharacterCollision(&character_vs_character);
+				character_vs_character.Add(character);
+				characters.push_back(character);
+				character_ptrs.push_back(character);
+			}
+
+			CharacterVirtualBatchUpdater updater;
+			TempAllocatorImpl allocator(1024 * 1024);
+			CharacterVirtual::ExtendedUpdateSettings update_settings;
+			Vec3 gravity = c.GetSystem()->GetGravity();
+			DefaultBroadPhaseLayerFilter broad_phase_layer_filter = c.GetSystem()->GetDefaultBroadPhaseLayerFilter(Layers::MOVING);
+			DefaultObjectLayerFilter object_layer_filter = c.GetSystem()->GetDefaultLayerFilter(Layers::MOVING);
+			for (int step = 0; step < 120; ++step)
+			{
+				c.SimulateSingleStep();
+
+				// Walk towards the center
+				for (CharacterVirtual *character : character_ptrs)
+				{
+					Vec3 horizontal_velocity = -cSpeed * Vec3(character->GetPosition()).Normalized();
+					horizontal_velocity.SetY(0);
+					Vec3 vertical_velocity = character->IsSupported()? Vec3::sZero() : Vec3(0, character->GetLinearVelocity().GetY(), 0) + gravity * c.GetDeltaTime();
+					character->SetLinearVelocity(horizontal_velocity + vertical_velocity);
+				}
+
+				if (run < 2)
+				{
+					updater.ExtendedUpdate(character_ptrs.data(), cNumCharacters, c.GetDeltaTime(), gravity, update_settings, broad_phase_layer_filter, object_layer_filter, { }, { }, c.GetJobSystem());
+
+					// Characters that are close to each other should have been grouped
+					const CharacterVirtualBatchUpdater::Stats &stats = updater.GetStats();
+					CHECK(stats.mNumIslands <= cNumCharacters / 4);
+					CHECK(stats.mMaxIslandSize >= 4);
+					CHECK(stats.mNumSharedIslands == stats.mNumIslands);
+					CHECK(stats.mNumUnsharedQueries == 0);
+				}
+				else
+				{
+					for (CharacterVirtual *character : character_ptrs)
+						character->ExtendedUpdate(c.GetDeltaTime(), gravity, update_settings, broad_phase_layer_filter, object_layer_filter, { }, { }, allocator);
+				}
+			}
+
+			for (const CharacterVirtual *character : character_ptrs)
+				positions[run].push_back(character->GetPosition());
+		}
+
+		// The batch update should not depend on the number of threads
+		for (int i = 0; i < cNumCharacters; ++i)
+			CHECK(positions[0][i] == positions[1][i]);
+
+		// And it should match updating the characters one by one
+		for (int i = 0; i < cNumCharacters; ++i)
+			CHECK_APPROX_EQUAL(positions[0][i], positions[2][i], 1.0e-3f);
+
+		// All characters should have been stopped by the obstacle or each other
+		for (int i = 0; i < cNumCharacters; ++i)
+			CHECK(Vec3(positions[0][i]).Length() > 0.5f);
+	}
+
+	TEST_CASE("TestCharacterVsCharacterGrid")
+	{
+		PhysicsTestContext c;
+
+		// Collector that records which characters were hit
+		class MyCollector : public CollideShapeCollector
+		{
+		public:
+			virtual void		SetUserData(uint64 inUserData) override		{ mCurrentCharacter = reinterpret_cast<const CharacterVirtual *>(inUserData); }
+			virtual void		AddHit(const CollideShapeResult &) override	{ mHits.push_back(mCurrentCharacter); }
+
+			const CharacterVirtual *mCurrentCharacter = nullptr;
+			Array<const CharacterVirtual *> mHits;
+		};
+
+		CharacterVirtualSettings settings;
+		settings.mShape = RotatedTranslatedShapeSettings(Vec3(0, 0.9f, 0), Quat::sIdentity(), new CapsuleShape(0.6f, 0.3f)).Create().Get();
+
+		// Create characters at random positions, use a small cell size so that characters are spread out over many cells
+		UnitTestRandom random;
+		uniform_real_distribution<float> position(-10.0f, 10.0f);
+		CharacterVsCharacterCollisionSimple simple;
+		CharacterVsCharacterCollisionGrid grid(1.0f);
+		Array<Ref<CharacterVirtual>> characters;
+		for (int i = 0; i < 200; ++i)
+		{
+			CharacterVirtual *character = new CharacterVirtual(&settings, RVec3(position(random), 0.1f * position(random), position(random)), Quat::sIdentity(), c.GetSystem());
+			character->SetCharacterVsCharacterCollision(&grid);
+			simple.Add(character);
+			grid.Add(character);
+			characters.push_back(character);
+		}
+
+		// Remove some characters
+		for (int i = 0; i < 200; i += 7)
+		{
+			simple.Remove(characters[i]);
+			grid.Remove(characters[i]);
+		}
+		CHECK(grid.GetNumCharacters() == uint(simple.mCharacters.size()));
+
+		auto check_same_hits = [&simple, &grid, &characters]()
+		{
+			for (const CharacterVirtual *character : characters)
+			{
+				CollideShapeSettings collide_settings;
+				collide_settings.mMaxSeparationDistance = 0.1f;
+				MyCollector simple_collector, grid_collector;
+				simple.CollideCharacter(character, character->GetCenterOfMassTransform(), collide_settings, character->GetPosition(), simple_collector);
+				grid.CollideCharacter(character, character->GetCenterOfMassTransform(), collide_settings, character->GetPosition(), grid_collector);
+
+				QuickSort(simple_collector.mHits.begin(), simple_collector.mHits.end());
+				QuickSort(grid_collector.mHits.begin(), grid_collector.mHits.end());
+				CHECK(simple_collector.mHits == grid_collector.mHits);
+			}
+		};
+		check_same_hits();
+
+		// Teleport all characters, the grid is notified through the collision interface
+		for (CharacterVirtual *character : characters)
+			character->SetPosition(character->GetPosition() + Vec3(0.5f * position(random), 0, 0.5f * position(random)));
+		check_same_hits();
+
+		// Let two characters walk into each other across many cells
+		Character character1(c), character2(c);
+		character1.mInitialPosition = RVec3(100, 0, 0);
+		character2.mInitialPosition = RVec3(106, 0, 0);
+		character1.Create();
+		character2.Create();
+		c.CreateBox(RVec3(103, -0.5f, 0), Quat::sIdentity(), EMotionType::Static, EMotionQuality::Discrete, Layers::NON_MOVING, Vec3(10, 0.5f, 10), EActivation::DontActivate);
+		for (Character *ch : { &character1, &character2 })
+		{
+			ch->mCharacter->SetCharacterVsCharacterCollision(&grid);
+			grid.Add(ch->mCharacter);
+		}
+		character1.mHorizontalSpeed = Vec3(4, 0, 0);
+		for (int i = 0; i < 120; ++i)
+		{
+			character1.Step();
+			character2.Step();
+		}
+
+		// Character 1 should have been stopped by character 2
+		bool found_contact = false;
+		for (const CharacterVirtual::Contact &contact : character1.mCharacter->GetActiveContacts())
+			found_contact |= contact.mCharacterB == character2.mCharacter;
+		CHECK(found_contact);
+		CHECK(character1.GetPosition().GetX() < character2.GetPosition().GetX() - 2.0f * character1.mRadiusStanding);
+	}
+
+	TEST_CASE("TestContactCache")
+	{
+		// Create the same scene twice, one character uses the contact cache and the other doesn't
+		PhysicsTestContext c1, c2;
+		Character character1(c1), character2(c2);
+		BodyID floor_id;
+		for (PhysicsTestContext *c : { &c1, &c2 })
+		{
+			floor_id = c->CreateFloor().GetID();
+			c->CreateBox(RVec3(0, 1, 1.5f), Quat::sIdentity(), EMotionType::Static, EMotionQuality::Discrete, Layers::NON_MOVING, Vec3(5, 1, 0.5f), EActivation::DontActivate);
+		}
+		character1.mCharacterSettings.mUseContactCache = true;
+		character1.Create();
+		character2.Create();
+
+		// Let the characters settle
+		for (int i = 0; i < 60; ++i)
+		{
+			character1.Step();
+			character2.Step();
+		}
+
+		// An idle character should be able to reuse its contacts
+		character1.mCharacter->ResetContactCacheStats();
+		for (int i = 0; i < 60; ++i)
+		{
+			character1.Step();
+			character2.Step();
+		}
+		CHECK(character1.mCharacter->GetNumContactCacheQueries() > 0);
+		CHECK(character1.mCharacter->GetNumContactCacheHits() >= character1.mCharacter->GetNumContactCacheQueries() - 1);
+		CHECK(character1.mCharacter->GetGroundState() == CharacterBase::EGroundState::OnGround);
+		CHECK_APPROX_EQUAL(character1.GetPosition(), character2.GetPosition(), 1.0e-4f);
+
+		// Walk slowly, the cached contacts should give the same result as colliding every update
+		character1.mCharacter->ResetContactCacheStats();
+		character1.mHorizontalSpeed = character2.mHorizontalSpeed = Vec3(0.5f, 0, 0);
+		for (int i = 0; i < 60; ++i)
+		{
+			character1.Step();
+			character2.Step();
+			CHECK_APPROX_EQUAL(character1.GetPosition(), character2.GetPosition(), 1.0e-3f);
+		}
+		CHECK(character1.mCharacter->GetNumContactCacheHits() > character1.mCharacter->GetNumContactCacheQueries() / 2);
+		CHECK(character1.mCharacter->GetGroundState() == CharacterBase::EGroundState::OnGround);
+
+		// Walk into the wall and slide along it
+		character1.mHorizontalSpeed = character2.mHorizontalSpeed = Vec3(0.3f, 0, 0.5f);
+		for (int i = 0; i < 180; ++i)
+		{
+			character1.Step();
+			character2.Step();
+			CHECK_APPROX_EQUAL(character1.GetPosition(), character2.GetPosition(), 1.0e-3f);
+		}
+		CHECK(character1.GetPosition().GetZ() < 1.0f - character1.mRadiusStanding + 0.01f);
+		CHECK(character1.GetPosition().GetX() > 1.0f);
+
+		// Move the floor away without activating it, the cache should detect that the floor moved and the character should fall
+		character1.mHorizontalSpeed = Vec3::sZero();
+		c1.GetBodyInterface().SetPosition(floor_id, RVec3(0, -10, 0), EActivation::DontActivate);
+		for (int i = 0; i < 10; ++i)
+			character1.Step();
+		CHECK(character1.mCharacter->GetGroundState() != CharacterBase::EGroundState::OnGround);
+		CHECK(character1.GetPosition().GetY() < -0.01f);
+	}
 }
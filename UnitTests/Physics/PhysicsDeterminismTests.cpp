@@ -192,4 +192,55 @@ TEST_SUITE("PhysicsDeterminismTests")
 
 		CompareSimulations(c1, c2, 5.0f);
 	}
+
+	TEST_CASE("TestStateHash")
+	{
+		// Enable the state hash, including contact impulses
+		PhysicsSettings settings;
+		settings.mCalculateStateHash = true;
+		settings.mStateHashIncludesContactImpulses = true;
+
+		PhysicsTestContext c1(1.0f / 60.0f, 1, 0);
+		c1.GetSystem()->SetPhysicsSettings(settings);
+		CreateGridOfBoxesDiscrete(c1);
+
+		PhysicsTestContext c2(1.0f / 60.0f, 1, 15);
+		c2.GetSystem()->SetPhysicsSettings(settings);
+		CreateGridOfBoxesDiscrete(c2);
+
+		// The hash should not depend on the number of threads
+		uint64 prev_hash = 0;
+		for (int i = 0; i < 60; ++i)
+		{
+			c1.SimulateSingleStep();
+			c2.SimulateSingleStep();
+			uint64 hash = c1.GetSystem()->GetStateHash();
+			CHECK(hash != 0);
+			CHECK(hash != prev_hash);
+			CHECK(hash == c2.GetSystem()->GetStateHash());
+			prev_hash = hash;
+		}
+
+		// A tiny change in velocity should change the hash
+		BodyIDVector bodies;
+		c2.GetSystem()->GetBodies(bodies);
+		BodyInterface &bi = c2.GetBodyInterface();
+		bi.SetLinearVelocity(bodies.back(), bi.GetLinearVelocity(bodies.back()) + Vec3(1.0e-5f, 0, 0));
+		c1.SimulateSingleStep();
+		c2.SimulateSingleStep();
+		CHECK(c1.GetSystem()->GetStateHash() != c2.GetSystem()->GetStateHash());
+
+		// Without contact impulses the hash should be different
+		settings.mStateHashIncludesContactImpulses = false;
+		c1.GetSystem()->SetPhysicsSettings(settings);
+		c1.SimulateSingleStep();
+		uint64 hash_without_impulses = c1.GetSystem()->GetStateHash();
+		CHECK(hash_without_impulses != 0);
+
+		// Disabling the hash should result in 0
+		settings.mCalculateStateHash = false;
+		c1.GetSystem()->SetPhysicsSettings(settings);
+		c1.SimulateSingleStep();
+		CHECK(c1.GetSystem()->GetStateHash() == 0);
+	}
 }
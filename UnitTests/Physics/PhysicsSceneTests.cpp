@@ -0,0 +1,106 @@
+// Jolt Physics Library (https://github.com/jrouwe/JoltPhysics)
+// SPDX-FileCopyrightText: 2024 Jorrit Rouwe
+// SPDX-License-Identifier: MIT
+
+#include "UnitTestFramework.h"
+#include "Layers.h"
+#include <Jolt/Physics/PhysicsScene.h>
+#include <Jolt/Physics/Collision/Shape/BoxShape.h>
+#include <Jolt/Physics/Collision/Shape/SphereShape.h>
+#include <Jolt/Physics/Collision/Shape/StaticCompoundShape.h>
+#include <Jolt/Physics/Collision/GroupFilterTable.h>
+#include <Jolt/Physics/Constraints/DistanceConstraint.h>
+#include <Jolt/Core/StreamWrapper.h>
+
+TEST_SUITE("PhysicsSceneTests")
+{
+	// Create a scene with shared shapes, a compound shape that shares a child, a group filter and a constraint
+	static Ref<PhysicsScene> sCreateScene()
+	{
+		Ref<PhysicsScene> scene = new PhysicsScene();
+
+		RefConst<Shape> box = new BoxShape(Vec3(1, 2, 3));
+		RefConst<Shape> sphere = new SphereShape(0.5f);
+		StaticCompoundShapeSettings compound_settings;
+		compound_settings.AddShape(Vec3(1, 0, 0), Quat::sIdentity(), sphere);
+		compound_settings.AddShape(Vec3(-1, 0, 0), Quat::sIdentity(), sphere);
+		RefConst<Shape> compound = compound_settings.Create().Get();
+		Ref<GroupFilterTable> group_filter = new GroupFilterTable(10);
+
+		scene->AddBody(BodyCreationSettings(new BoxShape(Vec3(100, 1, 100)), RVec3(0, -1, 0), Quat::sIdentity(), EMotionType::Static, Layers::NON_MOVING));
+		for (int i = 0; i < 30; ++i)
+		{
+			BodyCreationSettings settings(i % 3 == 0? box : (i % 3 == 1? sphere : compound), RVec3(Real(i), 2, Real(-i)), Quat::sRotation(Vec3::sAxisY(), 0.1f * i), EMotionType::Dynamic, Layers::MOVING);
+			settings.mLinearVelocity = Vec3(0, 0.5f * i, 0);
+			settings.mAngularVelocity = Vec3(0.1f * i, 0, 0);
+			settings.mFriction = 0.01f * i;
+			settings.mIsSensor = i == 5;
+			settings.mAllowSleeping = (i & 1) == 0;
+			settings.mMotionQuality = i == 7? EMotionQuality::LinearCast : EMotionQuality::Discrete;
+			settings.mNumVelocityStepsOverride = i;
+			if (i == 9)
+			{
+				settings.mOverrideMassProperties = EOverrideMassProperties::MassAndInertiaProvided;
+				settings.mMassPropertiesOverride.mMass = 10.0f;
+				settings.mMassPropertiesOverride.mInertia = Mat44::sScale(Vec3(1, 2, 3));
+			}
+			if (i < 10)
+				settings.mCollisionGroup = CollisionGroup(group_filter, 1, CollisionGroup::SubGroupID(i));
+			scene->AddBody(settings);
+		}
+
+		Ref<DistanceConstraintSettings> constraint = new DistanceConstraintSettings();
+		constraint->mPoint1 = RVec3(1, 2, -1);
+		constraint->mPoint2 = RVec3(2, 2, -2);
+		scene->AddConstraint(constraint, 2, 3);
+
+		return scene;
+	}
+
+	// Save a scene with SaveBinaryState
+	static string sSaveBinary(const PhysicsScene &inScene)
+	{
+		stringstream data;
+		StreamOutWrapper stream(data);
+		inScene.SaveBinaryState(stream, true, true);
+		return data.str();
+	}
+
+	TEST_CASE("TestPhysicsSceneCooked")
+	{
+		Ref<PhysicsScene> scene = sCreateScene();
+
+		// Save cooked
+		stringstream data;
+		StreamOutWrapper stream_out(data);
+		scene->SaveCooked(stream_out);
+		string cooked = data.str();
+
+		// Restore and check that we get the same scene back
+		PhysicsScene::PhysicsSceneResult result = PhysicsScene::sRestoreFromCooked(cooked.data(), cooked.size());
+		CHECK(result.IsValid());
+		Ref<PhysicsScene> restored = result.Get();
+		CHECK(restored->GetNumBodies() == scene->GetNumBodies());
+		CHECK(restored->GetNumConstraints() == scene->GetNumConstraints());
+		CHECK(sSaveBinary(*restored) == sSaveBinary(*scene));
+
+		// Shapes and group filters should still be shared
+		const Array<BodyCreationSettings> &bodies = restored->GetBodies();
+		CHECK(bodies[1].GetShape() == bodies[4].GetShape());
+		CHECK(bodies[1].GetShape() != bodies[2].GetShape());
+		CHECK(bodies[1].mCollisionGroup.GetGroupFilter() == bodies[2].mCollisionGroup.GetGroupFilter());
+		CHECK(bodies[20].mCollisionGroup.GetGroupFilter() == nullptr);
+		const StaticCompoundShape *compound = static_cast<const StaticCompoundShape *>(bodies[3].GetShape());
+		CHECK(compound->GetSubShape(0).mShape == bodies[2].GetShape());
+
+		// Truncated data should fail
+		result = PhysicsScene::sRestoreFromCooked(cooked.data(), cooked.size() / 2);
+		CHECK(result.HasError());
+
+		// Data with a different version should fail
+		string wrong_version = cooked;
+		wrong_version[4]++;
+		result = PhysicsScene::sRestoreFromCooked(wrong_version.data(), wrong_version.size());
+		CHECK(result.HasError());
+	}
+}
@@ -0,0 +1,355 @@
+// Jolt Physics Library (https://github.com/jrouwe/JoltPhysics)
+// SPDX-FileCopyrightText: 2024 Jorrit Rouwe
+// SPDX-License-Identifier: MIT
+
+#include "UnitTestFramework.h"
+#include "PhysicsTestContext.h"
+#include "Layers.h"
+#include <Jolt/Physics/Ragdoll/RagdollBatchDriver.h>
+#include <Jolt/Physics/Constraints/SwingTwistConstraint.h>
+#include <Jolt/Physics/Constraints/PointConstraint.h>
+#include <Jolt/Physics/Collision/Shape/BoxShape.h>
+#include <Jolt/Core/QuickSort.h>
+#include <Jolt/Core/StreamWrapper.h>
+
+TEST_SUITE("RagdollTests")
+{
+	// Number of ragdolls to create, more than fit in a single batch
+	static constexpr uint cNumRagdolls = 3 * RagdollBatchDriver::cRagdollsPerBatch + 5;
+
+	// Create a simple ragdoll that consists of 3 boxes on top of each other
+	static Ref<RagdollSettings> sCreateRagdollSettings()
+	{
+		Ref<RagdollSettings> settings = new RagdollSettings;
+		settings->mSkeleton = new Skeleton;
+		settings->mSkeleton->AddJoint("Pelvis");
+		settings->mSkeleton->AddJoint("Chest", 0);
+		settings->mSkeleton->AddJoint("Head", 1);
+
+		RefConst<Shape> box = new BoxShape(Vec3(0.2f, 0.2f, 0.2f));
+		settings->mParts.resize(3);
+		for (int i = 0; i < 3; ++i)
+		{
+			RagdollSettings::Part &part = settings->mParts[i];
+			part.SetShape(box);
+			part.mPosition = RVec3(0, 1.0f + 0.5f * i, 0);
+			part.mMotionType = EMotionType::Dynamic;
+			part.mObjectLayer = Layers::MOVING;
+			if (i > 0)
+			{
+				SwingTwistConstraintSettings *constraint = new SwingTwistConstraintSettings;
+				constraint->mPosition1 = constraint->mPosition2 = RVec3(0, 0.75f + 0.5f * i, 0);
+				constraint->mTwistAxis1 = constraint->mTwistAxis2 = Vec3::sAxisY();
+				constraint->mPlaneAxis1 = constraint->mPlaneAxis2 = Vec3::sAxisX();
+				constraint->mNormalHalfConeAngle = constraint->mPlaneHalfConeAngle = DegreesToRadians(45.0f);
+				constraint->mTwistMinAngle = -DegreesToRadians(45.0f);
+				constraint->mTwistMaxAngle = DegreesToRadians(45.0f);
+				part.mToParent = constraint;
+			}
+		}
+		settings->CalculateBodyIndexToConstraintIndex();
+		settings->DisableParentChildCollisions();
+		return settings;
+	}
+
+	// A world with a number of sleeping ragdolls and poses to drive them to
+	struct RagdollWorld
+	{
+		explicit RagdollWorld(const RagdollSettings *inSettings) :
+			mContext(1.0f / 60.0f, 1, 4)
+		{
+			mContext.ZeroGravity();
+
+			mRagdolls.resize(cNumRagdolls);
+			mPoses.resize(cNumRagdolls);
+			for (uint r = 0; r < cNumRagdolls; ++r)
+			{
+				// Spread out the ragdolls and leave them asleep so that driving them needs to activate them
+				Ragdoll *ragdoll = inSettings->CreateRagdoll(r, 0, mContext.GetSystem());
+				RVec3 offset(2.0f * (r % 10), 0, 2.0f * (r / 10));
+				SkeletonPose initial_pose;
+				initial_pose.SetSkeleton(inSettings->GetSkeleton());
+				initial_pose.SetRootOffset(offset);
+				for (int j = 0; j < 3; ++j)
+					initial_pose.GetJoint(j).mTranslation = j == 0? Vec3(0, 1, 0) : Vec3(0, 0.5f, 0);
+				initial_pose.CalculateJointMatrices();
+				ragdoll->SetPose(initial_pose);
+				ragdoll->AddToPhysicsSystem(EActivation::DontActivate);
+				mRagdolls[r] = ragdoll;
+
+				// Every third ragdoll keeps its pose so that its bodies don't need to be activated
+				SkeletonPose &pose = mPoses[r];
+				pose = initial_pose;
+				if (r % 3 != 0)
+				{
+					pose.GetJoint(0).mTranslation += Vec3(0.01f, 0.02f * (r % 5), 0);
+					for (int j = 1; j < 3; ++j)
+						pose.GetJoint(j).mRotation = Quat::sRotation(Vec3::sAxisX(), 0.02f * (r % 7) * j);
+					pose.CalculateJointMatrices();
+				}
+			}
+		}
+
+		~RagdollWorld()
+		{
+			for (Ragdoll *ragdoll : mRagdolls)
+				ragdoll->RemoveFromPhysicsSystem();
+		}
+
+		PhysicsTestContext		mContext;
+		Array<Ref<Ragdoll>>		mRagdolls;
+		Array<SkeletonPose>		mPoses;
+	};
+
+	// Get the active bodies of a world
+	static BodyIDVector sGetActiveBodies(const RagdollWorld &inWorld)
+	{
+		BodyIDVector active;
+		inWorld.mContext.GetSystem()->GetActiveBodies(EBodyType::RigidBody, active);
+		return active;
+	}
+
+	// Check that the bodies of two worlds are in exactly the same state
+	static void sCheckSameState(const RagdollWorld &inWorld1, const RagdollWorld &inWorld2)
+	{
+		// The order of the active bodies list depends on the order in which the simulation threads activate bodies, so compare it sorted
+		BodyIDVector active1 = sGetActiveBodies(inWorld1), active2 = sGetActiveBodies(inWorld2);
+		QuickSort(active1.begin(), active1.end());
+		QuickSort(active2.begin(), active2.end());
+		CHECK(active1 == active2);
+
+		BodyInterface &bi1 = inWorld1.mContext.GetBodyInterface();
+		BodyInterface &bi2 = inWorld2.mContext.GetBodyInterface();
+		for (uint r = 0; r < cNumRagdolls; ++r)
+			for (BodyID body_id : inWorld1.mRagdolls[r]->GetBodyIDs())
+			{
+				CHECK(bi1.GetPosition(body_id) == bi2.GetPosition(body_id));
+				CHECK(bi1.GetRotation(body_id) == bi2.GetRotation(body_id));
+				CHECK(bi1.GetLinearVelocity(body_id) == bi2.GetLinearVelocity(body_id));
+				CHECK(bi1.GetAngularVelocity(body_id) == bi2.GetAngularVelocity(body_id));
+			}
+	}
+
+	TEST_CASE("TestBatchDriveToPoseUsingKinematics")
+	{
+		Ref<RagdollSettings> settings = sCreateRagdollSettings();
+		RagdollWorld serial(settings), batched(settings);
+
+		// Drive the ragdolls one by one in the first world
+		float delta_time = serial.mContext.GetDeltaTime();
+		for (uint r = 0; r < cNumRagdolls; ++r)
+			serial.mRagdolls[r]->DriveToPoseUsingKinematics(serial.mPoses[r], delta_time);
+
+		// Drive the ragdolls in a batch in the second world
+		Array<Ragdoll *> ragdolls;
+		Array<const SkeletonPose *> poses;
+		for (uint r = 0; r < cNumRagdolls; ++r)
+		{
+			ragdolls.push_back(batched.mRagdolls[r]);
+			poses.push_back(&batched.mPoses[r]);
+		}
+		RagdollBatchDriver driver;
+		driver.DriveToPoseUsingKinematics(ragdolls.data(), poses.data(), cNumRagdolls, delta_time, batched.mContext.GetJobSystem());
+
+		// Only the ragdolls that need to move should have been activated, in the same order as when driving them one by one
+		for (uint r = 0; r < cNumRagdolls; ++r)
+			CHECK(batched.mRagdolls[r]->IsActive() == (r % 3 != 0));
+		CHECK(sGetActiveBodies(serial) == sGetActiveBodies(batched));
+
+		// Both worlds should be identical, also after simulating
+		sCheckSameState(serial, batched);
+		serial.mContext.SimulateSingleStep();
+		batched.mContext.SimulateSingleStep();
+		sCheckSameState(serial, batched);
+	}
+
+	TEST_CASE("TestBatchDriveToPoseUsingMotors")
+	{
+		Ref<RagdollSettings> settings = sCreateRagdollSettings();
+		RagdollWorld serial(settings), batched(settings);
+
+		// Drive the ragdolls one by one in the first world
+		for (uint r = 0; r < cNumRagdolls; ++r)
+		{
+			serial.mRagdolls[r]->DriveToPoseUsingMotors(serial.mPoses[r]);
+			serial.mRagdolls[r]->Activate();
+		}
+
+		// Drive the ragdolls in a batch in the second world
+		Array<Ragdoll *> ragdolls;
+		Array<const SkeletonPose *> poses;
+		for (uint r = 0; r < cNumRagdolls; ++r)
+		{
+			ragdolls.push_back(batched.mRagdolls[r]);
+			poses.push_back(&batched.mPoses[r]);
+		}
+		RagdollBatchDriver driver;
+		driver.DriveToPoseUsingMotors(ragdolls.data(), poses.data(), cNumRagdolls, batched.mContext.GetJobSystem());
+		for (Ragdoll *ragdoll : ragdolls)
+			ragdoll->Activate();
+
+		// All motors should have been turned on
+		for (Ragdoll *ragdoll : ragdolls)
+			for (uint c = 0; c < ragdoll->GetConstraintCount(); ++c)
+			{
+				const SwingTwistConstraint *constraint = static_cast<const SwingTwistConstraint *>(ragdoll->GetConstraint(c));
+				CHECK(constraint->GetSwingMotorState() == EMotorState::Position);
+				CHECK(constraint->GetTwistMotorState() == EMotorState::Position);
+			}
+
+		// Both worlds should be identical after simulating
+		serial.mContext.Simulate(0.5f);
+		batched.mContext.Simulate(0.5f);
+		sCheckSameState(serial, batched);
+	}
+
+	// Create a horizontal chain of light bodies with a heavy body at the end that hangs from a static body
+	static Ref<RagdollSettings> sCreateHangingChain(int inNumLinks)
+	{
+		Ref<RagdollSettings> settings = new RagdollSettings;
+		settings->mSkeleton = new Skeleton;
+		RefConst<Shape> box = new BoxShape(Vec3(0.2f, 0.1f, 0.1f));
+		settings->mParts.resize(inNumLinks);
+		for (int i = 0; i < inNumLinks; ++i)
+		{
+			settings->mSkeleton->AddJoint("Link" + ConvertToString(i), i - 1);
+
+			RagdollSettings::Part &part = settings->mParts[i];
+			part.SetShape(box);
+			part.mPosition = RVec3(0.5f * i, 10.0f, 0);
+			part.mMotionType = i == 0? EMotionType::Static : EMotionType::Dynamic;
+			part.mObjectLayer = i == 0? Layers::NON_MOVING : Layers::MOVING;
+			if (i == inNumLinks - 1)
+			{
+				part.mOverrideMassProperties = EOverrideMassProperties::CalculateInertia;
+				part.mMassPropertiesOverride.mMass = 100.0f;
+			}
+			if (i > 0)
+			{
+				PointConstraintSettings *constraint = new PointConstraintSettings;
+				constraint->mPoint1 = constraint->mPoint2 = RVec3(0.5f * i - 0.25f, 10.0f, 0);
+				part.mToParent = constraint;
+			}
+		}
+		settings->mUseArticulationConstraint = true;
+		settings->DisableParentChildCollisions();
+		return settings;
+	}
+
+	// Simulate a chain of light bodies with a heavy body at the end that hangs from a static body and return the largest separation of the joints
+	static float sSimulateHangingChain(bool inUseArticulation)
+	{
+		PhysicsTestContext c;
+		PhysicsSettings physics_settings;
+		physics_settings.mNumVelocitySteps = 2;
+		physics_settings.mNumPositionSteps = 1;
+		c.GetSystem()->SetPhysicsSettings(physics_settings);
+
+		// Create a horizontal chain so that it starts swinging
+		constexpr int cNumLinks = 10;
+		Ref<RagdollSettings> settings = sCreateHangingChain(cNumLinks);
+
+		Ref<Ragdoll> ragdoll = settings->CreateRagdoll(0, 0, c.GetSystem());
+		ragdoll->AddToPhysicsSystem(EActivation::Activate);
+		ArticulationConstraint *articulation = ragdoll->GetArticulationConstraint();
+		CHECK(articulation != nullptr);
+		CHECK(articulation->GetNumBodies() == cNumLinks);
+		articulation->SetEnabled(inUseArticulation);
+
+		// Let the chain swing down and measure how much the joints separate
+		float max_separation = 0.0f;
+		for (int step = 0; step < 60; ++step)
+		{
+			c.SimulateSingleStep();
+			max_separation = max(max_separation, articulation->GetMaxJointSeparation());
+		}
+
+		// The chain should have swung down
+		RVec3 end_position = c.GetBodyInterface().GetCenterOfMassPosition(ragdoll->GetBodyID(cNumLinks - 1));
+		CHECK(end_position.GetY() < 8.0f);
+
+		ragdoll->RemoveFromPhysicsSystem();
+		return max_separation;
+	}
+
+	TEST_CASE("TestArticulationConstraintReducesStretching")
+	{
+		float separation_iterative = sSimulateHangingChain(false);
+		float separation_articulated = sSimulateHangingChain(true);
+
+		// With only a few iterations the iterative solver lets the heavy end stretch the chain, the articulation keeps the joints together
+		CHECK(separation_iterative > 0.05f);
+		CHECK(separation_articulated < 0.2f * separation_iterative);
+	}
+
+	// Simulate the hanging chain after turning the last body kinematic and return the positions of all bodies
+	static Array<RVec3> sSimulateChainWithKinematicEnd(bool inUseArticulation)
+	{
+		PhysicsTestContext c;
+		PhysicsSettings physics_settings;
+		physics_settings.mNumVelocitySteps = 2;
+		physics_settings.mNumPositionSteps = 1;
+		c.GetSystem()->SetPhysicsSettings(physics_settings);
+
+		constexpr int cNumLinks = 10;
+		Ref<RagdollSettings> settings = sCreateHangingChain(cNumLinks);
+		Ref<Ragdoll> ragdoll = settings->CreateRagdoll(0, 0, c.GetSystem());
+		ragdoll->AddToPhysicsSystem(EActivation::Activate);
+		ArticulationConstraint *articulation = ragdoll->GetArticulationConstraint();
+		CHECK(articulation != nullptr);
+		articulation->SetEnabled(inUseArticulation);
+
+		// Turn the end of the chain into a kinematic body that moves down, it is now a non dynamic child of a dynamic body
+		BodyInterface &bi = c.GetBodyInterface();
+		BodyID end_id = ragdoll->GetBodyID(cNumLinks - 1);
+		bi.SetMotionType(end_id, EMotionType::Kinematic, EActivation::Activate);
+		bi.SetLinearVelocity(end_id, Vec3(0, -1.0f, 0));
+
+		for (int step = 0; step < 60; ++step)
+			c.SimulateSingleStep();
+
+		Array<RVec3> positions;
+		for (int i = 0; i < cNumLinks; ++i)
+			positions.push_back(bi.GetCenterOfMassPosition(ragdoll->GetBodyID(i)));
+
+		ragdoll->RemoveFromPhysicsSystem();
+		return positions;
+	}
+
+	TEST_CASE("TestArticulationConstraintKinematicChild")
+	{
+		Array<RVec3> positions_iterative = sSimulateChainWithKinematicEnd(false);
+		Array<RVec3> positions_articulated = sSimulateChainWithKinematicEnd(true);
+
+		// A kinematic child of a dynamic body can't be solved by the articulation, it should leave the chain to the regular constraints
+		for (size_t i = 0; i < positions_iterative.size(); ++i)
+			CHECK(positions_articulated[i] == positions_iterative[i]);
+	}
+
+	TEST_CASE("TestRagdollBinaryStateRoundTrip")
+	{
+		Ref<RagdollSettings> settings = new RagdollSettings;
+		settings->mSkeleton = new Skeleton;
+		settings->mSkeleton->AddJoint("Root");
+		settings->mParts.resize(1);
+		settings->mParts[0].SetShape(new BoxShape(Vec3::sReplicate(0.5f)));
+		settings->mUseArticulationConstraint = true;
+
+		// Save and restore, the articulation flag should survive
+		stringstream data;
+		StreamOutWrapper stream_out(data);
+		settings->SaveBinaryState(stream_out, true, true);
+		StreamInWrapper stream_in(data);
+		RagdollSettings::RagdollResult result = RagdollSettings::sRestoreFromBinaryState(stream_in);
+		CHECK(result.IsValid());
+		CHECK(result.Get()->mParts.size() == 1);
+		CHECK(result.Get()->mUseArticulationConstraint);
+
+		// Data that starts with a skeleton instead of the header should be rejected instead of being misread
+		stringstream old_data;
+		StreamOutWrapper old_stream_out(old_data);
+		settings->mSkeleton->SaveBinaryState(old_stream_out);
+		StreamInWrapper old_stream_in(old_data);
+		CHECK(RagdollSettings::sRestoreFromBinaryState(old_stream_in).HasError());
+	}
+}
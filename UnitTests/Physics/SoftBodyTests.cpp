@@ -8,6 +8,11 @@
 #include <Jolt/Physics/SoftBody/SoftBodySharedSettings.h>
 #include <Jolt/Physics/SoftBody/SoftBodyCreationSettings.h>
 #include <Jolt/Physics/SoftBody/SoftBodyMotionProperties.h>
+#include <Jolt/Physics/Collision/Shape/MeshShape.h>
+#include <Jolt/Physics/Collision/Shape/HeightFieldShape.h>
+#include <Jolt/Physics/Collision/CollideSoftBodyVerticesVsTriangles.h>
+#include <Jolt/Core/StreamWrapper.h>
+#include <Jolt/Core/TempAllocator.h>
 
 TEST_SUITE("SoftBodyTests")
 {
@@ -90,4 +95,566 @@ TEST_SUITE("SoftBodyTests")
 			}
 		}
 	}
+
+	// Create a piece of cloth that hangs from its top row
+	static Ref<SoftBodySharedSettings> sCreateCloth(uint inGridSize)
+	{
+		Ref<SoftBodySharedSettings> settings = new SoftBodySharedSettings;
+
+		// Create vertices, the top row is kinematic
+		for (uint y = 0; y < inGridSize; ++y)
+			for (uint x = 0; x < inGridSize; ++x)
+			{
+				SoftBodySharedSettings::Vertex v;
+				v.mPosition = Float3(0.1f * x, 0, 0.1f * y);
+				v.mInvMass = y == 0? 0.0f : 1.0f;
+				settings->mVertices.push_back(v);
+			}
+
+		// Create faces
+		for (uint y = 0; y < inGridSize - 1; ++y)
+			for (uint x = 0; x < inGridSize - 1; ++x)
+			{
+				uint32 v = y * inGridSize + x;
+				settings->AddFace(SoftBodySharedSettings::Face(v, v + inGridSize, v + 1));
+				settings->AddFace(SoftBodySharedSettings::Face(v + 1, v + inGridSize, v + inGridSize + 1));
+			}
+
+		// Create edge, dihedral bend and LRA constraints
+		SoftBodySharedSettings::VertexAttributes va(0.0f, 0.0f, 1.0e-4f, SoftBodySharedSettings::ELRAType::EuclideanDistance);
+		settings->CreateConstraints(&va, 1, SoftBodySharedSettings::EBendType::Dihedral);
+		settings->Optimize();
+		return settings;
+	}
+
+	TEST_CASE("TestSIMDConstraintsMatchScalar")
+	{
+		Ref<SoftBodySharedSettings> shared_settings = sCreateCloth(20);
+
+		// Simulate the cloth with and without SIMD constraints
+		Array<Vec3> positions[2];
+		for (int use_simd = 0; use_simd < 2; ++use_simd)
+		{
+			PhysicsTestContext c;
+			BodyInterface &bi = c.GetSystem()->GetBodyInterface();
+
+			SoftBodyCreationSettings sb_settings(shared_settings, RVec3::sZero(), Quat::sRotation(Vec3::sAxisX(), 0.25f * JPH_PI), Layers::MOVING);
+			sb_settings.mAllowSleeping = false;
+			Body &body = *bi.CreateSoftBody(sb_settings);
+			bi.AddBody(body.GetID(), EActivation::Activate);
+			SoftBodyMotionProperties *mp = static_cast<SoftBodyMotionProperties *>(body.GetMotionProperties());
+			mp->SetEnableSIMDConstraints(use_simd != 0);
+
+			c.Simulate(1.0f);
+
+			for (const SoftBodyVertex &v : mp->GetVertices())
+				positions[use_simd].push_back(v.mPosition);
+		}
+
+		// The results should be the same up to floating point round off
+		for (size_t i = 0; i < positions[0].size(); ++i)
+			CHECK_APPROX_EQUAL(positions[0][i], positions[1][i], 1.0e-3f);
+	}
+
+#ifdef JPH_USE_SSE
+	TEST_CASE("TestSIMDConstraintsNoDivisionByZero")
+	{
+		// Create 4 disjoint edges between kinematic vertices, these have a zero denominator
+		Ref<SoftBodySharedSettings> shared_settings = new SoftBodySharedSettings;
+		SoftBodySharedSettings::Vertex v;
+		v.mInvMass = 0;
+		for (int i = 0; i < 4; ++i)
+		{
+			v.mPosition = Float3(float(i), 0, 0);
+			shared_settings->mVertices.push_back(v);
+			v.mPosition = Float3(float(i), 0, 1);
+			shared_settings->mVertices.push_back(v);
+			shared_settings->mEdgeConstraints.push_back(SoftBodySharedSettings::Edge(2 * i, 2 * i + 1));
+		}
+
+		// Create 4 dynamic vertices that start on their LRA anchor, these constraints are not violated and have a zero length
+		v.mInvMass = 1;
+		for (int i = 0; i < 4; ++i)
+		{
+			v.mPosition = Float3(float(i), 0, 0);
+			shared_settings->mVertices.push_back(v);
+			shared_settings->mLRAConstraints.push_back(SoftBodySharedSettings::LRA(2 * i, 8 + i, 1.0f));
+		}
+		shared_settings->CalculateEdgeLengths();
+		shared_settings->Optimize();
+
+		PhysicsTestContext c;
+		BodyInterface &bi = c.GetSystem()->GetBodyInterface();
+		SoftBodyCreationSettings sb_settings(shared_settings, RVec3::sZero(), Quat::sIdentity(), Layers::MOVING);
+		sb_settings.mGravityFactor = 0.0f;
+		sb_settings.mAllowSleeping = false;
+		Body &body = *bi.CreateSoftBody(sb_settings);
+		bi.AddBody(body.GetID(), EActivation::Activate);
+		static_cast<SoftBodyMotionProperties *>(body.GetMotionProperties())->SetEnableSIMDConstraints(true);
+
+		// Simulate and check that no division by zero happened (this would trap when floating point exceptions are enabled)
+		_MM_SET_EXCEPTION_STATE(0);
+		c.SimulateSingleStep();
+		CHECK((_MM_GET_EXCEPTION_STATE() & (_MM_EXCEPT_DIV_ZERO | _MM_EXCEPT_INVALID)) == 0);
+	}
+#endif // JPH_USE_SSE
+
+	TEST_CASE("TestOptimizeFormsSIMDBatches")
+	{
+		Ref<SoftBodySharedSettings> shared_settings = sCreateCloth(20);
+
+		// Count the number of edges that are part of a batch of 4 consecutive edges that don't share any vertices
+		const Array<SoftBodySharedSettings::Edge> &edges = shared_settings->mEdgeConstraints;
+		uint num_batched = 0;
+		uint e = 0;
+		while (e + 4 <= edges.size())
+		{
+			bool shared = false;
+			for (uint i = e; i < e + 4; ++i)
+				for (uint j = i + 1; j < e + 4; ++j)
+					for (uint32 vi : edges[i].mVertex)
+						for (uint32 vj : edges[j].mVertex)
+							shared |= vi == vj;
+			if (shared)
+				++e;
+			else
+			{
+				num_batched += 4;
+				e += 4;
+			}
+		}
+
+		// Most edges should be part of a batch
+		CHECK(num_batched > edges.size() * 3 / 4);
+	}
+
+	TEST_CASE("TestSelfCollision")
+	{
+		// Create a soft body that consists of 2 horizontal patches of cloth, the bottom one is kinematic and bigger than the top one
+		const uint cGridSize = 10;
+		const float cSelfCollisionDistance = 0.05f;
+		Ref<SoftBodySharedSettings> shared_settings = new SoftBodySharedSettings;
+		for (uint patch = 0; patch < 2; ++patch)
+		{
+			uint32 start = (uint32)shared_settings->mVertices.size();
+			for (uint z = 0; z < cGridSize; ++z)
+				for (uint x = 0; x < cGridSize; ++x)
+				{
+					SoftBodySharedSettings::Vertex v;
+					v.mPosition = patch == 0? Float3(0.15f * x - 0.2f, 0, 0.15f * z - 0.2f) : Float3(0.1f * x + 0.03f, 0.2f, 0.1f * z + 0.04f);
+					v.mInvMass = patch == 0? 0.0f : 1.0f;
+					shared_settings->mVertices.push_back(v);
+				}
+			for (uint z = 0; z < cGridSize - 1; ++z)
+				for (uint x = 0; x < cGridSize - 1; ++x)
+				{
+					uint32 v = start + z * cGridSize + x;
+					shared_settings->AddFace(SoftBodySharedSettings::Face(v, v + cGridSize, v + 1));
+					shared_settings->AddFace(SoftBodySharedSettings::Face(v + 1, v + cGridSize, v + cGridSize + 1));
+				}
+		}
+		SoftBodySharedSettings::VertexAttributes va(0.0f, 0.0f, FLT_MAX);
+		shared_settings->CreateConstraints(&va, 1);
+		shared_settings->Optimize();
+
+		for (int self_collision = 0; self_collision < 2; ++self_collision)
+		{
+			shared_settings->mSelfCollisionDistance = self_collision? cSelfCollisionDistance : 0.0f;
+
+			PhysicsTestContext c;
+			BodyInterface &bi = c.GetSystem()->GetBodyInterface();
+			SoftBodyCreationSettings sb_settings(shared_settings, RVec3::sZero(), Quat::sIdentity(), Layers::MOVING);
+			sb_settings.mAllowSleeping = false;
+			sb_settings.mUpdatePosition = false;
+			Body &body = *bi.CreateSoftBody(sb_settings);
+			bi.AddBody(body.GetID(), EActivation::Activate);
+			SoftBodyMotionProperties *mp = static_cast<SoftBodyMotionProperties *>(body.GetMotionProperties());
+
+			c.Simulate(1.0f);
+
+			// Find the lowest vertex of the top patch
+			float lowest = FLT_MAX;
+			for (uint v = cGridSize * cGridSize; v < 2 * cGridSize * cGridSize; ++v)
+				lowest = min(lowest, mp->GetVertex(v).mPosition.GetY());
+
+			if (self_collision)
+				CHECK(lowest > 0.5f * cSelfCollisionDistance); // Resting on top of the bottom patch
+			else
+				CHECK(lowest < -1.0f); // Fell through
+		}
+	}
+
+	TEST_CASE("TestUpdateInterval")
+	{
+		Ref<SoftBodySharedSettings> shared_settings = sCreateCloth(10);
+
+		// Simulate the cloth with different update intervals
+		Vec3 positions[2];
+		for (uint update_interval : { 1, 3 })
+		{
+			PhysicsTestContext c;
+			BodyInterface &bi = c.GetSystem()->GetBodyInterface();
+
+			SoftBodyCreationSettings sb_settings(shared_settings, RVec3::sZero(), Quat::sRotation(Vec3::sAxisX(), 0.25f * JPH_PI), Layers::MOVING);
+			sb_settings.mAllowSleeping = false;
+			Body &body = *bi.CreateSoftBody(sb_settings);
+			bi.AddBody(body.GetID(), EActivation::Activate);
+			SoftBodyMotionProperties *mp = static_cast<SoftBodyMotionProperties *>(body.GetMotionProperties());
+			mp->SetUpdateInterval(update_interval);
+
+			// Take a vertex at the bottom of the cloth
+			const SoftBodyVertex &vertex = mp->GetVertex(99);
+
+			for (int step = 0; step < 60; ++step)
+			{
+				Vec3 before = vertex.mPosition;
+				c.SimulateSingleStep();
+
+				if ((step + 1) % update_interval == 0)
+				{
+					// Simulated this step
+					CHECK(vertex.mPosition != before);
+					CHECK(mp->GetTimeSinceLastUpdate() == 0.0f);
+				}
+				else
+				{
+					// Skipped this step
+					CHECK(vertex.mPosition == before);
+					CHECK_APPROX_EQUAL(mp->GetTimeSinceLastUpdate(), ((step + 1) % update_interval) * c.GetDeltaTime());
+				}
+			}
+
+			positions[update_interval == 1? 0 : 1] = Vec3(body.GetCenterOfMassPosition()) + vertex.mPosition;
+		}
+
+		// The cloth should swing down roughly the same with a lower update rate (the cloth is 0.9 m long)
+		CHECK_APPROX_EQUAL(positions[0], positions[1], 0.2f);
+	}
+
+	TEST_CASE("TestManySoftBodiesMultiThreaded")
+	{
+		Ref<SoftBodySharedSettings> large_settings = sCreateCloth(30);
+		Ref<SoftBodySharedSettings> small_settings = sCreateCloth(4);
+
+		// Simulate a single large cloth and many small ones, both single threaded and with worker threads
+		Array<Vec3> positions[2];
+		for (int num_threads : { 0, 4 })
+		{
+			PhysicsTestContext c(1.0f / 60.0f, 1, num_threads);
+			BodyInterface &bi = c.GetSystem()->GetBodyInterface();
+
+			Array<Body *> bodies;
+			for (int i = 0; i < 21; ++i)
+			{
+				SoftBodyCreationSettings sb_settings(i == 0? large_settings : small_settings, RVec3(5.0f * i, 0, 0), Quat::sRotation(Vec3::sAxisX(), 0.25f * JPH_PI), Layers::MOVING);
+				sb_settings.mAllowSleeping = false;
+				Body *body = bi.CreateSoftBody(sb_settings);
+				bi.AddBody(body->GetID(), EActivation::Activate);
+				bodies.push_back(body);
+			}
+
+			c.Simulate(0.5f);
+
+			Array<Vec3> &out = positions[num_threads == 0? 0 : 1];
+			for (const Body *body : bodies)
+				for (const SoftBodyVertex &v : static_cast<const SoftBodyMotionProperties *>(body->GetMotionProperties())->GetVertices())
+					out.push_back(Vec3(body->GetCenterOfMassPosition()) + v.mPosition);
+		}
+
+		// The update should be deterministic regardless of how the work was distributed over the threads
+		CHECK(positions[0].size() == positions[1].size());
+		for (size_t i = 0; i < min(positions[0].size(), positions[1].size()); ++i)
+			CHECK(positions[0][i] == positions[1][i]);
+	}
+
+	TEST_CASE("TestSoftBodyHelperJobsDontOverflowBarrier")
+	{
+		// Many soft bodies with many threads would spawn more helper jobs than the barrier can hold if they were not capped
+		Ref<SoftBodySharedSettings> settings = sCreateCloth(30);
+		PhysicsTestContext c(1.0f / 60.0f, 1, 15);
+		BodyInterface &bi = c.GetSystem()->GetBodyInterface();
+		for (int i = 0; i < 100; ++i)
+		{
+			SoftBodyCreationSettings sb_settings(settings, RVec3(5.0f * (i % 10), 0, 5.0f * (i / 10)), Quat::sIdentity(), Layers::MOVING);
+			sb_settings.mAllowSleeping = false;
+			bi.CreateAndAddSoftBody(sb_settings, EActivation::Activate);
+		}
+
+		CHECK(c.SimulateSingleStep() == EPhysicsUpdateError::None);
+	}
+
+	TEST_CASE("TestSoftBodyHelperJobsInLaterSteps")
+	{
+		// Job system that forwards to another job system and counts the soft body helper jobs that are created in each collision step
+		constexpr int cMaxSteps = 8;
+		class CountingJobSystem : public JobSystem
+		{
+		public:
+			explicit				CountingJobSystem(JobSystem &inJobSystem) : mJobSystem(inJobSystem) { }
+
+			virtual int				GetMaxConcurrency() const override { return mJobSystem.GetMaxConcurrency(); }
+
+			virtual JobHandle		CreateJob(const char *inName, ColorArg inColor, const JobFunction &inJobFunction, uint32 inNumDependencies) override
+			{
+				if (strcmp(inName, "SoftBodyPrepare") == 0)
+					return mJobSystem.CreateJob(inName, inColor, [this, inJobFunction]() { ++mStep; inJobFunction(); }, inNumDependencies);
+
+				if (strcmp(inName, "SoftBodySimulateHelper") == 0)
+					++mNumHelpers[min(mStep.load(), cMaxSteps - 1)];
+				return mJobSystem.CreateJob(inName, inColor, inJobFunction, inNumDependencies);
+			}
+
+			virtual Barrier *		CreateBarrier() override { return mJobSystem.CreateBarrier(); }
+			virtual void			DestroyBarrier(Barrier *inBarrier) override { mJobSystem.DestroyBarrier(inBarrier); }
+			virtual void			WaitForJobs(Barrier *inBarrier) override { mJobSystem.WaitForJobs(inBarrier); }
+
+			atomic<int>				mNumHelpers[cMaxSteps] = { };
+
+		protected:
+			// Jobs are created by the wrapped job system, so these are never called
+			virtual void			QueueJob(Job *) override { JPH_ASSERT(false); }
+			virtual void			QueueJobs(Job **, uint) override { JPH_ASSERT(false); }
+			virtual void			FreeJob(Job *) override { JPH_ASSERT(false); }
+
+		private:
+			JobSystem &				mJobSystem;
+			atomic<int>				mStep { 0 };
+		};
+
+		// Simulate cloths in multiple collision steps
+		constexpr int cCollisionSteps = 4;
+		Ref<SoftBodySharedSettings> settings = sCreateCloth(30);
+		PhysicsTestContext c(1.0f / 60.0f, cCollisionSteps, 15);
+		BodyInterface &bi = c.GetSystem()->GetBodyInterface();
+		for (int i = 0; i < 20; ++i)
+		{
+			SoftBodyCreationSettings sb_settings(settings, RVec3(5.0f * (i % 5), 0, 5.0f * (i / 5)), Quat::sIdentity(), Layers::MOVING);
+			sb_settings.mAllowSleeping = false;
+			bi.CreateAndAddSoftBody(sb_settings, EActivation::Activate);
+		}
+
+		CountingJobSystem job_system(c.GetJobSystem());
+		TempAllocatorMalloc temp_allocator;
+		CHECK(c.GetSystem()->Update(c.GetDeltaTime(), cCollisionSteps, &temp_allocator, &job_system) == EPhysicsUpdateError::None);
+
+
+		// Helpers return their slot when they finish, so the soft bodies should be simulated in parallel in every step and not only in the first ones
+		for (int step = 1; step <= cCollisionSteps; ++step)
+			CHECK(job_system.mNumHelpers[step] > 0);
+	}
+
+	TEST_CASE("TestCollideVerticesVsTrianglesBatched")
+	{
+		UnitTestRandom random;
+		uniform_real_distribution<float> height(-0.5f, 0.5f);
+
+		// Create a bumpy mesh
+		const int cGridSize = 16;
+		VertexList mesh_vertices;
+		for (int z = 0; z <= cGridSize; ++z)
+			for (int x = 0; x <= cGridSize; ++x)
+				mesh_vertices.push_back(Float3(0.5f * x, height(random), 0.5f * z));
+		IndexedTriangleList mesh_triangles;
+		for (int z = 0; z < cGridSize; ++z)
+			for (int x = 0; x < cGridSize; ++x)
+			{
+				uint32 v = z * (cGridSize + 1) + x;
+				mesh_triangles.push_back(IndexedTriangle(v, v + cGridSize + 1, v + 1));
+				mesh_triangles.push_back(IndexedTriangle(v + 1, v + cGridSize + 1, v + cGridSize + 2));
+			}
+		RefConst<Shape> mesh = MeshShapeSettings(mesh_vertices, mesh_triangles).Create().Get();
+
+		// Create a bumpy height field
+		HeightFieldShapeSettings height_field_settings;
+		height_field_settings.mScale = Vec3(0.25f, 1.0f, 0.25f);
+		height_field_settings.mSampleCount = 32;
+		height_field_settings.mHeightSamples.resize(Square(height_field_settings.mSampleCount));
+		for (float &h : height_field_settings.mHeightSamples)
+			h = height(random);
+		RefConst<Shape> height_field = height_field_settings.Create().Get();
+
+		// Create a grid of soft body vertices that hovers over the shapes and partially penetrates them
+		Array<SoftBodyVertex> vertices;
+		for (int z = 0; z < 30; ++z)
+			for (int x = 0; x < 30; ++x)
+			{
+				SoftBodyVertex v;
+				v.mPosition = Vec3(1.0f + 0.05f * x, 0.3f * height(random), 1.0f + 0.05f * z);
+				v.mInvMass = (x + z) % 7 == 0? 0.0f : 1.0f;
+				vertices.push_back(v);
+			}
+
+		Mat44 transform = Mat44::sRotationTranslation(Quat::sRotation(Vec3::sAxisY(), 0.1f), Vec3(0.1f, 0.0f, -0.1f));
+		for (const Shape *shape : { mesh.GetPtr(), height_field.GetPtr() })
+		{
+			// Collide all vertices at once so that they're processed in batches
+			Array<SoftBodyVertex> batched = vertices;
+			for (SoftBodyVertex &v : batched)
+				v.ResetCollision();
+			shape->CollideSoftBodyVertices(transform, Vec3::sReplicate(1.0f), CollideSoftBodyVertexIterator(batched.data()), (uint)batched.size(), 1);
+
+			// Collide the vertices one by one
+			Array<SoftBodyVertex> single = vertices;
+			for (SoftBodyVertex &v : single)
+			{
+				v.ResetCollision();
+				shape->CollideSoftBodyVertices(transform, Vec3::sReplicate(1.0f), CollideSoftBodyVertexIterator(&v), 1, 1);
+			}
+
+			// Both should find the same collisions
+			int num_colliding = 0;
+			for (size_t i = 0; i < vertices.size(); ++i)
+			{
+				CHECK(batched[i].mCollidingShapeIndex == single[i].mCollidingShapeIndex);
+				if (single[i].mCollidingShapeIndex >= 0)
+				{
+					++num_colliding;
+					CHECK_APPROX_EQUAL(batched[i].mLargestPenetration, single[i].mLargestPenetration, 1.0e-5f);
+					CHECK_APPROX_EQUAL(batched[i].mCollisionPlane.GetNormal(), single[i].mCollisionPlane.GetNormal(), 1.0e-5f);
+					CHECK_APPROX_EQUAL(batched[i].mCollisionPlane.SignedDistance(batched[i].mPosition), single[i].mCollisionPlane.SignedDistance(single[i].mPosition), 1.0e-5f);
+				}
+			}
+			CHECK(num_colliding > 500);
+		}
+	}
+
+	// Create a block of tetrahedra with jittered vertices
+	static Ref<SoftBodySharedSettings> sCreateTetrahedralBlock(uint inSize)
+	{
+		Ref<SoftBodySharedSettings> settings = new SoftBodySharedSettings;
+
+		// Create vertices
+		UnitTestRandom random;
+		uniform_real_distribution<float> jitter(-0.03f, 0.03f);
+		uint n = inSize + 1;
+		for (uint z = 0; z < n; ++z)
+			for (uint y = 0; y < n; ++y)
+				for (uint x = 0; x < n; ++x)
+				{
+					SoftBodySharedSettings::Vertex v;
+					v.mPosition = Float3(0.1f * x + jitter(random), 0.1f * y + jitter(random), 0.1f * z + jitter(random));
+					settings->mVertices.push_back(v);
+				}
+
+		// Split every cube in 5 tetrahedra, alternating the split so the tetrahedra of neighboring cubes share faces
+		UnorderedSet<uint64> edges;
+		auto add_edge = [&settings, &edges](uint32 inV1, uint32 inV2) {
+			uint64 key = (uint64(min(inV1, inV2)) << 32) | max(inV1, inV2);
+			if (edges.insert(key).second)
+				settings->mEdgeConstraints.push_back(SoftBodySharedSettings::Edge(inV1, inV2));
+		};
+		for (uint z = 0; z < inSize; ++z)
+			for (uint y = 0; y < inSize; ++y)
+				for (uint x = 0; x < inSize; ++x)
+				{
+					uint32 c[8];
+					for (uint i = 0; i < 8; ++i)
+						c[i] = ((z + (i >> 2)) * n + y + ((i >> 1) & 1)) * n + x + (i & 1);
+
+					static const uint cTets[2][5][4] = {
+						{ { 0, 1, 2, 4 }, { 1, 2, 3, 7 }, { 1, 4, 5, 7 }, { 2, 4, 6, 7 }, { 1, 2, 4, 7 } },
+						{ { 0, 1, 3, 5 }, { 0, 2, 3, 6 }, { 0, 4, 5, 6 }, { 3, 5, 6, 7 }, { 0, 3, 5, 6 } } };
+					for (const uint (&t)[4] : cTets[(x + y + z) & 1])
+					{
+						// Volume constraints need a positive volume
+						Vec3 x1(settings->mVertices[c[t[0]]].mPosition);
+						Vec3 x2(settings->mVertices[c[t[1]]].mPosition);
+						Vec3 x3(settings->mVertices[c[t[2]]].mPosition);
+						Vec3 x4(settings->mVertices[c[t[3]]].mPosition);
+						if ((x2 - x1).Cross(x3 - x1).Dot(x4 - x1) > 0.0f)
+							settings->mVolumeConstraints.push_back(SoftBodySharedSettings::Volume(c[t[0]], c[t[1]], c[t[2]], c[t[3]]));
+						else
+							settings->mVolumeConstraints.push_back(SoftBodySharedSettings::Volume(c[t[0]], c[t[2]], c[t[1]], c[t[3]]));
+						for (uint i = 0; i < 4; ++i)
+							for (uint j = i + 1; j < 4; ++j)
+								add_edge(c[t[i]], c[t[j]]);
+					}
+				}
+
+		settings->CalculateEdgeLengths();
+		settings->CalculateVolumeConstraintVolumes();
+		return settings;
+	}
+
+	TEST_CASE("TestOptimizeQuality")
+	{
+		// Optimize the same tetrahedral block with both qualities
+		Ref<SoftBodySharedSettings> fast = sCreateTetrahedralBlock(10);
+		Ref<SoftBodySharedSettings> high = fast->Clone();
+		fast->Optimize(SoftBodySharedSettings::EOptimizationQuality::Fast);
+		high->Optimize(SoftBodySharedSettings::EOptimizationQuality::High);
+
+		SoftBodySharedSettings::UpdateGroupStats fast_stats = fast->GetUpdateGroupStats();
+		SoftBodySharedSettings::UpdateGroupStats high_stats = high->GetUpdateGroupStats();
+
+		// All constraints should be accounted for
+		uint num_constraints = uint(fast->mEdgeConstraints.size() + fast->mVolumeConstraints.size());
+		CHECK(fast_stats.mNumConstraints == num_constraints);
+		CHECK(high_stats.mNumConstraints == num_constraints);
+		CHECK(fast_stats.mNumParallelGroups > 1);
+		CHECK(high_stats.mNumParallelGroups > 1);
+		CHECK(fast_stats.mNumLayers == 1);
+		CHECK(high_stats.mNumLayers > 1);
+		CHECK(high_stats.mMinParallelGroupSize > 0);
+		CHECK(high_stats.mMinParallelGroupSize <= high_stats.mMaxParallelGroupSize);
+
+		// Higher quality should result in fewer constraints in the non-parallel group
+		CHECK(high_stats.mNonParallelGroupSize < fast_stats.mNonParallelGroupSize);
+
+		// Simulating the layers of groups on multiple threads should give the same result as simulating on a single thread
+		Array<Vec3> positions[2];
+		for (int num_threads : { 0, 4 })
+		{
+			PhysicsTestContext c(1.0f / 60.0f, 1, num_threads);
+			BodyInterface &bi = c.GetSystem()->GetBodyInterface();
+			Body &body = *bi.CreateSoftBody(SoftBodyCreationSettings(high, RVec3::sZero(), Quat::sIdentity(), Layers::MOVING));
+			bi.AddBody(body.GetID(), EActivation::Activate);
+			c.Simulate(0.25f);
+
+			for (const SoftBodyVertex &v : static_cast<const SoftBodyMotionProperties *>(body.GetMotionProperties())->GetVertices())
+				positions[num_threads == 0? 0 : 1].push_back(v.mPosition);
+		}
+		for (size_t i = 0; i < positions[0].size(); ++i)
+			CHECK(positions[0][i] == positions[1][i]);
+	}
+
+	TEST_CASE("TestSaveRestoreOptimized")
+	{
+		Ref<SoftBodySharedSettings> settings = sCreateTetrahedralBlock(4);
+		settings->Optimize(SoftBodySharedSettings::EOptimizationQuality::High);
+
+		// Write the optimized settings to a binary stream
+		stringstream data;
+		{
+			StreamOutWrapper stream_out(data);
+			settings->SaveBinaryState(stream_out);
+		}
+
+		// Read them back
+		Ref<SoftBodySharedSettings> restored = new SoftBodySharedSettings;
+		{
+			StreamInWrapper stream_in(data);
+			restored->RestoreBinaryState(stream_in);
+		}
+
+		// The groups should be restored so there's no need to optimize again
+		SoftBodySharedSettings::UpdateGroupStats stats = settings->GetUpdateGroupStats();
+		SoftBodySharedSettings::UpdateGroupStats restored_stats = restored->GetUpdateGroupStats();
+		CHECK(restored_stats.mNumParallelGroups == stats.mNumParallelGroups);
+		CHECK(restored_stats.mNonParallelGroupSize == stats.mNonParallelGroupSize);
+		CHECK(restored_stats.mNumConstraints == stats.mNumConstraints);
+		CHECK(restored->mEdgeConstraints.size() == settings->mEdgeConstraints.size());
+		for (size_t i = 0; i < min(restored->mEdgeConstraints.size(), settings->mEdgeConstraints.size()); ++i)
+			CHECK(restored->mEdgeConstraints[i].mVertex[0] == settings->mEdgeConstraints[i].mVertex[0]);
+
+		// The restored settings can be simulated directly
+		PhysicsTestContext c;
+		BodyInterface &bi = c.GetSystem()->GetBodyInterface();
+		Body &body = *bi.CreateSoftBody(SoftBodyCreationSettings(restored, RVec3::sZero(), Quat::sIdentity(), Layers::MOVING));
+		bi.AddBody(body.GetID(), EActivation::Activate);
+		const SoftBodyVertex &vertex = static_cast<SoftBodyMotionProperties *>(body.GetMotionProperties())->GetVertex(0);
+		float start_y = float(body.GetCenterOfMassPosition().GetY()) + vertex.mPosition.GetY();
+		c.Simulate(0.1f);
+		CHECK(float(body.GetCenterOfMassPosition().GetY()) + vertex.mPosition.GetY() < start_y - 0.01f); // Falling due to gravity
+	}
 }
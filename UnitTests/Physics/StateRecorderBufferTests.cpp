@@ -0,0 +1,145 @@
+// Jolt Physics Library (https://github.com/jrouwe/JoltPhysics)
+// SPDX-FileCopyrightText: 2024 Jorrit Rouwe
+// SPDX-License-Identifier: MIT
+
+#include "UnitTestFramework.h"
+#include "PhysicsTestContext.h"
+#include "Layers.h"
+#include <Jolt/Physics/StateRecorderBuffer.h>
+#include <Jolt/Physics/StateRecorderImpl.h>
+
+TEST_SUITE("StateRecorderBufferTests")
+{
+	// Create a floor with a couple of boxes and spheres on top
+	static void sCreateScene(PhysicsTestContext &ioContext)
+	{
+		ioContext.CreateFloor();
+		for (int i = 0; i < 5; ++i)
+		{
+			ioContext.CreateBox(RVec3(Real(3 * i), 2, 0), Quat::sRotation(Vec3::sAxisX(), 0.1f * i), EMotionType::Dynamic, EMotionQuality::Discrete, Layers::MOVING, Vec3::sReplicate(0.5f));
+			ioContext.CreateSphere(RVec3(Real(3 * i), 5, 0), 0.5f, EMotionType::Dynamic, EMotionQuality::Discrete, Layers::MOVING);
+		}
+	}
+
+	TEST_CASE("TestStateRecorderBufferSaveRestore")
+	{
+		PhysicsTestContext c;
+		sCreateScene(c);
+		c.Simulate(0.5f);
+
+		// Save the state in both recorder types, the data should be identical
+		StateRecorderImpl reference;
+		c.GetSystem()->SaveState(reference);
+		StateRecorderBuffer buffer;
+		c.GetSystem()->SaveState(buffer);
+		CHECK(!buffer.IsFailed());
+		string reference_data = reference.GetData();
+		CHECK(buffer.GetDataSize() == reference_data.size());
+		CHECK(memcmp(buffer.GetData(), reference_data.data(), reference_data.size()) == 0);
+
+		// Simulate, restore and save again, this should reproduce the saved state
+		c.Simulate(0.5f);
+		buffer.Rewind();
+		c.GetSystem()->RestoreState(buffer);
+		CHECK(!buffer.IsFailed());
+		CHECK(!buffer.IsEOF());
+		StateRecorderBuffer restored;
+		c.GetSystem()->SaveState(restored);
+		CHECK(restored.IsEqual(buffer));
+
+		// Reusing the buffer should not reallocate unless the state got bigger than the buffer
+		for (int i = 0; i < 10; ++i)
+		{
+			const uint8 *data = buffer.GetData();
+			size_t capacity = buffer.GetCapacity();
+			c.SimulateSingleStep();
+			buffer.Clear();
+			c.GetSystem()->SaveState(buffer);
+			if (buffer.GetDataSize() <= capacity)
+			{
+				CHECK(buffer.GetData() == data);
+				CHECK(buffer.GetCapacity() == capacity);
+			}
+		}
+
+		// Validating the state that was just saved should succeed
+		buffer.Rewind();
+		buffer.SetValidating(true);
+		c.GetSystem()->RestoreState(buffer);
+		CHECK(!buffer.IsFailed());
+	}
+
+	TEST_CASE("TestStateRecorderBufferCallerMemory")
+	{
+		PhysicsTestContext c;
+		sCreateScene(c);
+		c.Simulate(0.5f);
+
+		// Determine the size of the state
+		StateRecorderBuffer sized;
+		c.GetSystem()->SaveState(sized);
+		size_t size = sized.GetDataSize();
+
+		// Memory that is too small should fail
+		Array<uint8> small_memory(size - 1);
+		StateRecorderBuffer small(small_memory.data(), small_memory.size());
+		c.GetSystem()->SaveState(small);
+		CHECK(small.IsFailed());
+
+		// Memory of the right size should produce the same state
+		Array<uint8> memory(size);
+		StateRecorderBuffer buffer(memory.data(), memory.size());
+		c.GetSystem()->SaveState(buffer);
+		CHECK(!buffer.IsFailed());
+		CHECK(buffer.GetData() == memory.data());
+		CHECK(buffer.IsEqual(sized));
+
+		// Reading past the end should fail
+		buffer.Rewind();
+		Array<uint8> read_back(size + 1);
+		buffer.ReadBytes(read_back.data(), read_back.size());
+		CHECK(buffer.IsEOF());
+		CHECK(buffer.IsFailed());
+	}
+
+	TEST_CASE("TestStateRecorderBufferParallel")
+	{
+		// Create more bodies and body pairs than fit in a single batch
+		PhysicsTestContext c(1.0f / 60.0f, 1, 3);
+		c.CreateFloor();
+		for (int x = 0; x < 20; ++x)
+			for (int z = 0; z < 20; ++z)
+				c.CreateBox(RVec3(1.5_r * x, 0.5_r, 1.5_r * z), Quat::sRotation(Vec3::sAxisY(), 0.1f * x), EMotionType::Dynamic, EMotionQuality::Discrete, Layers::MOVING, Vec3::sReplicate(0.5f));
+		c.Simulate(0.25f);
+		PhysicsSystem &system = *c.GetSystem();
+		JobSystem &job_system = c.GetJobSystem();
+
+		// Saving in parallel should give the same data as saving single threaded
+		StateRecorderBuffer expected;
+		system.SaveState(expected);
+		StateRecorderBuffer parallel;
+		system.SaveState(parallel, job_system);
+		CHECK(parallel.IsEqual(expected));
+
+		// Simulate, restore in parallel and check that we get the same state back
+		c.Simulate(0.25f);
+		CHECK(system.RestoreState(parallel, job_system));
+		CHECK(!parallel.IsFailed());
+		StateRecorderBuffer restored;
+		system.SaveState(restored);
+		CHECK(restored.IsEqual(expected));
+
+		// Simulating from the state restored in parallel should be deterministic
+		for (int i = 0; i < 5; ++i)
+			c.SimulateSingleStep();
+		StateRecorderBuffer after_parallel;
+		system.SaveState(after_parallel);
+		expected.Rewind();
+		CHECK(system.RestoreState(expected));
+		for (int i = 0; i < 5; ++i)
+			c.SimulateSingleStep();
+		StateRecorderBuffer after_sequential;
+		system.SaveState(after_sequential);
+		CHECK(after_parallel.IsEqual(after_sequential));
+	}
+}
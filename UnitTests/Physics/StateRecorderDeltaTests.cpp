@@ -0,0 +1,185 @@
+// Jolt Physics Library (https://github.com/jrouwe/JoltPhysics)
+// SPDX-FileCopyrightText: 2024 Jorrit Rouwe
+// SPDX-License-Identifier: MIT
+
+#include "UnitTestFramework.h"
+#include "PhysicsTestContext.h"
+#include "Layers.h"
+#include <Jolt/Physics/StateRecorderDelta.h>
+#include <Jolt/Physics/Constraints/DistanceConstraint.h>
+
+TEST_SUITE("StateRecorderDeltaTests")
+{
+	// Create a floor with a grid of boxes that fall asleep and a couple of spheres that keep rolling
+	static void sCreateScene(PhysicsTestContext &ioContext, Array<BodyID> &outRollingSpheres)
+	{
+		ioContext.CreateFloor();
+
+		for (int x = 0; x < 10; ++x)
+			for (int z = 0; z < 10; ++z)
+				ioContext.CreateBox(RVec3(Real(2 * x), 0.5_r, Real(2 * z)), Quat::sIdentity(), EMotionType::Dynamic, EMotionQuality::Discrete, Layers::MOVING, Vec3::sReplicate(0.5f));
+
+		Body &sphere1 = ioContext.CreateSphere(RVec3(-5, 1, 0), 1.0f, EMotionType::Dynamic, EMotionQuality::Discrete, Layers::MOVING);
+		Body &sphere2 = ioContext.CreateSphere(RVec3(-8, 1, 0), 1.0f, EMotionType::Dynamic, EMotionQuality::Discrete, Layers::MOVING);
+		for (Body *sphere : { &sphere1, &sphere2 })
+		{
+			sphere->SetAllowSleeping(false);
+			outRollingSpheres.push_back(sphere->GetID());
+		}
+
+		// Connect the spheres so we have a constraint in the delta
+		DistanceConstraintSettings settings;
+		settings.mPoint1 = sphere1.GetCenterOfMassPosition();
+		settings.mPoint2 = sphere2.GetCenterOfMassPosition();
+		ioContext.CreateConstraint<DistanceConstraint>(sphere1, sphere2, settings);
+
+		// Let the boxes fall asleep
+		ioContext.Simulate(2.0f);
+
+		// Roll the spheres
+		BodyInterface &bi = ioContext.GetBodyInterface();
+		for (BodyID id : outRollingSpheres)
+			bi.SetLinearVelocity(id, Vec3(0, 0, -2));
+	}
+
+	TEST_CASE("TestStateRecorderDeltaExact")
+	{
+		PhysicsTestContext c;
+		Array<BodyID> spheres;
+		sCreateScene(c, spheres);
+		PhysicsSystem &system = *c.GetSystem();
+
+		// Save a reference and simulate
+		DeltaStateReference reference;
+		system.SaveStateReference(reference);
+		for (int i = 0; i < 5; ++i)
+			c.SimulateSingleStep();
+
+		// Save a full state and a delta
+		StateRecorderBuffer full;
+		system.SaveState(full);
+		StateRecorderBuffer delta;
+		system.SaveStateDelta(delta, reference, DeltaStateSettings());
+		CHECK(!delta.IsFailed());
+
+		// Only the spheres are active, so the delta should be much smaller
+		CHECK(delta.GetDataSize() * 10 < full.GetDataSize());
+
+		// Simulate further, restore the delta and check that we get the same state back
+		c.Simulate(1.0f);
+		CHECK(system.RestoreStateDelta(delta, reference));
+		StateRecorderBuffer restored;
+		system.SaveState(restored);
+		CHECK(restored.IsEqual(full));
+
+		// Simulating from the restored state should be deterministic
+		full.Rewind();
+		CHECK(system.RestoreState(full));
+		for (int i = 0; i < 5; ++i)
+			c.SimulateSingleStep();
+		StateRecorderBuffer expected;
+		system.SaveState(expected);
+		delta.Rewind();
+		CHECK(system.RestoreStateDelta(delta, reference));
+		for (int i = 0; i < 5; ++i)
+			c.SimulateSingleStep();
+		StateRecorderBuffer actual;
+		system.SaveState(actual);
+		CHECK(actual.IsEqual(expected));
+	}
+
+	TEST_CASE("TestStateRecorderDeltaMostlyActive")
+	{
+		PhysicsTestContext c;
+		c.CreateFloor();
+		BodyInterface &bi = c.GetBodyInterface();
+
+		// Create a grid of boxes that float and never sleep, these are active but don't change
+		for (int x = 0; x < 10; ++x)
+			for (int z = 0; z < 10; ++z)
+			{
+				Body &box = c.CreateBox(RVec3(Real(2 * x), 5.0_r, Real(2 * z)), Quat::sIdentity(), EMotionType::Dynamic, EMotionQuality::Discrete, Layers::MOVING, Vec3::sReplicate(0.5f));
+				box.SetAllowSleeping(false);
+				bi.SetGravityFactor(box.GetID(), 0.0f);
+			}
+
+		// Drop a sphere on the floor so that there is a contact that changes
+		Body &sphere = c.CreateSphere(RVec3(-5, 1, 0), 1.0f, EMotionType::Dynamic, EMotionQuality::Discrete, Layers::MOVING);
+		sphere.SetAllowSleeping(false);
+		c.SimulateSingleStep();
+
+		// Save a reference and simulate
+		PhysicsSystem &system = *c.GetSystem();
+		DeltaStateReference reference;
+		system.SaveStateReference(reference);
+		for (int i = 0; i < 5; ++i)
+			c.SimulateSingleStep();
+		CHECK(system.GetNumActiveBodies(EBodyType::RigidBody) == 101);
+
+		// Only the sphere and its contact changed, so the delta should be much smaller than a full save
+		StateRecorderBuffer full;
+		system.SaveState(full);
+		StateRecorderBuffer delta;
+		system.SaveStateDelta(delta, reference, DeltaStateSettings());
+		CHECK(delta.GetDataSize() * 10 < full.GetDataSize());
+
+		// Restoring the delta should give the full state
+		c.Simulate(1.0f);
+		CHECK(system.RestoreStateDelta(delta, reference));
+		StateRecorderBuffer restored;
+		system.SaveState(restored);
+		CHECK(restored.IsEqual(full));
+	}
+
+	TEST_CASE("TestStateRecorderDeltaQuantized")
+	{
+		PhysicsTestContext c;
+		Array<BodyID> spheres;
+		sCreateScene(c, spheres);
+		PhysicsSystem &system = *c.GetSystem();
+		BodyInterface &bi = c.GetBodyInterface();
+
+		// Save a reference and simulate
+		DeltaStateReference reference;
+		system.SaveStateReference(reference);
+		for (int i = 0; i < 10; ++i)
+			c.SimulateSingleStep();
+
+		// Save an exact and a quantized delta
+		StateRecorderBuffer exact_delta;
+		system.SaveStateDelta(exact_delta, reference, DeltaStateSettings());
+		DeltaStateSettings settings;
+		settings.mQuantize = true;
+		StateRecorderBuffer quantized_delta;
+		system.SaveStateDelta(quantized_delta, reference, settings);
+		CHECK(quantized_delta.GetDataSize() < exact_delta.GetDataSize());
+
+		// A precision of zero cannot be quantized, the changes are stored exactly
+		DeltaStateSettings zero_precision_settings = settings;
+		zero_precision_settings.mPositionPrecision = 0.0f;
+		StateRecorderBuffer zero_precision_delta;
+		system.SaveStateDelta(zero_precision_delta, reference, zero_precision_settings);
+		CHECK(zero_precision_delta.GetDataSize() == exact_delta.GetDataSize());
+
+		// Remember the state of the spheres
+		RVec3 positions[2];
+		Quat rotations[2];
+		Vec3 velocities[2];
+		for (int i = 0; i < 2; ++i)
+		{
+			positions[i] = bi.GetCenterOfMassPosition(spheres[i]);
+			rotations[i] = bi.GetRotation(spheres[i]);
+			velocities[i] = bi.GetLinearVelocity(spheres[i]);
+		}
+
+		// Simulate further and restore the quantized delta, the spheres should be back within the precision
+		c.Simulate(1.0f);
+		CHECK(system.RestoreStateDelta(quantized_delta, reference));
+		for (int i = 0; i < 2; ++i)
+		{
+			CHECK_APPROX_EQUAL(bi.GetCenterOfMassPosition(spheres[i]), positions[i], settings.mPositionPrecision);
+			CHECK_APPROX_EQUAL(bi.GetRotation(spheres[i]), rotations[i], 1.0e-3f);
+			CHECK_APPROX_EQUAL(bi.GetLinearVelocity(spheres[i]), velocities[i], settings.mVelocityPrecision);
+		}
+	}
+}
@@ -7,6 +7,7 @@
 #include <Jolt/Physics/Collision/Shape/BoxShape.h>
 #include <Jolt/Physics/Collision/Shape/OffsetCenterOfMassShape.h>
 #include <Jolt/Physics/Vehicle/WheeledVehicleController.h>
+#include <Jolt/Physics/Vehicle/VehicleCollisionTester.h>
 #include <Jolt/Physics/Body/BodyCreationSettings.h>
 #include "Layers.h"
 
@@ -344,4 +345,190 @@ TEST_SUITE("WheeledVehicleTests")
 				CHECK_APPROX_EQUAL(body->GetPosition().GetZ(), 0, 0.06_r);
 		}
 	}
+
+	TEST_CASE("TestCollideWheels")
+	{
+		PhysicsTestContext c;
+		c.CreateFloor();
+
+		// Put blocks of different heights under some of the wheels
+		c.CreateBox(RVec3(0.9f, 0.06f, 1.4f), Quat::sIdentity(), EMotionType::Static, EMotionQuality::Discrete, Layers::NON_MOVING, Vec3(0.2f, 0.06f, 0.2f), EActivation::DontActivate);
+		c.CreateBox(RVec3(-0.9f, 0.1f, -1.4f), Quat::sRotation(Vec3::sAxisZ(), 0.2f), EMotionType::Static, EMotionQuality::Discrete, Layers::NON_MOVING, Vec3(0.2f, 0.1f, 0.2f), EActivation::DontActivate);
+
+		VehicleSettings settings;
+		settings.mPosition = RVec3(0, 0.9f, 0);
+		VehicleConstraint *constraint = AddVehicle(c, settings);
+		const Body *body = constraint->GetVehicleBody();
+		RMat44 body_transform = body->GetWorldTransform();
+
+		Array<RefConst<VehicleCollisionTester>> testers = { new VehicleCollisionTesterRay(Layers::MOVING), new VehicleCollisionTesterCastSphere(Layers::MOVING, 0.05f), new VehicleCollisionTesterCastCylinder(Layers::MOVING) };
+
+		auto check_same_results = [&c, constraint, body, &body_transform, &testers]()
+		{
+			uint num_hits = 0;
+			for (const VehicleCollisionTester *tester : testers)
+			{
+				// Test all wheels in one batch
+				Array<VehicleCollisionTester::WheelCollision> batch;
+				for (uint i = 0; i < uint(constraint->GetWheels().size()); ++i)
+				{
+					const WheelSettings *wheel_settings = constraint->GetWheel(i)->GetSettings();
+					VehicleCollisionTester::WheelCollision &collision = batch.emplace_back();
+					collision.mWheelIndex = i;
+					collision.mOrigin = body_transform * wheel_settings->mPosition;
+					collision.mDirection = body_transform.Multiply3x3(wheel_settings->mSuspensionDirection);
+				}
+				tester->CollideWheels(*c.GetSystem(), *constraint, body->GetID(), batch.data(), uint(batch.size()));
+
+				// Compare with testing the wheels one by one
+				for (const VehicleCollisionTester::WheelCollision &collision : batch)
+				{
+					Body *contact_body = nullptr;
+					SubShapeID sub_shape_id;
+					RVec3 contact_position;
+					Vec3 contact_normal;
+					float suspension_length;
+					bool hit = tester->Collide(*c.GetSystem(), *constraint, collision.mWheelIndex, collision.mOrigin, collision.mDirection, body->GetID(), contact_body, sub_shape_id, contact_position, contact_normal, suspension_length);
+					CHECK(collision.mBody == (hit? contact_body : nullptr));
+					if (hit && collision.mBody == contact_body)
+					{
+						++num_hits;
+						CHECK(collision.mSubShapeID == sub_shape_id);
+						CHECK(collision.mContactPosition == contact_position);
+						CHECK(collision.mContactNormal == contact_normal);
+						CHECK(collision.mSuspensionLength == suspension_length);
+					}
+				}
+			}
+			return num_hits;
+		};
+
+		// The wheels share a single broad phase query, all wheels should hit the floor or the blocks
+		CHECK(check_same_results() == uint(testers.size() * constraint->GetWheels().size()));
+
+		// Let the vehicle settle so that the wheels are tested in a different pose
+		c.Simulate(1.0f);
+
+		// Add more bodies than can be shared, the wheels should fall back to querying the world themselves
+		for (uint i = 0; i <= VehicleCollisionTester::cMaxSharedBodies; ++i)
+			c.CreateBox(RVec3(-0.6f + 0.15f * (i % 9), 0.1f, -0.5f + 0.15f * (i / 9)), Quat::sIdentity(), EMotionType::Static, EMotionQuality::Discrete, Layers::NON_MOVING, Vec3(0.06f, 0.06f, 0.06f), EActivation::DontActivate);
+		body_transform = body->GetWorldTransform();
+		CHECK(check_same_results() > 0);
+	}
+
+	TEST_CASE("TestVehicleLOD")
+	{
+		PhysicsTestContext c;
+		BodyID floor_id = c.CreateFloor().GetID();
+
+		VehicleSettings settings;
+		VehicleConstraint *constraint = AddVehicle(c, settings);
+		Body *body = constraint->GetVehicleBody();
+		WheeledVehicleController *controller = static_cast<WheeledVehicleController *>(constraint->GetController());
+		CHECK(constraint->GetLOD() == EVehicleLOD::Full);
+
+		// Settle and start driving forward at full LOD
+		c.Simulate(1.0f);
+		controller->SetDriverInput(1.0f, 0.0f, 0.0f, 0.0f);
+		c.GetBodyInterface().ActivateBody(body->GetID());
+		c.Simulate(2.0f);
+		CheckOnGround(constraint, settings, floor_id);
+		float full_velocity = body->GetLinearVelocity().GetZ();
+		CHECK(full_velocity > 1.0f);
+
+		// Switch to reduced LOD, the solver step overrides should be applied
+		constraint->SetLOD(EVehicleLOD::Reduced);
+		CHECK(constraint->GetLOD() == EVehicleLOD::Reduced);
+		CHECK(body->GetMotionProperties()->GetNumVelocityStepsOverride() == constraint->GetReducedLODNumVelocitySteps());
+		CHECK(body->GetMotionProperties()->GetNumPositionStepsOverride() == constraint->GetReducedLODNumPositionSteps());
+		CHECK(constraint->GetNumVelocityStepsOverride() == constraint->GetReducedLODNumVelocitySteps());
+		CHECK(constraint->GetNumPositionStepsOverride() == constraint->GetReducedLODNumPositionSteps());
+
+		// Switching should not cause a jump in velocity
+		c.SimulateSingleStep();
+		float reduced_velocity = body->GetLinearVelocity().GetZ();
+		CHECK_APPROX_EQUAL(reduced_velocity, full_velocity, 0.2f);
+
+		// The vehicle should keep accelerating and stay on the ground with the engine following the wheels
+		c.Simulate(2.0f);
+		CheckOnGround(constraint, settings, floor_id);
+		float reduced_velocity2 = body->GetLinearVelocity().GetZ();
+		CHECK(reduced_velocity2 > reduced_velocity + 1.0f);
+		CHECK_APPROX_EQUAL(body->GetPosition().GetX(), 0, 1.0e-2_r); // Not moving left/right
+		CHECK(controller->GetEngine().GetCurrentRPM() >= controller->GetEngine().mMinRPM);
+		CHECK(controller->GetEngine().GetCurrentRPM() <= controller->GetEngine().mMaxRPM);
+
+		// Switch back, the original solver step overrides should be restored
+		constraint->SetLOD(EVehicleLOD::Full);
+		CHECK(body->GetMotionProperties()->GetNumVelocityStepsOverride() == 0);
+		CHECK(body->GetMotionProperties()->GetNumPositionStepsOverride() == 0);
+		CHECK(constraint->GetNumVelocityStepsOverride() == 0);
+		CHECK(constraint->GetNumPositionStepsOverride() == 0);
+
+		// Switching back should not cause a jump in velocity either
+		c.SimulateSingleStep();
+		CHECK_APPROX_EQUAL(body->GetLinearVelocity().GetZ(), reduced_velocity2, 0.2f);
+		c.Simulate(1.0f);
+		CheckOnGround(constraint, settings, floor_id);
+		CHECK(body->GetLinearVelocity().GetZ() > reduced_velocity2);
+	}
+
+	TEST_CASE("TestVehicleLODTestsAllWheels")
+	{
+		PhysicsTestContext c;
+		c.CreateFloor();
+
+		// Collision tester that records on which step each wheel was last tested
+		class RecordingTester : public VehicleCollisionTesterRay
+		{
+		public:
+			using VehicleCollisionTesterRay::VehicleCollisionTesterRay;
+
+			virtual void	CollideWheels(PhysicsSystem &inPhysicsSystem, const VehicleConstraint &inVehicleConstraint, const BodyID &inVehicleBodyID, WheelCollision *ioWheels, uint inNumWheels) const override
+			{
+				for (uint i = 0; i < inNumWheels; ++i)
+					mLastTested[ioWheels[i].mWheelIndex] = mStep;
+				VehicleCollisionTesterRay::CollideWheels(inPhysicsSystem, inVehicleConstraint, inVehicleBodyID, ioWheels, inNumWheels);
+			}
+
+			int				mStep = 0;
+			mutable int		mLastTested[4] = { 0, 0, 0, 0 };
+		};
+
+		// Create a vehicle body that doesn't sleep
+		BodyCreationSettings car_body_settings(new BoxShape(Vec3(0.9f, 0.2f, 2.0f)), RVec3(0, 1, 0), Quat::sIdentity(), EMotionType::Dynamic, Layers::MOVING);
+		car_body_settings.mAllowSleeping = false;
+		Body *car_body = c.GetBodyInterface().CreateBody(car_body_settings);
+		c.GetBodyInterface().AddBody(car_body->GetID(), EActivation::Activate);
+
+		// Order the wheels so that the wheels of an axle are not next to each other: front left, back left, front right, back right
+		VehicleConstraintSettings vehicle;
+		vehicle.mController = new WheeledVehicleControllerSettings;
+		for (Vec3 position : { Vec3(0.9f, -0.2f, 1.4f), Vec3(0.9f, -0.2f, -1.4f), Vec3(-0.9f, -0.2f, 1.4f), Vec3(-0.9f, -0.2f, -1.4f) })
+		{
+			WheelSettingsWV *w = new WheelSettingsWV;
+			w->mPosition = position;
+			vehicle.mWheels.push_back(w);
+		}
+		VehicleConstraint *constraint = new VehicleConstraint(*car_body, vehicle);
+		Ref<RecordingTester> tester = new RecordingTester(Layers::MOVING);
+		constraint->SetVehicleCollisionTester(tester);
+		c.GetSystem()->AddConstraint(constraint);
+		c.GetSystem()->AddStepListener(constraint);
+
+		// Test the wheels every other step in reduced LOD, each wheel should be tested every 2 * 2 wheels per axle = 4 steps
+		constexpr int cNumStepsBetweenCollisionTest = 2;
+		constraint->SetNumStepsBetweenCollisionTestActive(cNumStepsBetweenCollisionTest);
+		constraint->SetLOD(EVehicleLOD::Reduced);
+		for (int step = 1; step <= 40; ++step)
+		{
+			tester->mStep = step;
+			c.SimulateSingleStep();
+			if (step >= 2 * cNumStepsBetweenCollisionTest)
+				for (int wheel = 0; wheel < 4; ++wheel)
+					CHECK(step - tester->mLastTested[wheel] < 2 * cNumStepsBetweenCollisionTest);
+		}
+
+		c.GetSystem()->RemoveStepListener(constraint);
+	}
 }
@@ -25,7 +25,7 @@ class PhysicsTestContext
 {
 public:
 	// Constructor / destructor
-						PhysicsTestContext(float inDeltaTime = 1.0f / 60.0f, int inCollisionSteps = 1, int inWorkerThreads = 0, uint inMaxBodies = 1024, uint inMaxBodyPairs = 4096, uint inMaxContactConstraints = 1024);
+						PhysicsTestContext(float inDeltaTime = 1.0f / 60.0f, int inCollisionSteps = 1, int inWorkerThreads = 0, uint inMaxBodies = 1024, uint inMaxBodyPairs = 4096, uint inMaxContactConstraints = 1024, EBroadPhaseType inBroadPhaseType = EBroadPhaseType::QuadTree);
 						~PhysicsTestContext();
 
 	// Set the gravity to zero
@@ -76,6 +76,12 @@ public:
 		return mSystem->GetBodyInterface();
 	}
 
+	// Access to the job system
+	JobSystem &			GetJobSystem() const
+	{
+		return *mJobSystem;
+	}
+
 	// Get delta time for simulation step
 	inline float		GetDeltaTime() const
 	{
@@ -0,0 +1,143 @@
+// Jolt Physics Library (https://github.com/jrouwe/JoltPhysics)
+// SPDX-FileCopyrightText: 2024 Jorrit Rouwe
+// SPDX-License-Identifier: MIT
+
+#include "UnitTestFramework.h"
+#include <Jolt/Skeleton/SkeletalAnimationSampler.h>
+#include <Jolt/Skeleton/SkeletonPose.h>
+#include <Jolt/Core/StringTools.h>
+
+JPH_SUPPRESS_WARNINGS_STD_BEGIN
+#include <random>
+JPH_SUPPRESS_WARNINGS_STD_END
+
+TEST_SUITE("SkeletalAnimationSamplerTests")
+{
+	// Number of joints in the test skeleton, not a multiple of 4 so that the last batch of joints is partially filled
+	static constexpr int cNumJoints = 6;
+
+	// Create a chain of joints
+	static Ref<Skeleton> sCreateSkeleton()
+	{
+		Ref<Skeleton> skeleton = new Skeleton;
+		for (int i = 0; i < cNumJoints; ++i)
+			skeleton->AddJoint("Joint" + ConvertToString(i), i - 1);
+		return skeleton;
+	}
+
+	// Create an animation with random keyframes, the last joint is not animated
+	static Ref<SkeletalAnimation> sCreateAnimation(uint32 inSeed, bool inSharedKeyTimes)
+	{
+		default_random_engine random(inSeed);
+		uniform_real_distribution<float> value(-1.0f, 1.0f);
+		uniform_real_distribution<float> time_step(0.1f, 0.5f);
+
+		Ref<SkeletalAnimation> animation = new SkeletalAnimation;
+		SkeletalAnimation::AnimatedJointVector &joints = animation->GetAnimatedJoints();
+		joints.resize(cNumJoints - 1);
+		for (int j = 0; j < cNumJoints - 1; ++j)
+		{
+			SkeletalAnimation::AnimatedJoint &joint = joints[j];
+			joint.mJointName = "Joint" + ConvertToString(j);
+			joint.mKeyframes.resize(inSharedKeyTimes? 4 : 3 + j);
+			float time = 0.0f;
+			for (SkeletalAnimation::Keyframe &k : joint.mKeyframes)
+			{
+				k.mTime = time;
+				k.mTranslation = Vec3(value(random), value(random), value(random));
+				k.mRotation = Quat(value(random), value(random), value(random), value(random)).Normalized();
+				time += inSharedKeyTimes? 0.25f : time_step(random);
+			}
+
+			// Make sure all joints end at the same time
+			joint.mKeyframes.back().mTime = 1.0f;
+		}
+		return animation;
+	}
+
+	// Compare sampling through the sampler with sampling the animation directly
+	static void sCheckSample(bool inSharedKeyTimes)
+	{
+		Ref<Skeleton> skeleton = sCreateSkeleton();
+		Ref<SkeletalAnimation> animation = sCreateAnimation(1234, inSharedKeyTimes);
+		SkeletalAnimationSampler sampler(animation, skeleton);
+		CHECK(sampler.GetDuration() == 1.0f);
+
+		// Give the joint that is not animated a known state
+		SkeletonPose expected, actual;
+		expected.SetSkeleton(skeleton);
+		expected.GetJoint(cNumJoints - 1).mTranslation = Vec3(1, 2, 3);
+		actual = expected;
+
+		for (float time : { 0.0f, 0.1f, 0.25f, 0.3f, 0.77f, 1.0f, 1.6f, 3.95f })
+		{
+			animation->Sample(time, expected);
+			sampler.Sample(time, actual);
+			for (int j = 0; j < cNumJoints; ++j)
+			{
+				CHECK_APPROX_EQUAL(actual.GetJoint(j).mTranslation, expected.GetJoint(j).mTranslation, 1.0e-5f);
+				CHECK_APPROX_EQUAL(actual.GetJoint(j).mRotation, expected.GetJoint(j).mRotation, 1.0e-4f);
+			}
+		}
+		CHECK(actual.GetJoint(cNumJoints - 1).mTranslation == Vec3(1, 2, 3));
+	}
+
+	TEST_CASE("TestSampleSharedKeyTimes")
+	{
+		sCheckSample(true);
+	}
+
+	TEST_CASE("TestSampleDifferentKeyTimes")
+	{
+		sCheckSample(false);
+	}
+
+	TEST_CASE("TestSampleAndBlend")
+	{
+		Ref<Skeleton> skeleton = sCreateSkeleton();
+		Ref<SkeletalAnimation> animation1 = sCreateAnimation(1, true);
+		Ref<SkeletalAnimation> animation2 = sCreateAnimation(2, false);
+		SkeletalAnimationSampler sampler1(animation1, skeleton);
+		SkeletalAnimationSampler sampler2(animation2, skeleton);
+
+		SkeletonPose pose1, pose2, blended;
+		pose1.SetSkeleton(skeleton);
+		pose2.SetSkeleton(skeleton);
+		blended.SetSkeleton(skeleton);
+		sampler1.Sample(0.3f, pose1);
+		sampler2.Sample(0.6f, pose2);
+
+		// A single animation with a non zero weight should give the same pose as sampling it
+		SkeletalAnimationSampler::BlendInput inputs[] = { { &sampler1, 0.3f, 0.0f }, { &sampler2, 0.6f, 2.0f } };
+		SkeletalAnimationSampler::sSampleAndBlend(inputs, 2, blended);
+		for (int j = 0; j < cNumJoints; ++j)
+		{
+			CHECK_APPROX_EQUAL(blended.GetJoint(j).mTranslation, pose2.GetJoint(j).mTranslation, 1.0e-5f);
+			CHECK_APPROX_EQUAL(blended.GetJoint(j).mRotation, pose2.GetJoint(j).mRotation, 1.0e-5f);
+		}
+
+		// Blending two animations with equal weight should average translations and give a rotation halfway between the two
+		inputs[0].mWeight = 1.0f;
+		inputs[1].mWeight = 1.0f;
+		SkeletalAnimationSampler::sSampleAndBlend(inputs, 2, blended);
+		for (int j = 0; j < cNumJoints - 1; ++j)
+		{
+			const SkeletonPose::JointState &joint1 = pose1.GetJoint(j), &joint2 = pose2.GetJoint(j), &joint = blended.GetJoint(j);
+			CHECK_APPROX_EQUAL(joint.mTranslation, 0.5f * (joint1.mTranslation + joint2.mTranslation), 1.0e-5f);
+			CHECK(joint.mRotation.IsNormalized());
+			CHECK_APPROX_EQUAL(joint.mRotation, joint1.mRotation.SLERP(joint2.mRotation, 0.5f).Normalized(), 1.0e-4f);
+		}
+	}
+
+	TEST_CASE("TestJointNameLookupAfterReallocation")
+	{
+		// Add enough joints so that the joint array is reallocated several times, short names are stored inside the joint so they move with it
+		Ref<Skeleton> skeleton = new Skeleton;
+		for (int i = 0; i < 100; ++i)
+			CHECK(skeleton->AddJoint("J" + ConvertToString(i), i - 1) == i);
+
+		for (int i = 0; i < 100; ++i)
+			CHECK(skeleton->GetJointIndex("J" + ConvertToString(i)) == i);
+		CHECK(skeleton->GetJointIndex("J100") == -1);
+	}
+}